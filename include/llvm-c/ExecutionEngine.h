@@ -40,6 +40,7 @@ void LLVMLinkInInterpreter(void);
 typedef struct LLVMOpaqueGenericValue *LLVMGenericValueRef;
 typedef struct LLVMOpaqueExecutionEngine *LLVMExecutionEngineRef;
 typedef struct LLVMOpaqueMCJITMemoryManager *LLVMMCJITMemoryManagerRef;
+typedef struct LLVMOpaqueObjectCache *LLVMObjectCacheRef;
 
 struct LLVMMCJITCompilerOptions {
   unsigned OptLevel;
@@ -206,6 +207,31 @@ LLVMMCJITMemoryManagerRef LLVMCreateSimpleMCJITMemoryManager(
 
 void LLVMDisposeMCJITMemoryManager(LLVMMCJITMemoryManagerRef MM);
 
+/*===-- Operations on object caches ---------------------------------------===*/
+
+/**
+ * Create a cache that keeps the objects compiled by an MCJIT execution engine
+ * in files in CacheDir, so that later runs and other processes compiling the
+ * same module the same way can load them instead of compiling it again.
+ *
+ * @param CacheDir The directory to keep the objects in, which is created if
+ *   it does not exist.
+ * @param MaxSize If not zero, the least recently used objects are removed
+ *   when the objects in CacheDir take more than MaxSize bytes.
+ */
+LLVMObjectCacheRef LLVMCreateFileObjectCache(const char *CacheDir,
+                                             uint64_t MaxSize);
+
+/**
+ * Make an MCJIT execution engine look up and store the objects it compiles in
+ * Cache, or stop using a cache if Cache is NULL.  The engine does not take
+ * ownership of the cache, which must outlive it.
+ */
+void LLVMSetExecutionEngineObjectCache(LLVMExecutionEngineRef EE,
+                                       LLVMObjectCacheRef Cache);
+
+void LLVMDisposeObjectCache(LLVMObjectCacheRef Cache);
+
 /**
  * @}
  */
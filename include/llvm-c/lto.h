@@ -40,7 +40,7 @@ typedef bool lto_bool_t;
  * @{
  */
 
-#define LTO_API_VERSION 17
+#define LTO_API_VERSION 18
 
 /**
  * \since prior to LTO_API_VERSION=3
@@ -478,6 +478,42 @@ lto_codegen_compile(lto_code_gen_t cg, size_t* length);
 extern lto_bool_t
 lto_codegen_compile_to_file(lto_code_gen_t cg, const char** name);
 
+/**
+ * Sets the number of native object files code generation produces. The
+ * merged module is split into that many partitions, which are compiled in
+ * parallel. The default is 1.
+ *
+ * With more than one partition, lto_codegen_compile() and
+ * lto_codegen_compile_optimized() return the first object file, and
+ * lto_codegen_get_object() returns the others. The linker must link all of
+ * them. lto_codegen_compile_to_file() does not support more than one
+ * partition.
+ *
+ * \since LTO_API_VERSION=18
+ */
+extern void
+lto_codegen_set_parallelism(lto_code_gen_t cg, unsigned int parallelism);
+
+/**
+ * Returns the number of native object files the last call to
+ * lto_codegen_compile() or lto_codegen_compile_optimized() generated.
+ *
+ * \since LTO_API_VERSION=18
+ */
+extern unsigned int
+lto_codegen_get_num_objects(lto_code_gen_t cg);
+
+/**
+ * Returns the native object file at the given index, which must be less
+ * than lto_codegen_get_num_objects(), and sets length to its size. The
+ * buffer is owned by the lto_code_gen_t and is freed as the one
+ * lto_codegen_compile() returns is.
+ *
+ * \since LTO_API_VERSION=18
+ */
+extern const void*
+lto_codegen_get_object(lto_code_gen_t cg, unsigned int index, size_t* length);
+
 /**
  * Runs optimization for the merged module. Returns true on error.
  *
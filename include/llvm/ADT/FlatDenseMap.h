@@ -0,0 +1,528 @@
+//===- llvm/ADT/FlatDenseMap.h - Control byte probed hash table -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the FlatDenseMap class, an alternative to DenseMap that
+// keeps a byte of metadata per bucket in a separate array and probes it a
+// group of buckets at a time.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_ADT_FLATDENSEMAP_H
+#define LLVM_ADT_FLATDENSEMAP_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/EpochTracker.h"
+#include "llvm/Support/Compiler.h"
+#include "llvm/Support/MathExtras.h"
+#include <cassert>
+#include <cstring>
+#include <iterator>
+#include <new>
+#include <utility>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace llvm {
+
+namespace detail {
+/// The control bytes of a group of consecutive FlatDenseMap buckets.
+///
+/// An empty bucket has the control byte Empty, and a full bucket holds 7 bits
+/// of its key's hash value, so that a probe only compares the keys of the
+/// buckets whose hash bits match.
+class FlatDenseMapGroup {
+  const uint8_t *Ctrl;
+
+public:
+  enum : uint8_t { Empty = 0x80 };
+  enum : unsigned { Width = 16 };
+
+  explicit FlatDenseMapGroup(const uint8_t *Ctrl) : Ctrl(Ctrl) {}
+
+  /// Return a mask with bit I set if bucket I of the group has the control
+  /// byte \p C.
+  unsigned match(uint8_t C) const {
+#if defined(__SSE2__)
+    __m128i Bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(Ctrl));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(Bytes, _mm_set1_epi8(C)));
+#else
+    unsigned Mask = 0;
+    for (unsigned I = 0; I != Width; ++I)
+      Mask |= unsigned(Ctrl[I] == C) << I;
+    return Mask;
+#endif
+  }
+
+  /// Return a mask of the empty buckets of the group.
+  unsigned matchEmpty() const {
+#if defined(__SSE2__)
+    // Only Empty has the sign bit set.
+    __m128i Bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(Ctrl));
+    return _mm_movemask_epi8(Bytes);
+#else
+    return match(Empty);
+#endif
+  }
+};
+} // end namespace detail
+
+template <typename KeyT, typename ValueT, typename KeyInfoT, typename BucketT,
+          bool IsConst = false>
+class FlatDenseMapIterator;
+
+/// \brief A hash map with the interface of DenseMap that probes a separate
+/// array of control bytes instead of the buckets.
+///
+/// Lookups load the control bytes of 16 buckets at a time and compare them
+/// against 7 bits of the key's hash value at once (with SSE2 where
+/// available), so that they rarely touch a bucket that does not hold the
+/// key. The buckets are probed linearly, and erasing an element shifts the
+/// elements after it back instead of leaving a tombstone, so lookups never
+/// slow down after many erasures. Unlike with DenseMap, KeyInfoT does not
+/// need to provide empty and tombstone keys.
+///
+/// Because erase() moves elements, it invalidates all iterators and
+/// references into the map, not just those to the erased element.
+template <typename KeyT, typename ValueT,
+          typename KeyInfoT = DenseMapInfo<KeyT>,
+          typename BucketT = detail::DenseMapPair<KeyT, ValueT>>
+class FlatDenseMap : public DebugEpochBase {
+  typedef detail::FlatDenseMapGroup Group;
+
+  /// The buckets, followed by NumBuckets control bytes and copies of the
+  /// first Group::Width - 1 of them, so that a group can be loaded from any
+  /// bucket without wrapping around.
+  BucketT *Buckets;
+  uint8_t *Ctrl;
+  unsigned NumBuckets;
+  unsigned NumEntries;
+
+public:
+  typedef unsigned size_type;
+  typedef KeyT key_type;
+  typedef ValueT mapped_type;
+  typedef BucketT value_type;
+
+  typedef FlatDenseMapIterator<KeyT, ValueT, KeyInfoT, BucketT> iterator;
+  typedef FlatDenseMapIterator<KeyT, ValueT, KeyInfoT, BucketT, true>
+      const_iterator;
+
+  explicit FlatDenseMap(unsigned InitialReserve = 0)
+      : Buckets(nullptr), Ctrl(nullptr), NumBuckets(0), NumEntries(0) {
+    reserve(InitialReserve);
+  }
+
+  FlatDenseMap(const FlatDenseMap &Other) : FlatDenseMap(Other.size()) {
+    for (const BucketT &B : Other)
+      insertUnique(B.getFirst(), B.getSecond());
+  }
+
+  FlatDenseMap(FlatDenseMap &&Other) : FlatDenseMap() { swap(Other); }
+
+  ~FlatDenseMap() {
+    destroyAll();
+    operator delete(Buckets);
+  }
+
+  FlatDenseMap &operator=(const FlatDenseMap &Other) {
+    if (&Other != this) {
+      FlatDenseMap Copy(Other);
+      swap(Copy);
+    }
+    return *this;
+  }
+
+  FlatDenseMap &operator=(FlatDenseMap &&Other) {
+    FlatDenseMap Tmp(std::move(Other));
+    swap(Tmp);
+    return *this;
+  }
+
+  void swap(FlatDenseMap &RHS) {
+    incrementEpoch();
+    RHS.incrementEpoch();
+    std::swap(Buckets, RHS.Buckets);
+    std::swap(Ctrl, RHS.Ctrl);
+    std::swap(NumBuckets, RHS.NumBuckets);
+    std::swap(NumEntries, RHS.NumEntries);
+  }
+
+  iterator begin() { return iterator(Buckets, Ctrl, Ctrl + NumBuckets, *this); }
+  iterator end() {
+    return iterator(Buckets + NumBuckets, Ctrl + NumBuckets,
+                    Ctrl + NumBuckets, *this);
+  }
+  const_iterator begin() const {
+    return const_iterator(Buckets, Ctrl, Ctrl + NumBuckets, *this);
+  }
+  const_iterator end() const {
+    return const_iterator(Buckets + NumBuckets, Ctrl + NumBuckets,
+                          Ctrl + NumBuckets, *this);
+  }
+
+  bool LLVM_ATTRIBUTE_UNUSED_RESULT empty() const { return NumEntries == 0; }
+  unsigned size() const { return NumEntries; }
+  unsigned getNumBuckets() const { return NumBuckets; }
+
+  /// Make room for \p NumElts elements without growing the table again.
+  void reserve(size_type NumElts) {
+    // Keep at least a quarter of the buckets empty, so that the runs of full
+    // buckets that probes and erasures walk through stay short.
+    if (NumElts == 0 || uint64_t(NumElts) * 4 <= uint64_t(NumBuckets) * 3)
+      return;
+    grow(NextPowerOf2((uint64_t(NumElts) * 4 + 2) / 3 - 1));
+  }
+
+  void clear() {
+    incrementEpoch();
+    if (NumEntries == 0)
+      return;
+    destroyAll();
+    std::memset(Ctrl, Group::Empty, NumBuckets + Group::Width - 1);
+    NumEntries = 0;
+  }
+
+  /// Return 1 if the specified key is in the map, 0 otherwise.
+  size_type count(const KeyT &Key) const {
+    unsigned BucketNo;
+    return lookupBucketFor(Key, getHash(Key), BucketNo) ? 1 : 0;
+  }
+
+  iterator find(const KeyT &Key) {
+    unsigned BucketNo;
+    if (lookupBucketFor(Key, getHash(Key), BucketNo))
+      return makeIterator(BucketNo);
+    return end();
+  }
+  const_iterator find(const KeyT &Key) const {
+    unsigned BucketNo;
+    if (lookupBucketFor(Key, getHash(Key), BucketNo))
+      return makeIterator(BucketNo);
+    return end();
+  }
+
+  /// Return the value for the specified key, or a default constructed value
+  /// if there is none.
+  ValueT lookup(const KeyT &Key) const {
+    unsigned BucketNo;
+    if (lookupBucketFor(Key, getHash(Key), BucketNo))
+      return Buckets[BucketNo].getSecond();
+    return ValueT();
+  }
+
+  /// Insert \p KV into the map if its key is not already in the map. Return
+  /// an iterator to the element with the key, and whether it was inserted.
+  std::pair<iterator, bool> insert(const std::pair<KeyT, ValueT> &KV) {
+    return tryEmplace(KV.first, KV.second);
+  }
+  std::pair<iterator, bool> insert(std::pair<KeyT, ValueT> &&KV) {
+    return tryEmplace(std::move(KV.first), std::move(KV.second));
+  }
+
+  ValueT &operator[](const KeyT &Key) { return tryEmplace(Key).first->second; }
+  ValueT &operator[](KeyT &&Key) {
+    return tryEmplace(std::move(Key)).first->second;
+  }
+
+  /// Erase the element with the specified key. Return true if there was one.
+  bool erase(const KeyT &Key) {
+    unsigned BucketNo;
+    if (!lookupBucketFor(Key, getHash(Key), BucketNo))
+      return false;
+    eraseBucket(BucketNo);
+    return true;
+  }
+  void erase(iterator I) { eraseBucket(I.getBucket() - Buckets); }
+
+  /// Return the approximate size (in bytes) of the actual map.
+  /// This is just the raw memory used by FlatDenseMap.
+  /// If entries are pointers to objects, the size of the referenced objects
+  /// are not included.
+  size_t getMemorySize() const {
+    return NumBuckets ? getAllocationSize(NumBuckets) : 0;
+  }
+
+private:
+  static size_t getAllocationSize(unsigned NumBuckets) {
+    return NumBuckets * sizeof(BucketT) + NumBuckets + Group::Width - 1;
+  }
+
+  static unsigned getHash(const KeyT &Key) {
+    return KeyInfoT::getHashValue(Key);
+  }
+  /// Use the low bits of the hash value for the home bucket, as DenseMap
+  /// does, since DenseMapInfo hashes are made for that.
+  static unsigned getHomeBucket(unsigned Hash, unsigned NumBuckets) {
+    return Hash & (NumBuckets - 1);
+  }
+  /// Take the control byte from the high bits of the hash value multiplied
+  /// by a large odd constant, so that it depends on all of its bits and is
+  /// mostly unrelated to the home bucket.
+  static uint8_t getControlByte(unsigned Hash) {
+    return (Hash * 0x9e3779b9U) >> 25;
+  }
+
+  void setControlByte(unsigned BucketNo, uint8_t C) {
+    Ctrl[BucketNo] = C;
+    if (BucketNo < Group::Width - 1)
+      Ctrl[NumBuckets + BucketNo] = C;
+  }
+
+  iterator makeIterator(unsigned BucketNo) {
+    return iterator(Buckets + BucketNo, Ctrl + BucketNo, Ctrl + NumBuckets,
+                    *this, true);
+  }
+  const_iterator makeIterator(unsigned BucketNo) const {
+    return const_iterator(Buckets + BucketNo, Ctrl + BucketNo,
+                          Ctrl + NumBuckets, *this, true);
+  }
+
+  /// Look up the bucket that holds \p Key, whose hash is \p Hash. If the key
+  /// is in the map, set \p BucketNo to its bucket and return true. Otherwise
+  /// set \p BucketNo to the empty bucket the key would go in.
+  bool lookupBucketFor(const KeyT &Key, unsigned Hash,
+                       unsigned &BucketNo) const {
+    if (NumBuckets == 0)
+      return false;
+    const uint8_t C = getControlByte(Hash);
+    const unsigned Mask = NumBuckets - 1;
+    unsigned First = getHomeBucket(Hash, NumBuckets);
+    // Most keys are in their home bucket, which is cheaper to check on its
+    // own than as part of a group.
+    if (Ctrl[First] == C && KeyInfoT::isEqual(Key, Buckets[First].getFirst())) {
+      BucketNo = First;
+      return true;
+    }
+    while (true) {
+      Group G(Ctrl + First);
+      for (unsigned Match = G.match(C); Match; Match &= Match - 1) {
+        unsigned I = (First + countTrailingZeros(Match)) & Mask;
+        if (LLVM_LIKELY(KeyInfoT::isEqual(Key, Buckets[I].getFirst()))) {
+          BucketNo = I;
+          return true;
+        }
+      }
+      // Probes stop at the first empty bucket, which is where the key would
+      // have been inserted.
+      if (unsigned Empty = G.matchEmpty()) {
+        BucketNo = (First + countTrailingZeros(Empty)) & Mask;
+        return false;
+      }
+      First = (First + Group::Width) & Mask;
+    }
+  }
+
+  /// Return the first empty bucket of the probe sequence of \p Hash.
+  unsigned findEmptyBucket(unsigned Hash) const {
+    const unsigned Mask = NumBuckets - 1;
+    unsigned First = getHomeBucket(Hash, NumBuckets);
+    while (true) {
+      if (unsigned Empty = Group(Ctrl + First).matchEmpty())
+        return (First + countTrailingZeros(Empty)) & Mask;
+      First = (First + Group::Width) & Mask;
+    }
+  }
+
+  template <typename KeyArg, typename... ValueArgs>
+  std::pair<iterator, bool> tryEmplace(KeyArg &&Key, ValueArgs &&... Values) {
+    unsigned Hash = getHash(Key);
+    unsigned BucketNo;
+    if (lookupBucketFor(Key, Hash, BucketNo))
+      return std::make_pair(makeIterator(BucketNo), false);
+
+    incrementEpoch();
+    if (NumBuckets == 0 || (NumEntries + 1) * 4 > NumBuckets * 3) {
+      grow(NumBuckets ? NumBuckets * 2 : Group::Width);
+      BucketNo = findEmptyBucket(Hash);
+    }
+    constructBucket(BucketNo, Hash, std::forward<KeyArg>(Key),
+                    std::forward<ValueArgs>(Values)...);
+    return std::make_pair(makeIterator(BucketNo), true);
+  }
+
+  /// Insert a key that is known not to be in the map, into a map that is
+  /// known to have room for it.
+  template <typename KeyArg, typename... ValueArgs>
+  void insertUnique(KeyArg &&Key, ValueArgs &&... Values) {
+    unsigned Hash = getHash(Key);
+    constructBucket(findEmptyBucket(Hash), Hash, std::forward<KeyArg>(Key),
+                    std::forward<ValueArgs>(Values)...);
+  }
+
+  template <typename KeyArg, typename... ValueArgs>
+  void constructBucket(unsigned BucketNo, unsigned Hash, KeyArg &&Key,
+                       ValueArgs &&... Values) {
+    BucketT &B = Buckets[BucketNo];
+    ::new (&B.getFirst()) KeyT(std::forward<KeyArg>(Key));
+    ::new (&B.getSecond()) ValueT(std::forward<ValueArgs>(Values)...);
+    setControlByte(BucketNo, getControlByte(Hash));
+    ++NumEntries;
+  }
+
+  /// Erase the element in bucket \p BucketNo, and move back the elements
+  /// after it that can be found sooner, so that no probe sequence goes
+  /// through the emptied bucket.
+  void eraseBucket(unsigned BucketNo) {
+    incrementEpoch();
+    const unsigned Mask = NumBuckets - 1;
+    unsigned Hole = BucketNo;
+    for (unsigned I = (Hole + 1) & Mask; Ctrl[I] != Group::Empty;
+         I = (I + 1) & Mask) {
+      // The element in bucket I can move to the hole if the hole is between
+      // its home bucket and I.
+      unsigned Home =
+          getHomeBucket(getHash(Buckets[I].getFirst()), NumBuckets);
+      if (((I - Home) & Mask) < ((I - Hole) & Mask))
+        continue;
+      Buckets[Hole].getFirst() = std::move(Buckets[I].getFirst());
+      Buckets[Hole].getSecond() = std::move(Buckets[I].getSecond());
+      setControlByte(Hole, Ctrl[I]);
+      Hole = I;
+    }
+    Buckets[Hole].getSecond().~ValueT();
+    Buckets[Hole].getFirst().~KeyT();
+    setControlByte(Hole, Group::Empty);
+    --NumEntries;
+  }
+
+  void destroyAll() {
+    for (unsigned I = 0; I != NumBuckets; ++I)
+      if (Ctrl[I] != Group::Empty) {
+        Buckets[I].getSecond().~ValueT();
+        Buckets[I].getFirst().~KeyT();
+      }
+  }
+
+  /// Reallocate the table with \p NewNumBuckets buckets, a power of two of at
+  /// least Group::Width, and reinsert the elements.
+  void grow(unsigned NewNumBuckets) {
+    incrementEpoch();
+    if (NewNumBuckets < Group::Width)
+      NewNumBuckets = Group::Width;
+    assert(isPowerOf2_32(NewNumBuckets) && NewNumBuckets > NumEntries);
+
+    BucketT *OldBuckets = Buckets;
+    uint8_t *OldCtrl = Ctrl;
+    unsigned OldNumBuckets = NumBuckets;
+
+    Buckets =
+        static_cast<BucketT *>(operator new(getAllocationSize(NewNumBuckets)));
+    Ctrl = reinterpret_cast<uint8_t *>(Buckets + NewNumBuckets);
+    NumBuckets = NewNumBuckets;
+    std::memset(Ctrl, Group::Empty, NumBuckets + Group::Width - 1);
+    NumEntries = 0;
+
+    for (unsigned I = 0; I != OldNumBuckets; ++I)
+      if (OldCtrl[I] != Group::Empty) {
+        BucketT &B = OldBuckets[I];
+        insertUnique(std::move(B.getFirst()), std::move(B.getSecond()));
+        B.getSecond().~ValueT();
+        B.getFirst().~KeyT();
+      }
+    operator delete(OldBuckets);
+  }
+};
+
+template <typename KeyT, typename ValueT, typename KeyInfoT, typename BucketT,
+          bool IsConst>
+class FlatDenseMapIterator : DebugEpochBase::HandleBase {
+  typedef FlatDenseMapIterator<KeyT, ValueT, KeyInfoT, BucketT, true>
+      ConstIterator;
+  friend class FlatDenseMapIterator<KeyT, ValueT, KeyInfoT, BucketT, true>;
+  friend class FlatDenseMapIterator<KeyT, ValueT, KeyInfoT, BucketT, false>;
+  friend class FlatDenseMap<KeyT, ValueT, KeyInfoT, BucketT>;
+
+public:
+  typedef ptrdiff_t difference_type;
+  typedef typename std::conditional<IsConst, const BucketT, BucketT>::type
+      value_type;
+  typedef value_type *pointer;
+  typedef value_type &reference;
+  typedef std::forward_iterator_tag iterator_category;
+
+private:
+  pointer Ptr;
+  const uint8_t *Ctrl, *End;
+
+  pointer getBucket() const { return Ptr; }
+
+public:
+  FlatDenseMapIterator() : Ptr(nullptr), Ctrl(nullptr), End(nullptr) {}
+
+  FlatDenseMapIterator(pointer Pos, const uint8_t *Ctrl, const uint8_t *End,
+                       const DebugEpochBase &Epoch, bool NoAdvance = false)
+      : DebugEpochBase::HandleBase(&Epoch), Ptr(Pos), Ctrl(Ctrl), End(End) {
+    assert(isHandleInSync() && "invalid construction!");
+    if (!NoAdvance)
+      AdvancePastEmptyBuckets();
+  }
+
+  // Converting ctor from non-const iterators to const iterators. SFINAE'd out
+  // for const iterator destinations so it doesn't end up as a user defined
+  // copy constructor.
+  template <bool IsConstSrc,
+            typename = typename std::enable_if<!IsConstSrc && IsConst>::type>
+  FlatDenseMapIterator(
+      const FlatDenseMapIterator<KeyT, ValueT, KeyInfoT, BucketT, IsConstSrc>
+          &I)
+      : DebugEpochBase::HandleBase(I), Ptr(I.Ptr), Ctrl(I.Ctrl), End(I.End) {}
+
+  reference operator*() const {
+    assert(isHandleInSync() && "invalid iterator access!");
+    return *Ptr;
+  }
+  pointer operator->() const {
+    assert(isHandleInSync() && "invalid iterator access!");
+    return Ptr;
+  }
+
+  bool operator==(const ConstIterator &RHS) const {
+    assert((!Ptr || isHandleInSync()) && "handle not in sync!");
+    assert((!RHS.Ptr || RHS.isHandleInSync()) && "handle not in sync!");
+    assert(getEpochAddress() == RHS.getEpochAddress() &&
+           "comparing incomparable iterators!");
+    return Ptr == RHS.Ptr;
+  }
+  bool operator!=(const ConstIterator &RHS) const {
+    return !(*this == RHS);
+  }
+
+  FlatDenseMapIterator &operator++() { // Preincrement
+    assert(isHandleInSync() && "invalid iterator access!");
+    ++Ptr;
+    ++Ctrl;
+    AdvancePastEmptyBuckets();
+    return *this;
+  }
+  FlatDenseMapIterator operator++(int) { // Postincrement
+    assert(isHandleInSync() && "invalid iterator access!");
+    FlatDenseMapIterator Tmp = *this;
+    ++*this;
+    return Tmp;
+  }
+
+private:
+  void AdvancePastEmptyBuckets() {
+    while (Ctrl != End && *Ctrl == detail::FlatDenseMapGroup::Empty) {
+      ++Ptr;
+      ++Ctrl;
+    }
+  }
+};
+
+template <typename KeyT, typename ValueT, typename KeyInfoT>
+static inline size_t
+capacity_in_bytes(const FlatDenseMap<KeyT, ValueT, KeyInfoT> &X) {
+  return X.getMemorySize();
+}
+
+} // end namespace llvm
+
+#endif
@@ -42,7 +42,8 @@ class StringMapImpl {
 protected:
   // Array of NumBuckets pointers to entries, null pointers are holes.
   // TheTable[NumBuckets] contains a sentinel value for easy iteration. Followed
-  // by an array of the actual hash values as unsigned integers.
+  // by an array of the actual hash values as unsigned integers, and by an
+  // array of control bytes that is probed a group of buckets at a time.
   StringMapEntryBase **TheTable;
   unsigned NumBuckets;
   unsigned NumItems;
@@ -85,8 +86,14 @@ protected:
   /// RemoveKey - Remove the StringMapEntry for the specified key from the
   /// table, returning it.  If the key is not in the table, this returns null.
   StringMapEntryBase *RemoveKey(StringRef Key);
+
+  /// resetBuckets - Mark all buckets as empty, once their entries have been
+  /// destroyed.
+  void resetBuckets();
 private:
   void init(unsigned Size);
+  unsigned *getHashTable() const;
+  uint8_t *getControlBytes() const;
 public:
   static StringMapEntryBase *getTombstoneVal() {
     return (StringMapEntryBase*)-1;
@@ -340,15 +347,13 @@ public:
     // Zap all values, resetting the keys back to non-present (not tombstone),
     // which is safe because we're removing all elements.
     for (unsigned I = 0, E = NumBuckets; I != E; ++I) {
-      StringMapEntryBase *&Bucket = TheTable[I];
+      StringMapEntryBase *Bucket = TheTable[I];
       if (Bucket && Bucket != getTombstoneVal()) {
         static_cast<MapEntryTy*>(Bucket)->Destroy(Allocator);
       }
-      Bucket = nullptr;
     }
 
-    NumItems = 0;
-    NumTombstones = 0;
+    resetBuckets();
   }
 
   /// remove - Remove the specified key/value pair from the map, but do not
@@ -0,0 +1,411 @@
+//===- MemorySSA.h - Build Memory SSA ---------------------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file exposes an interface to building and using memory SSA, an SSA
+// form of the memory state of a function that passes can keep up to date
+// instead of asking MemoryDependenceAnalysis again after each change.
+//
+// Each instruction that may write memory gets a MemoryDef, each instruction
+// that may only read it gets a MemoryUse, and each block where the memory
+// states of several predecessors meet gets a MemoryPhi.  Every MemoryUse and
+// MemoryDef points to the access defining the memory state it sees, and the
+// memory state on entry to the function is defined by a special MemoryDef,
+// the live on entry def.  For example:
+//
+//   define void @foo(i32* %a, i32* %b) {
+//   entry:
+//   ; 1 = MemoryDef(liveOnEntry)
+//     store i32 0, i32* %a
+//   ; MemoryUse(1)
+//     %v = load i32, i32* %b
+//   ...
+//
+// There is a single memory state: as far as the form is concerned, a
+// MemoryDef clobbers all of memory.  Finding the access that actually
+// clobbers a given location is the job of the MemorySSAWalker, which walks up
+// the defs skipping those that do not alias the location, and caches what it
+// finds, so that asking again about the same access is cheap.
+//
+// Only LICM uses memory SSA so far, under -enable-mssa-loop-dependency. GVN,
+// DSE and MemCpyOpt still query MemoryDependenceAnalysis, and so still pay
+// for its linear block scans.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_ANALYSIS_MEMORYSSA_H
+#define LLVM_ANALYSIS_MEMORYSSA_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/ilist.h"
+#include "llvm/ADT/ilist_node.h"
+#include "llvm/ADT/iterator_range.h"
+#include "llvm/Analysis/MemoryLocation.h"
+#include "llvm/Pass.h"
+#include <memory>
+
+namespace llvm {
+
+class AliasAnalysis;
+class BasicBlock;
+class DominatorTree;
+class Function;
+class Instruction;
+class MemorySSAWalker;
+class raw_ostream;
+
+/// \brief Whether MemorySSA is verified after the passes that update it.
+extern bool VerifyMemorySSA;
+
+/// \brief The base class of the accesses of memory SSA.
+///
+/// Accesses are kept in a list per basic block, in the order of the
+/// instructions they stand for, and know which accesses use them, so that an
+/// access can be replaced by another.
+class MemoryAccess : public ilist_node<MemoryAccess> {
+  MemoryAccess(const MemoryAccess &) = delete;
+  void operator=(const MemoryAccess &) = delete;
+
+public:
+  enum MemoryAccessKind { MemoryUseKind, MemoryDefKind, MemoryPhiKind };
+
+  virtual ~MemoryAccess();
+
+  MemoryAccessKind getKind() const { return Kind; }
+  BasicBlock *getBlock() const { return Block; }
+
+  typedef SmallPtrSetImpl<MemoryAccess *>::const_iterator user_iterator;
+  user_iterator user_begin() const { return Users.begin(); }
+  user_iterator user_end() const { return Users.end(); }
+  iterator_range<user_iterator> users() const {
+    return iterator_range<user_iterator>(user_begin(), user_end());
+  }
+  bool use_empty() const { return Users.empty(); }
+
+  void print(raw_ostream &OS) const;
+  void dump() const;
+
+protected:
+  friend class MemorySSA;
+  friend class MemoryUseOrDef;
+  friend class MemoryPhi;
+
+  MemoryAccess(MemoryAccessKind Kind, BasicBlock *BB)
+      : Kind(Kind), Block(BB) {}
+
+  void addUser(MemoryAccess *U) { Users.insert(U); }
+  void removeUser(MemoryAccess *U) { Users.erase(U); }
+
+  /// \brief Make all the users of this access use \p New instead.
+  void replaceAllUsesWith(MemoryAccess *New);
+
+private:
+  MemoryAccessKind Kind;
+  BasicBlock *Block;
+  SmallPtrSet<MemoryAccess *, 4> Users;
+};
+
+inline raw_ostream &operator<<(raw_ostream &OS, const MemoryAccess &MA) {
+  MA.print(OS);
+  return OS;
+}
+
+/// \brief The access of an instruction: a MemoryUse or a MemoryDef.
+class MemoryUseOrDef : public MemoryAccess {
+public:
+  /// \brief Return the instruction this access stands for, or null for the
+  /// live on entry def.
+  Instruction *getMemoryInst() const { return MemoryInst; }
+
+  /// \brief Return the access defining the memory state this access sees.
+  MemoryAccess *getDefiningAccess() const { return DefiningAccess; }
+
+  static bool classof(const MemoryAccess *MA) {
+    return MA->getKind() != MemoryPhiKind;
+  }
+
+protected:
+  friend class MemoryAccess;
+  friend class MemorySSA;
+
+  MemoryUseOrDef(MemoryAccessKind Kind, Instruction *MI, BasicBlock *BB)
+      : MemoryAccess(Kind, BB), MemoryInst(MI), DefiningAccess(nullptr) {}
+
+  void setDefiningAccess(MemoryAccess *DMA) {
+    if (DefiningAccess)
+      DefiningAccess->removeUser(this);
+    DefiningAccess = DMA;
+    if (DMA)
+      DMA->addUser(this);
+  }
+
+private:
+  Instruction *MemoryInst;
+  MemoryAccess *DefiningAccess;
+};
+
+/// \brief The access of an instruction that may read memory, but does not
+/// write it.
+class MemoryUse final : public MemoryUseOrDef {
+public:
+  MemoryUse(Instruction *MI, BasicBlock *BB)
+      : MemoryUseOrDef(MemoryUseKind, MI, BB) {}
+
+  static bool classof(const MemoryAccess *MA) {
+    return MA->getKind() == MemoryUseKind;
+  }
+};
+
+/// \brief The access of an instruction that may write memory, and so defines
+/// a new memory state.
+class MemoryDef final : public MemoryUseOrDef {
+public:
+  MemoryDef(Instruction *MI, BasicBlock *BB, unsigned ID)
+      : MemoryUseOrDef(MemoryDefKind, MI, BB), ID(ID) {}
+
+  /// \brief Return the number naming this def when printing. The live on
+  /// entry def is number zero.
+  unsigned getID() const { return ID; }
+
+  static bool classof(const MemoryAccess *MA) {
+    return MA->getKind() == MemoryDefKind;
+  }
+
+private:
+  unsigned ID;
+};
+
+/// \brief The memory state at the start of a block whose predecessors may
+/// see different memory states. There is one incoming access per
+/// predecessor edge, as for PHINode.
+class MemoryPhi final : public MemoryAccess {
+public:
+  MemoryPhi(BasicBlock *BB, unsigned ID)
+      : MemoryAccess(MemoryPhiKind, BB), ID(ID) {}
+
+  unsigned getID() const { return ID; }
+
+  unsigned getNumIncomingValues() const { return Incoming.size(); }
+  MemoryAccess *getIncomingValue(unsigned I) const {
+    return Incoming[I].first;
+  }
+  BasicBlock *getIncomingBlock(unsigned I) const {
+    return Incoming[I].second;
+  }
+
+  void addIncoming(MemoryAccess *V, BasicBlock *BB) {
+    Incoming.push_back(std::make_pair(V, BB));
+    V->addUser(this);
+  }
+
+  void setIncomingValue(unsigned I, MemoryAccess *V) {
+    MemoryAccess *Old = Incoming[I].first;
+    Incoming[I].first = V;
+    V->addUser(this);
+    if (!isIncomingValue(Old))
+      Old->removeUser(this);
+  }
+
+  static bool classof(const MemoryAccess *MA) {
+    return MA->getKind() == MemoryPhiKind;
+  }
+
+private:
+  friend class MemorySSA;
+
+  bool isIncomingValue(const MemoryAccess *V) const {
+    for (const auto &In : Incoming)
+      if (In.first == V)
+        return true;
+    return false;
+  }
+
+  void dropIncomingValues() {
+    for (const auto &In : Incoming)
+      In.first->removeUser(this);
+    Incoming.clear();
+  }
+
+  unsigned ID;
+  SmallVector<std::pair<MemoryAccess *, BasicBlock *>, 4> Incoming;
+};
+
+template <>
+struct ilist_traits<MemoryAccess> : public ilist_default_traits<MemoryAccess> {
+private:
+  mutable ilist_half_node<MemoryAccess> Sentinel;
+
+public:
+  MemoryAccess *createSentinel() const {
+    return static_cast<MemoryAccess *>(&Sentinel);
+  }
+  void destroySentinel(MemoryAccess *) const {}
+
+  MemoryAccess *provideInitialHead() const { return createSentinel(); }
+  MemoryAccess *ensureHead(MemoryAccess *) const { return createSentinel(); }
+  static void noteHead(MemoryAccess *, MemoryAccess *) {}
+};
+
+/// \brief Memory SSA of a function.
+///
+/// The form can be updated as instructions are moved and deleted, through
+/// removeMemoryAccess and createMemoryAccessInBB, which is cheaper than
+/// building it again.
+class MemorySSA {
+public:
+  MemorySSA(Function &F, AliasAnalysis &AA, DominatorTree &DT);
+  ~MemorySSA();
+
+  typedef iplist<MemoryAccess> AccessList;
+
+  /// \brief Return the walker finding the clobbering accesses of this form.
+  MemorySSAWalker *getWalker() { return Walker.get(); }
+
+  /// \brief Return the access of \p I, or null if \p I does not touch
+  /// memory.
+  MemoryUseOrDef *getMemoryAccess(const Instruction *I) const;
+
+  /// \brief Return the phi at the start of \p BB, if there is one.
+  MemoryPhi *getMemoryAccess(const BasicBlock *BB) const;
+
+  MemoryDef *getLiveOnEntryDef() const { return LiveOnEntryDef.get(); }
+  bool isLiveOnEntryDef(const MemoryAccess *MA) const {
+    return MA == LiveOnEntryDef.get();
+  }
+
+  /// \brief Return the accesses of \p BB in order, or null if it has none.
+  const AccessList *getBlockAccesses(const BasicBlock *BB) const {
+    auto It = PerBlockAccesses.find(BB);
+    return It == PerBlockAccesses.end() ? nullptr : It->second.get();
+  }
+
+  /// \brief Return true if \p Dominator dominates \p Dominatee. Accesses of
+  /// the same block are ordered by scanning the block.
+  bool dominates(const MemoryAccess *Dominator,
+                 const MemoryAccess *Dominatee) const;
+
+  enum InsertionPlace { Beginning, End };
+
+  /// \brief Create the access of \p I, an instruction that may read memory
+  /// but does not write it, at the beginning (after the phi) or at the end of
+  /// the accesses of \p BB, where \p I has been placed. Its defining access is
+  /// the memory state at that point. Return null if \p I does not touch
+  /// memory.
+  MemoryUseOrDef *createMemoryAccessInBB(Instruction *I, BasicBlock *BB,
+                                         InsertionPlace Point);
+
+  /// \brief Remove \p MA, whose instruction is about to be deleted or moved.
+  /// The users of a def see its defining access instead. A phi can only be
+  /// removed when all its incoming accesses are the same.
+  void removeMemoryAccess(MemoryAccess *MA);
+
+  /// \brief Throw the form away and build it again, after changes too large
+  /// to update it for.
+  void recalculate();
+
+  /// \brief Print the function annotated with its accesses.
+  void print(raw_ostream &OS) const;
+  void dump() const;
+
+  /// \brief Check that the accesses are in the order of their instructions,
+  /// that every access is dominated by its definitions, and that phis have
+  /// one incoming access per predecessor edge.
+  void verifyMemorySSA() const;
+
+private:
+  void buildMemorySSA();
+  MemoryUseOrDef *createNewAccess(Instruction *I);
+  AccessList &getOrCreateAccessList(BasicBlock *BB);
+  MemoryAccess *renameBlock(BasicBlock *BB, MemoryAccess *IncomingVal);
+  MemoryAccess *getReachingDefBefore(BasicBlock *BB,
+                                     AccessList::iterator Point) const;
+
+  Function &F;
+  AliasAnalysis &AA;
+  DominatorTree &DT;
+
+  /// The access of each instruction, and the phi of each block.
+  DenseMap<const Value *, MemoryAccess *> ValueToMemoryAccess;
+  DenseMap<const BasicBlock *, std::unique_ptr<AccessList>> PerBlockAccesses;
+  std::unique_ptr<MemoryDef> LiveOnEntryDef;
+  std::unique_ptr<MemorySSAWalker> Walker;
+  unsigned NextID;
+};
+
+/// \brief Finds the access clobbering the memory an instruction reads or
+/// writes, caching the answers.
+///
+/// The answer is the nearest access on the chain of definitions that may
+/// write the memory: a MemoryDef, the live on entry def, or a MemoryPhi where
+/// different clobbers meet. Walks are bounded, and give a nearer, more
+/// conservative answer when the bound is hit.
+///
+/// The answers for an instruction are cached under its access, so they stay
+/// valid until an access is removed, which forgets them. Queries for a bare
+/// location are not cached.
+class MemorySSAWalker {
+public:
+  MemorySSAWalker(MemorySSA &MSSA, AliasAnalysis &AA) : MSSA(MSSA), AA(AA) {}
+
+  /// \brief Return the access clobbering the memory \p I reads or writes,
+  /// skipping \p I itself.
+  MemoryAccess *getClobberingMemoryAccess(const Instruction *I);
+
+  /// \brief Return the access clobbering \p Loc in the memory state defined
+  /// by \p Start, which may be \p Start itself. The answer is not cached.
+  MemoryAccess *getClobberingMemoryAccess(MemoryAccess *Start,
+                                          const MemoryLocation &Loc);
+
+  /// \brief Forget the cached answers. MemorySSA calls this when an access
+  /// is removed.
+  void invalidateInfo() { CachedClobbers.clear(); }
+
+private:
+  struct Query;
+
+  MemoryAccess *walk(MemoryAccess *Start, Query &Q, unsigned &LowLink);
+  MemoryAccess *walkPhi(MemoryPhi *Phi, Query &Q, unsigned &LowLink);
+  MemoryAccess *doQuery(MemoryAccess *Start, Query &Q);
+  bool clobbers(const MemoryDef *MD, const Query &Q) const;
+  MemoryAccess *lookup(const MemoryAccess *MA, const Query &Q) const;
+  void cache(const MemoryAccess *MA, const Query &Q, MemoryAccess *Clobber);
+
+  MemorySSA &MSSA;
+  AliasAnalysis &AA;
+  /// Keyed by the access walked past and the access of the instruction
+  /// asking. The location, and whether ordered or volatile loads clobber,
+  /// both follow from the latter.
+  DenseMap<std::pair<const MemoryAccess *, const MemoryUseOrDef *>,
+           MemoryAccess *> CachedClobbers;
+};
+
+/// \brief Legacy analysis pass building the memory SSA of a function.
+class MemorySSAWrapperPass : public FunctionPass {
+public:
+  static char ID;
+
+  MemorySSAWrapperPass();
+
+  MemorySSA &getMSSA() { return *MSSA; }
+  const MemorySSA &getMSSA() const { return *MSSA; }
+
+  bool runOnFunction(Function &F) override;
+  void releaseMemory() override { MSSA.reset(); }
+  void getAnalysisUsage(AnalysisUsage &AU) const override;
+  void verifyAnalysis() const override;
+  void print(raw_ostream &OS, const Module *M = nullptr) const override;
+
+private:
+  std::unique_ptr<MemorySSA> MSSA;
+};
+
+} // end namespace llvm
+
+#endif
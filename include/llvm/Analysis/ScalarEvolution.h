@@ -260,6 +260,27 @@ namespace llvm {
     /// conditions dominating the backedge of a loop.
     bool WalkingBEDominatingConds;
 
+    /// WorkDone - The units of work spent analyzing the function so far, of
+    /// the budget set by -scalar-evolution-max-work. Once it is spent, new
+    /// values are left as SCEVUnknown and new trip counts as
+    /// SCEVCouldNotCompute.
+    unsigned WorkDone;
+
+    /// chargeWork - Spend one unit of work of the budget, returning false if
+    /// there was none left.
+    bool chargeWork();
+
+    /// NumPendingComputations - The number of expressions and trip counts
+    /// being computed. While there are some, results may be based on their
+    /// placeholders, which are weaker than the final values.
+    unsigned NumPendingComputations;
+
+    /// KnownPredicates - Memoized results from isKnownPredicate, keyed by the
+    /// canonicalized operands and predicate. Any forgotten result may have
+    /// fed into them, so they are all dropped whenever one is.
+    DenseMap<std::pair<std::pair<const SCEV *, const SCEV *>, unsigned>,
+             bool> KnownPredicates;
+
     /// ExitLimit - Information about the number of loop iterations for which a
     /// loop exit's branch condition evaluates to the not-taken path.  This is a
     /// temporary pair of exact and max expressions that are eventually
@@ -555,6 +576,11 @@ namespace llvm {
     Constant *getConstantEvolutionLoopExitValue(PHINode *PN, const APInt& BEs,
                                                 const Loop *L);
 
+    /// isKnownPredicateUncached - Compute isKnownPredicate for operands that
+    /// have already been canonicalized.
+    bool isKnownPredicateUncached(ICmpInst::Predicate Pred, const SCEV *LHS,
+                                  const SCEV *RHS);
+
     /// isKnownPredicateWithRanges - Test if the given expression is known to
     /// satisfy the condition described by Pred and the known constant ranges
     /// of LHS and RHS.
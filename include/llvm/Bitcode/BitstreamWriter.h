@@ -15,6 +15,7 @@
 #ifndef LLVM_BITCODE_BITSTREAMWRITER_H
 #define LLVM_BITCODE_BITSTREAMWRITER_H
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Bitcode/BitCodes.h"
@@ -99,6 +100,21 @@ public:
   /// \brief Retrieve the current position in the stream, in bits.
   uint64_t GetCurrentBitNo() const { return GetBufferOffset() * 8 + CurBit; }
 
+  /// \brief Overwrite the 32-bit fixed width field starting at bit \p BitNo
+  /// with \p NewWord.  The field must already have been flushed to the
+  /// output buffer, i.e. it must not overlap the word currently being filled.
+  void BackpatchFixed32(uint64_t BitNo, uint32_t NewWord) {
+    assert(BitNo + 32 <= GetBufferOffset() * 8 && "Field not flushed yet");
+    unsigned ByteNo = BitNo / 8, Shift = BitNo % 8;
+    uint64_t Mask = uint64_t(~0U) << Shift;
+    uint64_t Bits = uint64_t(NewWord) << Shift;
+    for (unsigned I = 0; I * 8 < Shift + 32; ++I) {
+      unsigned char ByteMask = Mask >> (I * 8);
+      char &Byte = Out[ByteNo + I];
+      Byte = (Byte & ~ByteMask) | ((Bits >> (I * 8)) & ByteMask);
+    }
+  }
+
   //===--------------------------------------------------------------------===//
   // Basic Primitives for emitting bits to the stream.
   //===--------------------------------------------------------------------===//
@@ -243,6 +259,24 @@ public:
     BlockScope.pop_back();
   }
 
+  /// \brief Emit a complete block whose body was encoded by another writer.
+  ///
+  /// \p Body is everything that follows the block size word, up to and
+  /// including the END_BLOCK and its alignment, so it must be a whole number
+  /// of 32-bit words.  The result is identical to entering the block,
+  /// emitting its records and exiting it on this stream, provided that the
+  /// other writer used the same block info abbreviations.
+  void EmitBlockWithBody(unsigned BlockID, unsigned CodeLen,
+                         ArrayRef<char> Body) {
+    assert((Body.size() & 3) == 0 && "Block body is not 32-bit aligned");
+    EmitCode(bitc::ENTER_SUBBLOCK);
+    EmitVBR(BlockID, bitc::BlockIDWidth);
+    EmitVBR(CodeLen, bitc::CodeLenWidth);
+    FlushToWord();
+    Emit(Body.size() / 4, bitc::BlockSizeWidth);
+    Out.append(Body.begin(), Body.end());
+  }
+
   //===--------------------------------------------------------------------===//
   // Record Emission
   //===--------------------------------------------------------------------===//
@@ -42,7 +42,9 @@ namespace bitc {
 
     TYPE_BLOCK_ID_NEW,
 
-    USELIST_BLOCK_ID
+    USELIST_BLOCK_ID,
+
+    FUNCTION_INDEX_BLOCK_ID
   };
 
 
@@ -73,6 +75,10 @@ namespace bitc {
 
     MODULE_CODE_GCNAME      = 11,  // GCNAME: [strchr x N]
     MODULE_CODE_COMDAT      = 12,  // COMDAT: [selection_kind, name]
+
+    // FNINDEX: [offset] - Offset, in 32-bit words from the start of the
+    // bitcode, of the FUNCTION_INDEX block that follows the function bodies.
+    MODULE_CODE_FNINDEX     = 13
   };
 
   /// PARAMATTR blocks have code for defining a parameter attribute set.
@@ -361,6 +367,14 @@ namespace bitc {
     USELIST_CODE_BB      = 2  // BB: [index..., bb-id]
   };
 
+  /// FUNCTION_INDEX blocks locate every function body of the module, so that
+  /// a lazy reader can jump straight to any of them.
+  enum FunctionIndexCodes {
+    // ENTRY: [valueid, offset] - Offset, in bits from the start of the
+    // bitcode, of the FUNCTION_BLOCK of the function with this value id.
+    FUNCTION_INDEX_CODE_ENTRY = 1
+  };
+
   enum AttributeKindCodes {
     // = 0 is unused
     ATTR_KIND_ALIGNMENT = 1,
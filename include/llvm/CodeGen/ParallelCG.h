@@ -0,0 +1,49 @@
+//===-- llvm/CodeGen/ParallelCG.h - Parallel code generation ----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This header declares functions that can be used for parallel code generation.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CODEGEN_PARALLELCG_H
+#define LLVM_CODEGEN_PARALLELCG_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/Target/TargetMachine.h"
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace llvm {
+
+class Module;
+class raw_pwrite_stream;
+
+/// Split M into OSs.size() partitions, and generate code for each partition on
+/// its own thread, writing the output for partition I to OSs[I]. Every
+/// partition is compiled in a fresh LLVMContext by a TargetMachine obtained
+/// from TMFactory, which must therefore be safe to call from several threads.
+/// The resulting output files, if linked together, are intended to be
+/// equivalent to the single output file that would have been code generated
+/// from M.
+///
+/// If OSs.size() == 1, M is compiled in place. Otherwise the local symbols of
+/// M are externalized by the split, so M should not be compiled again.
+///
+/// Returns true and sets ErrMsg if the target cannot emit FileType or a
+/// partition cannot be compiled; the output streams are then incomplete.
+bool splitCodeGen(
+    Module &M, ArrayRef<raw_pwrite_stream *> OSs,
+    const std::function<std::unique_ptr<TargetMachine>()> &TMFactory,
+    std::string &ErrMsg,
+    TargetMachine::CodeGenFileType FileType = TargetMachine::CGFT_ObjectFile);
+
+} // end namespace llvm
+
+#endif
@@ -0,0 +1,79 @@
+//===-- FileObjectCache.h - On-disk cache of compiled objects ---*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares FileObjectCache, an ObjectCache that keeps the objects
+// compiled by MCJIT or the ORC compile layer in a directory, so that they can
+// be reused by later runs and other processes.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_FILEOBJECTCACHE_H
+#define LLVM_EXECUTIONENGINE_FILEOBJECTCACHE_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/Support/FileCache.h"
+#include "llvm/Support/Mutex.h"
+#include <string>
+
+namespace llvm {
+
+class TargetMachine;
+
+/// FileObjectCache - An ObjectCache storing each object in a file of its own
+/// in a cache directory.  Objects are named after a hash of the bitcode of
+/// the module they were compiled from and of the configuration of the target
+/// machine that compiled them, so a cached object is only ever reused for an
+/// identical module compiled the same way, whatever its module identifier.
+///
+/// The objects are kept in a FileCache, so several processes can share a
+/// cache directory.  If a size limit is given, the least recently used
+/// objects are removed when the directory grows past it.
+class FileObjectCache : public ObjectCache {
+public:
+  /// Create a cache keeping its objects in CacheDir, which is created when
+  /// the first object is stored.  If MaxSize is not zero, the objects in the
+  /// directory are kept to at most MaxSize bytes.
+  FileObjectCache(StringRef CacheDir, uint64_t MaxSize = 0);
+  ~FileObjectCache() override;
+
+  /// Include the configuration of TM (its triple, CPU, features, code
+  /// generation options and optimization level) in the key of each module.
+  /// This should be the target machine of the engine the cache is used with.
+  void setTargetMachine(const TargetMachine &TM);
+
+  void notifyObjectCompiled(const Module *M, MemoryBufferRef Obj) override;
+  std::unique_ptr<MemoryBuffer> getObject(const Module *M) override;
+
+  /// Return the key, a hex string, that the object compiled from M is cached
+  /// under.
+  std::string getKey(const Module &M) const;
+
+  /// Remove the least recently used objects until the objects in the cache
+  /// directory take at most MaxSize bytes.  Does nothing if there is no size
+  /// limit or another process is pruning the directory.
+  void prune();
+
+  StringRef getCacheDir() const { return Cache.getDirectory(); }
+
+private:
+  FileCache Cache;
+  uint64_t MaxSize;
+  std::string TargetKey;
+
+  /// The keys computed by getObject for modules that missed the cache.  The
+  /// key must be computed before the module is compiled, because code
+  /// generation may change the module before notifyObjectCompiled is called.
+  sys::Mutex Lock;
+  DenseMap<const Module *, std::string> PendingKeys;
+};
+
+} // End llvm namespace
+
+#endif
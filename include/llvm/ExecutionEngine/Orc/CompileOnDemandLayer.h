@@ -19,9 +19,16 @@
 #include "LambdaResolver.h"
 #include "LogicalDylib.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/ExecutionEngine/SectionMemoryManager.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Transforms/Utils/Cloning.h"
+#include <atomic>
 #include <list>
+#include <map>
+#include <mutex>
 #include <set>
 
 #include "llvm/Support/Debug.h"
@@ -36,9 +43,13 @@ namespace orc {
 /// added to the layer below. When a stub is called it triggers the extraction
 /// of the function body from the original module. The extracted body is then
 /// compiled and executed.
+///
+///   With tiering enabled (see enableTiering), functions that are called often
+/// are compiled again by a second, optimizing layer on a background thread.
 template <typename BaseLayerT, typename CompileCallbackMgrT,
           typename PartitioningFtor =
-            std::function<std::set<Function*>(Function&)>>
+            std::function<std::set<Function*>(Function&)>,
+          typename OptLayerT = BaseLayerT>
 class CompileOnDemandLayer {
 private:
 
@@ -75,10 +86,14 @@ private:
   };
 
   typedef typename BaseLayerT::ModuleSetHandleT BaseLayerModuleSetHandleT;
+  typedef typename OptLayerT::ModuleSetHandleT OptLayerModuleSetHandleT;
 
   struct LogicalModuleResources {
     std::shared_ptr<Module> SourceModule;
     std::set<const Function*> StubsToClone;
+    // The functions whose bodies have been emitted to the base layer. With
+    // tiering, their IR stays in SourceModule.
+    std::set<const Function*> EmittedFunctions;
   };
 
   struct LogicalDylibResources {
@@ -86,6 +101,7 @@ private:
       SymbolResolverFtor;
     SymbolResolverFtor ExternalSymbolResolver;
     PartitioningFtor Partitioner;
+    std::vector<OptLayerModuleSetHandleT> OptimizedHandles;
   };
 
   typedef LogicalDylib<BaseLayerT, LogicalModuleResources,
@@ -94,6 +110,22 @@ private:
   typedef typename CODLogicalDylib::LogicalModuleHandle LogicalModuleHandle;
   typedef std::list<CODLogicalDylib> LogicalDylibList;
 
+  // The call counter of a function compiled by the base layer, and what is
+  // needed to compile it again once it is hot.
+  struct TierUpInfo {
+    TierUpInfo(CompileOnDemandLayer &Layer, CODLogicalDylib &LD,
+               LogicalModuleHandle LMH, Function &F)
+        : Layer(Layer), LD(LD), LMH(LMH), F(F), Calls(0),
+          FnPtrAddr(nullptr) {}
+
+    CompileOnDemandLayer &Layer;
+    CODLogicalDylib &LD;
+    LogicalModuleHandle LMH;
+    Function &F;
+    std::atomic<uint64_t> Calls;
+    void *FnPtrAddr;
+  };
+
 public:
   /// @brief Handle to a set of loaded modules.
   typedef typename LogicalDylibList::iterator ModuleSetHandleT;
@@ -102,7 +134,30 @@ public:
   CompileOnDemandLayer(BaseLayerT &BaseLayer, CompileCallbackMgrT &CallbackMgr,
                        bool CloneStubsIntoPartitions)
       : BaseLayer(BaseLayer), CompileCallbackMgr(CallbackMgr),
-        CloneStubsIntoPartitions(CloneStubsIntoPartitions) {}
+        CloneStubsIntoPartitions(CloneStubsIntoPartitions), OptLayer(nullptr),
+        HotCallCount(0) {}
+
+  /// @brief Compile hot functions again with OptLayer, in the background.
+  ///
+  ///   Functions of the modules added from now on count their calls, and a
+  /// function that is called HotCallCount times is queued for recompilation
+  /// by OptLayer on a background thread. Once that is done its stub is
+  /// atomically repointed at the new code, so the base layer should compile
+  /// quickly (e.g. at -O0 with FastISel) and OptLayer should optimize well.
+  ///
+  ///   The bodies of the functions compiled by the base layer are kept until
+  /// they are recompiled. A recompilation optimizes the function in an
+  /// LLVMContext of its own, and runs OptLayer while functions are compiled by
+  /// the base layer on their first call, so any layer that both of them share
+  /// (such as an ObjectLinkingLayer) must allow concurrent use.
+  void enableTiering(OptLayerT &OptLayer, unsigned HotCallCount) {
+    assert(HotCallCount > 0 && "Functions can't be hot before they are called");
+    std::lock_guard<std::mutex> Guard(Lock);
+    this->OptLayer = &OptLayer;
+    this->HotCallCount = HotCallCount;
+    if (!TierUpThread)
+      TierUpThread = llvm::make_unique<ThreadPool>(1);
+  }
 
   /// @brief Add a module to the compile-on-demand layer.
   template <typename ModuleSetT, typename MemoryManagerPtrT,
@@ -114,6 +169,7 @@ public:
     assert(MemMgr == nullptr &&
            "User supplied memory managers not supported with COD yet.");
 
+    std::lock_guard<std::mutex> Guard(Lock);
     LogicalDylibs.push_back(CODLogicalDylib(BaseLayer));
     auto &LDResources = LogicalDylibs.back().getDylibResources();
 
@@ -142,6 +198,19 @@ public:
   ///   This will remove all modules in the layers below that were derived from
   /// the module represented by H.
   void removeModuleSet(ModuleSetHandleT H) {
+    // Let the recompilations that were already requested finish first.
+    if (TierUpThread)
+      TierUpThread->wait();
+
+    std::lock_guard<std::mutex> Guard(Lock);
+    for (auto I = TierUps.begin(), E = TierUps.end(); I != E;) {
+      if (&I->second->LD == &*H)
+        I = TierUps.erase(I);
+      else
+        ++I;
+    }
+    for (auto OptH : H->getDylibResources().OptimizedHandles)
+      OptLayer->removeModuleSet(OptH);
     LogicalDylibs.erase(H);
   }
 
@@ -252,16 +321,30 @@ private:
   TargetAddress extractAndCompile(CODLogicalDylib &LD,
                                   LogicalModuleHandle LMH,
                                   Function &F) {
-    Module &SrcM = *LD.getLogicalModuleResources(LMH).SourceModule;
+    std::lock_guard<std::mutex> Guard(Lock);
+    auto &LMResources = LD.getLogicalModuleResources(LMH);
+    Module &SrcM = *LMResources.SourceModule;
 
-    // If F is a declaration we must already have compiled it.
-    if (F.isDeclaration())
-      return 0;
+    // If F was compiled while this call waited for the lock, its body pointer
+    // already points at the code.
+    if (LMResources.EmittedFunctions.count(&F))
+      return reinterpret_cast<std::atomic<uintptr_t>*>(
+                 getFnPtrAddr(LD, LMH, F))->load(std::memory_order_acquire);
 
     // Grab the name of the function being called here.
     std::string CalledFnName = Mangle(F.getName(), SrcM.getDataLayout());
 
+    // The partitioner may look at the body of F, so read it now if the
+    // source module was loaded lazily. Functions that another partition has
+    // already emitted are left out, so that no body is emitted twice.
+    materializeBody(F);
     auto Partition = LD.getDylibResources().Partitioner(F);
+    for (auto I = Partition.begin(); I != Partition.end();) {
+      if (*I != &F && LMResources.EmittedFunctions.count(*I))
+        I = Partition.erase(I);
+      else
+        ++I;
+    }
     auto PartitionH = emitPartition(LD, LMH, Partition);
 
     TargetAddress CalledAddr = 0;
@@ -270,17 +353,10 @@ private:
       auto FnBodySym =
         BaseLayer.findSymbolIn(PartitionH, Mangle(FName, SrcM.getDataLayout()),
                                false);
-      auto FnPtrSym =
-        BaseLayer.findSymbolIn(*LD.moduleHandlesBegin(LMH),
-                               Mangle(FName + "$orc_addr",
-                                      SrcM.getDataLayout()),
-                               false);
       assert(FnBodySym && "Couldn't find function body.");
-      assert(FnPtrSym && "Couldn't find function body pointer.");
 
       TargetAddress FnBodyAddr = FnBodySym.getAddress();
-      void *FnPtrAddr = reinterpret_cast<void*>(
-          static_cast<uintptr_t>(FnPtrSym.getAddress()));
+      void *FnPtrAddr = getFnPtrAddr(LD, LMH, *SubF);
 
       // If this is the function we're calling record the address so we can
       // return it from this function.
@@ -288,11 +364,37 @@ private:
         CalledAddr = FnBodyAddr;
 
       memcpy(FnPtrAddr, &FnBodyAddr, sizeof(uintptr_t));
+
+      auto TierUpI = TierUps.find(SubF);
+      if (TierUpI != TierUps.end())
+        TierUpI->second->FnPtrAddr = FnPtrAddr;
     }
 
     return CalledAddr;
   }
 
+  // Return the address of the body pointer that the stub of F calls through.
+  void *getFnPtrAddr(CODLogicalDylib &LD, LogicalModuleHandle LMH,
+                     Function &F) {
+    Module &SrcM = *LD.getLogicalModuleResources(LMH).SourceModule;
+    auto FnPtrSym =
+      BaseLayer.findSymbolIn(*LD.moduleHandlesBegin(LMH),
+                             Mangle((F.getName() + "$orc_addr").str(),
+                                    SrcM.getDataLayout()),
+                             false);
+    assert(FnPtrSym && "Couldn't find function body pointer.");
+    return reinterpret_cast<void*>(
+        static_cast<uintptr_t>(FnPtrSym.getAddress()));
+  }
+
+  static void materializeBody(Function &F) {
+    if (!F.isMaterializable())
+      return;
+    if (std::error_code EC = F.materialize())
+      report_fatal_error("Could not read the body of " + F.getName() + ": " +
+                         EC.message());
+  }
+
   template <typename PartitionT>
   BaseLayerModuleSetHandleT emitPartition(CODLogicalDylib &LD,
                                           LogicalModuleHandle LMH,
@@ -316,13 +418,37 @@ private:
     for (auto *F : Partition)
       cloneFunctionDecl(*M, *F, &VMap);
 
-    // Move the function bodies.
-    for (auto *F : Partition)
-      moveFunctionBody(*F, VMap, &GDM);
+    // Move the function bodies, reading them first if the source module was
+    // loaded lazily. With tiering, copy them instead, so that they can be
+    // recompiled once they are hot, and count their calls.
+    for (auto *F : Partition) {
+      materializeBody(*F);
+      LMResources.EmittedFunctions.insert(F);
+      if (!OptLayer) {
+        moveFunctionBody(*F, VMap, &GDM);
+        continue;
+      }
+      cloneFunctionBody(*F, VMap, &GDM);
+      // The code counting the calls refers to the TierUpInfo, so it must
+      // never be replaced.
+      auto &Info = TierUps[F];
+      assert(!Info && "Function body emitted twice?");
+      Info = llvm::make_unique<TierUpInfo>(*this, LD, LMH, *F);
+      addHotCallCounter(*cast<Function>(VMap[F]), toTargetAddress(&Info->Calls),
+                        HotCallCount, toTargetAddress(&requestTierUp),
+                        toTargetAddress(Info.get()));
+    }
 
-    // Create memory manager and symbol resolver.
-    auto MemMgr = llvm::make_unique<SectionMemoryManager>();
-    auto Resolver = createLambdaResolver(
+    std::vector<std::unique_ptr<Module>> PartMSet;
+    PartMSet.push_back(std::move(M));
+    return BaseLayer.addModuleSet(std::move(PartMSet),
+                                  llvm::make_unique<SectionMemoryManager>(),
+                                  createPartitionResolver(LD, LMH));
+  }
+
+  std::unique_ptr<RuntimeDyld::SymbolResolver>
+  createPartitionResolver(CODLogicalDylib &LD, LogicalModuleHandle LMH) {
+    return createLambdaResolver(
         [this, &LD, LMH](const std::string &Name) {
           if (auto Symbol = LD.findSymbolInternally(LMH, Name))
             return RuntimeDyld::SymbolInfo(Symbol.getAddress(),
@@ -335,16 +461,121 @@ private:
                                            Symbol.getFlags());
           return RuntimeDyld::SymbolInfo(nullptr);
         });
-    std::vector<std::unique_ptr<Module>> PartMSet;
-    PartMSet.push_back(std::move(M));
-    return BaseLayer.addModuleSet(std::move(PartMSet), std::move(MemMgr),
-                                  std::move(Resolver));
+  }
+
+  template <typename T>
+  static TargetAddress toTargetAddress(T *Ptr) {
+    return static_cast<TargetAddress>(reinterpret_cast<uintptr_t>(Ptr));
+  }
+
+  // Called by the code of a function compiled by the base layer when the
+  // function has become hot.
+  static void requestTierUp(void *Ctx) {
+    TierUpInfo &Info = *static_cast<TierUpInfo*>(Ctx);
+    Info.Layer.TierUpThread->async([&Info]() { Info.Layer.tierUp(Info); });
+  }
+
+  // Compile the function of Info with the optimizing layer and repoint its
+  // stub at the result.
+  //
+  // The source module's context is not thread safe, and first-call compiles
+  // keep using it, so the body is handed over as bitcode and optimized in a
+  // context of its own. The lock is only held to take the body out of the
+  // source module, to look up symbols in the logical dylib, and to repoint the
+  // stub, so first-call compiles don't wait for the optimization.
+  void tierUp(TierUpInfo &Info) {
+    CODLogicalDylib &LD = Info.LD;
+    LogicalModuleHandle LMH = Info.LMH;
+    std::string OptName;
+    SmallString<0> Bitcode;
+    DataLayout DL("");
+    {
+      std::lock_guard<std::mutex> Guard(Lock);
+      auto &LMResources = LD.getLogicalModuleResources(LMH);
+      Module &SrcM = *LMResources.SourceModule;
+      Function &F = Info.F;
+      assert(Info.FnPtrAddr && "Function is hot before it was compiled?");
+
+      auto M = llvm::make_unique<Module>(
+          (SrcM.getName() + "." + F.getName() + ".opt").str(),
+          SrcM.getContext());
+      M->setDataLayout(SrcM.getDataLayout());
+      ValueToValueMapTy VMap;
+      GlobalDeclMaterializer GDM(*M, &LMResources.StubsToClone);
+      Function *OptF = cloneFunctionDecl(*M, F, &VMap);
+      moveFunctionBody(F, VMap, &GDM);
+
+      // The code from the base layer still defines F, so give the optimized
+      // version a name of its own.
+      OptName = (F.getName() + "$orc_opt").str();
+      OptF->setName(OptName);
+      DL = SrcM.getDataLayout();
+
+      raw_svector_ostream OS(Bitcode);
+      WriteBitcodeToFile(M.get(), OS);
+    }
+
+    LLVMContext OptContext;
+    auto OptMOrErr = parseBitcodeFile(
+        MemoryBufferRef(Bitcode.str(), OptName), OptContext);
+    if (!OptMOrErr)
+      report_fatal_error("Could not read back the body of " + OptName + ": " +
+                         OptMOrErr.getError().message());
+
+    std::vector<std::unique_ptr<Module>> OptMSet;
+    OptMSet.push_back(std::move(*OptMOrErr));
+    auto OptH = OptLayer->addModuleSet(std::move(OptMSet),
+                                       llvm::make_unique<SectionMemoryManager>(),
+                                       createTierUpResolver(LD, LMH));
+    auto OptSym = OptLayer->findSymbolIn(OptH, Mangle(OptName, DL), false);
+    assert(OptSym && "Couldn't find optimized function body.");
+    TargetAddress OptAddr = OptSym.getAddress();
+
+    std::lock_guard<std::mutex> Guard(Lock);
+    LD.getDylibResources().OptimizedHandles.push_back(OptH);
+
+    // Stubs load the body pointer atomically, so a call running at the same
+    // time goes either to the old or to the new body.
+    reinterpret_cast<std::atomic<uintptr_t>*>(Info.FnPtrAddr)->store(
+        static_cast<uintptr_t>(OptAddr), std::memory_order_release);
+  }
+
+  // A resolver for the optimized code, which is linked without the lock held.
+  std::unique_ptr<RuntimeDyld::SymbolResolver>
+  createTierUpResolver(CODLogicalDylib &LD, LogicalModuleHandle LMH) {
+    return createLambdaResolver(
+        [this, &LD, LMH](const std::string &Name) {
+          {
+            std::lock_guard<std::mutex> Guard(Lock);
+            if (auto Symbol = LD.findSymbolInternally(LMH, Name))
+              return RuntimeDyld::SymbolInfo(Symbol.getAddress(),
+                                             Symbol.getFlags());
+          }
+          return LD.getDylibResources().ExternalSymbolResolver(Name);
+        },
+        [this, &LD, LMH](const std::string &Name) {
+          std::lock_guard<std::mutex> Guard(Lock);
+          if (auto Symbol = LD.findSymbolInternally(LMH, Name))
+            return RuntimeDyld::SymbolInfo(Symbol.getAddress(),
+                                           Symbol.getFlags());
+          return RuntimeDyld::SymbolInfo(nullptr);
+        });
   }
 
   BaseLayerT &BaseLayer;
   CompileCallbackMgrT &CompileCallbackMgr;
   LogicalDylibList LogicalDylibs;
   bool CloneStubsIntoPartitions;
+
+  // Serializes the compile callbacks, and guards the source modules and the
+  // logical dylibs against the recompilation of hot functions.
+  std::mutex Lock;
+  OptLayerT *OptLayer;
+  unsigned HotCallCount;
+  std::map<const Function*, std::unique_ptr<TierUpInfo>> TierUps;
+  // Declared last so that it finishes its work before anything else in the
+  // layer is destroyed.
+  std::unique_ptr<ThreadPool> TierUpThread;
 };
 
 } // End namespace orc.
@@ -236,8 +236,20 @@ GlobalVariable* createImplPointer(PointerType &PT, Module &M,
 
 /// @brief Turn a function declaration into a stub function that makes an
 ///        indirect call using the given function pointer.
+///
+///   The function pointer is read with an atomic load, so another thread may
+/// repoint the stub while it is in use.
 void makeStub(Function &F, GlobalVariable &ImplPointer);
 
+/// @brief Count the calls of function 'F' and report when it becomes hot.
+///
+///   Inserts code at the entry of F that atomically increments the 64-bit
+/// counter at CounterAddr, and that calls the void(i8*) function at
+/// CallbackAddr with CallbackArg when F is called for the HotCount'th time.
+void addHotCallCounter(Function &F, TargetAddress CounterAddr,
+                       uint64_t HotCount, TargetAddress CallbackAddr,
+                       TargetAddress CallbackArg);
+
 /// @brief Raise linkage types and rename as necessary to ensure that all
 ///        symbols are accessible for other modules.
 ///
@@ -260,6 +272,14 @@ void makeAllSymbolsExternallyAccessible(Module &M);
 Function* cloneFunctionDecl(Module &Dst, const Function &F,
                             ValueToValueMapTy *VMap = nullptr);
 
+/// @brief Copy the body of function 'F' to a cloned function declaration in a
+///        different module (See related cloneFunctionDecl).
+///
+///   This is moveFunctionBody without the deletion of the original body.
+void cloneFunctionBody(Function &OrigF, ValueToValueMapTy &VMap,
+                       ValueMaterializer *Materializer = nullptr,
+                       Function *NewF = nullptr);
+
 /// @brief Move the body of function 'F' to a cloned function declaration in a
 ///        different module (See related cloneFunctionDecl).
 ///
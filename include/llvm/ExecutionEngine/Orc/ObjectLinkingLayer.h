@@ -16,10 +16,16 @@
 
 #include "JITSymbol.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
 #include "llvm/ExecutionEngine/SectionMemoryManager.h"
+#include "llvm/Support/RWMutex.h"
+#include <algorithm>
+#include <atomic>
 #include <list>
 #include <memory>
+#include <mutex>
 
 namespace llvm {
 namespace orc {
@@ -41,7 +47,7 @@ protected:
     LinkedObjectSet(RuntimeDyld::MemoryManager &MemMgr,
                     RuntimeDyld::SymbolResolver &Resolver)
         : RTDyld(llvm::make_unique<RuntimeDyld>(MemMgr, Resolver)),
-          State(Raw) {}
+          State(Raw), Ready(false) {}
 
     virtual ~LinkedObjectSet() {}
 
@@ -54,7 +60,9 @@ protected:
       return RTDyld->getSymbol(Name);
     }
 
-    bool NeedsFinalization() const { return (State == Raw); }
+    /// Returns false once this set and every set it refers to have been
+    /// finalized.
+    bool NeedsFinalization() const { return !Ready; }
 
     virtual void Finalize() = 0;
 
@@ -68,9 +76,24 @@ protected:
       OwnedBuffers.push_back(std::move(B));
     }
 
+    /// Called on the finalizing thread after Finalize().
+    std::function<void()> NotifyFinalized;
+
+    /// The names of the symbols that this set adds to the layer's symbol
+    /// table (they point into the table).
+    std::vector<StringRef> SymbolNames;
+
   protected:
+    friend class ObjectLinkingLayerBase;
+
     std::unique_ptr<RuntimeDyld> RTDyld;
+    // State and Dependencies are guarded by FinalizeLock.
+    std::mutex FinalizeLock;
     enum { Raw, Finalizing, Finalized } State;
+    std::atomic<bool> Ready;
+    // The not yet ready sets whose symbols the relocations of this set
+    // referred to.
+    std::vector<LinkedObjectSet*> Dependencies;
 
     // FIXME: This ownership hack only exists because RuntimeDyldELF still
     //        wants to be able to inspect the original object when resolving
@@ -80,6 +103,25 @@ protected:
 
   typedef std::list<std::unique_ptr<LinkedObjectSet>> LinkedObjectSetListT;
 
+  /// @brief Return Addr, the address of a symbol in LOS, once LOS can run.
+  ///
+  ///   When called from the symbol resolver of a set that is being finalized,
+  /// this only records LOS as a dependency of that set, as sets may refer to
+  /// each other. The dependency is finalized right after.
+  static TargetAddress getAddressWhenReady(LinkedObjectSet &LOS,
+                                           TargetAddress Addr);
+
+  /// @brief Finalize LOS and every set that it depends on, directly or not.
+  ///
+  ///   Each set is finalized under its own lock, without holding any other, so
+  /// sets can be finalized on several threads at once.
+  static void finalizeWithDependencies(LinkedObjectSet &LOS);
+
+private:
+  /// The dependencies recorded by getAddressWhenReady while a set is being
+  /// finalized on this thread.
+  static LLVM_THREAD_LOCAL std::vector<LinkedObjectSet*> *PendingDependencies;
+
 public:
   /// @brief Handle to a set of loaded objects.
   typedef LinkedObjectSetListT::iterator ObjSetHandleT;
@@ -109,6 +151,10 @@ public:
 /// object files to be loaded into memory, linked, and the addresses of their
 /// symbols queried. All objects added to this layer can see each other's
 /// symbols.
+///
+///   Object sets can be added, linked, searched and removed from several
+/// threads at once. Objects are loaded without holding a lock, and symbols are
+/// looked up in a table of the symbols defined by all sets.
 template <typename NotifyLoadedFtor = DoNothingOnNotifyLoaded>
 class ObjectLinkingLayer : public ObjectLinkingLayerBase {
 private:
@@ -177,17 +223,40 @@ public:
   ObjSetHandleT addObjectSet(const ObjSetT &Objects,
                              MemoryManagerPtrT MemMgr,
                              SymbolResolverPtrT Resolver) {
-    ObjSetHandleT Handle =
-      LinkedObjSetList.insert(
-        LinkedObjSetList.end(),
-        createLinkedObjectSet(std::move(MemMgr), std::move(Resolver)));
-
-    LinkedObjectSet &LOS = **Handle;
+    auto NewLOS = createLinkedObjectSet(std::move(MemMgr), std::move(Resolver));
+    LinkedObjectSet &LOS = *NewLOS;
     LoadedObjInfoList LoadedObjInfos;
 
     for (auto &Obj : Objects)
       LoadedObjInfos.push_back(LOS.addObject(*Obj));
 
+    // Publish the set and its symbols.
+    ObjSetHandleT Handle;
+    {
+      sys::ScopedWriter Locked(Lock);
+      Handle = LinkedObjSetList.insert(LinkedObjSetList.end(),
+                                       std::move(NewLOS));
+      for (auto &Obj : Objects)
+        for (auto &Sym : Obj->symbols()) {
+          if (Sym.getFlags() & object::SymbolRef::SF_Undefined)
+            continue;
+          ErrorOr<StringRef> Name = Sym.getName();
+          if (!Name || !LOS.getSymbol(*Name))
+            continue;
+          auto &Entry = *SymbolTable.insert(
+              std::make_pair(*Name, SmallVector<ObjSetHandleT, 1>())).first;
+          if (Entry.second.empty() || Entry.second.back() != Handle) {
+            Entry.second.push_back(Handle);
+            LOS.SymbolNames.push_back(Entry.first());
+          }
+        }
+    }
+
+    LOS.NotifyFinalized = [this, Handle]() {
+      if (NotifyFinalized)
+        NotifyFinalized(Handle);
+    };
+
     NotifyLoaded(Handle, Objects, LoadedObjInfos);
 
     return Handle;
@@ -202,7 +271,14 @@ public:
   /// required to detect or resolve such issues it should be added at a higher
   /// layer.
   void removeObjectSet(ObjSetHandleT H) {
-    // How do we invalidate the symbols in H?
+    sys::ScopedWriter Locked(Lock);
+    for (StringRef Name : (*H)->SymbolNames) {
+      auto I = SymbolTable.find(Name);
+      auto &Definitions = I->second;
+      Definitions.erase(std::find(Definitions.begin(), Definitions.end(), H));
+      if (Definitions.empty())
+        SymbolTable.erase(I);
+    }
     LinkedObjSetList.erase(H);
   }
 
@@ -211,9 +287,14 @@ public:
   /// @param ExportedSymbolsOnly If true, search only for exported symbols.
   /// @return A handle for the given named symbol, if it exists.
   JITSymbol findSymbol(StringRef Name, bool ExportedSymbolsOnly) {
-    for (auto I = LinkedObjSetList.begin(), E = LinkedObjSetList.end(); I != E;
-         ++I)
-      if (auto Symbol = findSymbolIn(I, Name, ExportedSymbolsOnly))
+    sys::ScopedReader Locked(Lock);
+    auto I = SymbolTable.find(Name);
+    if (I == SymbolTable.end())
+      return nullptr;
+
+    // Return the definition of the set that was added first.
+    for (auto H : I->second)
+      if (auto Symbol = findSymbolIn(H, Name, ExportedSymbolsOnly))
         return Symbol;
 
     return nullptr;
@@ -241,14 +322,10 @@ public:
           // it. The functor still needs to double-check whether finalization is
           // required, in case someone else finalizes this set before the
           // functor is called.
+          LinkedObjectSet &LOS = **H;
           auto GetAddress =
-            [this, Addr, H]() {
-              if ((*H)->NeedsFinalization()) {
-                (*H)->Finalize();
-                if (NotifyFinalized)
-                  NotifyFinalized(H);
-              }
-              return Addr;
+            [&LOS, Addr]() {
+              return getAddressWhenReady(LOS, Addr);
             };
           return JITSymbol(std::move(GetAddress), Flags);
         }
@@ -267,13 +344,15 @@ public:
   ///        given handle.
   /// @param H Handle for object set to emit/finalize.
   void emitAndFinalize(ObjSetHandleT H) {
-    (*H)->Finalize();
-    if (NotifyFinalized)
-      NotifyFinalized(H);
+    finalizeWithDependencies(**H);
   }
 
 private:
+  // Guards the list of sets and the symbol table.
+  sys::RWMutex Lock;
   LinkedObjectSetListT LinkedObjSetList;
+  // The sets that define each symbol, in the order they were added.
+  StringMap<SmallVector<ObjSetHandleT, 1>> SymbolTable;
   NotifyLoadedFtor NotifyLoaded;
   NotifyFinalizedFtor NotifyFinalized;
 };
@@ -0,0 +1,166 @@
+//===- PooledMemoryManager.h - Memory manager sharing slabs -----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares JITMemoryPool, which hands out memory carved from large
+// slabs, and PooledMemoryManager, a memory manager for MCJIT and ORC that
+// takes its memory from such a pool and gives it back when destroyed.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_POOLEDMEMORYMANAGER_H
+#define LLVM_EXECUTIONENGINE_POOLEDMEMORYMANAGER_H
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ExecutionEngine/RTDyldMemoryManager.h"
+#include "llvm/Support/Memory.h"
+#include "llvm/Support/Mutex.h"
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace llvm {
+
+/// JITMemoryPool - A thread safe pool of pages carved from large slabs of
+/// mapped memory.  Code and data are kept in slabs of their own, and pages
+/// are handed out first fit from the lowest addresses, so that the code of
+/// all the modules using the pool stays packed into as few slabs (and, with
+/// huge pages, TLB entries) as possible.  Pages given back are reused, and a
+/// slab that becomes unused is unmapped, except for one spare per kind.
+///
+/// The pool must outlive every memory manager taking memory from it.
+class JITMemoryPool {
+public:
+  enum MemoryKind { Code, Data, NumMemoryKinds };
+
+  /// The size of a huge page on the hosts where they are supported, and the
+  /// default slab size.
+  static const size_t HugePageSize = 2 * 1024 * 1024;
+
+  /// Create a pool mapping slabs of at least SlabSize bytes.  If
+  /// UseHugePages is true, slabs are aligned to HugePageSize and the system
+  /// is asked to back them with huge pages.  Changing the permissions of part
+  /// of a slab would split its mapping, and break up its huge pages, so the
+  /// slabs are then mapped with the permissions their memory needs at once:
+  /// code slabs are readable, writable and executable, and data slabs
+  /// readable and writable, for as long as they are mapped.
+  explicit JITMemoryPool(size_t SlabSize = HugePageSize,
+                         bool UseHugePages = false);
+  ~JITMemoryPool();
+
+  /// Allocate a page aligned, readable and writable block of at least Size
+  /// bytes, rounded up to whole pages, for memory of kind K.  Returns an
+  /// empty block if no memory could be mapped.
+  sys::MemoryBlock allocate(MemoryKind K, size_t Size);
+
+  /// Give back a block, or a page aligned part of one, obtained from
+  /// allocate.
+  void release(MemoryKind K, const sys::MemoryBlock &Block);
+
+  /// Whether the memory handed out must keep the permissions of its slab,
+  /// which is the case with huge pages.
+  bool hasFixedPermissions() const { return UseHugePages; }
+
+  /// The number of slabs mapped for memory of kind K.
+  unsigned getNumSlabs(MemoryKind K) const;
+
+  /// The number of bytes of memory of kind K handed out and not given back.
+  size_t getAllocatedSize(MemoryKind K) const;
+
+private:
+  JITMemoryPool(const JITMemoryPool &) = delete;
+  void operator=(const JITMemoryPool &) = delete;
+
+  struct Slab {
+    /// The mapping holding the slab, which may be larger than it if the slab
+    /// had to be aligned.
+    sys::MemoryBlock Mapping;
+    uintptr_t Base;
+    size_t Size;
+    /// The free ranges of the slab, by start address, which are coalesced
+    /// when pages are given back.
+    std::map<uintptr_t, size_t> Free;
+    size_t FreeSize;
+  };
+
+  /// The slabs of one kind of memory, by base address.
+  struct SlabList {
+    std::map<uintptr_t, std::unique_ptr<Slab>> Slabs;
+    size_t AllocatedSize;
+    SlabList() : AllocatedSize(0) {}
+  };
+
+  Slab *createSlab(MemoryKind K, size_t MinSize);
+  void destroySlab(Slab &S);
+
+  size_t PageSize;
+  size_t SlabSize;
+  bool UseHugePages;
+  mutable sys::Mutex Lock;
+  SlabList Lists[NumMemoryKinds];
+};
+
+/// PooledMemoryManager - A memory manager allocating the sections of the
+/// objects it loads from a JITMemoryPool, packing them into as few pages as
+/// it can.  All of its memory is given back to the pool when it is
+/// destroyed, so using one memory manager per module, as the ORC layers do,
+/// lets the memory of each module be freed on its own.
+///
+/// Pages left unused at the end of a block when the manager finalizes its
+/// memory are given back to the pool right away, so that the code of the
+/// next object goes right after this one's.  Finalizing makes code read-only
+/// and executable, and read-only data read-only, unless the pool has fixed
+/// permissions, in which case they stay writable.
+class PooledMemoryManager : public RTDyldMemoryManager {
+  PooledMemoryManager(const PooledMemoryManager &) = delete;
+  void operator=(const PooledMemoryManager &) = delete;
+
+public:
+  explicit PooledMemoryManager(JITMemoryPool &Pool) : Pool(Pool) {}
+  ~PooledMemoryManager() override;
+
+  uint8_t *allocateCodeSection(uintptr_t Size, unsigned Alignment,
+                               unsigned SectionID,
+                               StringRef SectionName) override;
+
+  uint8_t *allocateDataSection(uintptr_t Size, unsigned Alignment,
+                               unsigned SectionID, StringRef SectionName,
+                               bool IsReadOnly) override;
+
+  bool finalizeMemory(std::string *ErrMsg = nullptr) override;
+
+  /// \brief Invalidate instruction cache for code sections.
+  virtual void invalidateInstructionCache();
+
+private:
+  struct MemoryGroup {
+    /// The blocks taken from the pool; those from Unfinalized on do not have
+    /// their final permissions yet.
+    SmallVector<sys::MemoryBlock, 4> Blocks;
+    unsigned Unfinalized;
+    /// The free end of the last block, which sections are carved from.
+    uintptr_t Cur, End;
+    MemoryGroup() : Unfinalized(0), Cur(0), End(0) {}
+  };
+
+  uint8_t *allocateSection(MemoryGroup &MemGroup, JITMemoryPool::MemoryKind K,
+                           uintptr_t Size, unsigned Alignment);
+  std::error_code finalizeGroup(MemoryGroup &MemGroup,
+                                JITMemoryPool::MemoryKind K,
+                                unsigned Permissions);
+  void releaseGroup(MemoryGroup &MemGroup, JITMemoryPool::MemoryKind K);
+
+  JITMemoryPool &Pool;
+  MemoryGroup CodeMem;
+  MemoryGroup RWDataMem;
+  MemoryGroup RODataMem;
+};
+
+} // End llvm namespace
+
+#endif
@@ -18,6 +18,7 @@
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/Memory.h"
+#include "llvm/Support/Mutex.h"
 #include "llvm/DebugInfo/DIContext.h"
 #include <memory>
 
@@ -182,6 +183,10 @@ public:
   };
 
   /// \brief Construct a RuntimeDyld instance.
+  ///
+  /// Objects may be loaded into an instance, and its symbols looked up, from
+  /// several threads at once; loading and relocation within one instance are
+  /// serialized.  Separate instances link independently of each other.
   RuntimeDyld(MemoryManager &MemMgr, SymbolResolver &Resolver);
   ~RuntimeDyld();
 
@@ -233,9 +238,15 @@ public:
   }
 
 private:
+  RuntimeDyldImpl *getOrCreateImpl(const object::ObjectFile &Obj);
+  RuntimeDyldImpl *getImpl() const;
+
   // RuntimeDyldImpl is the actual class. RuntimeDyld is just the public
   // interface.
   std::unique_ptr<RuntimeDyldImpl> Dyld;
+  // Guards the creation of Dyld, so that objects can be loaded and symbols
+  // looked up on several threads at once.
+  mutable sys::Mutex DyldLock;
   MemoryManager &MemMgr;
   SymbolResolver &Resolver;
   bool ProcessAllSections;
@@ -111,6 +111,15 @@ public:
   /// \brief Provide an overload for a Use.
   bool isReachableFromEntry(const Use &U) const;
 
+  /// \brief Update the tree after the given edges were inserted into or
+  /// deleted from the CFG, as DominatorTreeBase::applyUpdates does.
+  ///
+  /// With -verify-dom-updates, the result is checked against a tree computed
+  /// from scratch.
+  void applyUpdates(ArrayRef<UpdateType> Updates);
+  void insertEdge(BasicBlock *From, BasicBlock *To);
+  void deleteEdge(BasicBlock *From, BasicBlock *To);
+
   /// \brief Verify the correctness of the domtree by re-computing it.
   ///
   /// This should only be used for debugging as it aborts the program if the
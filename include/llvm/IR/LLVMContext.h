@@ -37,7 +37,8 @@ class DebugLoc;
 /// (opaquely) owns and manages the core "global" data of LLVM's core
 /// infrastructure, including the type and constant uniquing tables.
 /// LLVMContext itself provides no locking guarantees, so you should be careful
-/// to have one context per thread.
+/// to have one context per thread, unless the context is made multithreaded
+/// with setMultithreaded().
 class LLVMContext {
 public:
   LLVMContextImpl *const pImpl;
@@ -177,6 +178,40 @@ public:
     return OptionRegistry::instance().template get<ValT, Base, Mem>();
   }
 
+  /// \brief Returns the number of bytes reserved by this context's IR arena.
+  ///
+  /// The arena only grows while an IRArenaScope for this context is active.
+  size_t getIRArenaSize() const;
+
+  /// \brief Allow several threads to work on the IR of this context at once.
+  ///
+  /// While the context is multithreaded, the uniquing tables of its types,
+  /// constants, metadata and attributes, the use lists of its constants and
+  /// globals, and the other state that all of its functions share are only
+  /// accessed under a lock.  Threads may then create and change IR at the same
+  /// time, as long as no two of them work on the same function, and as long as
+  /// they change module-level IR only by creating declarations and references
+  /// to globals.
+  ///
+  /// This covers reading the shared state as well as changing it.  Queries
+  /// such as Value::use_empty() and Value::hasOneUse() take the use list lock
+  /// of a constant or global themselves, but a walk over the uses or users of
+  /// one must hold Value::lockUseList() for its duration, since another thread
+  /// may add or remove uses in the meantime.
+  ///
+  /// This only protects the state of the context itself.  Code that walks the
+  /// users of a shared value, or looks at the instructions of other functions,
+  /// still races with the threads changing those functions, so passes must be
+  /// checked one by one before they run on several threads.
+  ///
+  /// Many IR operations take the lock, so a context should only be
+  /// multithreaded while threads share it.  This must only be called while no
+  /// other thread uses the context.
+  void setMultithreaded(bool Multithreaded);
+
+  /// \brief Return true if several threads may be working on this context.
+  bool isMultithreaded() const;
+
 private:
   LLVMContext(LLVMContext&) = delete;
   void operator=(LLVMContext&) = delete;
@@ -192,6 +227,32 @@ private:
   friend class Module;
 };
 
+/// \brief Places the IR created on the current thread into a context arena.
+///
+/// While an IRArenaScope is alive, every User allocated on the constructing
+/// thread (instructions, constants, globals) is bump-allocated, together with
+/// its operand list, from an arena owned by the given context instead of the
+/// heap.  Deleting an arena-allocated User runs its destructor but leaves its
+/// memory in place; the whole arena is released when the context is
+/// destroyed.  This trades reuse of freed memory for cheaper allocation,
+/// denser IR and no per-object malloc overhead, which pays off for IR that
+/// lives about as long as its context, e.g. modules loaded into a JIT.
+///
+/// Only values belonging to the given context may be created while the scope
+/// is active, which is checked by an assertion.  Scopes nest; the innermost
+/// one wins.
+class IRArenaScope {
+public:
+  explicit IRArenaScope(LLVMContext &C);
+  ~IRArenaScope();
+
+private:
+  IRArenaScope(const IRArenaScope &) = delete;
+  void operator=(const IRArenaScope &) = delete;
+
+  LLVMContextImpl *Prev;
+};
+
 /// getGlobalContext - Returns a global context.  This is for LLVM clients that
 /// only care about operating on a single thread.
 extern LLVMContext &getGlobalContext();
@@ -19,6 +19,9 @@
 
 #include "llvm/Pass.h"
 #include "llvm/Support/CBindingWrapping.h"
+#include <functional>
+#include <memory>
+#include <vector>
 
 namespace llvm {
 
@@ -58,10 +61,31 @@ public:
   /// whether any of the passes modifies the module, and if so, return true.
   bool run(Module &M);
 
+  /// setFunctionPassThreads - Run the function passes of this manager that
+  /// are grouped directly under the module passes on up to \p Threads
+  /// functions at once.  Passes keep state, so each additional thread runs
+  /// its own copy of the pipeline, which \p AddPasses builds by adding the
+  /// same passes in the same order as were added to this manager.  A group
+  /// of function passes runs on one function at a time if it needs any
+  /// analysis other than its own and those of immutable passes, if any of
+  /// its passes is not on the list of passes known to be safe to run on
+  /// several functions at once, or if the copies do not match.  While a
+  /// group runs on several threads, the context of the module is
+  /// multithreaded (see LLVMContext::setMultithreaded()).
+  void setFunctionPassThreads(
+      unsigned Threads, std::function<void(PassManagerBase &)> AddPasses);
+
 private:
   /// PassManagerImpl_New is the actual class. PassManager is just the
   /// wraper to publish simple pass manager interface
   PassManagerImpl *PM;
+
+  /// The number of threads requested by setFunctionPassThreads(), the
+  /// callback that builds a copy of the pipeline, and the copies built so
+  /// far.
+  unsigned Threads;
+  std::function<void(PassManagerBase &)> AddPasses;
+  std::vector<std::unique_ptr<PassManager>> ThreadCopies;
 };
 
 /// FunctionPassManager manages FunctionPasses and BasicBlockPassManagers.
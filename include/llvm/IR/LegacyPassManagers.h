@@ -19,6 +19,7 @@
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Pass.h"
+#include "llvm/Support/TimeTraceProfiler.h"
 #include <map>
 #include <vector>
 
@@ -356,6 +357,20 @@ public:
     return (unsigned)PassVector.size();
   }
 
+  /// isSelfContained - Return true if every analysis required by the passes
+  /// of this manager, including those of nested managers, is computed by one
+  /// of these passes or by an immutable pass.
+  bool isSelfContained();
+
+  /// hasOnlyThreadSafePasses - Return true if every pass of this manager,
+  /// including those of nested managers, is known to be safe to run on
+  /// several functions of a module at once.
+  bool hasOnlyThreadSafePasses();
+
+  /// hasSamePasses - Return true if \p Other manages passes with the same
+  /// IDs, nested the same way and in the same order, as this manager.
+  bool hasSamePasses(const PMDataManager &Other) const;
+
   virtual PassManagerType getPassManagerType() const {
     assert ( 0 && "Invalid use of getPassManagerType");
     return PMT_Unknown;
@@ -467,13 +482,42 @@ public:
     return FP;
   }
 
+  /// setThreadCopies - Let runOnModule run the passes on several functions
+  /// at once, using the given copies of this manager on the other threads.
+  /// The copies belong to other top level managers built from the same
+  /// pipeline.
+  void setThreadCopies(ArrayRef<FPPassManager *> Copies) {
+    ThreadCopies.clear();
+    ThreadCopies.append(Copies.begin(), Copies.end());
+  }
+
   PassManagerType getPassManagerType() const override {
     return PMT_FunctionPassManager;
   }
+
+private:
+  /// runOnFunctionsInParallel - Run the passes on the function definitions of
+  /// M, using this manager and its thread copies on one thread each.
+  bool runOnFunctionsInParallel(Module &M);
+
+  SmallVector<FPPassManager *, 4> ThreadCopies;
 };
 
 Timer *getPassTimer(Pass *);
 
+/// PassTraceRegion - If -time-passes-trace is enabled, record the execution of
+/// a pass on the IR unit described by \p Detail as an event of the trace.
+class PassTraceRegion {
+  TimeTraceRegion Region;
+
+public:
+  PassTraceRegion(Pass *P, StringRef Detail);
+
+  /// isEnabled - Return true if passes are traced, for callers that only
+  /// want to compute an expensive detail when it is used.
+  static bool isEnabled();
+};
+
 }
 
 #endif
@@ -59,6 +59,8 @@ protected:
     // null.
     assert((!HasHungOffUses || !getOperandList()) &&
            "Error in initializing hung off uses for User");
+    assert((!IsArenaAllocated || isInActiveArenaContext()) &&
+           "User of one context created in the IR arena of another");
   }
 
   /// \brief Allocate the array of Uses, followed by a pointer
@@ -97,6 +99,10 @@ protected:
     return OpFrom<Idx>(this);
   }
 private:
+  /// \brief Return true if the active IR arena of the calling thread belongs
+  /// to the context of this User.
+  bool isInActiveArenaContext() const;
+
   Use *&getHungOffOperands() { return *(reinterpret_cast<Use **>(this) - 1); }
 
   Use *getIntrusiveOperands() {
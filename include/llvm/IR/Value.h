@@ -20,6 +20,7 @@
 #include "llvm/Support/CBindingWrapping.h"
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/Compiler.h"
+#include <atomic>
 
 namespace llvm {
 
@@ -37,6 +38,7 @@ class GlobalVariable;
 class InlineAsm;
 class Instruction;
 class LLVMContext;
+class LLVMContextImpl;
 class Module;
 class ModuleSlotTracker;
 class StringRef;
@@ -72,6 +74,7 @@ class Value {
 
   friend class ValueAsMetadata; // Allow access to IsUsedByMD.
   friend class ValueHandleBase;
+  friend class LLVMContextImpl; // Allow access to NumMultithreadedContexts.
 
   const unsigned char SubclassID;   // Subclass identifier (for isa/dyn_cast)
   unsigned char HasValueHandle : 1; // Has a ValueHandle pointing to this?
@@ -104,13 +107,18 @@ protected:
   ///
   /// Note, this should *NOT* be used directly by any class other than User.
   /// User uses this value to find the Use list.
-  enum : unsigned { NumUserOperandsBits = 29 };
+  enum : unsigned { NumUserOperandsBits = 28 };
   unsigned NumUserOperands : NumUserOperandsBits;
 
   bool IsUsedByMD : 1;
   bool HasName : 1;
   bool HasHungOffUses : 1;
 
+  /// \brief Set by User::operator new when the object, and any hung off
+  /// operand list it later acquires, lives in its context's IR arena (see
+  /// IRArenaScope).  Such memory is reclaimed with the context, not on delete.
+  bool IsArenaAllocated : 1;
+
 private:
   template <typename UseT> // UseT == 'Use' or 'const Use'
   class use_iterator_impl
@@ -272,7 +280,16 @@ public:
   //----------------------------------------------------------------------
   // Methods for handling the chain of uses of this Value.
   //
-  bool               use_empty() const { return UseList == nullptr; }
+  // While the context is multithreaded, other threads may change the use
+  // lists of constants and globals.  use_empty(), hasOneUse() and the other
+  // queries below then read them under a lock, but a walk over the uses or
+  // users of such a value must hold lockUseList() itself.
+  //
+  bool use_empty() const {
+    if (LLVM_UNLIKELY(needsUseListLock()))
+      return hasNUsesLocked(0, /*OrMore=*/false);
+    return UseList == nullptr;
+  }
 
   typedef use_iterator_impl<Use>       use_iterator;
   typedef use_iterator_impl<const Use> const_use_iterator;
@@ -287,7 +304,7 @@ public:
     return iterator_range<const_use_iterator>(use_begin(), use_end());
   }
 
-  bool               user_empty() const { return UseList == nullptr; }
+  bool               user_empty() const { return use_empty(); }
 
   typedef user_iterator_impl<User>       user_iterator;
   typedef user_iterator_impl<const User> const_user_iterator;
@@ -309,6 +326,8 @@ public:
   /// This is specialized because it is a common request and does not require
   /// traversing the whole use list.
   bool hasOneUse() const {
+    if (LLVM_UNLIKELY(needsUseListLock()))
+      return hasNUsesLocked(1, /*OrMore=*/false);
     const_use_iterator I = use_begin(), E = use_end();
     if (I == E) return false;
     return ++I == E;
@@ -331,8 +350,29 @@ public:
   /// hasNUsesOrMore to check for specific values.
   unsigned getNumUses() const;
 
+  /// \brief Keep other threads from changing the use list of this value
+  /// until unlockUseList() is called.
+  ///
+  /// This only has an effect on constants and globals while their context is
+  /// multithreaded (see LLVMContext::setMultithreaded).  Code that may run on
+  /// several functions at once must hold it while it walks the uses or users
+  /// of such a value, and must not change IR while it holds it.
+  void lockUseList() const;
+  void unlockUseList() const;
+
   /// \brief This method should only be used by the Use class.
-  void addUse(Use &U) { U.addToList(&UseList); }
+  void addUse(Use &U) {
+    if (LLVM_UNLIKELY(needsUseListLock()))
+      return addUseLocked(U);
+    U.addToList(&UseList);
+  }
+
+  /// \brief This method should only be used by the Use class.
+  void removeUse(Use &U) {
+    if (LLVM_UNLIKELY(needsUseListLock()))
+      return removeUseLocked(U);
+    U.removeFromList();
+  }
 
   /// \brief Concrete subclass of this.
   ///
@@ -503,6 +543,25 @@ private:
   template <class Compare>
   static void mergeUseListsImpl(Use *L, Use *R, Use **Next, Compare Cmp);
 
+  /// \brief The number of multithreaded contexts (see
+  /// LLVMContext::setMultithreaded).
+  ///
+  /// While there are any, the use lists of the values that any function can
+  /// refer to, such as constants and globals, are updated under a lock of
+  /// their context.
+  static std::atomic<unsigned> NumMultithreadedContexts;
+
+  /// \brief Return true if the use list of this value may be updated by
+  /// several threads at once.
+  bool needsUseListLock() const {
+    return NumMultithreadedContexts.load(std::memory_order_relaxed) != 0 &&
+           SubclassID < InstructionVal && SubclassID != ArgumentVal &&
+           SubclassID != BasicBlockVal;
+  }
+  void addUseLocked(Use &U);
+  void removeUseLocked(Use &U);
+  bool hasNUsesLocked(unsigned N, bool OrMore) const;
+
 protected:
   unsigned short getSubclassDataFromValue() const { return SubclassData; }
   void setValueSubclassData(unsigned short D) { SubclassData = D; }
@@ -513,8 +572,13 @@ inline raw_ostream &operator<<(raw_ostream &OS, const Value &V) {
   return OS;
 }
 
+Use::~Use() {
+  if (Val)
+    Val->removeUse(*this);
+}
+
 void Use::set(Value *V) {
-  if (Val) removeFromList();
+  if (Val) Val->removeUse(*this);
   Val = V;
   if (V) V->addUse(*this);
 }
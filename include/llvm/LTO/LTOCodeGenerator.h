@@ -40,7 +40,9 @@
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/Linker/Linker.h"
+#include "llvm/Support/CodeGen.h"
 #include "llvm/Target/TargetOptions.h"
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -50,6 +52,7 @@ namespace llvm {
   class GlobalValue;
   class Mangler;
   class MemoryBuffer;
+  class Target;
   class TargetLibraryInfo;
   class TargetMachine;
   class raw_ostream;
@@ -133,6 +136,19 @@ struct LTOCodeGenerator {
   // if the compilation was not successful.
   std::unique_ptr<MemoryBuffer> compileOptimized(std::string &errMsg);
 
+  // Compiles the merged optimized module into Out.size() object files, one per
+  // stream, generating code for the partitions in parallel. Return true on
+  // success. With more than one stream the local symbols of the merged module
+  // are externalized, so it should not be written out or compiled again.
+  bool compileOptimized(ArrayRef<raw_pwrite_stream *> Out,
+                        std::string &errMsg);
+
+  // Compiles the merged optimized module into Parallelism object files,
+  // generating code for the partitions in parallel, and returns them in
+  // buffers. Returns an empty vector if the compilation was not successful.
+  std::vector<std::unique_ptr<MemoryBuffer>>
+  compileOptimized(unsigned Parallelism, std::string &errMsg);
+
   void setDiagnosticHandler(lto_diagnostic_handler_t, void *);
 
   LLVMContext &getContext() { return Context; }
@@ -148,6 +164,7 @@ private:
                         SmallPtrSetImpl<GlobalValue *> &AsmUsed,
                         Mangler &Mangler);
   bool determineTarget(std::string &errMsg);
+  std::unique_ptr<TargetMachine> createTargetMachine();
 
   static void DiagnosticHandler(const DiagnosticInfo &DI, void *Context);
 
@@ -160,6 +177,11 @@ private:
   LLVMContext &Context;
   Linker IRLinker;
   TargetMachine *TargetMach = nullptr;
+  const Target *MArch = nullptr;
+  std::string TripleStr;
+  std::string FeatureStr;
+  Reloc::Model RelocModel = Reloc::Default;
+  CodeGenOpt::Level CGOptLevel = CodeGenOpt::Default;
   bool EmitDwarfDebugInfo = false;
   bool ScopeRestrictionsDone = false;
   lto_codegen_model CodeModel = LTO_CODEGEN_PIC_MODEL_DEFAULT;
@@ -408,9 +408,16 @@ public:
        IndexedInstrProfReader &ProfileReader);
 
   /// \brief Load the coverage mapping from the given files.
+  ///
+  /// If \p CacheDir is not empty, the decoded coverage mapping of the object
+  /// is kept in a cache in that directory, keyed by the object's path, size
+  /// and modification time, and read from there in place by later loads.
+  /// Adding an entry prunes the cache to \p CacheSizeLimit bytes, unless that
+  /// is 0.
   static ErrorOr<std::unique_ptr<CoverageMapping>>
   load(StringRef ObjectFilename, StringRef ProfileFilename,
-       StringRef Arch = StringRef());
+       StringRef Arch = StringRef(), StringRef CacheDir = StringRef(),
+       uint64_t CacheSizeLimit = 0);
 
   /// \brief The number of functions that couldn't have their profiles mapped.
   ///
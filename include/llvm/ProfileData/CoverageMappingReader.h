@@ -176,6 +176,57 @@ public:
   std::error_code readNextRecord(CoverageMappingRecord &Record) override;
 };
 
+/// \brief Reader for a cache of decoded coverage mapping records.
+///
+/// The cache holds the records of another reader with their expressions and
+/// regions laid out as they are in memory, so that they are used in place,
+/// from the mapped file, rather than decoded again. A cache is only valid on
+/// a host like the one that wrote it; others reject it as malformed.
+class CachedCoverageReader : public CoverageMappingReader {
+public:
+  /// \brief The fixed size part of a record in the cache.
+  struct CachedRecord {
+    uint64_t FunctionHash;
+    uint32_t FunctionName;
+    uint32_t FilenamesBegin;
+    uint32_t NumFilenames;
+    uint32_t NumExpressions;
+    uint32_t NumRegions;
+    uint32_t Padding;
+  };
+
+private:
+  std::unique_ptr<MemoryBuffer> Buffer;
+  ArrayRef<CachedRecord> Records;
+  ArrayRef<CounterExpression> Expressions;
+  ArrayRef<CounterMappingRegion> MappingRegions;
+  std::vector<StringRef> Strings;
+  std::vector<StringRef> Filenames;
+  size_t CurrentRecord;
+  size_t CurrentExpression;
+  size_t CurrentRegion;
+
+  CachedCoverageReader(const CachedCoverageReader &) = delete;
+  CachedCoverageReader &operator=(const CachedCoverageReader &) = delete;
+
+  CachedCoverageReader(std::unique_ptr<MemoryBuffer> Buffer)
+      : Buffer(std::move(Buffer)), CurrentRecord(0), CurrentExpression(0),
+        CurrentRegion(0) {}
+
+  std::error_code readCache();
+
+public:
+  /// \brief Create a reader for the cache in \p Buffer, checking that all of
+  /// it is well formed.
+  static ErrorOr<std::unique_ptr<CachedCoverageReader>>
+  create(std::unique_ptr<MemoryBuffer> Buffer);
+
+  /// \brief Write the cache of all the records of \p Reader to \p OS.
+  static std::error_code write(CoverageMappingReader &Reader, raw_ostream &OS);
+
+  std::error_code readNextRecord(CoverageMappingRecord &Record) override;
+};
+
 } // end namespace coverage
 } // end namespace llvm
 
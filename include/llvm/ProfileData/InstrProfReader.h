@@ -18,6 +18,7 @@
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ProfileData/InstrProf.h"
+#include "llvm/Support/Endian.h"
 #include "llvm/Support/EndianStream.h"
 #include "llvm/Support/ErrorOr.h"
 #include "llvm/Support/LineIterator.h"
@@ -189,10 +190,21 @@ namespace IndexedInstrProf {
 enum class HashT : uint32_t;
 }
 
+/// A record of an indexed profile whose counts are read in place, from the
+/// profile data, rather than copied out of it.
+struct InstrProfRecordRef {
+  InstrProfRecordRef(StringRef Name, uint64_t Hash,
+                     ArrayRef<support::ulittle64_t> Counts)
+      : Name(Name), Hash(Hash), Counts(Counts) {}
+  StringRef Name;
+  uint64_t Hash;
+  ArrayRef<support::ulittle64_t> Counts;
+};
+
 /// Trait for lookups into the on-disk hash table for the binary instrprof
 /// format.
 class InstrProfLookupTrait {
-  std::vector<InstrProfRecord> DataBuffer;
+  std::vector<InstrProfRecordRef> DataBuffer;
   IndexedInstrProf::HashT HashType;
   unsigned FormatVersion;
 
@@ -200,7 +212,7 @@ public:
   InstrProfLookupTrait(IndexedInstrProf::HashT HashType, unsigned FormatVersion)
       : HashType(HashType), FormatVersion(FormatVersion) {}
 
-  typedef ArrayRef<InstrProfRecord> data_type;
+  typedef ArrayRef<InstrProfRecordRef> data_type;
 
   typedef StringRef internal_key_type;
   typedef StringRef external_key_type;
@@ -261,6 +273,10 @@ public:
   /// Fill Counts with the profile data for the given function name.
   std::error_code getFunctionCounts(StringRef FuncName, uint64_t FuncHash,
                                     std::vector<uint64_t> &Counts);
+  /// Point Counts at the profile data for the given function name, without
+  /// copying it. The counts remain valid as long as the reader does.
+  std::error_code getFunctionCounts(StringRef FuncName, uint64_t FuncHash,
+                                    ArrayRef<support::ulittle64_t> &Counts);
   /// Return the maximum of all known function counts.
   uint64_t getMaximumFunctionCount() { return MaxFunctionCount; }
 
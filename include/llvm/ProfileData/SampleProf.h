@@ -16,6 +16,7 @@
 
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
@@ -59,6 +60,15 @@ static inline uint64_t SPMagic() {
 
 static inline uint64_t SPVersion() { return 100; }
 
+/// The magic number of the indexed binary format, which differs from that of
+/// the binary format in its last byte.
+static inline uint64_t SPIndexedMagic() { return SPMagic() - 1; }
+
+/// The hash of a function name in the index of the indexed binary format.
+static inline uint64_t SPIndexHash(StringRef FName) {
+  return HashString(FName);
+}
+
 /// Represents the relative location of an instruction.
 ///
 /// Instruction locations are specified by the line offset from the
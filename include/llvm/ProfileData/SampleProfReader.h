@@ -20,11 +20,14 @@
 #include "llvm/IR/DiagnosticInfo.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
 #include "llvm/ProfileData/SampleProf.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/Endian.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/ErrorOr.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/OnDiskHashTable.h"
 #include "llvm/Support/raw_ostream.h"
 
 namespace llvm {
@@ -55,9 +58,11 @@ namespace sampleprof {
 ///      protection against source code shuffling, line numbers should
 ///      be relative to the start of the function.
 ///
-/// The reader supports two file formats: text and binary. The text format
-/// is useful for debugging and testing, while the binary format is more
-/// compact. They can both be used interchangeably.
+/// The reader supports three file formats: text, binary and indexed binary.
+/// The text format is useful for debugging and testing, while the binary
+/// format is more compact. The indexed binary format lets the profiles of
+/// the functions of a module be read without reading the whole file. They
+/// can all be used interchangeably.
 class SampleProfileReader {
 public:
   SampleProfileReader(std::unique_ptr<MemoryBuffer> B, LLVMContext &C)
@@ -71,6 +76,14 @@ public:
   /// \brief Read sample profiles from the associated file.
   virtual std::error_code read() = 0;
 
+  /// \brief Read the sample profiles of the functions defined in \p M.
+  ///
+  /// Only the indexed binary format can find the profile of a function
+  /// without reading the whole file; the other formats read all the profiles.
+  virtual std::error_code readModuleProfiles(const Module &M) {
+    return read();
+  }
+
   /// \brief Print the profile for \p FName on stream \p OS.
   void dumpFunctionProfile(StringRef FName, raw_ostream &OS = dbgs());
 
@@ -137,6 +150,9 @@ public:
   static bool hasFormat(const MemoryBuffer &Buffer);
 
 protected:
+  /// \brief Read and validate the file header, which starts with \p Magic.
+  std::error_code readHeader(uint64_t Magic);
+
   /// \brief Read a numeric value of type T from the profile.
   ///
   /// If an error occurs during decoding, a diagnostic message is emitted and
@@ -153,6 +169,9 @@ protected:
   /// \returns the read value.
   ErrorOr<StringRef> readString();
 
+  /// \brief Read the samples of a function, past its name, into \p FProfile.
+  std::error_code readProfile(FunctionSamples &FProfile);
+
   /// \brief Return true if we've reached the end of file.
   bool at_eof() const { return Data >= End; }
 
@@ -163,6 +182,82 @@ protected:
   const uint8_t *End;
 };
 
+/// Trait for lookups into the on-disk hash table of the indexed binary
+/// format, which maps function names to the offset of their profile.
+class SampleProfLookupTrait {
+public:
+  /// The name of a function and the offset of its profile.
+  typedef std::pair<StringRef, uint64_t> data_type;
+
+  typedef StringRef internal_key_type;
+  typedef StringRef external_key_type;
+  typedef uint64_t hash_value_type;
+  typedef uint64_t offset_type;
+
+  static bool EqualKey(StringRef A, StringRef B) { return A == B; }
+  static StringRef GetInternalKey(StringRef K) { return K; }
+  static hash_value_type ComputeHash(StringRef K) { return SPIndexHash(K); }
+
+  static std::pair<offset_type, offset_type>
+  ReadKeyDataLength(const unsigned char *&D) {
+    using namespace support;
+    offset_type KeyLen = endian::readNext<offset_type, little, unaligned>(D);
+    offset_type DataLen = endian::readNext<offset_type, little, unaligned>(D);
+    return std::make_pair(KeyLen, DataLen);
+  }
+
+  static StringRef ReadKey(const unsigned char *D, offset_type N) {
+    return StringRef((const char *)D, N);
+  }
+
+  static data_type ReadData(StringRef K, const unsigned char *D,
+                            offset_type N) {
+    using namespace support;
+    if (N != sizeof(uint64_t))
+      return data_type(K, 0);
+    return data_type(K, endian::read<uint64_t, little, unaligned>(D));
+  }
+};
+
+typedef OnDiskIterableChainedHashTable<SampleProfLookupTrait>
+    SampleProfReaderIndex;
+
+/// \brief Sample-based profile reader for the indexed binary format.
+///
+/// The profiles are only decoded when asked for, so that compiling a module
+/// only costs decoding the profiles of its functions, whatever the size of
+/// the profile.
+class SampleProfileReaderIndexed : public SampleProfileReaderBinary {
+public:
+  SampleProfileReaderIndexed(std::unique_ptr<MemoryBuffer> B, LLVMContext &C)
+      : SampleProfileReaderBinary(std::move(B), C), ProfilesEnd(nullptr) {}
+
+  /// \brief Read and validate the file header and index.
+  std::error_code readHeader() override;
+
+  /// \brief Read all the sample profiles from the associated file.
+  std::error_code read() override;
+
+  /// \brief Read the sample profiles of the functions defined in \p M.
+  std::error_code readModuleProfiles(const Module &M) override;
+
+  /// \brief Read the sample profile of function \p FName, if it has one.
+  std::error_code readFunctionProfile(StringRef FName);
+
+  /// \brief Return true if \p Buffer is in the format supported by this class.
+  static bool hasFormat(const MemoryBuffer &Buffer);
+
+private:
+  /// \brief Decode the profile of \p FName at \p Offset in the file.
+  std::error_code readProfileAt(StringRef FName, uint64_t Offset);
+
+  /// \brief The index from function names to the offset of their profile.
+  std::unique_ptr<SampleProfReaderIndex> Index;
+
+  /// \brief Points to the end of the profiles, where the index starts.
+  const uint8_t *ProfilesEnd;
+};
+
 } // End namespace sampleprof
 
 } // End namespace llvm
@@ -13,6 +13,7 @@
 #ifndef LLVM_PROFILEDATA_SAMPLEPROFWRITER_H
 #define LLVM_PROFILEDATA_SAMPLEPROFWRITER_H
 
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Module.h"
@@ -25,7 +26,13 @@ namespace llvm {
 
 namespace sampleprof {
 
-enum SampleProfileFormat { SPF_None = 0, SPF_Text, SPF_Binary, SPF_GCC };
+enum SampleProfileFormat {
+  SPF_None = 0,
+  SPF_Text,
+  SPF_Binary,
+  SPF_GCC,
+  SPF_IndexedBinary
+};
 
 /// \brief Sample-based profile writer. Base class.
 class SampleProfileWriter {
@@ -95,12 +102,42 @@ public:
 /// \brief Sample-based profile writer (binary format).
 class SampleProfileWriterBinary : public SampleProfileWriter {
 public:
-  SampleProfileWriterBinary(StringRef F, std::error_code &EC);
+  SampleProfileWriterBinary(StringRef F, std::error_code &EC)
+      : SampleProfileWriterBinary(F, EC, SPMagic()) {}
 
   bool write(StringRef F, const FunctionSamples &S) override;
   bool write(const Module &M, StringMap<FunctionSamples> &P) {
     return SampleProfileWriter::write(M, P);
   }
+
+protected:
+  /// \brief Open \p F and write the file header, starting with \p Magic.
+  SampleProfileWriterBinary(StringRef F, std::error_code &EC, uint64_t Magic);
+
+  /// \brief Write the samples in \p S, without the function name.
+  void writeBody(const FunctionSamples &S);
+};
+
+/// \brief Sample-based profile writer (indexed binary format).
+///
+/// The profile of each function is written as in the binary format, without
+/// its name. The names go to an on-disk hash table giving the offset of the
+/// profile of each function, which is written, followed by the offsets of the
+/// table, when the writer is destroyed.
+class SampleProfileWriterIndexed : public SampleProfileWriterBinary {
+public:
+  SampleProfileWriterIndexed(StringRef F, std::error_code &EC)
+      : SampleProfileWriterBinary(F, EC, SPIndexedMagic()) {}
+  ~SampleProfileWriterIndexed() override;
+
+  bool write(StringRef F, const FunctionSamples &S) override;
+  bool write(const Module &M, StringMap<FunctionSamples> &P) {
+    return SampleProfileWriter::write(M, P);
+  }
+
+private:
+  /// \brief The offset of the profile of each function written.
+  StringMap<uint64_t> Offsets;
 };
 
 } // End namespace sampleprof
@@ -0,0 +1,83 @@
+//===- llvm/Support/FileCache.h - Content-addressed file cache --*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines FileCache, a directory of build artifacts that are looked
+// up by a hash of everything that went into producing them.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_FILECACHE_H
+#define LLVM_SUPPORT_FILECACHE_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/ErrorOr.h"
+#include "llvm/Support/MD5.h"
+#include <memory>
+#include <string>
+#include <system_error>
+
+namespace llvm {
+
+class MemoryBuffer;
+
+/// \brief An on-disk cache mapping keys to blobs of data.
+///
+/// Each entry is stored in its own file, named after its key, in the cache
+/// directory. Keys are expected to be hashes of the inputs of whatever
+/// produced the entry, so an entry never changes once it has been written
+/// and there is no invalidation.
+///
+/// Entries are written to a temporary file and renamed into place, so
+/// several processes may share a cache directory: a reader sees either no
+/// entry or a complete one.
+///
+/// A lookup that finds an entry marks it as used by updating its
+/// modification time, and prune() removes the entries that were used least
+/// recently, so that the cache stays within a size bound. A lock file in the
+/// cache directory ensures that only one process prunes it at a time.
+class FileCache {
+public:
+  /// \brief Use \p Directory as the cache directory. It is created the first
+  /// time an entry is stored.
+  explicit FileCache(StringRef Directory) : Directory(Directory) {}
+
+  StringRef getDirectory() const { return Directory; }
+
+  /// \brief Return the path of the file holding the entry for \p Key.
+  std::string getEntryPath(StringRef Key) const;
+
+  /// \brief Look up the entry for \p Key and mark it as used. Returns
+  /// std::errc::no_such_file_or_directory if there is none.
+  ErrorOr<std::unique_ptr<MemoryBuffer>> lookup(StringRef Key) const;
+
+  /// \brief Store \p Data as the entry for \p Key, replacing any existing
+  /// entry.
+  std::error_code store(StringRef Key, StringRef Data) const;
+
+  /// \brief Remove the least recently used entries until the entries take at
+  /// most \p MaxSize bytes. Entries that another process removes or replaces
+  /// meanwhile are skipped, and so are temporary files written less than
+  /// TempFileGracePeriod seconds ago, which may belong to a store in progress.
+  /// Does nothing if another process is pruning the directory.
+  std::error_code prune(uint64_t MaxSize) const;
+
+  /// \brief How long, in seconds, prune() leaves temporary files alone.
+  static const int64_t TempFileGracePeriod = 600;
+
+  /// \brief Return the key for the inputs hashed into \p Hash: the hex
+  /// digest of the hash.
+  static std::string getKey(MD5 &Hash);
+
+private:
+  std::string Directory;
+};
+
+} // end namespace llvm
+
+#endif
@@ -18,6 +18,7 @@
 #ifndef LLVM_SUPPORT_GENERICDOMTREE_H
 #define LLVM_SUPPORT_GENERICDOMTREE_H
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DepthFirstIterator.h"
 #include "llvm/ADT/GraphTraits.h"
@@ -70,6 +71,7 @@ template <class NodeT> class DomTreeNodeBase {
   NodeT *TheBB;
   DomTreeNodeBase<NodeT> *IDom;
   std::vector<DomTreeNodeBase<NodeT> *> Children;
+  unsigned Level;
   mutable int DFSNumIn, DFSNumOut;
 
   template <class N> friend class DominatorTreeBase;
@@ -87,12 +89,16 @@ public:
 
   NodeT *getBlock() const { return TheBB; }
   DomTreeNodeBase<NodeT> *getIDom() const { return IDom; }
+  /// getLevel - Return the depth of this node in the tree, the root being at
+  /// level 0.
+  unsigned getLevel() const { return Level; }
   const std::vector<DomTreeNodeBase<NodeT> *> &getChildren() const {
     return Children;
   }
 
   DomTreeNodeBase(NodeT *BB, DomTreeNodeBase<NodeT> *iDom)
-      : TheBB(BB), IDom(iDom), DFSNumIn(-1), DFSNumOut(-1) {}
+      : TheBB(BB), IDom(iDom), Level(iDom ? iDom->Level + 1 : 0),
+        DFSNumIn(-1), DFSNumOut(-1) {}
 
   std::unique_ptr<DomTreeNodeBase<NodeT>>
   addChild(std::unique_ptr<DomTreeNodeBase<NodeT>> C) {
@@ -135,6 +141,8 @@ public:
       // Switch to new dominator
       IDom = NewIDom;
       IDom->Children.push_back(this);
+
+      updateLevel();
     }
   }
 
@@ -144,6 +152,21 @@ public:
   unsigned getDFSNumOut() const { return DFSNumOut; }
 
 private:
+  // Recompute the levels of the nodes of the subtree rooted at this node after
+  // it was moved.
+  void updateLevel() {
+    if (Level == IDom->Level + 1)
+      return;
+    SmallVector<DomTreeNodeBase<NodeT> *, 32> WorkStack(1, this);
+    while (!WorkStack.empty()) {
+      DomTreeNodeBase<NodeT> *N = WorkStack.pop_back_val();
+      N->Level = N->IDom->Level + 1;
+      for (DomTreeNodeBase<NodeT> *C : N->Children)
+        if (C->Level != N->Level + 1)
+          WorkStack.push_back(C);
+    }
+  }
+
   // Return true if this node is dominated by other. Use this only if DFS info
   // is valid.
   bool DominatedBy(const DomTreeNodeBase<NodeT> *other) const {
@@ -518,25 +541,13 @@ public:
       return nullptr;
     }
 
-    // Collect NodeA dominators set.
-    SmallPtrSet<DomTreeNodeBase<NodeT> *, 16> NodeADoms;
-    NodeADoms.insert(NodeA);
-    DomTreeNodeBase<NodeT> *IDomA = NodeA->getIDom();
-    while (IDomA) {
-      NodeADoms.insert(IDomA);
-      IDomA = IDomA->getIDom();
+    // Otherwise walk up from the deeper of the two nodes until they meet.
+    while (NodeA && NodeA != NodeB) {
+      if (NodeA->getLevel() < NodeB->getLevel())
+        std::swap(NodeA, NodeB);
+      NodeA = NodeA->getIDom();
     }
-
-    // Walk NodeB immediate dominators chain and find common dominator node.
-    DomTreeNodeBase<NodeT> *IDomB = NodeB->getIDom();
-    while (IDomB) {
-      if (NodeADoms.count(IDomB) != 0)
-        return IDomB->getBlock();
-
-      IDomB = IDomB->getIDom();
-    }
-
-    return nullptr;
+    return NodeA ? NodeA->getBlock() : nullptr;
   }
 
   const NodeT *findNearestCommonDominator(const NodeT *A, const NodeT *B) {
@@ -598,6 +609,42 @@ public:
     DomTreeNodes.erase(BB);
   }
 
+  /// The kind of a change to the edges of the graph.
+  enum UpdateKind { Insert, Delete };
+
+  /// A change to the edges of the graph, as given to applyUpdates.
+  struct UpdateType {
+    UpdateKind Kind;
+    NodeT *From;
+    NodeT *To;
+  };
+
+  /// insertEdge - Update the dominator tree after the edge From -> To was
+  /// added to the graph.  From may have become reachable only now, and To may
+  /// have been unreachable until now.
+  void insertEdge(NodeT *From, NodeT *To) {
+    UpdateType Update = {Insert, From, To};
+    applyUpdates(Update);
+  }
+
+  /// deleteEdge - Update the dominator tree after the edge From -> To was
+  /// removed from the graph.  Blocks that were only reachable through it are
+  /// removed from the tree.
+  void deleteEdge(NodeT *From, NodeT *To) {
+    UpdateType Update = {Delete, From, To};
+    applyUpdates(Update);
+  }
+
+  /// applyUpdates - Update the dominator tree after all of the edge insertions
+  /// and deletions in Updates were made to the graph, in any order.  An edge
+  /// both inserted and deleted in the batch is ignored.  This is cheaper than
+  /// recalculating the tree when the changes are local, which they most often
+  /// are.  Large batches, and post-dominator trees, are recalculated.
+  ///
+  /// This is provided in GenericDomTreeUpdate.h, and instantiated with the
+  /// rest of the tree.
+  void applyUpdates(ArrayRef<UpdateType> Updates);
+
   /// splitBlock - BB is split and now it has one successor. Update dominator
   /// tree to reflect this change.
   void splitBlock(NodeT *NewBB) {
@@ -639,6 +686,8 @@ protected:
   friend void
   Calculate(DominatorTreeBase<typename GraphTraits<N>::NodeType> &DT, FuncT &F);
 
+  class Updater;
+
 
   DomTreeNodeBase<NodeT> *getNodeForBlock(NodeT *BB) {
     if (DomTreeNodeBase<NodeT> *Node = getNode(BB))
@@ -0,0 +1,404 @@
+//===- GenericDomTreeUpdate.h - Incremental dominator updates ---*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file
+///
+/// Generic implementation of DominatorTreeBase::applyUpdates, which keeps a
+/// dominator tree up to date as edges are inserted into and deleted from the
+/// graph, without recalculating it. It is included only by the files that
+/// instantiate the dominator trees.
+///
+/// Insertions follow the depth based search of Georgiadis et al., "An
+/// Experimental Study of Dynamic Dominators": the nodes whose immediate
+/// dominator changes are exactly those reached from the target of the edge by
+/// paths not going above them in the tree, and all of them become children of
+/// the nearest common dominator of the endpoints. Deletions recompute the
+/// subtree of the nearest common dominator of the endpoints with the
+/// iterative algorithm of Cooper, Harvey and Kennedy, after removing the
+/// blocks that became unreachable.
+///
+/// A batch of updates is applied one update at a time, each one seeing the
+/// graph as it was before the updates still to be applied.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_GENERICDOMTREEUPDATE_H
+#define LLVM_SUPPORT_GENERICDOMTREEUPDATE_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/GenericDomTree.h"
+#include <queue>
+#include <type_traits>
+
+namespace llvm {
+
+template <class NodeT> class DominatorTreeBase<NodeT>::Updater {
+  typedef DomTreeNodeBase<NodeT> TreeNode;
+  typedef std::pair<NodeT *, UpdateKind> FutureUpdate;
+
+  DominatorTreeBase &DT;
+
+  // The updates still to be applied, by source and by target. They tell how
+  // the graph looked before them.
+  DenseMap<NodeT *, SmallVector<FutureUpdate, 4>> FutureSuccessors;
+  DenseMap<NodeT *, SmallVector<FutureUpdate, 4>> FuturePredecessors;
+
+public:
+  explicit Updater(DominatorTreeBase &DT) : DT(DT) {}
+
+  void apply(ArrayRef<UpdateType> Updates) {
+    SmallVector<UpdateType, 8> Legal;
+    legalize(Updates, Legal);
+
+    // Recalculating the tree is cheaper than many updates to a small one.
+    if (Legal.size() > 1 && Legal.size() > DT.DomTreeNodes.size() / 40) {
+      DT.recalculate(*Legal.front().From->getParent());
+      return;
+    }
+
+    for (const UpdateType &U : Legal) {
+      FutureSuccessors[U.From].push_back(FutureUpdate(U.To, U.Kind));
+      FuturePredecessors[U.To].push_back(FutureUpdate(U.From, U.Kind));
+    }
+
+    for (const UpdateType &U : Legal) {
+      forget(FutureSuccessors, U.From, U.To);
+      forget(FuturePredecessors, U.To, U.From);
+      if (U.Kind == Insert)
+        insertEdge(U.From, U.To);
+      else
+        deleteEdge(U.From, U.To);
+    }
+  }
+
+private:
+  // Drop the updates of the same edge that cancel out, keeping the others in
+  // the order they were given.
+  static void legalize(ArrayRef<UpdateType> Updates,
+                       SmallVectorImpl<UpdateType> &Legal) {
+    DenseMap<std::pair<NodeT *, NodeT *>, int> Count;
+    SmallVector<std::pair<NodeT *, NodeT *>, 8> Order;
+    for (const UpdateType &U : Updates) {
+      auto Edge = std::make_pair(U.From, U.To);
+      auto Inserted = Count.insert(std::make_pair(Edge, 0));
+      if (Inserted.second)
+        Order.push_back(Edge);
+      Inserted.first->second += U.Kind == Insert ? 1 : -1;
+    }
+    for (const auto &Edge : Order) {
+      int N = Count[Edge];
+      assert(N >= -1 && N <= 1 && "Edge inserted or deleted twice!");
+      if (N != 0) {
+        UpdateType U = {N > 0 ? Insert : Delete, Edge.first, Edge.second};
+        Legal.push_back(U);
+      }
+    }
+  }
+
+  static void forget(DenseMap<NodeT *, SmallVector<FutureUpdate, 4>> &Future,
+                     NodeT *N, NodeT *Other) {
+    SmallVectorImpl<FutureUpdate> &List = Future[N];
+    for (auto I = List.begin(), E = List.end(); I != E; ++I)
+      if (I->first == Other) {
+        List.erase(I);
+        return;
+      }
+    llvm_unreachable("Update not found!");
+  }
+
+  // Return the successors (or the predecessors) of N in the graph as it was
+  // before the updates still to be applied, each one once.
+  template <bool Preds> SmallVector<NodeT *, 8> getChildren(NodeT *N) const {
+    typedef typename std::conditional<Preds, GraphTraits<Inverse<NodeT *>>,
+                                      GraphTraits<NodeT *>>::type Traits;
+    const auto &Future = Preds ? FuturePredecessors : FutureSuccessors;
+    auto FI = Future.find(N);
+
+    SmallVector<NodeT *, 8> Children;
+    SmallPtrSet<NodeT *, 8> Seen;
+    for (auto I = Traits::child_begin(N), E = Traits::child_end(N); I != E;
+         ++I) {
+      NodeT *C = *I;
+      if (FI != Future.end() &&
+          std::find(FI->second.begin(), FI->second.end(),
+                    FutureUpdate(C, Insert)) != FI->second.end())
+        continue;
+      if (Seen.insert(C).second)
+        Children.push_back(C);
+    }
+    if (FI != Future.end())
+      for (const FutureUpdate &F : FI->second)
+        if (F.second == Delete && Seen.insert(F.first).second)
+          Children.push_back(F.first);
+    return Children;
+  }
+
+  static TreeNode *findNCD(TreeNode *A, TreeNode *B) {
+    while (A != B) {
+      if (A->getLevel() < B->getLevel())
+        std::swap(A, B);
+      A = A->getIDom();
+    }
+    return A;
+  }
+
+  // Collect in reverse post order the nodes reached from Root through nodes
+  // InRegion accepts.
+  template <typename InRegionFn>
+  void computeRPO(NodeT *Root, InRegionFn InRegion,
+                  SmallVectorImpl<NodeT *> &RPO) const {
+    SmallPtrSet<NodeT *, 32> Visited;
+    SmallVector<std::pair<NodeT *, SmallVector<NodeT *, 8>>, 32> WorkStack;
+    Visited.insert(Root);
+    WorkStack.push_back(std::make_pair(Root, getChildren<false>(Root)));
+    while (!WorkStack.empty()) {
+      SmallVectorImpl<NodeT *> &Succs = WorkStack.back().second;
+      if (Succs.empty()) {
+        RPO.push_back(WorkStack.pop_back_val().first);
+        continue;
+      }
+      NodeT *Succ = Succs.pop_back_val();
+      if (InRegion(Succ) && Visited.insert(Succ).second)
+        WorkStack.push_back(std::make_pair(Succ, getChildren<false>(Succ)));
+    }
+    std::reverse(RPO.begin(), RPO.end());
+  }
+
+  // Compute the immediate dominators of the nodes of RPO, a region in reverse
+  // post order which is only entered through its first node, with the
+  // iterative algorithm of Cooper, Harvey and Kennedy. IDoms[I] is the index
+  // of the immediate dominator of RPO[I].
+  void computeIDoms(ArrayRef<NodeT *> RPO,
+                    SmallVectorImpl<unsigned> &IDoms) const {
+    const unsigned Undef = ~0U;
+    DenseMap<NodeT *, unsigned> Index;
+    for (unsigned I = 0, E = RPO.size(); I != E; ++I)
+      Index[RPO[I]] = I;
+    std::vector<SmallVector<unsigned, 4>> Preds(RPO.size());
+    for (unsigned I = 1, E = RPO.size(); I != E; ++I)
+      for (NodeT *P : getChildren<true>(RPO[I])) {
+        auto It = Index.find(P);
+        if (It != Index.end())
+          Preds[I].push_back(It->second);
+      }
+
+    IDoms.assign(RPO.size(), Undef);
+    IDoms[0] = 0;
+    bool Changed = true;
+    while (Changed) {
+      Changed = false;
+      for (unsigned I = 1, E = RPO.size(); I != E; ++I) {
+        unsigned NewIDom = Undef;
+        for (unsigned P : Preds[I]) {
+          if (IDoms[P] == Undef)
+            continue;
+          if (NewIDom == Undef) {
+            NewIDom = P;
+            continue;
+          }
+          unsigned A = P;
+          while (A != NewIDom) {
+            while (A > NewIDom)
+              A = IDoms[A];
+            while (NewIDom > A)
+              NewIDom = IDoms[NewIDom];
+          }
+        }
+        if (NewIDom != IDoms[I]) {
+          IDoms[I] = NewIDom;
+          Changed = true;
+        }
+      }
+    }
+  }
+
+  void insertEdge(NodeT *From, NodeT *To) {
+    TreeNode *FromTN = DT.getNode(From);
+    // Edges out of unreachable blocks do not change anything.
+    if (!FromTN)
+      return;
+    DT.DFSInfoValid = false;
+    if (TreeNode *ToTN = DT.getNode(To))
+      insertReachable(FromTN, ToTN);
+    else
+      insertUnreachable(FromTN, To);
+  }
+
+  // Add the blocks that From -> To made reachable to the tree, then account
+  // for their edges to the blocks that were already reachable.
+  void insertUnreachable(TreeNode *FromTN, NodeT *To) {
+    SmallVector<NodeT *, 16> RPO;
+    computeRPO(To, [&](NodeT *N) { return !DT.getNode(N); }, RPO);
+
+    SmallVector<std::pair<NodeT *, NodeT *>, 8> EdgesToReachable;
+    for (NodeT *N : RPO)
+      for (NodeT *Succ : getChildren<false>(N))
+        if (DT.getNode(Succ))
+          EdgesToReachable.push_back(std::make_pair(N, Succ));
+
+    SmallVector<unsigned, 16> IDoms;
+    computeIDoms(RPO, IDoms);
+    DT.addNewBlock(To, FromTN->getBlock());
+    for (unsigned I = 1, E = RPO.size(); I != E; ++I)
+      DT.addNewBlock(RPO[I], RPO[IDoms[I]]);
+
+    for (const auto &Edge : EdgesToReachable)
+      insertReachable(DT.getNode(Edge.first), DT.getNode(Edge.second));
+  }
+
+  void insertReachable(TreeNode *FromTN, TreeNode *ToTN) {
+    TreeNode *NCD = findNCD(FromTN, ToTN);
+    const unsigned NCDLevel = NCD->getLevel();
+    // A node v is affected, its immediate dominator becoming NCD, iff
+    // level(NCD) + 1 < level(v) and there is a path from To to v whose nodes
+    // are all at least as deep as v. Nothing is affected unless To is.
+    if (NCDLevel + 1 >= ToTN->getLevel())
+      return;
+
+    // Visit the nodes in decreasing order of the depth of the shallowest node
+    // on the best path reaching them.
+    typedef std::pair<unsigned, TreeNode *> BucketEntry;
+    std::priority_queue<BucketEntry> Bucket;
+    SmallPtrSet<TreeNode *, 16> Visited;
+    SmallVector<TreeNode *, 16> Affected;
+    SmallVector<TreeNode *, 16> UnaffectedOnCurrentLevel;
+    Bucket.push(BucketEntry(ToTN->getLevel(), ToTN));
+    Visited.insert(ToTN);
+
+    while (!Bucket.empty()) {
+      TreeNode *TN = Bucket.top().second;
+      Bucket.pop();
+      Affected.push_back(TN);
+
+      const unsigned CurrentLevel = TN->getLevel();
+      while (true) {
+        for (NodeT *Succ : getChildren<false>(TN->getBlock())) {
+          TreeNode *SuccTN = DT.getNode(Succ);
+          assert(SuccTN && "Unreachable successor of a reachable block!");
+          const unsigned SuccLevel = SuccTN->getLevel();
+          // Nodes not deeper than NCD's children are not affected, nor is
+          // anything only reached through them. The first visit of a node
+          // is along its best path.
+          if (SuccLevel <= NCDLevel + 1 || !Visited.insert(SuccTN).second)
+            continue;
+
+          if (SuccLevel > CurrentLevel)
+            // Not affected, but it may lead to affected nodes.
+            UnaffectedOnCurrentLevel.push_back(SuccTN);
+          else
+            Bucket.push(BucketEntry(SuccLevel, SuccTN));
+        }
+
+        if (UnaffectedOnCurrentLevel.empty())
+          break;
+        TN = UnaffectedOnCurrentLevel.pop_back_val();
+      }
+    }
+
+    for (TreeNode *TN : Affected)
+      TN->setIDom(NCD);
+  }
+
+  void deleteEdge(NodeT *From, NodeT *To) {
+    TreeNode *FromTN = DT.getNode(From);
+    TreeNode *ToTN = DT.getNode(To);
+    // Edges out of unreachable blocks do not change anything.
+    if (!FromTN || !ToTN)
+      return;
+    // Neither does deleting one of several edges between the same blocks.
+    SmallVector<NodeT *, 8> Succs = getChildren<false>(From);
+    if (std::find(Succs.begin(), Succs.end(), To) != Succs.end())
+      return;
+
+    // Nor deleting an edge to a dominator: any path using it already went
+    // through To.
+    TreeNode *NCD = findNCD(FromTN, ToTN);
+    if (NCD == ToTN)
+      return;
+
+    DT.DFSInfoValid = false;
+    // To stays reachable if it does not need From to be reached.
+    if (FromTN != ToTN->getIDom() || hasProperSupport(ToTN))
+      rebuildSubtree(NCD);
+    else
+      deleteUnreachable(ToTN);
+  }
+
+  // Return true if TN has a predecessor it does not dominate.
+  bool hasProperSupport(TreeNode *TN) const {
+    for (NodeT *Pred : getChildren<true>(TN->getBlock())) {
+      TreeNode *PredTN = DT.getNode(Pred);
+      if (PredTN && findNCD(TN, PredTN) != TN)
+        return true;
+    }
+    return false;
+  }
+
+  // Remove the subtree of ToTN, which became unreachable, and rebuild the
+  // part of the tree whose dominators may have been reached through it.
+  void deleteUnreachable(TreeNode *ToTN) {
+    const unsigned Level = ToTN->getLevel();
+    SmallVector<TreeNode *, 16> Doomed(1, ToTN);
+    TreeNode *MinNode = nullptr;
+    for (unsigned I = 0; I != Doomed.size(); ++I) {
+      TreeNode *TN = Doomed[I];
+      Doomed.append(TN->begin(), TN->end());
+      // Successors outside of the subtree are not below its root.
+      for (NodeT *Succ : getChildren<false>(TN->getBlock())) {
+        TreeNode *SuccTN = DT.getNode(Succ);
+        if (!SuccTN || SuccTN->getLevel() > Level)
+          continue;
+        TreeNode *NCD = findNCD(SuccTN, ToTN);
+        if (NCD != SuccTN &&
+            (!MinNode || NCD->getLevel() < MinNode->getLevel()))
+          MinNode = NCD;
+      }
+    }
+
+    for (auto I = Doomed.rbegin(), E = Doomed.rend(); I != E; ++I)
+      DT.eraseNode((*I)->getBlock());
+
+    if (MinNode)
+      rebuildSubtree(MinNode);
+  }
+
+  // Recompute the immediate dominators of the nodes of the subtree of Root,
+  // all of which are reachable from it without leaving the subtree.
+  void rebuildSubtree(TreeNode *Root) {
+    const unsigned Level = Root->getLevel();
+    SmallVector<NodeT *, 32> RPO;
+    computeRPO(Root->getBlock(), [&](NodeT *N) {
+      TreeNode *TN = DT.getNode(N);
+      return TN && TN->getLevel() > Level;
+    }, RPO);
+
+    SmallVector<unsigned, 32> IDoms;
+    computeIDoms(RPO, IDoms);
+    for (unsigned I = 1, E = RPO.size(); I != E; ++I)
+      DT.getNode(RPO[I])->setIDom(DT.getNode(RPO[IDoms[I]]));
+  }
+};
+
+template <class NodeT>
+void DominatorTreeBase<NodeT>::applyUpdates(ArrayRef<UpdateType> Updates) {
+  if (Updates.empty())
+    return;
+
+  if (this->isPostDominator()) {
+    recalculate(*Updates.front().From->getParent());
+    return;
+  }
+
+  Updater(*this).apply(Updates);
+}
+
+}
+
+#endif
@@ -108,6 +108,16 @@ namespace sys {
     static std::error_code protectMappedMemory(const MemoryBlock &Block,
                                                unsigned Flags);
 
+    /// This method asks the operating system to back \p Block, which must
+    /// have been allocated with allocateMappedMemory, with huge pages where
+    /// it can, which lets code spread over it use fewer TLB entries.  This is
+    /// only a hint, which is currently acted on by Linux only.
+    ///
+    /// \r true if the hint was given, false if it is not supported.
+    ///
+    /// @brief Advise the use of huge pages.
+    static bool adviseHugePages(const MemoryBlock &Block);
+
     /// This method allocates a block of Read/Write/Execute memory that is
     /// suitable for executing dynamically generated code (e.g. JIT). An
     /// attempt to allocate \p NumBytes bytes of virtual memory is made.
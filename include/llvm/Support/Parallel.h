@@ -0,0 +1,145 @@
+//===-- llvm/Support/Parallel.h - Parallel algorithms -----------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines parallel_for, parallel_for_each and parallel_sort on top
+// of the default ThreadPool. The callbacks must be safe to run concurrently;
+// the calling thread participates in the work and returns once it is done.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_PARALLEL_H
+#define LLVM_SUPPORT_PARALLEL_H
+
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/ThreadPool.h"
+#include <algorithm>
+#include <functional>
+#include <iterator>
+
+namespace llvm {
+
+namespace detail {
+/// Inputs shorter than this are sorted sequentially.
+const ptrdiff_t MinParallelSortSize = 1024;
+
+/// Number of chunks handed to each worker by the parallel loops, so that a
+/// few slow iterations do not leave the other workers idle.
+const unsigned ChunksPerThread = 4;
+
+template <class RandomAccessIterator, class Comparator>
+RandomAccessIterator medianOf3(RandomAccessIterator Start,
+                               RandomAccessIterator End,
+                               const Comparator &Comp) {
+  RandomAccessIterator Mid = Start + (std::distance(Start, End) / 2);
+  return Comp(*Start, *(End - 1))
+             ? (Comp(*Mid, *(End - 1)) ? (Comp(*Start, *Mid) ? Mid : Start)
+                                       : End - 1)
+             : (Comp(*Mid, *Start) ? (Comp(*(End - 1), *Mid) ? Mid : End - 1)
+                                   : Start);
+}
+
+template <class RandomAccessIterator, class Comparator>
+void parallelQuickSort(RandomAccessIterator Start, RandomAccessIterator End,
+                       const Comparator &Comp, TaskGroup &TG, unsigned Depth) {
+  if (std::distance(Start, End) < MinParallelSortSize || Depth == 0) {
+    std::sort(Start, End, Comp);
+    return;
+  }
+
+  // Partition around a median-of-3 pivot parked at the end of the range.
+  RandomAccessIterator Pivot = medianOf3(Start, End, Comp);
+  std::swap(*(End - 1), *Pivot);
+  Pivot = std::partition(Start, End - 1, [&Comp, End](decltype(*Start) V) {
+    return Comp(V, *(End - 1));
+  });
+  std::swap(*Pivot, *(End - 1));
+
+  TG.spawn([=, &Comp, &TG] {
+    parallelQuickSort(Start, Pivot, Comp, TG, Depth - 1);
+  });
+  parallelQuickSort(Pivot + 1, End, Comp, TG, Depth - 1);
+}
+} // end namespace detail
+
+/// \brief Invoke \p Fn on every element of [\p Begin, \p End) concurrently.
+template <class IterTy, class FuncTy>
+void parallel_for_each(IterTy Begin, IterTy End, FuncTy Fn) {
+  ThreadPool &Pool = getDefaultThreadPool();
+  ptrdiff_t Count = std::distance(Begin, End);
+  if (Pool.getThreadCount() <= 1 || Count <= 1) {
+    std::for_each(Begin, End, Fn);
+    return;
+  }
+
+  ptrdiff_t ChunkSize = std::max<ptrdiff_t>(
+      1, Count / (Pool.getThreadCount() * detail::ChunksPerThread));
+  TaskGroup TG(Pool);
+  while (Count > ChunkSize) {
+    IterTy ChunkEnd = Begin;
+    std::advance(ChunkEnd, ChunkSize);
+    TG.spawn([=, &Fn] { std::for_each(Begin, ChunkEnd, Fn); });
+    Begin = ChunkEnd;
+    Count -= ChunkSize;
+  }
+  // The last chunk runs on the calling thread.
+  std::for_each(Begin, End, Fn);
+  TG.wait();
+}
+
+/// \brief Invoke \p Fn on every index in [\p Begin, \p End) concurrently.
+template <class IndexTy, class FuncTy>
+void parallel_for(IndexTy Begin, IndexTy End, FuncTy Fn) {
+  ThreadPool &Pool = getDefaultThreadPool();
+  if (Pool.getThreadCount() <= 1 || End - Begin <= 1) {
+    for (IndexTy I = Begin; I < End; ++I)
+      Fn(I);
+    return;
+  }
+
+  IndexTy ChunkSize = std::max<IndexTy>(
+      1, (End - Begin) / (Pool.getThreadCount() * detail::ChunksPerThread));
+  TaskGroup TG(Pool);
+  IndexTy I = Begin;
+  for (; End - I > ChunkSize; I += ChunkSize) {
+    TG.spawn([=, &Fn] {
+      for (IndexTy J = I, E = I + ChunkSize; J != E; ++J)
+        Fn(J);
+    });
+  }
+  for (; I < End; ++I)
+    Fn(I);
+  TG.wait();
+}
+
+/// \brief Sort [\p Start, \p End) using \p Comp, splitting the range across
+/// the default pool. Like std::sort, the sort is not stable.
+template <class RandomAccessIterator, class Comparator>
+void parallel_sort(RandomAccessIterator Start, RandomAccessIterator End,
+                   const Comparator &Comp) {
+  ThreadPool &Pool = getDefaultThreadPool();
+  ptrdiff_t Count = std::distance(Start, End);
+  if (Pool.getThreadCount() <= 1 || Count < detail::MinParallelSortSize) {
+    std::sort(Start, End, Comp);
+    return;
+  }
+  TaskGroup TG(Pool);
+  detail::parallelQuickSort(Start, End, Comp, TG, Log2_64(Count) + 1);
+  TG.wait();
+}
+
+template <class RandomAccessIterator>
+void parallel_sort(RandomAccessIterator Start, RandomAccessIterator End) {
+  typedef typename std::iterator_traits<RandomAccessIterator>::value_type
+      ValueTy;
+  parallel_sort(Start, End, std::less<ValueTy>());
+}
+
+} // end namespace llvm
+
+#endif
@@ -52,6 +52,10 @@ public:
   /// allocated space.
   static size_t GetMallocUsage();
 
+  /// \brief Return the amount of memory of the process that is resident in
+  /// physical memory, in bytes, or 0 if this is not supported.
+  static size_t GetResidentMemoryUsage();
+
   /// This static function will set \p user_time to the amount of CPU time
   /// spent in user (non-kernel) mode and \p sys_time to the amount of CPU
   /// time spent in system (kernel) mode.  If the operating system does not
@@ -0,0 +1,176 @@
+//===-- llvm/Support/ThreadPool.h - A work-stealing thread pool -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines a work-stealing ThreadPool and a TaskGroup for waiting on
+// a subset of the tasks submitted to a pool.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_THREADPOOL_H
+#define LLVM_SUPPORT_THREADPOOL_H
+
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/Compiler.h"
+#include "llvm/Support/ThreadLocal.h"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace llvm {
+
+/// \brief Returns the number of hardware threads available to the process,
+/// clamped by the global thread limit (see setMaxThreadCount()). Never
+/// returns zero.
+unsigned getDefaultThreadCount();
+
+/// \brief Sets a process-wide upper bound on the number of worker threads a
+/// ThreadPool may spawn. Zero removes the limit. Pools that are already
+/// running are not resized.
+void setMaxThreadCount(unsigned Limit);
+
+/// \brief Returns the process-wide thread limit, or zero if unlimited.
+unsigned getMaxThreadCount();
+
+/// \brief A pool of worker threads executing asynchronously submitted tasks.
+///
+/// Every worker owns a task deque. Tasks submitted from a worker thread are
+/// pushed onto that worker's deque and popped in LIFO order, which keeps
+/// recursively spawned work cache-local; tasks submitted from any other
+/// thread are distributed round-robin. An idle worker steals the oldest task
+/// from another worker's deque before going to sleep.
+///
+/// When LLVM is built without thread support, tasks run synchronously on the
+/// submitting thread.
+class ThreadPool {
+public:
+  typedef std::function<void()> TaskTy;
+
+  /// \brief Construct a pool of \p ThreadCount workers. A count of zero uses
+  /// getDefaultThreadCount(). The count is clamped to the global limit.
+  explicit ThreadPool(unsigned ThreadCount = 0);
+
+  /// \brief Blocking destructor: drains the queues and joins every worker.
+  ~ThreadPool();
+
+  /// \brief Submit \p F, bound to \p ArgList, for asynchronous execution.
+  /// The returned future can be used to wait on the task; it does not block
+  /// on destruction.
+  template <typename Function, typename... Args>
+  std::shared_future<void> async(Function &&F, Args &&... ArgList) {
+    auto Task =
+        std::bind(std::forward<Function>(F), std::forward<Args>(ArgList)...);
+    return asyncImpl(std::move(Task));
+  }
+
+  /// \brief Submit \p F for asynchronous execution.
+  template <typename Function>
+  std::shared_future<void> async(Function &&F) {
+    return asyncImpl(std::forward<Function>(F));
+  }
+
+  /// \brief Block until every queued and running task has completed. Must
+  /// not be called from one of this pool's worker threads; use a TaskGroup
+  /// to wait on nested work instead.
+  void wait();
+
+  /// \brief Returns the number of worker threads in the pool.
+  unsigned getThreadCount() const { return ThreadCount; }
+
+  /// \brief Returns true if the calling thread is a worker of this pool.
+  bool isWorkerThread() const;
+
+private:
+  friend class TaskGroup;
+
+  struct WorkQueue {
+    std::mutex Lock;
+    std::deque<TaskTy> Tasks;
+    unsigned Index;
+  };
+
+  ThreadPool(const ThreadPool &) = delete;
+  void operator=(const ThreadPool &) = delete;
+
+  std::shared_future<void> asyncImpl(TaskTy F);
+
+  /// Queue \p F without creating a future.
+  void enqueue(TaskTy F);
+
+  /// Pop a task from the calling worker's deque or steal one from another
+  /// worker and run it. Returns false if every deque was empty.
+  bool runOneTask();
+
+  void workerLoop(unsigned Index);
+
+  unsigned ThreadCount;
+  std::vector<std::unique_ptr<WorkQueue>> Queues;
+#if LLVM_ENABLE_THREADS
+  std::vector<std::thread> Threads;
+  mutable sys::ThreadLocal<const WorkQueue> CurrentQueue;
+
+  /// Guards the counters below and the two condition variables.
+  std::mutex StateLock;
+  std::condition_variable WorkAvailable;
+  std::condition_variable Completion;
+  unsigned QueuedTasks;
+  unsigned ActiveTasks;
+  unsigned NextQueue;
+  bool Stopping;
+#endif
+};
+
+/// \brief A set of tasks running on a ThreadPool that can be waited on as a
+/// unit, independently of any other work in the pool.
+///
+/// Waiting from a worker thread of the same pool is allowed: the waiter runs
+/// queued tasks until the group completes instead of blocking a worker, so
+/// groups may be nested arbitrarily.
+class TaskGroup {
+public:
+  explicit TaskGroup(ThreadPool &Pool);
+
+  /// \brief Waits for every task spawned in this group.
+  ~TaskGroup();
+
+  /// \brief Run \p F asynchronously as part of this group.
+  template <typename Function> void spawn(Function &&F) {
+    spawnImpl(ThreadPool::TaskTy(std::forward<Function>(F)));
+  }
+
+  /// \brief Block until every task spawned so far has completed.
+  void wait();
+
+  ThreadPool &getPool() const { return Pool; }
+
+private:
+  TaskGroup(const TaskGroup &) = delete;
+  void operator=(const TaskGroup &) = delete;
+
+  void spawnImpl(ThreadPool::TaskTy F);
+  void finishTask();
+
+  ThreadPool &Pool;
+  std::mutex Lock;
+  std::condition_variable Done;
+  unsigned Pending;
+};
+
+/// \brief Returns the process-wide pool shared by the parallel algorithms in
+/// llvm/Support/Parallel.h. It is created with getDefaultThreadCount()
+/// workers on first use and torn down by llvm_shutdown().
+ThreadPool &getDefaultThreadPool();
+
+} // end namespace llvm
+
+#endif
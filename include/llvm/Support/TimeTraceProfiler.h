@@ -0,0 +1,91 @@
+//===- llvm/Support/TimeTraceProfiler.h - Chrome trace recording -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief This file defines the TimeTraceProfiler class, which records when
+/// each of a set of events ran and how much the resident memory grew during
+/// it, and writes them in the Chrome Trace Event format, which
+/// chrome://tracing and other trace viewers can load.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_TIMETRACEPROFILER_H
+#define LLVM_SUPPORT_TIMETRACEPROFILER_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/DataTypes.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/TimeValue.h"
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace llvm {
+
+class raw_ostream;
+
+/// \brief Records events that may overlap and nest, on any thread.
+class TimeTraceProfiler {
+public:
+  TimeTraceProfiler();
+
+  /// \brief Return the number of microseconds since the profiler was created.
+  uint64_t getTimestamp() const;
+
+  /// \brief Record an event called \p Name that ran on the calling thread from
+  /// \p Start to \p End, as returned by getTimestamp(). \p Detail says what
+  /// the event was about, such as the function a pass ran on, and
+  /// \p RSSDelta by how much the resident memory grew.
+  void addEvent(StringRef Name, StringRef Detail, uint64_t Start,
+                uint64_t End, int64_t RSSDelta);
+
+  /// \brief Write the events recorded so far as a JSON trace.
+  void write(raw_ostream &OS);
+
+private:
+  struct Event {
+    std::string Name;
+    std::string Detail;
+    unsigned ThreadID;
+    uint64_t Start;
+    uint64_t End;
+    int64_t RSSDelta;
+  };
+
+  sys::TimeValue StartTime;
+  sys::Mutex Lock;
+  std::vector<Event> Events;
+  /// Small numbers for the threads that recorded events, in the order they
+  /// did so first.
+  std::map<std::thread::id, unsigned> ThreadIDs;
+};
+
+/// \brief Records an event in a TimeTraceProfiler that runs from the
+/// construction of the region to its destruction.
+class TimeTraceRegion {
+  TimeTraceProfiler *Profiler;
+  std::string Name;
+  std::string Detail;
+  uint64_t Start;
+  size_t StartRSS;
+
+  TimeTraceRegion(const TimeTraceRegion &) = delete;
+  void operator=(const TimeTraceRegion &) = delete;
+
+public:
+  /// \brief Start the event, unless \p Profiler is null.
+  TimeTraceRegion(TimeTraceProfiler *Profiler, StringRef Name,
+                  StringRef Detail);
+  ~TimeTraceRegion();
+};
+
+} // end namespace llvm
+
+#endif
@@ -107,6 +107,21 @@ private:
 
 char CGPassManager::ID = 0;
 
+/// getSCCName - Return the names of the functions of an SCC, for the pass
+/// trace.
+static std::string getSCCName(CallGraphSCC &SCC) {
+  std::string Name;
+  for (CallGraphNode *CGN : SCC) {
+    if (!Name.empty())
+      Name += ", ";
+    if (Function *F = CGN->getFunction())
+      Name += F->getName();
+    else
+      Name += "<external node>";
+  }
+  return Name;
+}
+
 
 bool CGPassManager::RunPassOnSCC(Pass *P, CallGraphSCC &CurSCC,
                                  CallGraph &CG, bool &CallGraphUpToDate,
@@ -123,6 +138,8 @@ bool CGPassManager::RunPassOnSCC(Pass *P, CallGraphSCC &CurSCC,
 
     {
       TimeRegion PassTimer(getPassTimer(CGSP));
+      PassTraceRegion PassTrace(
+          CGSP, PassTraceRegion::isEnabled() ? getSCCName(CurSCC) : "");
       Changed = CGSP->runOnSCC(CurSCC);
     }
     
@@ -147,6 +164,7 @@ bool CGPassManager::RunPassOnSCC(Pass *P, CallGraphSCC &CurSCC,
       dumpPassInfo(P, EXECUTION_MSG, ON_FUNCTION_MSG, F->getName());
       {
         TimeRegion PassTimer(getPassTimer(FPP));
+        PassTraceRegion PassTrace(FPP, F->getName());
         Changed |= FPP->runOnFunction(*F);
       }
       F->getContext().yield();
@@ -247,6 +247,7 @@ bool LPPassManager::runOnFunction(Function &F) {
       {
         PassManagerPrettyStackEntry X(P, *CurrentLoop->getHeader());
         TimeRegion PassTimer(getPassTimer(P));
+        PassTraceRegion PassTrace(P, F.getName());
 
         Changed |= P->runOnLoop(CurrentLoop, *this);
       }
@@ -0,0 +1,732 @@
+//===-- MemorySSA.cpp - Memory SSA Builder --------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the MemorySSA class: building memory SSA with phis at
+// the iterated dominance frontier of the blocks writing memory, keeping it up
+// to date as accesses are moved and removed, and walking it to find the
+// clobbering access of a location.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Analysis/MemorySSA.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/IteratedDominanceFrontier.h"
+#include "llvm/IR/AssemblyAnnotationWriter.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/FormattedStream.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+using namespace llvm;
+
+#define DEBUG_TYPE "memoryssa"
+
+// Always verify MemorySSA if expensive checking is enabled.
+#ifdef XDEBUG
+bool llvm::VerifyMemorySSA = true;
+#else
+bool llvm::VerifyMemorySSA = false;
+#endif
+static cl::opt<bool, true>
+    VerifyMemorySSAX("verify-memoryssa", cl::location(VerifyMemorySSA),
+                     cl::desc("Verify MemorySSA (time consuming)"));
+
+static cl::opt<unsigned> WalkLimit(
+    "memssa-walk-limit", cl::Hidden, cl::init(100),
+    cl::desc("The number of accesses the MemorySSA walker visits before "
+             "giving a conservative answer (default = 100)"));
+
+//===----------------------------------------------------------------------===//
+// MemoryAccess
+//===----------------------------------------------------------------------===//
+
+MemoryAccess::~MemoryAccess() {}
+
+void MemoryAccess::replaceAllUsesWith(MemoryAccess *New) {
+  assert(New != this && "Replacing an access with itself");
+  // Every update below removes this access from the users of the user.
+  while (!Users.empty()) {
+    MemoryAccess *U = *Users.begin();
+    if (auto *MUD = dyn_cast<MemoryUseOrDef>(U)) {
+      MUD->setDefiningAccess(New);
+      continue;
+    }
+    auto *Phi = cast<MemoryPhi>(U);
+    for (unsigned I = 0, E = Phi->getNumIncomingValues(); I != E; ++I)
+      if (Phi->getIncomingValue(I) == this)
+        Phi->setIncomingValue(I, New);
+  }
+}
+
+static void printAccessName(raw_ostream &OS, const MemoryAccess *MA) {
+  if (auto *MD = dyn_cast<MemoryDef>(MA)) {
+    if (!MD->getMemoryInst())
+      OS << "liveOnEntry";
+    else
+      OS << MD->getID();
+  } else {
+    OS << cast<MemoryPhi>(MA)->getID();
+  }
+}
+
+void MemoryAccess::print(raw_ostream &OS) const {
+  switch (getKind()) {
+  case MemoryUseKind:
+    OS << "MemoryUse(";
+    printAccessName(OS, cast<MemoryUse>(this)->getDefiningAccess());
+    OS << ')';
+    break;
+  case MemoryDefKind: {
+    auto *MD = cast<MemoryDef>(this);
+    if (!MD->getMemoryInst()) {
+      OS << "liveOnEntry";
+      break;
+    }
+    OS << MD->getID() << " = MemoryDef(";
+    printAccessName(OS, MD->getDefiningAccess());
+    OS << ')';
+    break;
+  }
+  case MemoryPhiKind: {
+    auto *Phi = cast<MemoryPhi>(this);
+    OS << Phi->getID() << " = MemoryPhi(";
+    for (unsigned I = 0, E = Phi->getNumIncomingValues(); I != E; ++I) {
+      if (I)
+        OS << ',';
+      OS << '{';
+      Phi->getIncomingBlock(I)->printAsOperand(OS, false);
+      OS << ',';
+      printAccessName(OS, Phi->getIncomingValue(I));
+      OS << '}';
+    }
+    OS << ')';
+    break;
+  }
+  }
+}
+
+void MemoryAccess::dump() const {
+  print(dbgs());
+  dbgs() << "\n";
+}
+
+//===----------------------------------------------------------------------===//
+// MemorySSA
+//===----------------------------------------------------------------------===//
+
+MemorySSA::MemorySSA(Function &F, AliasAnalysis &AA, DominatorTree &DT)
+    : F(F), AA(AA), DT(DT), Walker(new MemorySSAWalker(*this, AA)),
+      NextID(0) {
+  buildMemorySSA();
+}
+
+MemorySSA::~MemorySSA() {}
+
+MemoryUseOrDef *MemorySSA::getMemoryAccess(const Instruction *I) const {
+  return cast_or_null<MemoryUseOrDef>(ValueToMemoryAccess.lookup(I));
+}
+
+MemoryPhi *MemorySSA::getMemoryAccess(const BasicBlock *BB) const {
+  return cast_or_null<MemoryPhi>(ValueToMemoryAccess.lookup(BB));
+}
+
+MemorySSA::AccessList &MemorySSA::getOrCreateAccessList(BasicBlock *BB) {
+  std::unique_ptr<AccessList> &Accesses = PerBlockAccesses[BB];
+  if (!Accesses)
+    Accesses.reset(new AccessList());
+  return *Accesses;
+}
+
+/// Return what \p I may do to memory. Calls are classified by their
+/// behavior, so that the calls that only read memory are uses.
+static AliasAnalysis::ModRefResult getAccessModRef(AliasAnalysis &AA,
+                                                   Instruction *I) {
+  if (ImmutableCallSite CS = ImmutableCallSite(I)) {
+    AliasAnalysis::ModRefBehavior MRB = AA.getModRefBehavior(CS);
+    if (MRB == AliasAnalysis::DoesNotAccessMemory)
+      return AliasAnalysis::NoModRef;
+    if (AliasAnalysis::onlyReadsMemory(MRB))
+      return AliasAnalysis::Ref;
+    return AliasAnalysis::ModRef;
+  }
+  return AA.getModRefInfo(I);
+}
+
+/// Create the access of \p I according to what it may do to memory, without
+/// placing it.
+MemoryUseOrDef *MemorySSA::createNewAccess(Instruction *I) {
+  AliasAnalysis::ModRefResult ModRef = getAccessModRef(AA, I);
+  MemoryUseOrDef *MUD;
+  if (ModRef & AliasAnalysis::Mod)
+    MUD = new MemoryDef(I, I->getParent(), NextID++);
+  else if (ModRef & AliasAnalysis::Ref)
+    MUD = new MemoryUse(I, I->getParent());
+  else
+    return nullptr;
+  ValueToMemoryAccess[I] = MUD;
+  return MUD;
+}
+
+/// Link the accesses of \p BB to the memory state \p IncomingVal reaching
+/// the block, and its successors' phis to the state at its end, which is
+/// returned.
+MemoryAccess *MemorySSA::renameBlock(BasicBlock *BB,
+                                     MemoryAccess *IncomingVal) {
+  auto It = PerBlockAccesses.find(BB);
+  if (It != PerBlockAccesses.end()) {
+    for (MemoryAccess &MA : *It->second) {
+      if (auto *MUD = dyn_cast<MemoryUseOrDef>(&MA)) {
+        MUD->setDefiningAccess(IncomingVal);
+        if (isa<MemoryDef>(MUD))
+          IncomingVal = MUD;
+      } else {
+        IncomingVal = &MA;
+      }
+    }
+  }
+  for (BasicBlock *S : successors(BB))
+    if (MemoryPhi *Phi = getMemoryAccess(S))
+      Phi->addIncoming(IncomingVal, BB);
+  return IncomingVal;
+}
+
+void MemorySSA::buildMemorySSA() {
+  // The memory state on entry to the function is number zero.
+  LiveOnEntryDef.reset(new MemoryDef(nullptr, &F.getEntryBlock(), 0));
+  NextID = 1;
+
+  // Create the accesses of the instructions, noting the reachable blocks
+  // that write memory.
+  SmallPtrSet<BasicBlock *, 32> DefiningBlocks;
+  for (BasicBlock &BB : F) {
+    AccessList *Accesses = nullptr;
+    for (Instruction &I : BB) {
+      MemoryUseOrDef *MUD = createNewAccess(&I);
+      if (!MUD)
+        continue;
+      if (!Accesses)
+        Accesses = &getOrCreateAccessList(&BB);
+      Accesses->push_back(MUD);
+      if (isa<MemoryDef>(MUD) && DT.isReachableFromEntry(&BB))
+        DefiningBlocks.insert(&BB);
+    }
+  }
+
+  // Place phis at the iterated dominance frontier of those blocks. The phis
+  // are numbered in the order of the blocks, which does not depend on the
+  // order the frontier is computed in.
+  IDFCalculator IDFs(DT);
+  IDFs.setDefiningBlocks(DefiningBlocks);
+  SmallVector<BasicBlock *, 32> IDFBlocks;
+  IDFs.calculate(IDFBlocks);
+  SmallPtrSet<BasicBlock *, 32> PhiBlocks(IDFBlocks.begin(), IDFBlocks.end());
+  for (BasicBlock &BB : F) {
+    if (!PhiBlocks.count(&BB))
+      continue;
+    MemoryPhi *Phi = new MemoryPhi(&BB, NextID++);
+    ValueToMemoryAccess[&BB] = Phi;
+    getOrCreateAccessList(&BB).push_front(Phi);
+  }
+
+  // Link each access to the memory state reaching it, walking the dominator
+  // tree depth first.
+  struct RenamePassData {
+    DomTreeNode *Node;
+    DomTreeNode::iterator ChildIt;
+    MemoryAccess *IncomingVal;
+  };
+  SmallVector<RenamePassData, 32> WorkStack;
+  DomTreeNode *Root = DT.getRootNode();
+  WorkStack.push_back({Root, Root->begin(),
+                       renameBlock(Root->getBlock(), LiveOnEntryDef.get())});
+  while (!WorkStack.empty()) {
+    RenamePassData &Top = WorkStack.back();
+    if (Top.ChildIt == Top.Node->end()) {
+      WorkStack.pop_back();
+      continue;
+    }
+    DomTreeNode *Child = *Top.ChildIt++;
+    MemoryAccess *IncomingVal = renameBlock(Child->getBlock(), Top.IncomingVal);
+    WorkStack.push_back({Child, Child->begin(), IncomingVal});
+  }
+
+  // Nothing defines the memory state of unreachable code: its accesses, and
+  // the phi entries for edges out of it, see the state on entry.
+  for (BasicBlock &BB : F) {
+    if (DT.isReachableFromEntry(&BB))
+      continue;
+    auto It = PerBlockAccesses.find(&BB);
+    if (It != PerBlockAccesses.end())
+      for (MemoryAccess &MA : *It->second)
+        cast<MemoryUseOrDef>(MA).setDefiningAccess(LiveOnEntryDef.get());
+    for (BasicBlock *S : successors(&BB))
+      if (MemoryPhi *Phi = getMemoryAccess(S))
+        Phi->addIncoming(LiveOnEntryDef.get(), &BB);
+  }
+}
+
+void MemorySSA::recalculate() {
+  Walker->invalidateInfo();
+  ValueToMemoryAccess.clear();
+  PerBlockAccesses.clear();
+  LiveOnEntryDef.reset();
+  buildMemorySSA();
+}
+
+bool MemorySSA::dominates(const MemoryAccess *Dominator,
+                          const MemoryAccess *Dominatee) const {
+  if (Dominator == Dominatee)
+    return true;
+  if (isLiveOnEntryDef(Dominatee))
+    return false;
+  if (isLiveOnEntryDef(Dominator))
+    return true;
+  if (Dominator->getBlock() != Dominatee->getBlock())
+    return DT.dominates(Dominator->getBlock(), Dominatee->getBlock());
+
+  for (const MemoryAccess &MA : *getBlockAccesses(Dominator->getBlock())) {
+    if (&MA == Dominator)
+      return true;
+    if (&MA == Dominatee)
+      return false;
+  }
+  llvm_unreachable("Accesses are not in the list of their block");
+}
+
+/// Return the memory state before \p Point in the accesses of \p BB: the
+/// nearest def or phi before it in \p BB, or else the state at the end of the
+/// nearest dominator that has one.
+MemoryAccess *
+MemorySSA::getReachingDefBefore(BasicBlock *BB,
+                                AccessList::iterator Point) const {
+  if (!DT.isReachableFromEntry(BB))
+    return LiveOnEntryDef.get();
+
+  auto It = PerBlockAccesses.find(BB);
+  if (It != PerBlockAccesses.end())
+    for (AccessList::iterator I = Point; I != It->second->begin();) {
+      --I;
+      if (!isa<MemoryUse>(*I))
+        return &*I;
+    }
+
+  for (DomTreeNode *N = DT.getNode(BB)->getIDom(); N; N = N->getIDom()) {
+    It = PerBlockAccesses.find(N->getBlock());
+    if (It == PerBlockAccesses.end())
+      continue;
+    for (auto I = It->second->rbegin(), E = It->second->rend(); I != E; ++I)
+      if (!isa<MemoryUse>(*I))
+        return &*I;
+  }
+  return LiveOnEntryDef.get();
+}
+
+MemoryUseOrDef *MemorySSA::createMemoryAccessInBB(Instruction *I,
+                                                  BasicBlock *BB,
+                                                  InsertionPlace Point) {
+  assert(I->getParent() == BB && "The instruction is not in the block");
+  assert(!getMemoryAccess(I) && "The instruction already has an access");
+  AliasAnalysis::ModRefResult ModRef = getAccessModRef(AA, I);
+  // A new def would change the memory state seen by the accesses after it,
+  // and may need phis of its own.
+  assert(!(ModRef & AliasAnalysis::Mod) &&
+         "Only accesses that do not write memory can be created");
+  if (!(ModRef & AliasAnalysis::Ref))
+    return nullptr;
+
+  AccessList &Accesses = getOrCreateAccessList(BB);
+  AccessList::iterator Pos = Accesses.end();
+  if (Point == Beginning) {
+    Pos = Accesses.begin();
+    if (Pos != Accesses.end() && isa<MemoryPhi>(*Pos))
+      ++Pos;
+  }
+
+  MemoryUse *MU = new MemoryUse(I, BB);
+  MU->setDefiningAccess(getReachingDefBefore(BB, Pos));
+  Accesses.insert(Pos, MU);
+  ValueToMemoryAccess[I] = MU;
+  return MU;
+}
+
+void MemorySSA::removeMemoryAccess(MemoryAccess *MA) {
+  assert(!isLiveOnEntryDef(MA) && "Cannot remove the live on entry def");
+
+  // Find the memory state the users of MA see once it is gone.
+  MemoryAccess *NewDefTarget = nullptr;
+  if (auto *MUD = dyn_cast<MemoryUseOrDef>(MA)) {
+    NewDefTarget = MUD->getDefiningAccess();
+    MUD->setDefiningAccess(nullptr);
+    ValueToMemoryAccess.erase(MUD->getMemoryInst());
+  } else {
+    auto *Phi = cast<MemoryPhi>(MA);
+    for (unsigned I = 0, E = Phi->getNumIncomingValues(); I != E; ++I) {
+      MemoryAccess *In = Phi->getIncomingValue(I);
+      if (In == Phi)
+        continue;
+      assert((!NewDefTarget || NewDefTarget == In) &&
+             "Cannot remove a phi merging different memory states");
+      NewDefTarget = In;
+    }
+    Phi->dropIncomingValues();
+    ValueToMemoryAccess.erase(Phi->getBlock());
+  }
+
+  if (!isa<MemoryUse>(MA))
+    MA->replaceAllUsesWith(NewDefTarget);
+  // The walker may have cached answers naming MA, passing through it, or
+  // asked by it, and a new access may be allocated where it was.
+  Walker->invalidateInfo();
+
+  auto It = PerBlockAccesses.find(MA->getBlock());
+  It->second->erase(MA);
+  if (It->second->empty())
+    PerBlockAccesses.erase(It);
+}
+
+namespace {
+/// Prints the accesses of the function before its instructions.
+class MemorySSAAnnotatedWriter : public AssemblyAnnotationWriter {
+  const MemorySSA *MSSA;
+
+public:
+  MemorySSAAnnotatedWriter(const MemorySSA *M) : MSSA(M) {}
+
+  void emitBasicBlockStartAnnot(const BasicBlock *BB,
+                                formatted_raw_ostream &OS) override {
+    if (MemoryAccess *MA = MSSA->getMemoryAccess(BB))
+      OS << "; " << *MA << "\n";
+  }
+
+  void emitInstructionAnnot(const Instruction *I,
+                            formatted_raw_ostream &OS) override {
+    if (MemoryAccess *MA = MSSA->getMemoryAccess(I))
+      OS << "; " << *MA << "\n";
+  }
+};
+} // end anonymous namespace
+
+void MemorySSA::print(raw_ostream &OS) const {
+  MemorySSAAnnotatedWriter Writer(this);
+  F.print(OS, &Writer);
+}
+
+void MemorySSA::dump() const { print(dbgs()); }
+
+void MemorySSA::verifyMemorySSA() const {
+  for (BasicBlock &BB : F) {
+    // The accesses of the block are its phi, then those of its instructions
+    // in order.
+    SmallVector<const MemoryAccess *, 32> Expected;
+    if (MemoryPhi *Phi = getMemoryAccess(&BB))
+      Expected.push_back(Phi);
+    for (Instruction &I : BB)
+      if (MemoryUseOrDef *MUD = getMemoryAccess(&I))
+        Expected.push_back(MUD);
+    const AccessList *Accesses = getBlockAccesses(&BB);
+    assert(bool(Accesses) == !Expected.empty() &&
+           "Block access list does not match the block");
+    if (!Accesses)
+      continue;
+
+    bool Reachable = DT.isReachableFromEntry(&BB);
+    unsigned Pos = 0;
+    SmallPtrSet<const MemoryAccess *, 32> Seen;
+    for (const MemoryAccess &MA : *Accesses) {
+      assert(Pos < Expected.size() && &MA == Expected[Pos] &&
+             "Accesses are not in the order of their instructions");
+      assert(MA.getBlock() == &BB && "Access is in the wrong block");
+      ++Pos;
+      Seen.insert(&MA);
+
+      if (auto *MUD = dyn_cast<MemoryUseOrDef>(&MA)) {
+        MemoryAccess *Def = MUD->getDefiningAccess();
+        assert(Def && !isa<MemoryUse>(Def) && "Access has no definition");
+        assert(std::find(Def->user_begin(), Def->user_end(), MUD) !=
+                   Def->user_end() &&
+               "Access is not a user of its definition");
+        assert((!Reachable || isLiveOnEntryDef(Def) ||
+                (Def->getBlock() == &BB ? Seen.count(Def)
+                                        : DT.dominates(Def->getBlock(), &BB))) &&
+               "Access is not dominated by its definition");
+        (void)Def;
+        continue;
+      }
+
+      const auto *Phi = cast<MemoryPhi>(&MA);
+      assert(Phi->getNumIncomingValues() ==
+                 unsigned(std::distance(pred_begin(&BB), pred_end(&BB))) &&
+             "Phi does not have one access per predecessor edge");
+      for (unsigned I = 0, E = Phi->getNumIncomingValues(); I != E; ++I) {
+        MemoryAccess *In = Phi->getIncomingValue(I);
+        BasicBlock *Pred = Phi->getIncomingBlock(I);
+        assert(In && !isa<MemoryUse>(In) && "Phi has no incoming access");
+        assert((!DT.isReachableFromEntry(Pred) || isLiveOnEntryDef(In) ||
+                DT.dominates(In->getBlock(), Pred)) &&
+               "Incoming access does not dominate its edge");
+        (void)In;
+        (void)Pred;
+      }
+    }
+    assert(Pos == Expected.size() &&
+           "Block access list does not match the block");
+    (void)Reachable;
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// MemorySSAWalker
+//===----------------------------------------------------------------------===//
+
+static const unsigned NoLink = ~0U;
+
+/// What a walk looks for: the clobber of a location, or of a call.
+struct MemorySSAWalker::Query {
+  MemoryLocation Loc;
+  /// The instruction accessing Loc, if the walk is for one.
+  const Instruction *Inst;
+  const Instruction *Call;
+  /// The access of Inst or Call, under which the answers are cached, or null
+  /// if they are not.
+  const MemoryUseOrDef *Origin;
+  /// The phis being walked through, and their depth in the walk.
+  DenseMap<const MemoryPhi *, unsigned> OnStack;
+  /// The number of accesses the walk may still visit.
+  unsigned Budget;
+  /// Whether the budget ran out; nothing is cached after that.
+  bool Exhausted;
+
+  Query()
+      : Inst(nullptr), Call(nullptr), Origin(nullptr), Budget(WalkLimit),
+        Exhausted(false) {}
+};
+
+/// Return true if the load \p Use cannot be moved above the load
+/// \p MayClobber, which is ordered or volatile, and so a MemoryDef.
+static bool loadsAreOrdered(const LoadInst *Use, const LoadInst *MayClobber,
+                            AliasAnalysis &AA) {
+  // Nothing moves above an acquire, and a sequentially consistent load moves
+  // above no other load.
+  if (isAtLeastAcquire(MayClobber->getOrdering()) ||
+      Use->getOrdering() == SequentiallyConsistent)
+    return true;
+  // Volatile loads keep their order.
+  if (Use->isVolatile() && MayClobber->isVolatile())
+    return true;
+  // Volatile accesses are only ordered among themselves, so a plain load
+  // moves above any load that is not an acquire. Other loads keep their order
+  // unless they do not alias.
+  if (Use->isUnordered())
+    return false;
+  return AA.alias(MemoryLocation::get(Use), MemoryLocation::get(MayClobber));
+}
+
+bool MemorySSAWalker::clobbers(const MemoryDef *MD, const Query &Q) const {
+  Instruction *DefInst = MD->getMemoryInst();
+  if (Q.Call) {
+    if (isa<FenceInst>(DefInst))
+      return true;
+    return AA.getModRefInfo(DefInst, ImmutableCallSite(Q.Call)) !=
+           AliasAnalysis::NoModRef;
+  }
+  // AliasAnalysis takes an ordered load to write all of memory.
+  if (auto *DefLoad = dyn_cast<LoadInst>(DefInst))
+    if (auto *UseLoad = dyn_cast_or_null<LoadInst>(Q.Inst))
+      return loadsAreOrdered(UseLoad, DefLoad, AA);
+  return AA.getModRefInfo(DefInst, Q.Loc) & AliasAnalysis::Mod;
+}
+
+MemoryAccess *MemorySSAWalker::lookup(const MemoryAccess *MA,
+                                      const Query &Q) const {
+  if (!Q.Origin)
+    return nullptr;
+  return CachedClobbers.lookup(std::make_pair(MA, Q.Origin));
+}
+
+void MemorySSAWalker::cache(const MemoryAccess *MA, const Query &Q,
+                            MemoryAccess *Clobber) {
+  if (Q.Origin)
+    CachedClobbers[std::make_pair(MA, Q.Origin)] = Clobber;
+}
+
+/// Walk up from \p MA to the clobber of the query. Return null if every path
+/// leads back to a phi being walked through, and set \p LowLink to the
+/// smallest depth of such a phi, or NoLink if there is none: the answer
+/// depends on the other paths of that phi until it is done, and is only
+/// cached then.
+MemoryAccess *MemorySSAWalker::walk(MemoryAccess *MA, Query &Q,
+                                    unsigned &LowLink) {
+  LowLink = NoLink;
+  SmallVector<const MemoryAccess *, 8> Skipped;
+  MemoryAccess *Result;
+  while (true) {
+    if (MemoryAccess *Cached = lookup(MA, Q)) {
+      Result = Cached;
+      break;
+    }
+    if (MSSA.isLiveOnEntryDef(MA)) {
+      Result = MA;
+      break;
+    }
+    // Out of budget: MA may clobber, as far as we know.
+    if (Q.Budget == 0) {
+      Q.Exhausted = true;
+      Result = MA;
+      break;
+    }
+    --Q.Budget;
+    if (auto *Phi = dyn_cast<MemoryPhi>(MA)) {
+      Result = walkPhi(Phi, Q, LowLink);
+      break;
+    }
+    auto *MD = cast<MemoryDef>(MA);
+    Skipped.push_back(MD);
+    if (clobbers(MD, Q)) {
+      Result = MD;
+      break;
+    }
+    MA = MD->getDefiningAccess();
+  }
+
+  if (Result && LowLink == NoLink && !Q.Exhausted)
+    for (const MemoryAccess *S : Skipped)
+      cache(S, Q, Result);
+  return Result;
+}
+
+/// Walk up all the incoming paths of \p Phi. The clobber is the one all the
+/// paths agree on, or else the phi itself.
+MemoryAccess *MemorySSAWalker::walkPhi(MemoryPhi *Phi, Query &Q,
+                                       unsigned &LowLink) {
+  auto It = Q.OnStack.find(Phi);
+  if (It != Q.OnStack.end()) {
+    // A cycle back to a phi being walked through adds nothing to it.
+    LowLink = It->second;
+    return nullptr;
+  }
+  unsigned Depth = Q.OnStack.size() + 1;
+  Q.OnStack[Phi] = Depth;
+
+  LowLink = NoLink;
+  MemoryAccess *Result = nullptr;
+  for (unsigned I = 0, E = Phi->getNumIncomingValues(); I != E; ++I) {
+    unsigned InLowLink;
+    MemoryAccess *InResult = walk(Phi->getIncomingValue(I), Q, InLowLink);
+    LowLink = std::min(LowLink, InLowLink);
+    if (!InResult)
+      continue;
+    if (!Result) {
+      Result = InResult;
+    } else if (InResult != Result) {
+      // Whatever the other paths find, they disagree.
+      Result = Phi;
+      break;
+    }
+  }
+  Q.OnStack.erase(Phi);
+
+  // The answer is final unless a path led back to a phi that is still being
+  // walked through.
+  if (Result == Phi || LowLink >= Depth) {
+    LowLink = NoLink;
+    if (!Result)
+      Result = Phi;
+    if (!Q.Exhausted)
+      cache(Phi, Q, Result);
+  }
+  return Result;
+}
+
+MemoryAccess *MemorySSAWalker::doQuery(MemoryAccess *Start, Query &Q) {
+  unsigned LowLink;
+  MemoryAccess *Result = walk(Start, Q, LowLink);
+  assert(Result && LowLink == NoLink && "Walk ended in a cycle");
+  return Result;
+}
+
+MemoryAccess *
+MemorySSAWalker::getClobberingMemoryAccess(const Instruction *I) {
+  MemoryUseOrDef *MUD = MSSA.getMemoryAccess(I);
+  assert(MUD && "The instruction does not touch memory");
+  MemoryAccess *Start = MUD->getDefiningAccess();
+
+  Query Q;
+  Q.Origin = MUD;
+  if (ImmutableCallSite(I)) {
+    Q.Call = I;
+    return doQuery(Start, Q);
+  }
+  // Fences have no location; the nearest def is all we can say.
+  if (!isa<LoadInst>(I) && !isa<StoreInst>(I) && !isa<VAArgInst>(I) &&
+      !isa<AtomicCmpXchgInst>(I) && !isa<AtomicRMWInst>(I))
+    return Start;
+
+  Q.Loc = MemoryLocation::get(I);
+  Q.Inst = I;
+  // Nothing clobbers memory that is never written.
+  if (auto *LI = dyn_cast<LoadInst>(I))
+    if (LI->isUnordered() &&
+        (LI->getMetadata(LLVMContext::MD_invariant_load) ||
+         AA.pointsToConstantMemory(Q.Loc)))
+      return MSSA.getLiveOnEntryDef();
+  return doQuery(Start, Q);
+}
+
+MemoryAccess *
+MemorySSAWalker::getClobberingMemoryAccess(MemoryAccess *Start,
+                                           const MemoryLocation &Loc) {
+  Query Q;
+  Q.Loc = Loc;
+  return doQuery(Start, Q);
+}
+
+//===----------------------------------------------------------------------===//
+// MemorySSAWrapperPass
+//===----------------------------------------------------------------------===//
+
+char MemorySSAWrapperPass::ID = 0;
+INITIALIZE_PASS_BEGIN(MemorySSAWrapperPass, "memoryssa", "Memory SSA", false,
+                      true)
+INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
+INITIALIZE_AG_DEPENDENCY(AliasAnalysis)
+INITIALIZE_PASS_END(MemorySSAWrapperPass, "memoryssa", "Memory SSA", false,
+                    true)
+
+MemorySSAWrapperPass::MemorySSAWrapperPass() : FunctionPass(ID) {
+  initializeMemorySSAWrapperPassPass(*PassRegistry::getPassRegistry());
+}
+
+void MemorySSAWrapperPass::getAnalysisUsage(AnalysisUsage &AU) const {
+  AU.setPreservesAll();
+  AU.addRequiredTransitive<DominatorTreeWrapperPass>();
+  AU.addRequiredTransitive<AliasAnalysis>();
+}
+
+bool MemorySSAWrapperPass::runOnFunction(Function &F) {
+  DominatorTree &DT = getAnalysis<DominatorTreeWrapperPass>().getDomTree();
+  AliasAnalysis &AA = getAnalysis<AliasAnalysis>();
+  MSSA.reset(new MemorySSA(F, AA, DT));
+  if (VerifyMemorySSA)
+    MSSA->verifyMemorySSA();
+  return false;
+}
+
+void MemorySSAWrapperPass::verifyAnalysis() const {
+  if (VerifyMemorySSA)
+    MSSA->verifyMemorySSA();
+}
+
+void MemorySSAWrapperPass::print(raw_ostream &OS, const Module *M) const {
+  MSSA->print(OS);
+}
@@ -101,6 +101,16 @@ STATISTIC(NumTripCountsNotComputed,
           "Number of loops without predictable loop counts");
 STATISTIC(NumBruteForceTripCountsComputed,
           "Number of loops with trip counts computed by force");
+STATISTIC(NumWorkBudgetsExhausted,
+          "Number of functions exhausting the work budget");
+STATISTIC(NumSCEVsOverBudget,
+          "Number of values left unknown for lack of work budget");
+STATISTIC(NumTripCountsOverBudget,
+          "Number of loops without trip counts for lack of work budget");
+STATISTIC(NumImpliedCondsOverBudget,
+          "Number of implied conditions not checked for lack of work budget");
+STATISTIC(NumKnownPredicateCacheHits,
+          "Number of isKnownPredicate queries answered from the cache");
 
 static cl::opt<unsigned>
 MaxBruteForceIterations("scalar-evolution-max-iterations", cl::ReallyHidden,
@@ -109,6 +119,13 @@ MaxBruteForceIterations("scalar-evolution-max-iterations", cl::ReallyHidden,
                                  "derived loop"),
                         cl::init(100));
 
+static cl::opt<unsigned>
+MaxWork("scalar-evolution-max-work", cl::Hidden,
+        cl::desc("Maximum number of values, loops and implied conditions "
+                 "ScalarEvolution analyzes in a function before leaving new "
+                 "ones unknown (0 = unlimited)"),
+        cl::init(1000000));
+
 // FIXME: Enable this with XDEBUG when the test suite is clean.
 static cl::opt<bool>
 VerifySCEV("verify-scev",
@@ -3323,7 +3340,9 @@ const SCEV *ScalarEvolution::getSCEV(Value *V) {
     else
       ValueExprMap.erase(I);
   }
+  ++NumPendingComputations;
   const SCEV *S = createSCEV(V);
+  --NumPendingComputations;
 
   // The process of creating a SCEV for V may have caused other SCEVs
   // to have been created, so it's necessary to insert the new entry
@@ -4106,6 +4125,13 @@ const SCEV *ScalarEvolution::createSCEV(Value *V) {
     // analysis depends on.
     if (!DT->isReachableFromEntry(I->getParent()))
       return getUnknown(V);
+
+    // Once the work budget is spent, leave new instructions unanalyzed, which
+    // is always correct, so that pathological inputs take bounded time.
+    if (!chargeWork()) {
+      ++NumSCEVsOverBudget;
+      return getUnknown(V);
+    }
   } else if (ConstantExpr *CE = dyn_cast<ConstantExpr>(V))
     Opcode = CE->getOpcode();
   else if (ConstantInt *CI = dyn_cast<ConstantInt>(V))
@@ -4613,7 +4639,16 @@ ScalarEvolution::getBackedgeTakenInfo(const Loop *L) {
   // ComputeBackedgeTakenCount may allocate memory for its result. Inserting it
   // into the BackedgeTakenCounts map transfers ownership. Otherwise, the result
   // must be cleared in this scope.
-  BackedgeTakenInfo Result = ComputeBackedgeTakenCount(L);
+  BackedgeTakenInfo Result;
+  if (chargeWork()) {
+    ++NumPendingComputations;
+    Result = ComputeBackedgeTakenCount(L);
+    --NumPendingComputations;
+  } else {
+    SmallVector<std::pair<BasicBlock *, const SCEV *>, 1> NoExitCounts;
+    Result = BackedgeTakenInfo(NoExitCounts, false, getCouldNotCompute());
+    ++NumTripCountsOverBudget;
+  }
 
   if (Result.getExact(this) != getCouldNotCompute()) {
     assert(isLoopInvariant(Result.getExact(this), L) &&
@@ -4677,6 +4712,9 @@ ScalarEvolution::getBackedgeTakenInfo(const Loop *L) {
 /// changed a loop in a way that may effect ScalarEvolution's ability to
 /// compute a trip count, or if the loop is deleted.
 void ScalarEvolution::forgetLoop(const Loop *L) {
+  // Known predicates may have been proved from the loop's guards.
+  KnownPredicates.clear();
+
   // Drop any stored trip count value.
   DenseMap<const Loop*, BackedgeTakenInfo>::iterator BTCPos =
     BackedgeTakenCounts.find(L);
@@ -4717,6 +4755,10 @@ void ScalarEvolution::forgetLoop(const Loop *L) {
 /// changed a value in a way that may effect its value, or which may
 /// disconnect it from a def-use chain linking it to a loop.
 void ScalarEvolution::forgetValue(Value *V) {
+  // Known predicates may have been proved from V, such as a condition, even if
+  // it has no expression of its own.
+  KnownPredicates.clear();
+
   Instruction *I = dyn_cast<Instruction>(V);
   if (!I) return;
 
@@ -6585,6 +6627,30 @@ bool ScalarEvolution::isKnownPredicate(ICmpInst::Predicate Pred,
   // Canonicalize the inputs first.
   (void)SimplifyICmpOperands(Pred, LHS, RHS);
 
+  // Results computed while expressions or trip counts are being computed, or
+  // while isImpliedCond or isLoopBackedgeGuardedByCond are cutting recursion
+  // short, may be weaker than they should, so only those of outermost
+  // queries are memoized.
+  if (NumPendingComputations || !PendingLoopPredicates.empty() ||
+      WalkingBEDominatingConds)
+    return isKnownPredicateUncached(Pred, LHS, RHS);
+
+  auto Key = std::make_pair(std::make_pair(LHS, RHS), unsigned(Pred));
+  auto I = KnownPredicates.find(Key);
+  if (I != KnownPredicates.end()) {
+    ++NumKnownPredicateCacheHits;
+    return I->second;
+  }
+  bool Result = isKnownPredicateUncached(Pred, LHS, RHS);
+  // The query may have added entries to the cache, so look up the insert
+  // position again.
+  KnownPredicates[Key] = Result;
+  return Result;
+}
+
+bool ScalarEvolution::isKnownPredicateUncached(ICmpInst::Predicate Pred,
+                                               const SCEV *LHS,
+                                               const SCEV *RHS) {
   // If LHS or RHS is an addrec, check to see if the condition is true in
   // every iteration of the loop.
   // If LHS and RHS are both addrec, both conditions must be true in
@@ -6865,6 +6931,11 @@ bool ScalarEvolution::isImpliedCond(ICmpInst::Predicate Pred,
   if (Mark.Pending)
     return false;
 
+  if (!chargeWork()) {
+    ++NumImpliedCondsOverBudget;
+    return false;
+  }
+
   // Recursively handle And and Or conditions.
   if (BinaryOperator *BO = dyn_cast<BinaryOperator>(FoundCondValue)) {
     if (BO->getOpcode() == Instruction::And) {
@@ -8060,7 +8131,8 @@ ScalarEvolution::SCEVCallbackVH::SCEVCallbackVH(Value *V, ScalarEvolution *se)
 //===----------------------------------------------------------------------===//
 
 ScalarEvolution::ScalarEvolution()
-    : FunctionPass(ID), WalkingBEDominatingConds(false), ValuesAtScopes(64),
+    : FunctionPass(ID), WalkingBEDominatingConds(false), WorkDone(0),
+      NumPendingComputations(0), ValuesAtScopes(64),
       LoopDispositions(64), BlockDispositions(64), FirstUnknown(nullptr) {
   initializeScalarEvolutionPass(*PassRegistry::getPassRegistry());
 }
@@ -8071,9 +8143,23 @@ bool ScalarEvolution::runOnFunction(Function &F) {
   LI = &getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
   TLI = &getAnalysis<TargetLibraryInfoWrapperPass>().getTLI();
   DT = &getAnalysis<DominatorTreeWrapperPass>().getDomTree();
+  WorkDone = 0;
   return false;
 }
 
+bool ScalarEvolution::chargeWork() {
+  if (!MaxWork)
+    return true;
+  if (WorkDone == MaxWork)
+    return false;
+  if (++WorkDone == MaxWork) {
+    ++NumWorkBudgetsExhausted;
+    DEBUG(dbgs() << "SCEV: work budget exhausted in function " << F->getName()
+                 << "\n");
+  }
+  return true;
+}
+
 void ScalarEvolution::releaseMemory() {
   // Iterate through all the SCEVUnknown instances and call their
   // destructors, so that they release their references to their values.
@@ -8093,6 +8179,7 @@ void ScalarEvolution::releaseMemory() {
 
   assert(PendingLoopPredicates.empty() && "isImpliedCond garbage");
   assert(!WalkingBEDominatingConds && "isLoopBackedgeGuardedByCond garbage!");
+  assert(!NumPendingComputations && "getSCEV garbage!");
 
   BackedgeTakenCounts.clear();
   ConstantEvolutionLoopExitValue.clear();
@@ -8101,6 +8188,8 @@ void ScalarEvolution::releaseMemory() {
   BlockDispositions.clear();
   UnsignedRanges.clear();
   SignedRanges.clear();
+  KnownPredicates.clear();
+  WorkDone = 0;
   UniqueSCEVs.clear();
   SCEVAllocator.Reset();
 }
@@ -8436,6 +8525,7 @@ void ScalarEvolution::forgetMemoizedResults(const SCEV *S) {
   BlockDispositions.erase(S);
   UnsignedRanges.erase(S);
   SignedRanges.erase(S);
+  KnownPredicates.clear();
 
   for (DenseMap<const Loop*, BackedgeTakenInfo>::iterator I =
          BackedgeTakenCounts.begin(), E = BackedgeTakenCounts.end(); I != E; ) {
@@ -381,11 +381,13 @@ static bool isEphemeralValueOf(Instruction *I, const Value *E) {
 
     // If all uses of this value are ephemeral, then so is this value.
     bool FoundNEUse = false;
+    V->lockUseList();
     for (const User *I : V->users())
       if (!EphValues.count(I)) {
         FoundNEUse = true;
         break;
       }
+    V->unlockUseList();
 
     if (!FoundNEUse) {
       if (V == E)
@@ -658,6 +660,10 @@ static void computeKnownBitsFromDominatingCondition(Value *V, APInt &KnownZero,
   }
 
   // Option 2 - Search the other uses of V
+  // The users of a constant or global are in any function, and while the
+  // context is multithreaded other threads may be changing them.
+  if (isa<Constant>(V) && V->getContext().isMultithreaded())
+    return;
   unsigned NumUsesExplored = 0;
   for (auto U : V->users()) {
     // Avoid massive lists
@@ -3186,6 +3192,11 @@ bool llvm::isKnownNonNull(const Value *V, const TargetLibraryInfo *TLI) {
 static bool isKnownNonNullFromDominatingCondition(const Value *V,
                                                   const Instruction *CtxI,
                                                   const DominatorTree *DT) {
+  // The users of a constant or global are in any function, and while the
+  // context is multithreaded other threads may be changing them.
+  if (isa<Constant>(V) && V->getContext().isMultithreaded())
+    return false;
+
   unsigned NumUsesExplored = 0;
   for (auto U : V->users()) {
     // Avoid massive lists
@@ -11,6 +11,7 @@
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/Bitcode/BitstreamReader.h"
 #include "llvm/Bitcode/LLVMBitCodes.h"
@@ -36,6 +37,10 @@
 #include <deque>
 using namespace llvm;
 
+#define DEBUG_TYPE "bitcode-reader"
+
+STATISTIC(NumFunctionBodiesRead, "Number of function bodies read");
+
 namespace {
 enum {
   SWITCH_INST_MAGIC = 0x4B5 // May 2012 => 1205 => Hex
@@ -185,6 +190,14 @@ class BitcodeReader : public GVMaterializer {
   /// where to find deferred function body in the stream.
   DenseMap<Function*, uint64_t> DeferredFunctionInfo;
 
+  /// Bit position of the FUNCTION_INDEX block, or 0 if the module has none.
+  /// The index fills in DeferredFunctionInfo for all bodies at once.
+  uint64_t FunctionIndexBit = 0;
+
+  /// True if the bitcode is being streamed in, in which case the function
+  /// index at the end of the module is not worth fetching early.
+  bool IsStreamed = false;
+
   /// When Metadata block is initially scanned when parsing the module, we may
   /// choose to defer parsing of the metadata. This vector contains info about
   /// which Metadata blocks are deferred.
@@ -360,6 +373,7 @@ private:
   std::error_code parseValueSymbolTable();
   std::error_code parseConstants();
   std::error_code rememberAndSkipFunctionBody();
+  std::error_code parseFunctionIndex();
   /// Save the positions of the Metadata blocks and skip parsing the blocks.
   std::error_code rememberAndSkipMetadata();
   std::error_code parseFunctionBody(Function *F);
@@ -2709,7 +2723,10 @@ std::error_code BitcodeReader::rememberAndSkipFunctionBody() {
 
   // Save the current stream state.
   uint64_t CurBit = Stream.GetCurrentBitNo();
-  DeferredFunctionInfo[Fn] = CurBit;
+  uint64_t &BodyBit = DeferredFunctionInfo[Fn];
+  assert((BodyBit == 0 || BodyBit == CurBit) &&
+         "Function index disagrees with the function block position");
+  BodyBit = CurBit;
 
   // Skip over the function block for now.
   if (Stream.SkipBlock())
@@ -2717,6 +2734,58 @@ std::error_code BitcodeReader::rememberAndSkipFunctionBody() {
   return std::error_code();
 }
 
+/// Read the FUNCTION_INDEX block and record where every function body lives,
+/// so that any of them can be materialized without first skipping over the
+/// bodies that precede it.  The stream position is preserved.
+std::error_code BitcodeReader::parseFunctionIndex() {
+  // The index points at the start of each FUNCTION_BLOCK, whereas deferred
+  // positions are taken after its abbrev ID and block ID have been read.
+  uint64_t BodyDelta = Stream.getAbbrevIDWidth() + bitc::BlockIDWidth;
+  uint64_t CurBit = Stream.GetCurrentBitNo();
+  if (!Stream.canSkipToPos(FunctionIndexBit / 8))
+    return error("Invalid record");
+  Stream.JumpToBit(FunctionIndexBit);
+
+  BitstreamEntry Entry = Stream.advance();
+  if (Entry.Kind != BitstreamEntry::SubBlock ||
+      Entry.ID != bitc::FUNCTION_INDEX_BLOCK_ID ||
+      Stream.EnterSubBlock(bitc::FUNCTION_INDEX_BLOCK_ID))
+    return error("Malformed block");
+
+  SmallVector<uint64_t, 2> Record;
+  while (1) {
+    Entry = Stream.advanceSkippingSubblocks();
+    switch (Entry.Kind) {
+    case BitstreamEntry::SubBlock: // Handled for us already.
+    case BitstreamEntry::Error:
+      return error("Malformed block");
+    case BitstreamEntry::EndBlock:
+      Stream.JumpToBit(CurBit);
+      return std::error_code();
+    case BitstreamEntry::Record:
+      break;
+    }
+
+    Record.clear();
+    switch (Stream.readRecord(Entry.ID, Record)) {
+    default: // Default behavior: ignore.
+      break;
+    case bitc::FUNCTION_INDEX_CODE_ENTRY: { // ENTRY: [valueid, offset]
+      if (Record.size() < 2 || Record[0] >= ValueList.size())
+        return error("Invalid record");
+      Function *F = dyn_cast_or_null<Function>(ValueList[Record[0]]);
+      auto DFII = F ? DeferredFunctionInfo.find(F) : DeferredFunctionInfo.end();
+      uint64_t BodyBit = Record[1] + BodyDelta;
+      if (DFII == DeferredFunctionInfo.end() ||
+          !Stream.canSkipToPos(BodyBit / 8))
+        return error("Invalid record");
+      DFII->second = BodyBit;
+      break;
+    }
+    }
+  }
+}
+
 std::error_code BitcodeReader::globalCleanup() {
   // Patch the initializers for globals and aliases up.
   resolveGlobalAndAliasInits();
@@ -2813,6 +2882,9 @@ std::error_code BitcodeReader::parseModule(bool Resume,
           if (std::error_code EC = globalCleanup())
             return EC;
           SeenFirstFunctionBody = true;
+          if (FunctionIndexBit && !IsStreamed)
+            if (std::error_code EC = parseFunctionIndex())
+              return EC;
         }
 
         if (std::error_code EC = rememberAndSkipFunctionBody())
@@ -2895,6 +2967,12 @@ std::error_code BitcodeReader::parseModule(bool Resume,
       SectionTable.push_back(S);
       break;
     }
+    case bitc::MODULE_CODE_FNINDEX: { // FNINDEX: [offset]
+      if (Record.size() < 1)
+        return error("Invalid record");
+      FunctionIndexBit = Record[0] * 32;
+      break;
+    }
     case bitc::MODULE_CODE_GCNAME: {  // SECTIONNAME: [strchr x N]
       std::string S;
       if (convertToString(Record, 0, S))
@@ -4470,6 +4548,7 @@ std::error_code BitcodeReader::materialize(GlobalValue *GV) {
   if (std::error_code EC = parseFunctionBody(F))
     return EC;
   F->setIsMaterializable(false);
+  ++NumFunctionBodiesRead;
 
   if (StripDebugInfo)
     stripDebugInfo(*F);
@@ -4599,6 +4678,7 @@ std::error_code
 BitcodeReader::initLazyStream(std::unique_ptr<DataStreamer> Streamer) {
   // Check and strip off the bitcode wrapper; BitstreamReader expects never to
   // see it.
+  IsStreamed = true;
   auto OwnedBytes =
       llvm::make_unique<StreamingMemoryObject>(std::move(Streamer));
   StreamingMemoryObject &Bytes = *OwnedBytes;
@@ -29,7 +29,9 @@
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/Program.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 #include <cctype>
 #include <map>
 using namespace llvm;
@@ -2100,10 +2102,9 @@ static void WriteUseListBlock(const Function *F, ValueEnumerator &VE,
   Stream.ExitBlock();
 }
 
-/// WriteFunction - Emit a function body to the module stream.
-static void WriteFunction(const Function &F, ValueEnumerator &VE,
-                          BitstreamWriter &Stream) {
-  Stream.EnterSubblock(bitc::FUNCTION_BLOCK_ID, 4);
+/// WriteFunctionRecords - Emit the contents of the FUNCTION_BLOCK for F.
+static void WriteFunctionRecords(const Function &F, ValueEnumerator &VE,
+                                 BitstreamWriter &Stream) {
   VE.incorporateFunction(F);
 
   SmallVector<unsigned, 64> Vals;
@@ -2170,6 +2171,13 @@ static void WriteFunction(const Function &F, ValueEnumerator &VE,
   if (VE.shouldPreserveUseListOrder())
     WriteUseListBlock(&F, VE, Stream);
   VE.purgeFunction();
+}
+
+/// WriteFunction - Emit a function body to the module stream.
+static void WriteFunction(const Function &F, ValueEnumerator &VE,
+                          BitstreamWriter &Stream) {
+  Stream.EnterSubblock(bitc::FUNCTION_BLOCK_ID, 4);
+  WriteFunctionRecords(F, VE, Stream);
   Stream.ExitBlock();
 }
 
@@ -2348,9 +2356,147 @@ static void WriteBlockInfo(const ValueEnumerator &VE, BitstreamWriter &Stream) {
   Stream.ExitBlock();
 }
 
+/// Emit a MODULE_CODE_FNINDEX record with a zero placeholder offset, to be
+/// filled in by WriteFunctionIndex.  Returns the bit position of the field.
+static uint64_t WriteFunctionIndexOffset(BitstreamWriter &Stream) {
+  // The offset is a fixed 32-bit field so that it can be backpatched.
+  BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+  Abbv->Add(BitCodeAbbrevOp(bitc::MODULE_CODE_FNINDEX));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 32));
+  unsigned FnIndexAbbrev = Stream.EmitAbbrev(Abbv);
+
+  SmallVector<unsigned, 1> Vals;
+  Vals.push_back(0);
+  Stream.EmitRecord(bitc::MODULE_CODE_FNINDEX, Vals, FnIndexAbbrev);
+  return Stream.GetCurrentBitNo() - 32;
+}
+
+/// Emit the FUNCTION_INDEX block, which records the bit offset of the body of
+/// each function, and point the MODULE_CODE_FNINDEX record at it.
+static void
+WriteFunctionIndex(ArrayRef<std::pair<unsigned, uint64_t>> FunctionOffsets,
+                   uint64_t OffsetFieldBit, uint64_t BitcodeStartBit,
+                   BitstreamWriter &Stream) {
+  // The index directly follows a function block, so it is 32-bit aligned.
+  uint64_t IndexBit = Stream.GetCurrentBitNo() - BitcodeStartBit;
+  assert((IndexBit & 31) == 0 && "Function index is not word aligned");
+  Stream.BackpatchFixed32(OffsetFieldBit, IndexBit / 32);
+
+  Stream.EnterSubblock(bitc::FUNCTION_INDEX_BLOCK_ID, 3);
+
+  BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+  Abbv->Add(BitCodeAbbrevOp(bitc::FUNCTION_INDEX_CODE_ENTRY));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 8)); // value id
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 8)); // offset
+  unsigned EntryAbbrev = Stream.EmitAbbrev(Abbv);
+
+  SmallVector<uint64_t, 2> Vals;
+  for (const auto &Entry : FunctionOffsets) {
+    Vals.push_back(Entry.first);
+    Vals.push_back(Entry.second);
+    Stream.EmitRecord(bitc::FUNCTION_INDEX_CODE_ENTRY, Vals, EntryAbbrev);
+    Vals.clear();
+  }
+
+  Stream.ExitBlock();
+}
+
+namespace {
+/// The function blocks of a contiguous run of function bodies, encoded into a
+/// private buffer by EncodeFunctionBlocks.
+struct EncodedFunctionBlocks {
+  std::vector<const Function *> Functions;
+  UseListOrderStack UseListOrders;
+  SmallVector<char, 0> Buffer;
+  /// The [begin, end) byte range in Buffer of the body of each block, i.e.
+  /// everything following its block size word.
+  std::vector<std::pair<size_t, size_t>> Bodies;
+};
+} // end anonymous namespace
+
+/// Encode the function blocks of Blocks.Functions into Blocks.Buffer, using a
+/// private copy of the module-level enumeration in ModuleVE.  This only reads
+/// the IR, so it can run concurrently for disjoint sets of functions.
+static void EncodeFunctionBlocks(const ValueEnumerator &ModuleVE,
+                                 EncodedFunctionBlocks &Blocks) {
+  ValueEnumerator VE(ModuleVE);
+  VE.UseListOrders = std::move(Blocks.UseListOrders);
+
+  BitstreamWriter Stream(Blocks.Buffer);
+
+  // Define the same block info abbreviations as the module stream.  The
+  // BLOCKINFO_BLOCK itself is thrown away along with the block headers.
+  WriteBlockInfo(VE, Stream);
+
+  for (const Function *F : Blocks.Functions) {
+    Stream.EnterSubblock(bitc::FUNCTION_BLOCK_ID, 4);
+    size_t Begin = Blocks.Buffer.size();
+    WriteFunctionRecords(*F, VE, Stream);
+    Stream.ExitBlock();
+    Blocks.Bodies.push_back(std::make_pair(Begin, Blocks.Buffer.size()));
+  }
+}
+
+/// Emit the function blocks for Bodies, encoding them on up to Threads
+/// threads, and record the offset of each block in FunctionOffsets.
+static void WriteFunctionsInParallel(
+    ArrayRef<const Function *> Bodies, ValueEnumerator &VE, unsigned Threads,
+    uint64_t BitcodeStartBit,
+    std::vector<std::pair<unsigned, uint64_t>> &FunctionOffsets,
+    BitstreamWriter &Stream) {
+  // Split the bodies into contiguous runs of roughly equal instruction
+  // counts, one per thread.
+  std::vector<uint64_t> Sizes;
+  uint64_t TotalSize = 0;
+  for (const Function *F : Bodies) {
+    uint64_t Size = 1;
+    for (const BasicBlock &BB : *F)
+      Size += BB.size();
+    Sizes.push_back(Size);
+    TotalSize += Size;
+  }
+
+  unsigned NumChunks = std::min<size_t>(Threads, Bodies.size());
+  std::vector<EncodedFunctionBlocks> Chunks(NumChunks);
+  DenseMap<const Function *, unsigned> ChunkOf;
+  uint64_t SizeSoFar = 0;
+  for (unsigned I = 0, E = Bodies.size(); I != E; ++I) {
+    unsigned Chunk = SizeSoFar * NumChunks / TotalSize;
+    Chunks[Chunk].Functions.push_back(Bodies[I]);
+    ChunkOf[Bodies[I]] = Chunk;
+    SizeSoFar += Sizes[I];
+  }
+
+  // Hand every chunk the use-list orders of its functions.  The stack is
+  // ordered by function, so this keeps each chunk's orders in the order
+  // WriteUseListBlock expects.
+  for (UseListOrder &Order : VE.UseListOrders)
+    Chunks[ChunkOf.lookup(Order.F)].UseListOrders.push_back(std::move(Order));
+  VE.UseListOrders.clear();
+
+  {
+    ThreadPool Pool(NumChunks);
+    for (EncodedFunctionBlocks &Chunk : Chunks)
+      if (!Chunk.Functions.empty())
+        Pool.async([&VE, &Chunk] { EncodeFunctionBlocks(VE, Chunk); });
+    Pool.wait();
+  }
+
+  for (const EncodedFunctionBlocks &Chunk : Chunks)
+    for (unsigned I = 0, E = Chunk.Functions.size(); I != E; ++I) {
+      FunctionOffsets.push_back(
+          std::make_pair(VE.getValueID(Chunk.Functions[I]),
+                         Stream.GetCurrentBitNo() - BitcodeStartBit));
+      ArrayRef<char> Body(Chunk.Buffer.data() + Chunk.Bodies[I].first,
+                          Chunk.Bodies[I].second - Chunk.Bodies[I].first);
+      Stream.EmitBlockWithBody(bitc::FUNCTION_BLOCK_ID, 4, Body);
+    }
+}
+
 /// WriteModule - Emit the specified module to the bitstream.
 static void WriteModule(const Module *M, BitstreamWriter &Stream,
-                        bool ShouldPreserveUseListOrder) {
+                        bool ShouldPreserveUseListOrder, unsigned Threads,
+                        uint64_t BitcodeStartBit) {
   Stream.EnterSubblock(bitc::MODULE_BLOCK_ID, 3);
 
   SmallVector<unsigned, 1> Vals;
@@ -2395,10 +2541,30 @@ static void WriteModule(const Module *M, BitstreamWriter &Stream,
   if (VE.shouldPreserveUseListOrder())
     WriteUseListBlock(nullptr, VE, Stream);
 
-  // Emit function bodies.
-  for (Module::const_iterator F = M->begin(), E = M->end(); F != E; ++F)
-    if (!F->isDeclaration())
+  // Emit function bodies, followed by an index of where each of them starts.
+  std::vector<const Function *> Bodies;
+  for (const Function &F : *M)
+    if (!F.isDeclaration())
+      Bodies.push_back(&F);
+
+  uint64_t FnIndexOffsetBit = 0;
+  if (!Bodies.empty())
+    FnIndexOffsetBit = WriteFunctionIndexOffset(Stream);
+
+  std::vector<std::pair<unsigned, uint64_t>> FunctionOffsets;
+  if (Threads > 1 && Bodies.size() > 1) {
+    WriteFunctionsInParallel(Bodies, VE, Threads, BitcodeStartBit,
+                             FunctionOffsets, Stream);
+  } else {
+    for (const Function *F : Bodies) {
+      FunctionOffsets.push_back(std::make_pair(
+          VE.getValueID(F), Stream.GetCurrentBitNo() - BitcodeStartBit));
       WriteFunction(*F, VE, Stream);
+    }
+  }
+  if (!FunctionOffsets.empty())
+    WriteFunctionIndex(FunctionOffsets, FnIndexOffsetBit, BitcodeStartBit,
+                       Stream);
 
   Stream.ExitBlock();
 }
@@ -2476,7 +2642,8 @@ static void EmitDarwinBCHeaderAndTrailer(SmallVectorImpl<char> &Buffer,
 /// WriteBitcodeToFile - Write the specified module to the specified output
 /// stream.
 void llvm::WriteBitcodeToFile(const Module *M, raw_ostream &Out,
-                              bool ShouldPreserveUseListOrder) {
+                              bool ShouldPreserveUseListOrder,
+                              unsigned Threads) {
   SmallVector<char, 0> Buffer;
   Buffer.reserve(256*1024);
 
@@ -2489,6 +2656,7 @@ void llvm::WriteBitcodeToFile(const Module *M, raw_ostream &Out,
   // Emit the module into the buffer.
   {
     BitstreamWriter Stream(Buffer);
+    uint64_t BitcodeStartBit = Stream.GetCurrentBitNo();
 
     // Emit the file header.
     Stream.Emit((unsigned)'B', 8);
@@ -2499,7 +2667,8 @@ void llvm::WriteBitcodeToFile(const Module *M, raw_ostream &Out,
     Stream.Emit(0xD, 4);
 
     // Emit the module.
-    WriteModule(M, Stream, ShouldPreserveUseListOrder);
+    WriteModule(M, Stream, ShouldPreserveUseListOrder, Threads,
+                BitcodeStartBit);
   }
 
   if (TT.isOSDarwin())
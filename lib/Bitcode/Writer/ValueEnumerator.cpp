@@ -397,6 +397,19 @@ ValueEnumerator::ValueEnumerator(const Module &M,
   OptimizeConstants(FirstConstant, Values.size());
 }
 
+ValueEnumerator::ValueEnumerator(const ValueEnumerator &VE)
+    : TypeMap(VE.TypeMap), Types(VE.Types), ValueMap(VE.ValueMap),
+      Values(VE.Values), Comdats(VE.Comdats), MDs(VE.MDs),
+      MDValueMap(VE.MDValueMap), HasMDString(VE.HasMDString),
+      HasDILocation(VE.HasDILocation), HasGenericDINode(VE.HasGenericDINode),
+      ShouldPreserveUseListOrder(VE.ShouldPreserveUseListOrder),
+      AttributeGroupMap(VE.AttributeGroupMap),
+      AttributeGroups(VE.AttributeGroups), AttributeMap(VE.AttributeMap),
+      Attribute(VE.Attribute), InstructionCount(0) {
+  assert(VE.BasicBlocks.empty() && VE.FunctionLocalMDs.empty() &&
+         "Cannot copy a ValueEnumerator with an incorporated function");
+}
+
 unsigned ValueEnumerator::getInstructionID(const Instruction *Inst) const {
   InstructionMapType::const_iterator I = InstructionMap.find(Inst);
   assert(I != InstructionMap.end() && "Instruction is not mapped!");
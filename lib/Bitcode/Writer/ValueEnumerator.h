@@ -100,11 +100,15 @@ private:
   unsigned FirstFuncConstantID;
   unsigned FirstInstID;
 
-  ValueEnumerator(const ValueEnumerator &) = delete;
   void operator=(const ValueEnumerator &) = delete;
 public:
   ValueEnumerator(const Module &M, bool ShouldPreserveUseListOrder);
 
+  /// Copy the module-level enumeration of \p VE, so that functions can be
+  /// incorporated into the copy independently of the original.  \p VE must
+  /// not have a function incorporated.  Use-list orders are not copied.
+  explicit ValueEnumerator(const ValueEnumerator &VE);
+
   void dump() const;
   void print(raw_ostream &OS, const ValueMapType &Map, const char *Name) const;
   void print(raw_ostream &OS, const MetadataMapType &Map,
@@ -100,13 +100,15 @@ void DwarfAccelTable::FinalizeTable(AsmPrinter *Asm, StringRef Prefix) {
   }
 
   // Sort the contents of the buckets by hash value so that hash
-  // collisions end up together. Stable sort makes testing easier and
-  // doesn't cost much more.
+  // collisions end up together. Collisions are ordered by name, so that the
+  // output does not depend on the StringMap's iteration order.
   for (size_t i = 0; i < Buckets.size(); ++i)
-    std::stable_sort(Buckets[i].begin(), Buckets[i].end(),
-                     [] (HashData *LHS, HashData *RHS) {
-                       return LHS->HashValue < RHS->HashValue;
-                     });
+    std::sort(Buckets[i].begin(), Buckets[i].end(),
+              [] (HashData *LHS, HashData *RHS) {
+                if (LHS->HashValue != RHS->HashValue)
+                  return LHS->HashValue < RHS->HashValue;
+                return LHS->Str < RHS->Str;
+              });
 }
 
 // Emits the header for the table via the AsmPrinter.
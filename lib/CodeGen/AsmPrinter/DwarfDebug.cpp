@@ -1418,10 +1418,20 @@ void DwarfDebug::emitDebugPubSection(
     Asm->OutStreamer->AddComment("Compilation Unit Length");
     Asm->EmitInt32(TheU->getLength());
 
-    // Emit the pubnames for this compilation unit.
-    for (const auto &GI : Globals) {
-      const char *Name = GI.getKeyData();
-      const DIE *Entity = GI.second;
+    // Emit the pubnames for this compilation unit, sorted by name so that
+    // the output does not depend on the StringMap's hash order.
+    std::vector<const StringMapEntry<const DIE *> *> Sorted;
+    Sorted.reserve(Globals.size());
+    for (const auto &GI : Globals)
+      Sorted.push_back(&GI);
+    std::sort(Sorted.begin(), Sorted.end(),
+              [](const StringMapEntry<const DIE *> *A,
+                 const StringMapEntry<const DIE *> *B) {
+                return A->getKey() < B->getKey();
+              });
+    for (const auto *GI : Sorted) {
+      const char *Name = GI->getKeyData();
+      const DIE *Entity = GI->second;
 
       Asm->OutStreamer->AddComment("DIE offset");
       Asm->EmitInt32(Entity->getOffset());
@@ -1435,7 +1445,7 @@ void DwarfDebug::emitDebugPubSection(
       }
 
       Asm->OutStreamer->AddComment("External Name");
-      Asm->OutStreamer->EmitBytes(StringRef(Name, GI.getKeyLength() + 1));
+      Asm->OutStreamer->EmitBytes(StringRef(Name, GI->getKeyLength() + 1));
     }
 
     Asm->OutStreamer->AddComment("End Mark");
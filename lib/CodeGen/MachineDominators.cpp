@@ -15,6 +15,7 @@
 #include "llvm/CodeGen/MachineDominators.h"
 #include "llvm/CodeGen/Passes.h"
 #include "llvm/ADT/SmallBitVector.h"
+#include "llvm/Support/GenericDomTreeUpdate.h"
 
 using namespace llvm;
 
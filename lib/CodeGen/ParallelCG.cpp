@@ -0,0 +1,98 @@
+//===-- ParallelCG.cpp ----------------------------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines functions that can be used for parallel code generation.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/CodeGen/ParallelCG.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Triple.h"
+#include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/SplitModule.h"
+
+using namespace llvm;
+
+static bool
+codegen(Module *M, llvm::raw_pwrite_stream &OS,
+        const std::function<std::unique_ptr<TargetMachine>()> &TMFactory,
+        TargetMachine::CodeGenFileType FileType, std::string &ErrMsg) {
+  std::unique_ptr<TargetMachine> TM = TMFactory();
+  legacy::PassManager CodeGenPasses;
+
+  // Add an appropriate TargetLibraryInfo pass for the module's triple.
+  TargetLibraryInfoImpl TLII(Triple(M->getTargetTriple()));
+  CodeGenPasses.add(new TargetLibraryInfoWrapperPass(TLII));
+
+  if (TM->addPassesToEmitFile(CodeGenPasses, OS, FileType)) {
+    ErrMsg = "target does not support generation of this file type";
+    return true;
+  }
+  CodeGenPasses.run(*M);
+  return false;
+}
+
+bool llvm::splitCodeGen(
+    Module &M, ArrayRef<llvm::raw_pwrite_stream *> OSs,
+    const std::function<std::unique_ptr<TargetMachine>()> &TMFactory,
+    std::string &ErrMsg, TargetMachine::CodeGenFileType FileType) {
+  if (OSs.size() == 1)
+    return codegen(&M, *OSs[0], TMFactory, FileType, ErrMsg);
+
+  // We want to clone the module in a new context to multi-thread the codegen.
+  // We do it by serializing partition modules to bitcode (while still on the
+  // main thread, in order to avoid data races) and letting the workers
+  // deserialize the partitions into separate contexts. The buffers and the
+  // error messages of the partitions are owned here so that they outlive the
+  // tasks.
+  std::vector<SmallVector<char, 0>> Bitcode(OSs.size());
+  std::vector<std::string> Errors(OSs.size());
+  ThreadPool Pool(OSs.size());
+  unsigned Partition = 0;
+  SplitModule(M, OSs.size(), [&](std::unique_ptr<Module> MPart) {
+    SmallVector<char, 0> &BC = Bitcode[Partition];
+    std::string &Error = Errors[Partition];
+    raw_pwrite_stream *ThreadOS = OSs[Partition];
+    ++Partition;
+    {
+      raw_svector_ostream BCOS(BC);
+      WriteBitcodeToFile(MPart.get(), BCOS);
+    }
+
+    Pool.async([&BC, &Error, ThreadOS, &TMFactory, FileType] {
+      LLVMContext Ctx;
+      ErrorOr<std::unique_ptr<Module>> MOrErr = parseBitcodeFile(
+          MemoryBufferRef(StringRef(BC.data(), BC.size()), "<split-module>"),
+          Ctx);
+      if (!MOrErr) {
+        Error = "failed to read split module: " + MOrErr.getError().message();
+        return;
+      }
+      std::unique_ptr<Module> MPartInCtx = std::move(MOrErr.get());
+
+      codegen(MPartInCtx.get(), *ThreadOS, TMFactory, FileType, Error);
+    });
+  });
+
+  Pool.wait();
+
+  for (const std::string &Error : Errors)
+    if (!Error.empty()) {
+      ErrMsg = Error;
+      return true;
+    }
+  return false;
+}
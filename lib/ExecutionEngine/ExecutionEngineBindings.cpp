@@ -13,6 +13,7 @@
 
 #include "llvm-c/ExecutionEngine.h"
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
+#include "llvm/ExecutionEngine/FileObjectCache.h"
 #include "llvm/ExecutionEngine/GenericValue.h"
 #include "llvm/ExecutionEngine/RTDyldMemoryManager.h"
 #include "llvm/IR/DerivedTypes.h"
@@ -27,6 +28,7 @@ using namespace llvm;
 
 // Wrapping the C bindings types.
 DEFINE_SIMPLE_CONVERSION_FUNCTIONS(GenericValue, LLVMGenericValueRef)
+DEFINE_SIMPLE_CONVERSION_FUNCTIONS(FileObjectCache, LLVMObjectCacheRef)
 
 
 inline LLVMTargetMachineRef wrap(const TargetMachine *P) {
@@ -448,3 +450,23 @@ void LLVMDisposeMCJITMemoryManager(LLVMMCJITMemoryManagerRef MM) {
   delete unwrap(MM);
 }
 
+
+/*===-- Operations on object caches ---------------------------------------===*/
+
+LLVMObjectCacheRef LLVMCreateFileObjectCache(const char *CacheDir,
+                                             uint64_t MaxSize) {
+  return wrap(new FileObjectCache(CacheDir, MaxSize));
+}
+
+void LLVMSetExecutionEngineObjectCache(LLVMExecutionEngineRef EE,
+                                       LLVMObjectCacheRef Cache) {
+  FileObjectCache *FOC = unwrap(Cache);
+  if (FOC)
+    if (TargetMachine *TM = unwrap(EE)->getTargetMachine())
+      FOC->setTargetMachine(*TM);
+  unwrap(EE)->setObjectCache(FOC);
+}
+
+void LLVMDisposeObjectCache(LLVMObjectCacheRef Cache) {
+  delete unwrap(Cache);
+}
@@ -0,0 +1,117 @@
+//===-- FileObjectCache.cpp - On-disk cache of compiled objects -----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements FileObjectCache.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/FileObjectCache.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/MutexGuard.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+
+using namespace llvm;
+
+#define DEBUG_TYPE "object-cache"
+
+STATISTIC(NumCacheHits, "Number of objects loaded from the object cache");
+STATISTIC(NumCacheMisses, "Number of modules missing from the object cache");
+
+// Bump this when the way keys are computed changes.
+static const char CacheVersion[] = "1";
+
+FileObjectCache::FileObjectCache(StringRef CacheDir, uint64_t MaxSize)
+    : Cache(CacheDir), MaxSize(MaxSize) {}
+
+FileObjectCache::~FileObjectCache() {}
+
+void FileObjectCache::setTargetMachine(const TargetMachine &TM) {
+  const TargetOptions &Options = TM.Options;
+  std::string Key;
+  raw_string_ostream OS(Key);
+  OS << TM.getTargetTriple().str() << '\0' << TM.getTargetCPU() << '\0'
+     << TM.getTargetFeatureString() << '\0' << TM.getRelocationModel() << ' '
+     << TM.getCodeModel() << ' ' << TM.getOptLevel() << ' '
+     << Options.LessPreciseFPMADOption << Options.UnsafeFPMath
+     << Options.NoInfsFPMath << Options.NoNaNsFPMath
+     << Options.HonorSignDependentRoundingFPMathOption
+     << Options.NoZerosInBSS << Options.GuaranteedTailCallOpt
+     << Options.EnableFastISel << Options.PositionIndependentExecutable
+     << Options.UseInitArray << Options.DisableIntegratedAS
+     << Options.CompressDebugSections << Options.FunctionSections
+     << Options.DataSections << Options.UniqueSectionNames
+     << Options.TrapUnreachable << ' ' << Options.StackAlignmentOverride << ' '
+     << Options.FloatABIType << ' ' << Options.AllowFPOpFusion << ' '
+     << Options.JTType << ' ' << Options.ThreadModel;
+  TargetKey = OS.str();
+}
+
+std::string FileObjectCache::getKey(const Module &M) const {
+  SmallString<4096> Bitcode;
+  {
+    raw_svector_ostream OS(Bitcode);
+    WriteBitcodeToFile(&M, OS);
+  }
+
+  MD5 Hash;
+  Hash.update(CacheVersion);
+  Hash.update(LLVM_VERSION_STRING);
+  Hash.update(StringRef(TargetKey.c_str(), TargetKey.size() + 1));
+  // The triple and data layout of the module are part of its bitcode.
+  Hash.update(Bitcode);
+  return FileCache::getKey(Hash);
+}
+
+std::unique_ptr<MemoryBuffer> FileObjectCache::getObject(const Module *M) {
+  std::string Key = getKey(*M);
+  if (auto Buffer = Cache.lookup(Key)) {
+    ++NumCacheHits;
+    return std::move(*Buffer);
+  }
+
+  ++NumCacheMisses;
+  MutexGuard Locked(Lock);
+  PendingKeys[M] = std::move(Key);
+  return nullptr;
+}
+
+void FileObjectCache::notifyObjectCompiled(const Module *M,
+                                           MemoryBufferRef Obj) {
+  std::string Key;
+  {
+    MutexGuard Locked(Lock);
+    auto I = PendingKeys.find(M);
+    if (I != PendingKeys.end()) {
+      Key = std::move(I->second);
+      PendingKeys.erase(I);
+    }
+  }
+  // An engine that did not look the module up first has compiled it as it is.
+  if (Key.empty())
+    Key = getKey(*M);
+
+  // Failing to cache the object only costs compiling the module again.
+  if (Cache.store(Key, Obj.getBuffer()))
+    return;
+
+  if (MaxSize)
+    prune();
+}
+
+void FileObjectCache::prune() {
+  if (MaxSize)
+    Cache.prune(MaxSize);
+}
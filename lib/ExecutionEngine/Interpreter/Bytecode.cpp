@@ -0,0 +1,1165 @@
+//===-- Bytecode.cpp - Lower functions to bytecode and run them -----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file lowers functions to the register bytecode defined in Bytecode.h
+// the first time they are called, and runs them.  Functions using anything
+// the bytecode does not handle (aggregates and vectors, integers wider than
+// 64 bits, varargs, exceptions, ...) are left to the instruction visitor in
+// Execution.cpp, and the two call each other freely.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Interpreter.h"
+#include "Bytecode.h"
+#include "llvm/ADT/APInt.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/CodeGen/IntrinsicLowering.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/GetElementPtrTypeIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/MathExtras.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+using namespace llvm;
+
+#define DEBUG_TYPE "interpreter"
+
+STATISTIC(NumBytecodeFunctions, "Number of functions lowered to bytecode");
+STATISTIC(NumVisitedFunctions,
+          "Number of functions that could not be lowered to bytecode");
+
+static cl::opt<bool> UseBytecode("interpreter-bytecode", cl::Hidden,
+    cl::init(true),
+    cl::desc("Lower functions to bytecode before interpreting them"));
+
+// With GCC's labels as values, each instruction holds the address of the code
+// implementing it and jumps straight to the next one, instead of going back
+// through a switch.
+#if defined(__GNUC__)
+#define LLVM_INTERPRETER_THREADED_DISPATCH 1
+#else
+#define LLVM_INTERPRETER_THREADED_DISPATCH 0
+#endif
+
+//===----------------------------------------------------------------------===//
+//                     Various Helper Functions
+//===----------------------------------------------------------------------===//
+
+static bool isSlotType(Type *Ty) {
+  if (Ty->isIntegerTy())
+    return Ty->getIntegerBitWidth() <= 64;
+  return Ty->isFloatTy() || Ty->isDoubleTy() || Ty->isPointerTy();
+}
+
+static unsigned getWidth(Type *Ty) {
+  return Ty->isIntegerTy() ? Ty->getIntegerBitWidth() : 64;
+}
+
+static uint64_t getMask(unsigned Width) {
+  return Width == 64 ? ~0ULL : (1ULL << Width) - 1;
+}
+
+static BytecodeSlot toSlot(const GenericValue &Val, Type *Ty) {
+  BytecodeSlot S;
+  S.I = 0;
+  switch (Ty->getTypeID()) {
+  default: llvm_unreachable("Type has no bytecode slot");
+  case Type::IntegerTyID:
+    S.I = Val.IntVal.zextOrTrunc(Ty->getIntegerBitWidth()).getZExtValue();
+    break;
+  case Type::FloatTyID:   S.F = Val.FloatVal; break;
+  case Type::DoubleTyID:  S.D = Val.DoubleVal; break;
+  case Type::PointerTyID: S.I = uintptr_t(Val.PointerVal); break;
+  }
+  return S;
+}
+
+static GenericValue fromSlot(BytecodeSlot S, Type *Ty) {
+  GenericValue Val;
+  switch (Ty->getTypeID()) {
+  default: llvm_unreachable("Type has no bytecode slot");
+  case Type::IntegerTyID:
+    Val.IntVal = APInt(Ty->getIntegerBitWidth(), S.I);
+    break;
+  case Type::FloatTyID:   Val.FloatVal = S.F; break;
+  case Type::DoubleTyID:  Val.DoubleVal = S.D; break;
+  case Type::PointerTyID: Val.PointerVal = (void *)uintptr_t(S.I); break;
+  }
+  return Val;
+}
+
+static void *toPointer(BytecodeSlot S) { return (void *)uintptr_t(S.I); }
+
+template <typename T> static uint64_t loadInt(BytecodeSlot Ptr) {
+  T Val;
+  memcpy(&Val, toPointer(Ptr), sizeof(T));
+  return Val;
+}
+
+template <typename T> static void storeInt(BytecodeSlot Ptr, uint64_t Val) {
+  T Truncated = T(Val);
+  memcpy(toPointer(Ptr), &Truncated, sizeof(T));
+}
+
+// Shift amounts not smaller than the width are undefined; wrap them the way
+// getShiftAmount in Execution.cpp does.
+static unsigned getShiftAmount(uint64_t Amount, unsigned Width) {
+  if (Amount < Width)
+    return Amount;
+  return (NextPowerOf2(Width - 1) - 1) & Amount;
+}
+
+/// Return true if lowering calls to the given intrinsic with
+/// IntrinsicLowering is silent and produces code the bytecode handles.
+static bool isLowerableIntrinsic(Intrinsic::ID ID) {
+  switch (ID) {
+  default:
+    return false;
+  case Intrinsic::expect:
+  case Intrinsic::ctpop:
+  case Intrinsic::bswap:
+  case Intrinsic::ctlz:
+  case Intrinsic::cttz:
+  case Intrinsic::prefetch:
+  case Intrinsic::pcmarker:
+  case Intrinsic::annotation:
+  case Intrinsic::ptr_annotation:
+  case Intrinsic::assume:
+  case Intrinsic::var_annotation:
+  case Intrinsic::memcpy:
+  case Intrinsic::memmove:
+  case Intrinsic::memset:
+  case Intrinsic::sqrt:
+  case Intrinsic::log:
+  case Intrinsic::log2:
+  case Intrinsic::log10:
+  case Intrinsic::exp:
+  case Intrinsic::exp2:
+  case Intrinsic::pow:
+  case Intrinsic::sin:
+  case Intrinsic::cos:
+  case Intrinsic::floor:
+  case Intrinsic::ceil:
+  case Intrinsic::trunc:
+  case Intrinsic::round:
+  case Intrinsic::copysign:
+  case Intrinsic::invariant_start:
+  case Intrinsic::invariant_end:
+  case Intrinsic::lifetime_start:
+  case Intrinsic::lifetime_end:
+    return true;
+  }
+}
+
+/// Return true if the constant can be evaluated up front by getOperandValue.
+static bool isEvaluableConstant(const Constant *C) {
+  if (isa<ConstantInt>(C) || isa<ConstantFP>(C) ||
+      isa<ConstantPointerNull>(C) || isa<UndefValue>(C) ||
+      isa<GlobalValue>(C))
+    return true;
+  const ConstantExpr *CE = dyn_cast<ConstantExpr>(C);
+  if (!CE)
+    return false;
+  if (!CE->isCast() && !CE->isCompare() && !Instruction::isBinaryOp(
+      CE->getOpcode()) && CE->getOpcode() != Instruction::GetElementPtr &&
+      CE->getOpcode() != Instruction::Select)
+    return false;
+  for (const Use &Op : CE->operands())
+    if (!isEvaluableConstant(cast<Constant>(Op)))
+      return false;
+  return true;
+}
+
+//===----------------------------------------------------------------------===//
+//                     Lowering Functions to Bytecode
+//===----------------------------------------------------------------------===//
+
+namespace llvm {
+/// Lowers one function to bytecode.
+class BytecodeLowering {
+  Interpreter &Interp;
+  const DataLayout &TD;
+  Function &F;
+  std::unique_ptr<BytecodeFunction> BF;
+  DenseMap<const Value *, unsigned> Slots;
+  // The first of the slots used to copy the values of PHI nodes.
+  unsigned TempBase;
+  // Set when an operand without a slot is found.
+  bool Unsupported;
+
+  // Branches refer to labels, one for each CFG edge, which are resolved once
+  // all blocks are emitted.  Edges into blocks with PHI nodes are resolved to
+  // code copying the incoming values.
+  DenseMap<const BasicBlock *, unsigned> BlockStart;
+  std::vector<std::pair<BasicBlock *, BasicBlock *>> Edges;
+  DenseMap<std::pair<BasicBlock *, BasicBlock *>, unsigned> EdgeLabels;
+  // The instructions whose Dst (false) or B (true) is a label.
+  std::vector<std::pair<unsigned, bool>> LabelFixups;
+
+public:
+  BytecodeLowering(Interpreter &Interp, Function &F)
+      : Interp(Interp), TD(*Interp.getDataLayout()), F(F), TempBase(0),
+        Unsupported(false) {}
+
+  std::unique_ptr<BytecodeFunction> lower();
+
+private:
+  bool lowerIntrinsics();
+  bool assignSlots();
+  bool lowerInstruction(Instruction &I, BasicBlock *NextBB);
+  bool lowerCast(CastInst &I);
+  bool lowerGEP(GetElementPtrInst &I);
+  bool lowerCall(CallInst &I);
+  void resolveLabels();
+
+  unsigned getSlot(const Value *V) {
+    auto S = Slots.find(V);
+    if (S != Slots.end())
+      return S->second;
+    Unsupported = true;
+    return 0;
+  }
+
+  unsigned emit(unsigned Opcode, unsigned Dst = 0, unsigned A = 0,
+                unsigned B = 0, uint64_t Imm = 0, unsigned Width = 0) {
+    BytecodeInst I;
+    I.Handler = nullptr;
+    I.Opcode = Opcode;
+    I.Width = Width;
+    I.Dst = Dst;
+    I.A = A;
+    I.B = B;
+    I.Imm = Imm;
+    BF->Code.push_back(I);
+    return BF->Code.size() - 1;
+  }
+
+  unsigned getEdgeLabel(BasicBlock *From, BasicBlock *To) {
+    auto Edge = std::make_pair(From, To);
+    auto Label = EdgeLabels.insert(std::make_pair(Edge, Edges.size()));
+    if (Label.second)
+      Edges.push_back(Edge);
+    return Label.first->second;
+  }
+};
+}
+
+std::unique_ptr<BytecodeFunction> BytecodeLowering::lower() {
+  if (F.isVarArg() ||
+      (!F.getReturnType()->isVoidTy() && !isSlotType(F.getReturnType())))
+    return nullptr;
+  // Loads and stores go straight to host memory.
+  if (TD.isLittleEndian() != sys::IsLittleEndianHost)
+    return nullptr;
+
+  BF = llvm::make_unique<BytecodeFunction>();
+  BF->F = &F;
+  BF->StaticAllocaSize = 0;
+  BF->Threaded = false;
+  if (!lowerIntrinsics() || !assignSlots())
+    return nullptr;
+
+  for (Function::iterator BB = F.begin(), E = F.end(); BB != E; ++BB) {
+    BlockStart[BB] = BF->Code.size();
+    BasicBlock *NextBB = std::next(BB) == E ? nullptr : std::next(BB);
+    for (Instruction &I : *BB)
+      if (!lowerInstruction(I, NextBB))
+        return nullptr;
+  }
+  resolveLabels();
+  if (Unsupported)
+    return nullptr;
+  return std::move(BF);
+}
+
+/// Lower the calls to intrinsics the way the instruction visitor would when
+/// reaching them, failing if there is any it cannot lower cleanly.
+bool BytecodeLowering::lowerIntrinsics() {
+  SmallVector<CallInst *, 8> Calls;
+  for (BasicBlock &BB : F)
+    for (Instruction &I : BB) {
+      CallInst *CI = dyn_cast<CallInst>(&I);
+      Function *Callee = CI ? CI->getCalledFunction() : nullptr;
+      if (!Callee || !Callee->isIntrinsic() || isa<DbgInfoIntrinsic>(CI))
+        continue;
+      if (!isLowerableIntrinsic(Callee->getIntrinsicID()))
+        return false;
+      Calls.push_back(CI);
+    }
+  for (CallInst *CI : Calls)
+    Interp.IL->LowerIntrinsicCall(CI);
+  return true;
+}
+
+/// Number the slots of the arguments, the instructions, the temporaries
+/// for PHI nodes and the constants, in that order, and evaluate the
+/// constants.
+bool BytecodeLowering::assignSlots() {
+  unsigned NumSlots = 0;
+  for (Argument &A : F.args()) {
+    if (!isSlotType(A.getType()))
+      return false;
+    Slots[&A] = NumSlots++;
+  }
+
+  unsigned MaxPHIs = 0;
+  for (BasicBlock &BB : F) {
+    unsigned NumPHIs = 0;
+    for (Instruction &I : BB) {
+      if (isa<PHINode>(I))
+        ++NumPHIs;
+      if (I.getType()->isVoidTy() || isa<DbgInfoIntrinsic>(I))
+        continue;
+      if (!isSlotType(I.getType()))
+        return false;
+      Slots[&I] = NumSlots++;
+    }
+    MaxPHIs = std::max(MaxPHIs, NumPHIs);
+  }
+  TempBase = NumSlots;
+  NumSlots += MaxPHIs;
+
+  BF->ConstantBase = NumSlots;
+  ExecutionContext Dummy;
+  for (BasicBlock &BB : F)
+    for (Instruction &I : BB) {
+      if (isa<DbgInfoIntrinsic>(I))
+        continue;
+      // Case values are matched from the switch table.
+      unsigned NumOperands =
+          isa<SwitchInst>(I) ? 1 : I.getNumOperands();
+      for (unsigned i = 0; i != NumOperands; ++i) {
+        Constant *C = dyn_cast<Constant>(I.getOperand(i));
+        if (!C || !isSlotType(C->getType()) || Slots.count(C) ||
+            !isEvaluableConstant(C))
+          continue;
+        // Direct callees are not read from the frame.
+        if (isa<CallInst>(I) && C == cast<CallInst>(I).getCalledValue() &&
+            isa<Function>(C))
+          continue;
+        Slots[C] = NumSlots++;
+        BF->Constants.push_back(
+            toSlot(Interp.getOperandValue(C, Dummy), C->getType()));
+      }
+    }
+  BF->NumSlots = NumSlots;
+  return true;
+}
+
+bool BytecodeLowering::lowerInstruction(Instruction &I, BasicBlock *NextBB) {
+  unsigned Dst = I.getType()->isVoidTy() ? 0 : getSlot(&I);
+  switch (I.getOpcode()) {
+  default:
+    return false;
+
+  case Instruction::Ret: {
+    ReturnInst &RI = cast<ReturnInst>(I);
+    if (Value *V = RI.getReturnValue())
+      emit(BC_Ret, 0, getSlot(V));
+    else
+      emit(BC_RetVoid);
+    return true;
+  }
+  case Instruction::Br: {
+    BranchInst &BI = cast<BranchInst>(I);
+    BasicBlock *BB = BI.getParent();
+    if (BI.isUnconditional()) {
+      BasicBlock *Succ = BI.getSuccessor(0);
+      // Fall through into the next block if nothing needs to be copied.
+      if (Succ == NextBB && !isa<PHINode>(Succ->begin()))
+        return true;
+      LabelFixups.push_back(std::make_pair(
+          emit(BC_Br, getEdgeLabel(BB, Succ)), false));
+      return true;
+    }
+    unsigned Br = emit(BC_CondBr, getEdgeLabel(BB, BI.getSuccessor(0)),
+                       getSlot(BI.getCondition()),
+                       getEdgeLabel(BB, BI.getSuccessor(1)));
+    LabelFixups.push_back(std::make_pair(Br, false));
+    LabelFixups.push_back(std::make_pair(Br, true));
+    return true;
+  }
+  case Instruction::Switch: {
+    SwitchInst &SI = cast<SwitchInst>(I);
+    if (!isSlotType(SI.getCondition()->getType()))
+      return false;
+    BytecodeSwitch Table;
+    BasicBlock *BB = SI.getParent();
+    for (SwitchInst::CaseIt i = SI.case_begin(), e = SI.case_end(); i != e;
+         ++i)
+      Table.Cases.push_back(std::make_pair(
+          i.getCaseValue()->getZExtValue(),
+          getEdgeLabel(BB, i.getCaseSuccessor())));
+    Table.Default = getEdgeLabel(BB, SI.getDefaultDest());
+    BF->Switches.push_back(std::move(Table));
+    emit(BC_Switch, 0, getSlot(SI.getCondition()), BF->Switches.size() - 1);
+    return true;
+  }
+  case Instruction::Unreachable:
+    emit(BC_Unreachable);
+    return true;
+
+  case Instruction::Add:  case Instruction::Sub:  case Instruction::Mul:
+  case Instruction::UDiv: case Instruction::SDiv: case Instruction::URem:
+  case Instruction::SRem: case Instruction::Shl:  case Instruction::LShr:
+  case Instruction::AShr: case Instruction::And:  case Instruction::Or:
+  case Instruction::Xor: {
+    unsigned Opcode;
+    switch (I.getOpcode()) {
+    default: llvm_unreachable("Not an integer binary operator");
+    case Instruction::Add:  Opcode = BC_Add; break;
+    case Instruction::Sub:  Opcode = BC_Sub; break;
+    case Instruction::Mul:  Opcode = BC_Mul; break;
+    case Instruction::UDiv: Opcode = BC_UDiv; break;
+    case Instruction::SDiv: Opcode = BC_SDiv; break;
+    case Instruction::URem: Opcode = BC_URem; break;
+    case Instruction::SRem: Opcode = BC_SRem; break;
+    case Instruction::Shl:  Opcode = BC_Shl; break;
+    case Instruction::LShr: Opcode = BC_LShr; break;
+    case Instruction::AShr: Opcode = BC_AShr; break;
+    case Instruction::And:  Opcode = BC_And; break;
+    case Instruction::Or:   Opcode = BC_Or; break;
+    case Instruction::Xor:  Opcode = BC_Xor; break;
+    }
+    unsigned Width = getWidth(I.getType());
+    emit(Opcode, Dst, getSlot(I.getOperand(0)), getSlot(I.getOperand(1)),
+         getMask(Width), Width);
+    return true;
+  }
+  case Instruction::FAdd: case Instruction::FSub: case Instruction::FMul:
+  case Instruction::FDiv: case Instruction::FRem: {
+    unsigned Opcode;
+    switch (I.getOpcode()) {
+    default: llvm_unreachable("Not a floating point binary operator");
+    case Instruction::FAdd: Opcode = BC_FAddF; break;
+    case Instruction::FSub: Opcode = BC_FSubF; break;
+    case Instruction::FMul: Opcode = BC_FMulF; break;
+    case Instruction::FDiv: Opcode = BC_FDivF; break;
+    case Instruction::FRem: Opcode = BC_FRemF; break;
+    }
+    if (I.getType()->isDoubleTy())
+      Opcode += BC_FAddD - BC_FAddF;
+    emit(Opcode, Dst, getSlot(I.getOperand(0)), getSlot(I.getOperand(1)));
+    return true;
+  }
+  case Instruction::ICmp: {
+    unsigned Opcode;
+    switch (cast<ICmpInst>(I).getPredicate()) {
+    default: llvm_unreachable("Invalid integer predicate");
+    case ICmpInst::ICMP_EQ:  Opcode = BC_ICmpEQ; break;
+    case ICmpInst::ICMP_NE:  Opcode = BC_ICmpNE; break;
+    case ICmpInst::ICMP_UGT: Opcode = BC_ICmpUGT; break;
+    case ICmpInst::ICMP_UGE: Opcode = BC_ICmpUGE; break;
+    case ICmpInst::ICMP_ULT: Opcode = BC_ICmpULT; break;
+    case ICmpInst::ICMP_ULE: Opcode = BC_ICmpULE; break;
+    case ICmpInst::ICMP_SGT: Opcode = BC_ICmpSGT; break;
+    case ICmpInst::ICMP_SGE: Opcode = BC_ICmpSGE; break;
+    case ICmpInst::ICMP_SLT: Opcode = BC_ICmpSLT; break;
+    case ICmpInst::ICMP_SLE: Opcode = BC_ICmpSLE; break;
+    }
+    emit(Opcode, Dst, getSlot(I.getOperand(0)), getSlot(I.getOperand(1)), 0,
+         getWidth(I.getOperand(0)->getType()));
+    return true;
+  }
+  case Instruction::FCmp: {
+    unsigned Opcode;
+    switch (cast<FCmpInst>(I).getPredicate()) {
+    default: llvm_unreachable("Invalid floating point predicate");
+    case FCmpInst::FCMP_FALSE: emit(BC_LoadImm, Dst, 0, 0, 0); return true;
+    case FCmpInst::FCMP_TRUE:  emit(BC_LoadImm, Dst, 0, 0, 1); return true;
+    case FCmpInst::FCMP_OEQ: Opcode = BC_FCmpOEQF; break;
+    case FCmpInst::FCMP_ONE: Opcode = BC_FCmpONEF; break;
+    case FCmpInst::FCMP_OGT: Opcode = BC_FCmpOGTF; break;
+    case FCmpInst::FCMP_OGE: Opcode = BC_FCmpOGEF; break;
+    case FCmpInst::FCMP_OLT: Opcode = BC_FCmpOLTF; break;
+    case FCmpInst::FCMP_OLE: Opcode = BC_FCmpOLEF; break;
+    case FCmpInst::FCMP_ORD: Opcode = BC_FCmpORDF; break;
+    case FCmpInst::FCMP_UNO: Opcode = BC_FCmpUNOF; break;
+    case FCmpInst::FCMP_UEQ: Opcode = BC_FCmpUEQF; break;
+    case FCmpInst::FCMP_UNE: Opcode = BC_FCmpUNEF; break;
+    case FCmpInst::FCMP_UGT: Opcode = BC_FCmpUGTF; break;
+    case FCmpInst::FCMP_UGE: Opcode = BC_FCmpUGEF; break;
+    case FCmpInst::FCMP_ULT: Opcode = BC_FCmpULTF; break;
+    case FCmpInst::FCMP_ULE: Opcode = BC_FCmpULEF; break;
+    }
+    if (I.getOperand(0)->getType()->isDoubleTy())
+      Opcode += BC_FCmpOEQD - BC_FCmpOEQF;
+    emit(Opcode, Dst, getSlot(I.getOperand(0)), getSlot(I.getOperand(1)));
+    return true;
+  }
+  case Instruction::Select:
+    if (!isSlotType(I.getOperand(0)->getType()))
+      return false;
+    emit(BC_Select, Dst, getSlot(I.getOperand(0)), getSlot(I.getOperand(1)),
+         getSlot(I.getOperand(2)));
+    return true;
+
+  case Instruction::Trunc:    case Instruction::ZExt:
+  case Instruction::SExt:     case Instruction::FPTrunc:
+  case Instruction::FPExt:    case Instruction::FPToUI:
+  case Instruction::FPToSI:   case Instruction::UIToFP:
+  case Instruction::SIToFP:   case Instruction::PtrToInt:
+  case Instruction::IntToPtr: case Instruction::BitCast:
+  case Instruction::AddrSpaceCast:
+    return lowerCast(cast<CastInst>(I));
+
+  case Instruction::Alloca: {
+    AllocaInst &AI = cast<AllocaInst>(I);
+    uint64_t TypeSize = TD.getTypeAllocSize(AI.getAllocatedType());
+    unsigned Align = std::max(AI.getAlignment(),
+                              TD.getPrefTypeAlignment(AI.getAllocatedType()));
+    ConstantInt *Count = dyn_cast<ConstantInt>(AI.getArraySize());
+    // Give the fixed size allocas of the entry block their place in a single
+    // block of memory, as long as malloc aligns it enough for them.
+    if (Count && AI.getParent() == &F.getEntryBlock() && Align <= 16) {
+      uint64_t Offset = RoundUpToAlignment(BF->StaticAllocaSize, Align);
+      BF->StaticAllocaSize =
+          Offset + std::max<uint64_t>(1, Count->getZExtValue() * TypeSize);
+      emit(BC_StaticAlloca, Dst, 0, 0, Offset);
+      return true;
+    }
+    if (!isSlotType(AI.getArraySize()->getType()))
+      return false;
+    emit(BC_Alloca, Dst, getSlot(AI.getArraySize()), 0, TypeSize);
+    return true;
+  }
+  case Instruction::Load: {
+    LoadInst &LI = cast<LoadInst>(I);
+    if (LI.isVolatile() && Interp.shouldPrintVolatile())
+      return false;
+    unsigned Opcode;
+    Type *Ty = LI.getType();
+    if (Ty->isFloatTy())
+      Opcode = BC_LoadF;
+    else if (Ty->isDoubleTy())
+      Opcode = BC_LoadD;
+    else if (Ty->isPointerTy())
+      Opcode = BC_LoadP;
+    else switch (Ty->getIntegerBitWidth()) {
+    default: return false;
+    case 1:  Opcode = BC_Load1; break;
+    case 8:  Opcode = BC_Load8; break;
+    case 16: Opcode = BC_Load16; break;
+    case 32: Opcode = BC_Load32; break;
+    case 64: Opcode = BC_Load64; break;
+    }
+    emit(Opcode, Dst, getSlot(LI.getPointerOperand()));
+    return true;
+  }
+  case Instruction::Store: {
+    StoreInst &SI = cast<StoreInst>(I);
+    if (SI.isVolatile() && Interp.shouldPrintVolatile())
+      return false;
+    Value *Val = SI.getValueOperand();
+    if (!isSlotType(Val->getType()))
+      return false;
+    unsigned Opcode;
+    Type *Ty = Val->getType();
+    if (Ty->isFloatTy())
+      Opcode = BC_StoreF;
+    else if (Ty->isDoubleTy())
+      Opcode = BC_StoreD;
+    else if (Ty->isPointerTy())
+      Opcode = BC_StoreP;
+    else switch (Ty->getIntegerBitWidth()) {
+    default: return false;
+    case 1:
+    case 8:  Opcode = BC_Store8; break;
+    case 16: Opcode = BC_Store16; break;
+    case 32: Opcode = BC_Store32; break;
+    case 64: Opcode = BC_Store64; break;
+    }
+    emit(Opcode, 0, getSlot(Val), getSlot(SI.getPointerOperand()));
+    return true;
+  }
+  case Instruction::GetElementPtr:
+    return lowerGEP(cast<GetElementPtrInst>(I));
+  case Instruction::Call:
+    return lowerCall(cast<CallInst>(I));
+  case Instruction::PHI:
+    // Copied on the edges into the block.
+    return true;
+  }
+}
+
+bool BytecodeLowering::lowerCast(CastInst &I) {
+  Type *SrcTy = I.getSrcTy(), *DstTy = I.getDestTy();
+  if (!isSlotType(I.getOperand(0)->getType()))
+    return false;
+  unsigned Dst = getSlot(&I), Src = getSlot(I.getOperand(0));
+  switch (I.getOpcode()) {
+  default: llvm_unreachable("Invalid cast");
+  case Instruction::Trunc:
+  case Instruction::PtrToInt:
+    emit(BC_Trunc, Dst, Src, 0, getMask(getWidth(DstTy)));
+    break;
+  case Instruction::IntToPtr:
+    emit(BC_Trunc, Dst, Src, 0, getMask(TD.getPointerSizeInBits()));
+    break;
+  case Instruction::ZExt:
+  case Instruction::AddrSpaceCast:
+    emit(BC_Move, Dst, Src);
+    break;
+  case Instruction::SExt:
+    emit(BC_SExt, Dst, Src, 0, getMask(getWidth(DstTy)), getWidth(SrcTy));
+    break;
+  case Instruction::FPTrunc:
+    emit(BC_FPTrunc, Dst, Src);
+    break;
+  case Instruction::FPExt:
+    emit(BC_FPExt, Dst, Src);
+    break;
+  case Instruction::FPToUI:
+  case Instruction::FPToSI:
+    emit(SrcTy->isFloatTy() ? BC_FPToIntF : BC_FPToIntD, Dst, Src, 0, 0,
+         getWidth(DstTy));
+    break;
+  case Instruction::UIToFP:
+    emit(DstTy->isFloatTy() ? BC_UIToFPF : BC_UIToFPD, Dst, Src);
+    break;
+  case Instruction::SIToFP:
+    emit(DstTy->isFloatTy() ? BC_SIToFPF : BC_SIToFPD, Dst, Src, 0, 0,
+         getWidth(SrcTy));
+    break;
+  case Instruction::BitCast:
+    if (SrcTy->isFloatTy() && DstTy->isIntegerTy())
+      emit(BC_FloatToBits, Dst, Src);
+    else if (SrcTy->isIntegerTy() && DstTy->isFloatTy())
+      emit(BC_BitsToFloat, Dst, Src);
+    else if (SrcTy->isDoubleTy() && DstTy->isIntegerTy())
+      emit(BC_DoubleToBits, Dst, Src);
+    else if (SrcTy->isIntegerTy() && DstTy->isDoubleTy())
+      emit(BC_BitsToDouble, Dst, Src);
+    else
+      emit(BC_Move, Dst, Src);
+    break;
+  }
+  return true;
+}
+
+bool BytecodeLowering::lowerGEP(GetElementPtrInst &I) {
+  if (!isSlotType(I.getPointerOperand()->getType()))
+    return false;
+  unsigned Dst = getSlot(&I), Base = getSlot(I.getPointerOperand());
+  // Fold the constant indices into a single offset, and scale the others
+  // one by one.
+  uint64_t Offset = 0;
+  for (gep_type_iterator GTI = gep_type_begin(I), E = gep_type_end(I);
+       GTI != E; ++GTI) {
+    if (StructType *STy = dyn_cast<StructType>(*GTI)) {
+      unsigned Field = cast<ConstantInt>(GTI.getOperand())->getZExtValue();
+      Offset += TD.getStructLayout(STy)->getElementOffset(Field);
+      continue;
+    }
+    uint64_t Scale =
+        TD.getTypeAllocSize(cast<SequentialType>(*GTI)->getElementType());
+    if (ConstantInt *CI = dyn_cast<ConstantInt>(GTI.getOperand())) {
+      Offset += Scale * CI->getSExtValue();
+      continue;
+    }
+    if (!isSlotType(GTI.getOperand()->getType()))
+      return false;
+    emit(BC_GEPIndex, Dst, Base, getSlot(GTI.getOperand()), Scale,
+         getWidth(GTI.getOperand()->getType()));
+    Base = Dst;
+  }
+  if (Offset || Base != Dst)
+    emit(BC_GEPConst, Dst, Base, 0, Offset);
+  return true;
+}
+
+bool BytecodeLowering::lowerCall(CallInst &I) {
+  // Debug intrinsics have no effect on execution.
+  if (isa<DbgInfoIntrinsic>(I))
+    return true;
+  if (I.isInlineAsm())
+    return false;
+
+  BytecodeCall Call;
+  Call.Callee = I.getCalledFunction();
+  if (Call.Callee && Call.Callee->isIntrinsic())
+    return false;
+  Call.CalleeSlot = Call.Callee ? 0 : getSlot(I.getCalledValue());
+  Call.FTy = cast<FunctionType>(
+      cast<PointerType>(I.getCalledValue()->getType())->getElementType());
+  for (unsigned i = 0, e = I.getNumArgOperands(); i != e; ++i) {
+    Value *Arg = I.getArgOperand(i);
+    if (!isSlotType(Arg->getType()))
+      return false;
+    Call.Args.push_back(getSlot(Arg));
+    Call.ArgTypes.push_back(Arg->getType());
+  }
+  Call.Target = nullptr;
+  Call.TargetResolved = false;
+  BF->Calls.push_back(std::move(Call));
+  emit(BC_Call, I.getType()->isVoidTy() ? 0 : getSlot(&I), 0,
+       BF->Calls.size() - 1);
+  return true;
+}
+
+/// Turn the labels of branches and switch tables into the index of the code
+/// they branch to, emitting the copies into PHI nodes along the way.
+void BytecodeLowering::resolveLabels() {
+  std::vector<unsigned> LabelStart(Edges.size());
+  for (unsigned Label = 0, e = Edges.size(); Label != e; ++Label) {
+    BasicBlock *From = Edges[Label].first, *To = Edges[Label].second;
+    if (!isa<PHINode>(To->begin())) {
+      LabelStart[Label] = BlockStart[To];
+      continue;
+    }
+
+    // The PHI nodes of a block are assigned all at once, so go through
+    // temporaries if one of them is assigned the value of another.
+    SmallVector<std::pair<unsigned, unsigned>, 8> Copies;
+    bool NeedsTemps = false;
+    for (BasicBlock::iterator I = To->begin(); isa<PHINode>(I); ++I) {
+      PHINode *PN = cast<PHINode>(I);
+      Value *Incoming = PN->getIncomingValueForBlock(From);
+      if (isa<PHINode>(Incoming) &&
+          cast<PHINode>(Incoming)->getParent() == To && Incoming != PN)
+        NeedsTemps = true;
+      Copies.push_back(std::make_pair(getSlot(PN), getSlot(Incoming)));
+    }
+
+    LabelStart[Label] = BF->Code.size();
+    if (NeedsTemps) {
+      for (unsigned i = 0, e = Copies.size(); i != e; ++i)
+        emit(BC_Move, TempBase + i, Copies[i].second);
+      for (unsigned i = 0, e = Copies.size(); i != e; ++i)
+        emit(BC_Move, Copies[i].first, TempBase + i);
+    } else {
+      for (auto &Copy : Copies)
+        if (Copy.first != Copy.second)
+          emit(BC_Move, Copy.first, Copy.second);
+    }
+    emit(BC_Br, BlockStart[To]);
+  }
+
+  for (auto &Fixup : LabelFixups) {
+    BytecodeInst &I = BF->Code[Fixup.first];
+    if (Fixup.second)
+      I.B = LabelStart[I.B];
+    else
+      I.Dst = LabelStart[I.Dst];
+  }
+  for (BytecodeSwitch &Table : BF->Switches) {
+    for (auto &Case : Table.Cases)
+      Case.second = LabelStart[Case.second];
+    Table.Default = LabelStart[Table.Default];
+  }
+}
+
+//===----------------------------------------------------------------------===//
+//                     Running Bytecode
+//===----------------------------------------------------------------------===//
+
+BytecodeFunction *Interpreter::getBytecode(Function *F) {
+  if (!UseBytecode || F->isDeclaration())
+    return nullptr;
+  auto Entry = BytecodeFunctions.find(F);
+  if (Entry != BytecodeFunctions.end())
+    return Entry->second.get();
+
+  std::unique_ptr<BytecodeFunction> BF = BytecodeLowering(*this, *F).lower();
+  if (BF)
+    ++NumBytecodeFunctions;
+  else
+    ++NumVisitedFunctions;
+  BytecodeFunction *Result = BF.get();
+  BytecodeFunctions[F] = std::move(BF);
+  return Result;
+}
+
+GenericValue Interpreter::runBytecode(BytecodeFunction &BF,
+                                      ArrayRef<GenericValue> ArgVals) {
+  Function *F = BF.F;
+  SmallVector<BytecodeSlot, 8> Args;
+  unsigned i = 0;
+  for (Argument &A : F->args()) {
+    BytecodeSlot S;
+    S.I = 0;
+    if (i < ArgVals.size())
+      S = toSlot(ArgVals[i], A.getType());
+    Args.push_back(S);
+    ++i;
+  }
+  BytecodeSlot Result = executeBytecode(BF, Args);
+  if (F->getReturnType()->isVoidTy())
+    return GenericValue();
+  return fromSlot(Result, F->getReturnType());
+}
+
+GenericValue Interpreter::callFromBytecode(Function *F,
+                                           ArrayRef<GenericValue> ArgVals) {
+  if (F->isDeclaration())
+    return callExternalFunction(F, ArgVals);
+
+  // Run the function on the instruction visitor, on top of a frame without a
+  // function that stops run() once the function returns.
+  ECStack.emplace_back();
+  callFunction(F, ArgVals);
+  run();
+  ECStack.pop_back();
+  return ExitValue;
+}
+
+BytecodeFunction *Interpreter::getCallTarget(BytecodeCall &Call,
+                                             BytecodeSlot *Frame,
+                                             Function *&Callee) {
+  Callee = Call.Callee;
+  BytecodeFunction *Target;
+  if (Callee) {
+    if (!Call.TargetResolved) {
+      Call.Target = getBytecode(Callee);
+      Call.TargetResolved = true;
+    }
+    Target = Call.Target;
+  } else {
+    // Function pointers are the Function itself, see getPointerToFunction.
+    Callee = (Function *)toPointer(Frame[Call.CalleeSlot]);
+    Target = getBytecode(Callee);
+  }
+  if (Target && Callee->getFunctionType() == Call.FTy)
+    return Target;
+  return nullptr;
+}
+
+void Interpreter::executeBytecodeCall(BytecodeCall &Call, Function *Callee,
+                                      BytecodeSlot *Frame, unsigned Dst) {
+  Type *RetTy = Call.FTy->getReturnType();
+  std::vector<GenericValue> ArgVals;
+  ArgVals.reserve(Call.Args.size());
+  for (unsigned i = 0, e = Call.Args.size(); i != e; ++i)
+    ArgVals.push_back(fromSlot(Frame[Call.Args[i]], Call.ArgTypes[i]));
+  GenericValue Result = callFromBytecode(Callee, ArgVals);
+  if (!RetTy->isVoidTy())
+    Frame[Dst] = toSlot(Result, RetTy);
+}
+
+namespace {
+/// A call to a bytecode function being run by executeBytecode.  Its frame is
+/// the slots of the slot stack from FrameBase on.
+struct BytecodeActivation {
+  BytecodeFunction *BF;
+  size_t FrameBase;
+  char *StaticAllocas;
+  AllocaHolder Allocas;
+  /// The call instruction the function is in, while it is calling another.
+  const BytecodeInst *CallIP;
+
+  BytecodeActivation(BytecodeFunction *BF, size_t FrameBase)
+      : BF(BF), FrameBase(FrameBase), StaticAllocas(nullptr),
+        CallIP(nullptr) {}
+
+  // Define explicit move special members for MSVC.
+  BytecodeActivation(BytecodeActivation &&RHS)
+      : BF(RHS.BF), FrameBase(RHS.FrameBase), StaticAllocas(RHS.StaticAllocas),
+        Allocas(std::move(RHS.Allocas)), CallIP(RHS.CallIP) {}
+  BytecodeActivation &operator=(BytecodeActivation &&RHS) {
+    BF = RHS.BF;
+    FrameBase = RHS.FrameBase;
+    StaticAllocas = RHS.StaticAllocas;
+    Allocas = std::move(RHS.Allocas);
+    CallIP = RHS.CallIP;
+    return *this;
+  }
+};
+} // end anonymous namespace
+
+BytecodeSlot Interpreter::executeBytecode(BytecodeFunction &EntryBF,
+                                          ArrayRef<BytecodeSlot> Args) {
+#if LLVM_INTERPRETER_THREADED_DISPATCH
+  static const void *const Handlers[] = {
+#define BYTECODE_HANDLER(Op) &&Op_##Op,
+    BYTECODE_OPCODES(BYTECODE_HANDLER)
+#undef BYTECODE_HANDLER
+  };
+#define TARGET(Op) case BC_##Op: Op_##Op:
+#define DISPATCH() goto *IP->Handler
+#else
+#define TARGET(Op) case BC_##Op:
+#define DISPATCH() continue
+#endif
+#define NEXT() { ++IP; DISPATCH(); }
+#define JUMP(Target) { IP = Code + (Target); DISPATCH(); }
+#define R(Field) Frame[IP->Field]
+
+  assert(Args.size() == EntryBF.F->arg_size() && "Wrong number of arguments!");
+
+  // Calls from bytecode to bytecode do not recurse on the C++ stack, so that
+  // the depth of recursion of the program is bounded by memory only.  Each
+  // call pushes an activation, and the frame of the callee on Slots, and the
+  // loop below goes on in the callee.  Returning pops them and resumes the
+  // caller after its call instruction.
+  SmallVector<BytecodeActivation, 16> Activations;
+  SmallVector<BytecodeSlot, 256> Slots;
+  BytecodeFunction *BF;
+  BytecodeSlot *Frame;
+  char *StaticAllocas;
+  const BytecodeInst *Code;
+  const BytecodeInst *IP;
+
+  // Push a frame for Callee, whose arguments are yet to be filled in, and
+  // start running it.
+  auto Enter = [&](BytecodeFunction &Callee) {
+#if LLVM_INTERPRETER_THREADED_DISPATCH
+    if (LLVM_UNLIKELY(!Callee.Threaded)) {
+      for (BytecodeInst &I : Callee.Code)
+        I.Handler = Handlers[I.Opcode];
+      Callee.Threaded = true;
+    }
+#endif
+    size_t Base = Slots.size();
+    if (Slots.capacity() < Base + Callee.NumSlots)
+      Slots.reserve(Base + Callee.NumSlots);
+    Slots.set_size(Base + Callee.NumSlots);
+    Activations.push_back(BytecodeActivation(&Callee, Base));
+    BF = &Callee;
+    Frame = Slots.data() + Base;
+    std::copy(Callee.Constants.begin(), Callee.Constants.end(),
+              Frame + Callee.ConstantBase);
+    StaticAllocas = nullptr;
+    if (Callee.StaticAllocaSize) {
+      StaticAllocas = (char *)malloc(Callee.StaticAllocaSize);
+      assert(StaticAllocas && "Null pointer returned by malloc!");
+      Activations.back().Allocas.add(StaticAllocas);
+      Activations.back().StaticAllocas = StaticAllocas;
+    }
+    Code = Callee.Code.data();
+    IP = Code;
+  };
+
+  // Pop the frame of the function returning.  Return true if it is the one
+  // executeBytecode was called for, and otherwise go back to the call
+  // instruction of the caller.
+  auto Leave = [&]() -> bool {
+    Slots.set_size(Activations.back().FrameBase);
+    Activations.pop_back();
+    if (Activations.empty())
+      return true;
+    BytecodeActivation &Caller = Activations.back();
+    BF = Caller.BF;
+    Frame = Slots.data() + Caller.FrameBase;
+    StaticAllocas = Caller.StaticAllocas;
+    Code = BF->Code.data();
+    IP = Caller.CallIP;
+    return false;
+  };
+
+  Enter(EntryBF);
+  std::copy(Args.begin(), Args.end(), Frame);
+
+  for (;;) {
+    switch (IP->Opcode) {
+    default: llvm_unreachable("Invalid bytecode opcode!");
+
+    TARGET(LoadImm) R(Dst).I = IP->Imm; NEXT();
+    TARGET(Move) R(Dst) = R(A); NEXT();
+    TARGET(Br) JUMP(IP->Dst);
+    TARGET(CondBr) if (R(A).I & 1) JUMP(IP->Dst); JUMP(IP->B);
+    TARGET(Switch) {
+      const BytecodeSwitch &Table = BF->Switches[IP->B];
+      uint64_t Val = R(A).I;
+      unsigned Target = Table.Default;
+      for (auto &Case : Table.Cases)
+        if (Case.first == Val) {
+          Target = Case.second;
+          break;
+        }
+      JUMP(Target);
+    }
+    // A function returns a value only to a call of the same type, whose Dst
+    // receives it.
+    TARGET(Ret) {
+      BytecodeSlot Result = R(A);
+      if (Leave())
+        return Result;
+      R(Dst) = Result;
+      NEXT();
+    }
+    TARGET(RetVoid) {
+      BytecodeSlot Result;
+      Result.I = 0;
+      if (Leave())
+        return Result;
+      NEXT();
+    }
+    TARGET(Unreachable)
+      report_fatal_error("Program executed an 'unreachable' instruction!");
+    TARGET(Call) {
+      BytecodeCall &Call = BF->Calls[IP->B];
+      Function *Callee;
+      BytecodeFunction *Target = getCallTarget(Call, Frame, Callee);
+      if (!Target) {
+        executeBytecodeCall(Call, Callee, Frame, IP->Dst);
+        NEXT();
+      }
+      Activations.back().CallIP = IP;
+      size_t CallerBase = Activations.back().FrameBase;
+      Enter(*Target);
+      for (unsigned i = 0, e = Call.Args.size(); i != e; ++i)
+        Frame[i] = Slots[CallerBase + Call.Args[i]];
+      DISPATCH();
+    }
+
+    // Integer values are kept zero-extended, so only the operations that may
+    // carry out of the width of their type need to mask their result.
+    TARGET(Add) R(Dst).I = (R(A).I + R(B).I) & IP->Imm; NEXT();
+    TARGET(Sub) R(Dst).I = (R(A).I - R(B).I) & IP->Imm; NEXT();
+    TARGET(Mul) R(Dst).I = (R(A).I * R(B).I) & IP->Imm; NEXT();
+    TARGET(UDiv) R(Dst).I = R(A).I / R(B).I; NEXT();
+    TARGET(URem) R(Dst).I = R(A).I % R(B).I; NEXT();
+    TARGET(SDiv) {
+      int64_t LHS = SignExtend64(R(A).I, IP->Width);
+      int64_t RHS = SignExtend64(R(B).I, IP->Width);
+      // Dividing the smallest value by -1 wraps around, as in APInt.
+      R(Dst).I = (RHS == -1 ? 0 - uint64_t(LHS) : uint64_t(LHS / RHS)) &
+                 IP->Imm;
+      NEXT();
+    }
+    TARGET(SRem) {
+      int64_t LHS = SignExtend64(R(A).I, IP->Width);
+      int64_t RHS = SignExtend64(R(B).I, IP->Width);
+      R(Dst).I = (RHS == -1 ? 0 : uint64_t(LHS % RHS)) & IP->Imm;
+      NEXT();
+    }
+    TARGET(Shl)
+      R(Dst).I = (R(A).I << getShiftAmount(R(B).I, IP->Width)) & IP->Imm;
+      NEXT();
+    TARGET(LShr) R(Dst).I = R(A).I >> getShiftAmount(R(B).I, IP->Width); NEXT();
+    TARGET(AShr)
+      R(Dst).I = uint64_t(SignExtend64(R(A).I, IP->Width) >>
+                          getShiftAmount(R(B).I, IP->Width)) & IP->Imm;
+      NEXT();
+    TARGET(And) R(Dst).I = R(A).I & R(B).I; NEXT();
+    TARGET(Or) R(Dst).I = R(A).I | R(B).I; NEXT();
+    TARGET(Xor) R(Dst).I = R(A).I ^ R(B).I; NEXT();
+
+    TARGET(FAddF) R(Dst).F = R(A).F + R(B).F; NEXT();
+    TARGET(FSubF) R(Dst).F = R(A).F - R(B).F; NEXT();
+    TARGET(FMulF) R(Dst).F = R(A).F * R(B).F; NEXT();
+    TARGET(FDivF) R(Dst).F = R(A).F / R(B).F; NEXT();
+    TARGET(FRemF) R(Dst).F = std::fmod(R(A).F, R(B).F); NEXT();
+    TARGET(FAddD) R(Dst).D = R(A).D + R(B).D; NEXT();
+    TARGET(FSubD) R(Dst).D = R(A).D - R(B).D; NEXT();
+    TARGET(FMulD) R(Dst).D = R(A).D * R(B).D; NEXT();
+    TARGET(FDivD) R(Dst).D = R(A).D / R(B).D; NEXT();
+    TARGET(FRemD) R(Dst).D = std::fmod(R(A).D, R(B).D); NEXT();
+
+    TARGET(ICmpEQ) R(Dst).I = R(A).I == R(B).I; NEXT();
+    TARGET(ICmpNE) R(Dst).I = R(A).I != R(B).I; NEXT();
+    TARGET(ICmpUGT) R(Dst).I = R(A).I > R(B).I; NEXT();
+    TARGET(ICmpUGE) R(Dst).I = R(A).I >= R(B).I; NEXT();
+    TARGET(ICmpULT) R(Dst).I = R(A).I < R(B).I; NEXT();
+    TARGET(ICmpULE) R(Dst).I = R(A).I <= R(B).I; NEXT();
+#define SIGNED_ICMP(Op, Pred)                                                  \
+    TARGET(Op)                                                                 \
+      R(Dst).I = SignExtend64(R(A).I, IP->Width) Pred                          \
+                 SignExtend64(R(B).I, IP->Width);                              \
+      NEXT();
+    SIGNED_ICMP(ICmpSGT, >)
+    SIGNED_ICMP(ICmpSGE, >=)
+    SIGNED_ICMP(ICmpSLT, <)
+    SIGNED_ICMP(ICmpSLE, <=)
+#undef SIGNED_ICMP
+
+    // A value is unordered with respect to another if either is a NaN, which
+    // makes all ordered comparisons false.
+#define FCMPS(T, M)                                                            \
+    TARGET(FCmpOEQ##T) R(Dst).I = R(A).M == R(B).M; NEXT();                    \
+    TARGET(FCmpONE##T) R(Dst).I = R(A).M < R(B).M || R(A).M > R(B).M; NEXT();  \
+    TARGET(FCmpOGT##T) R(Dst).I = R(A).M > R(B).M; NEXT();                     \
+    TARGET(FCmpOGE##T) R(Dst).I = R(A).M >= R(B).M; NEXT();                    \
+    TARGET(FCmpOLT##T) R(Dst).I = R(A).M < R(B).M; NEXT();                     \
+    TARGET(FCmpOLE##T) R(Dst).I = R(A).M <= R(B).M; NEXT();                    \
+    TARGET(FCmpORD##T)                                                         \
+      R(Dst).I = R(A).M == R(A).M && R(B).M == R(B).M; NEXT();                 \
+    TARGET(FCmpUNO##T)                                                         \
+      R(Dst).I = R(A).M != R(A).M || R(B).M != R(B).M; NEXT();                 \
+    TARGET(FCmpUEQ##T)                                                         \
+      R(Dst).I = !(R(A).M < R(B).M || R(A).M > R(B).M); NEXT();                \
+    TARGET(FCmpUNE##T) R(Dst).I = R(A).M != R(B).M; NEXT();                    \
+    TARGET(FCmpUGT##T) R(Dst).I = !(R(A).M <= R(B).M); NEXT();                 \
+    TARGET(FCmpUGE##T) R(Dst).I = !(R(A).M < R(B).M); NEXT();                  \
+    TARGET(FCmpULT##T) R(Dst).I = !(R(A).M >= R(B).M); NEXT();                 \
+    TARGET(FCmpULE##T) R(Dst).I = !(R(A).M > R(B).M); NEXT();
+    FCMPS(F, F)
+    FCMPS(D, D)
+#undef FCMPS
+
+    TARGET(Select) R(Dst) = (R(A).I & 1) ? R(B) : Frame[IP->Imm]; NEXT();
+    TARGET(Trunc) R(Dst).I = R(A).I & IP->Imm; NEXT();
+    TARGET(SExt)
+      R(Dst).I = uint64_t(SignExtend64(R(A).I, IP->Width)) & IP->Imm;
+      NEXT();
+    TARGET(FPTrunc) R(Dst).F = float(R(A).D); NEXT();
+    TARGET(FPExt) R(Dst).D = R(A).F; NEXT();
+    // These match the conversions done by the instruction visitor.
+    TARGET(FPToIntF)
+      R(Dst).I = APIntOps::RoundFloatToAPInt(R(A).F, IP->Width)
+                     .getZExtValue();
+      NEXT();
+    TARGET(FPToIntD)
+      R(Dst).I = APIntOps::RoundDoubleToAPInt(R(A).D, IP->Width)
+                     .getZExtValue();
+      NEXT();
+    TARGET(UIToFPF) R(Dst).F = float(double(R(A).I)); NEXT();
+    TARGET(UIToFPD) R(Dst).D = double(R(A).I); NEXT();
+    TARGET(SIToFPF)
+      R(Dst).F = float(double(SignExtend64(R(A).I, IP->Width)));
+      NEXT();
+    TARGET(SIToFPD) R(Dst).D = double(SignExtend64(R(A).I, IP->Width)); NEXT();
+    TARGET(FloatToBits) R(Dst).I = FloatToBits(R(A).F); NEXT();
+    TARGET(BitsToFloat) R(Dst).F = BitsToFloat(uint32_t(R(A).I)); NEXT();
+    TARGET(DoubleToBits) R(Dst).I = DoubleToBits(R(A).D); NEXT();
+    TARGET(BitsToDouble) R(Dst).D = BitsToDouble(R(A).I); NEXT();
+
+    TARGET(StaticAlloca) R(Dst).I = uintptr_t(StaticAllocas + IP->Imm); NEXT();
+    TARGET(Alloca) {
+      // Avoid malloc-ing zero bytes, use max()...
+      void *Memory = malloc(std::max<uint64_t>(1, R(A).I * IP->Imm));
+      assert(Memory && "Null pointer returned by malloc!");
+      Activations.back().Allocas.add(Memory);
+      R(Dst).I = uintptr_t(Memory);
+      NEXT();
+    }
+    TARGET(GEPConst) R(Dst).I = R(A).I + IP->Imm; NEXT();
+    TARGET(GEPIndex)
+      R(Dst).I = R(A).I + uint64_t(SignExtend64(R(B).I, IP->Width)) * IP->Imm;
+      NEXT();
+
+    TARGET(Load1) R(Dst).I = loadInt<uint8_t>(R(A)) & 1; NEXT();
+    TARGET(Load8) R(Dst).I = loadInt<uint8_t>(R(A)); NEXT();
+    TARGET(Load16) R(Dst).I = loadInt<uint16_t>(R(A)); NEXT();
+    TARGET(Load32) R(Dst).I = loadInt<uint32_t>(R(A)); NEXT();
+    TARGET(Load64) R(Dst).I = loadInt<uint64_t>(R(A)); NEXT();
+    TARGET(LoadF) memcpy(&R(Dst).F, toPointer(R(A)), sizeof(float)); NEXT();
+    TARGET(LoadD) memcpy(&R(Dst).D, toPointer(R(A)), sizeof(double)); NEXT();
+    TARGET(LoadP) R(Dst).I = uintptr_t(loadInt<uintptr_t>(R(A))); NEXT();
+    TARGET(Store8) storeInt<uint8_t>(R(B), R(A).I); NEXT();
+    TARGET(Store16) storeInt<uint16_t>(R(B), R(A).I); NEXT();
+    TARGET(Store32) storeInt<uint32_t>(R(B), R(A).I); NEXT();
+    TARGET(Store64) storeInt<uint64_t>(R(B), R(A).I); NEXT();
+    TARGET(StoreF) memcpy(toPointer(R(B)), &R(A).F, sizeof(float)); NEXT();
+    TARGET(StoreD) memcpy(toPointer(R(B)), &R(A).D, sizeof(double)); NEXT();
+    TARGET(StoreP) storeInt<uintptr_t>(R(B), R(A).I); NEXT();
+    }
+  }
+
+#undef R
+#undef JUMP
+#undef NEXT
+#undef DISPATCH
+#undef TARGET
+}
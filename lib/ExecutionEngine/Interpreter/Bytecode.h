@@ -0,0 +1,125 @@
+//===-- Bytecode.h - Register bytecode for the interpreter -----*- C++ -*--===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the register-based bytecode that the interpreter lowers
+// functions to before running them.  Every SSA value of a function gets a
+// slot in a flat frame holding an unboxed 64-bit value: integers are kept
+// zero-extended from their bit width, pointers as integers, and floats and
+// doubles natively.  Constants are given slots too, which are filled in when
+// the frame is created, so that operands never need to be decoded.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_LIB_EXECUTIONENGINE_INTERPRETER_BYTECODE_H
+#define LLVM_LIB_EXECUTIONENGINE_INTERPRETER_BYTECODE_H
+
+#include "llvm/Support/DataTypes.h"
+#include <utility>
+#include <vector>
+
+namespace llvm {
+
+class Function;
+class FunctionType;
+class Type;
+struct BytecodeFunction;
+
+// The opcodes of the bytecode.  Operations on integers take their bit width
+// from BytecodeInst::Width, and those that may carry out of it the mask of
+// the result from BytecodeInst::Imm.  Floating point operations come in a
+// float (F) and a double (D) flavour.
+#define BYTECODE_FCMP_OPCODES(X, T)                                            \
+  X(FCmpOEQ##T) X(FCmpONE##T) X(FCmpOGT##T) X(FCmpOGE##T) X(FCmpOLT##T)        \
+  X(FCmpOLE##T) X(FCmpORD##T) X(FCmpUNO##T) X(FCmpUEQ##T) X(FCmpUNE##T)        \
+  X(FCmpUGT##T) X(FCmpUGE##T) X(FCmpULT##T) X(FCmpULE##T)
+
+#define BYTECODE_OPCODES(X)                                                    \
+  X(LoadImm) X(Move) X(Br) X(CondBr) X(Switch) X(Ret) X(RetVoid)               \
+  X(Unreachable) X(Call)                                                       \
+  X(Add) X(Sub) X(Mul) X(UDiv) X(SDiv) X(URem) X(SRem)                         \
+  X(Shl) X(LShr) X(AShr) X(And) X(Or) X(Xor)                                   \
+  X(FAddF) X(FSubF) X(FMulF) X(FDivF) X(FRemF)                                 \
+  X(FAddD) X(FSubD) X(FMulD) X(FDivD) X(FRemD)                                 \
+  X(ICmpEQ) X(ICmpNE) X(ICmpUGT) X(ICmpUGE) X(ICmpULT) X(ICmpULE)              \
+  X(ICmpSGT) X(ICmpSGE) X(ICmpSLT) X(ICmpSLE)                                  \
+  BYTECODE_FCMP_OPCODES(X, F) BYTECODE_FCMP_OPCODES(X, D)                      \
+  X(Select) X(Trunc) X(SExt) X(FPTrunc) X(FPExt)                               \
+  X(FPToIntF) X(FPToIntD)                                                      \
+  X(UIToFPF) X(UIToFPD) X(SIToFPF) X(SIToFPD)                                  \
+  X(FloatToBits) X(BitsToFloat) X(DoubleToBits) X(BitsToDouble)                \
+  X(StaticAlloca) X(Alloca) X(GEPConst) X(GEPIndex)                            \
+  X(Load1) X(Load8) X(Load16) X(Load32) X(Load64) X(LoadF) X(LoadD)            \
+  X(LoadP) X(Store8) X(Store16) X(Store32) X(Store64) X(StoreF)                \
+  X(StoreD) X(StoreP)
+
+enum BytecodeOpcode {
+#define BYTECODE_ENUM(Op) BC_##Op,
+  BYTECODE_OPCODES(BYTECODE_ENUM)
+#undef BYTECODE_ENUM
+  BC_NumOpcodes
+};
+
+/// One slot of a bytecode frame.
+union BytecodeSlot {
+  uint64_t I;
+  float F;
+  double D;
+};
+
+/// One bytecode instruction.  Dst, A and B are normally frame slots; branch
+/// targets and the indices of call sites and switch tables are stored in
+/// them too.  Select keeps its third operand in Imm.
+struct BytecodeInst {
+  /// The code implementing the opcode, when dispatch is threaded.
+  const void *Handler;
+  uint16_t Opcode;
+  uint8_t Width;
+  uint32_t Dst, A, B;
+  uint64_t Imm;
+};
+
+struct BytecodeCall {
+  /// The called function, or null if the call is indirect, in which case the
+  /// callee is read from CalleeSlot.
+  Function *Callee;
+  unsigned CalleeSlot;
+  /// The type of the call, and of each argument passed.
+  FunctionType *FTy;
+  std::vector<Type *> ArgTypes;
+  std::vector<unsigned> Args;
+  /// The bytecode of a direct callee, filled in on the first call.
+  BytecodeFunction *Target;
+  bool TargetResolved;
+};
+
+struct BytecodeSwitch {
+  std::vector<std::pair<uint64_t, unsigned>> Cases;
+  unsigned Default;
+};
+
+struct BytecodeFunction {
+  Function *F;
+  std::vector<BytecodeInst> Code;
+  /// The arguments of the function are in the first slots of a frame, and its
+  /// constants in the slots from ConstantBase on.
+  unsigned NumSlots;
+  unsigned ConstantBase;
+  std::vector<BytecodeSlot> Constants;
+  /// The bytes of memory needed by the fixed size allocas of the entry block,
+  /// which are allocated at once when the function is called.
+  unsigned StaticAllocaSize;
+  std::vector<BytecodeCall> Calls;
+  std::vector<BytecodeSwitch> Switches;
+  /// Whether the Handler of each instruction has been filled in.
+  bool Threaded;
+};
+
+} // End llvm namespace
+
+#endif
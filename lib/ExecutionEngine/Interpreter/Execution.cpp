@@ -43,6 +43,10 @@ static void SetValue(Value *V, GenericValue Val, ExecutionContext &SF) {
   SF.Values[V] = Val;
 }
 
+bool Interpreter::shouldPrintVolatile() const {
+  return PrintVolatile;
+}
+
 //===----------------------------------------------------------------------===//
 //                    Binary Instruction Implementations
 //===----------------------------------------------------------------------===//
@@ -829,7 +833,8 @@ void Interpreter::exitCalled(GenericValue GV) {
 /// Pop the last stack frame off of ECStack and then copy the result
 /// back into the result variable if we are not returning void. The
 /// result variable may be the ExitValue, or the Value of the calling
-/// CallInst if there was a previous stack frame. This method may
+/// CallInst if there was a previous stack frame. Returning to bytecode
+/// also leaves the result in ExitValue, for callFromBytecode. This method may
 /// invalidate any ECStack iterators you have. This method also takes
 /// care of switching to the normal destination BB, if we are returning
 /// from an invoke.
@@ -839,7 +844,8 @@ void Interpreter::popStackAndReturnValueToCaller(Type *RetTy,
   // Pop the current stack frame.
   ECStack.pop_back();
 
-  if (ECStack.empty()) {  // Finished main.  Put result into exit code...
+  if (ECStack.empty() || !ECStack.back().CurFunction) {
+    // Finished main, or returning to bytecode.  Put result into exit code...
     if (RetTy && !RetTy->isVoidTy()) {          // Nonvoid return type?
       ExitValue = Result;   // Capture the exit value of the program
     } else {
@@ -2077,6 +2083,16 @@ void Interpreter::callFunction(Function *F, ArrayRef<GenericValue> ArgVals) {
   assert((ECStack.empty() || !ECStack.back().Caller.getInstruction() ||
           ECStack.back().Caller.arg_size() == ArgVals.size()) &&
          "Incorrect number of arguments passed into function call!");
+  // Run the function as bytecode if it can be lowered to it, and simulate a
+  // 'ret' from it.
+  if (BytecodeFunction *BF = getBytecode(F)) {
+    GenericValue Result = runBytecode(*BF, ArgVals);
+    ECStack.emplace_back();
+    ECStack.back().CurFunction = F;
+    popStackAndReturnValueToCaller(F->getReturnType(), Result);
+    return;
+  }
+
   // Make a new stack frame... and fill it in.
   ECStack.emplace_back();
   ExecutionContext &StackFrame = ECStack.back();
@@ -2111,7 +2127,8 @@ void Interpreter::callFunction(Function *F, ArrayRef<GenericValue> ArgVals) {
 
 
 void Interpreter::run() {
-  while (!ECStack.empty()) {
+  // Stop at the frame of a bytecode caller, which resumes by itself.
+  while (!ECStack.empty() && ECStack.back().CurFunction) {
     // Interpret a single instruction & increment the "PC".
     ExecutionContext &SF = ECStack.back();  // Current stack frame
     Instruction &I = *SF.CurInst++;         // Increment before execute
@@ -14,6 +14,7 @@
 #ifndef LLVM_LIB_EXECUTIONENGINE_INTERPRETER_INTERPRETER_H
 #define LLVM_LIB_EXECUTIONENGINE_INTERPRETER_INTERPRETER_H
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
 #include "llvm/ExecutionEngine/GenericValue.h"
 #include "llvm/IR/CallSite.h"
@@ -27,6 +28,9 @@ namespace llvm {
 
 class IntrinsicLowering;
 struct FunctionInfo;
+struct BytecodeFunction;
+struct BytecodeCall;
+union BytecodeSlot;
 template<typename T> class generic_gep_type_iterator;
 class ConstantExpr;
 typedef generic_gep_type_iterator<User::const_op_iterator> gep_type_iterator;
@@ -60,7 +64,8 @@ public:
 typedef std::vector<GenericValue> ValuePlaneTy;
 
 // ExecutionContext struct - This struct represents one stack frame currently
-// executing.
+// executing.  A frame without a function marks where a function running as
+// bytecode called one that is interpreted instruction by instruction.
 //
 struct ExecutionContext {
   Function             *CurFunction;// The currently executing function
@@ -106,6 +111,11 @@ class Interpreter : public ExecutionEngine, public InstVisitor<Interpreter> {
   // registered with the atexit() library function.
   std::vector<Function*> AtExitHandlers;
 
+  // BytecodeFunctions - The bytecode of each function lowered so far, or null
+  // for functions that cannot be lowered and are interpreted instruction by
+  // instruction instead.
+  DenseMap<Function*, std::unique_ptr<BytecodeFunction>> BytecodeFunctions;
+
 public:
   explicit Interpreter(std::unique_ptr<Module> M);
   ~Interpreter() override;
@@ -249,6 +259,19 @@ private:  // Helper functions
                                     Type *Ty, ExecutionContext &SF);
   void popStackAndReturnValueToCaller(Type *RetTy, GenericValue Result);
 
+  // Bytecode execution, see Bytecode.cpp.
+  friend class BytecodeLowering;
+  bool shouldPrintVolatile() const;
+  BytecodeFunction *getBytecode(Function *F);
+  GenericValue runBytecode(BytecodeFunction &BF,
+                           ArrayRef<GenericValue> ArgVals);
+  BytecodeSlot executeBytecode(BytecodeFunction &BF,
+                               ArrayRef<BytecodeSlot> Args);
+  BytecodeFunction *getCallTarget(BytecodeCall &Call, BytecodeSlot *Frame,
+                                  Function *&Callee);
+  void executeBytecodeCall(BytecodeCall &Call, Function *Callee,
+                           BytecodeSlot *Frame, unsigned Dst);
+  GenericValue callFromBytecode(Function *F, ArrayRef<GenericValue> ArgVals);
 };
 
 } // End llvm namespace
@@ -44,6 +44,8 @@ void makeStub(Function &F, GlobalVariable &ImplPointer) {
   BasicBlock *EntryBlock = BasicBlock::Create(M.getContext(), "entry", &F);
   IRBuilder<> Builder(EntryBlock);
   LoadInst *ImplAddr = Builder.CreateLoad(&ImplPointer);
+  ImplAddr->setAlignment(M.getDataLayout().getPointerABIAlignment());
+  ImplAddr->setAtomic(Unordered);
   std::vector<Value*> CallArgs;
   for (auto &A : F.args())
     CallArgs.push_back(&A);
@@ -56,6 +58,45 @@ void makeStub(Function &F, GlobalVariable &ImplPointer) {
     Builder.CreateRet(Call);
 }
 
+void addHotCallCounter(Function &F, TargetAddress CounterAddr,
+                       uint64_t HotCount, TargetAddress CallbackAddr,
+                       TargetAddress CallbackArg) {
+  assert(!F.isDeclaration() && "Can't count the calls of a declaration.");
+  assert(HotCount > 0 && "Functions can't be hot before they are called.");
+  LLVMContext &Context = F.getContext();
+  BasicBlock *OldEntry = &F.getEntryBlock();
+  BasicBlock *Entry =
+    BasicBlock::Create(Context, "orc.count", &F, OldEntry);
+  BasicBlock *Hot = BasicBlock::Create(Context, "orc.hot", &F, OldEntry);
+
+  // Keep the static allocas in the entry block.
+  while (auto *AI = dyn_cast<AllocaInst>(OldEntry->begin())) {
+    if (!isa<Constant>(AI->getArraySize()))
+      break;
+    AI->removeFromParent();
+    Entry->getInstList().push_back(AI);
+  }
+
+  IRBuilder<> Builder(Entry);
+  Type *Int64Ty = Builder.getInt64Ty();
+  Constant *Counter =
+    ConstantExpr::getIntToPtr(Builder.getInt64(CounterAddr),
+                              PointerType::getUnqual(Int64Ty));
+  Value *Calls = Builder.CreateAtomicRMW(AtomicRMWInst::Add, Counter,
+                                         Builder.getInt64(1), Monotonic);
+  Value *IsHot = Builder.CreateICmpEQ(Calls, Builder.getInt64(HotCount - 1));
+  Builder.CreateCondBr(IsHot, Hot, OldEntry);
+
+  Builder.SetInsertPoint(Hot);
+  FunctionType *CallbackTy =
+    FunctionType::get(Builder.getVoidTy(), Builder.getInt8PtrTy(), false);
+  Constant *Arg =
+    ConstantExpr::getIntToPtr(Builder.getInt64(CallbackArg),
+                              Builder.getInt8PtrTy());
+  Builder.CreateCall(createIRTypedAddress(*CallbackTy, CallbackAddr), Arg);
+  Builder.CreateBr(OldEntry);
+}
+
 // Utility class for renaming global values and functions during partitioning.
 class GlobalRenamer {
 public:
@@ -127,22 +168,28 @@ Function* cloneFunctionDecl(Module &Dst, const Function &F,
   return NewF;
 }
 
-void moveFunctionBody(Function &OrigF, ValueToValueMapTy &VMap,
-                      ValueMaterializer *Materializer,
-                      Function *NewF) {
-  assert(!OrigF.isDeclaration() && "Nothing to move");
+void cloneFunctionBody(Function &OrigF, ValueToValueMapTy &VMap,
+                       ValueMaterializer *Materializer,
+                       Function *NewF) {
+  assert(!OrigF.isDeclaration() && "Nothing to clone");
   if (!NewF)
     NewF = cast<Function>(VMap[&OrigF]);
   else
     assert(VMap[&OrigF] == NewF && "Incorrect function mapping in VMap.");
   assert(NewF && "Function mapping missing from VMap.");
   assert(NewF->getParent() != OrigF.getParent() &&
-         "moveFunctionBody should only be used to move bodies between "
+         "cloneFunctionBody should only be used to copy bodies between "
          "modules.");
 
   SmallVector<ReturnInst *, 8> Returns; // Ignore returns cloned.
   CloneFunctionInto(NewF, &OrigF, VMap, /*ModuleLevelChanges=*/true, Returns,
                     "", nullptr, nullptr, Materializer);
+}
+
+void moveFunctionBody(Function &OrigF, ValueToValueMapTy &VMap,
+                      ValueMaterializer *Materializer,
+                      Function *NewF) {
+  cloneFunctionBody(OrigF, VMap, Materializer, NewF);
   OrigF.deleteBody();
 }
 
@@ -0,0 +1,75 @@
+//===--------- ObjectLinkingLayer.cpp - Linking of JIT'd object sets ------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/Orc/ObjectLinkingLayer.h"
+#include "llvm/ADT/SmallPtrSet.h"
+
+namespace llvm {
+namespace orc {
+
+LLVM_THREAD_LOCAL std::vector<ObjectLinkingLayerBase::LinkedObjectSet*> *
+ObjectLinkingLayerBase::PendingDependencies = nullptr;
+
+TargetAddress
+ObjectLinkingLayerBase::getAddressWhenReady(LinkedObjectSet &LOS,
+                                            TargetAddress Addr) {
+  if (LOS.Ready)
+    return Addr;
+
+  // We're resolving the relocations of another set. Finalizing LOS here could
+  // deadlock with a thread that finalizes LOS and needs that other set, so
+  // leave it to finalizeWithDependencies.
+  if (PendingDependencies) {
+    PendingDependencies->push_back(&LOS);
+    return Addr;
+  }
+
+  finalizeWithDependencies(LOS);
+  return Addr;
+}
+
+void ObjectLinkingLayerBase::finalizeWithDependencies(LinkedObjectSet &LOS) {
+  if (LOS.Ready)
+    return;
+
+  SmallVector<LinkedObjectSet*, 8> Worklist;
+  SmallPtrSet<LinkedObjectSet*, 8> Visited;
+  Worklist.push_back(&LOS);
+  while (!Worklist.empty()) {
+    LinkedObjectSet *S = Worklist.pop_back_val();
+    if (S->Ready || !Visited.insert(S).second)
+      continue;
+
+    bool FinalizedHere = false;
+    {
+      std::lock_guard<std::mutex> Locked(S->FinalizeLock);
+      if (S->State == LinkedObjectSet::Raw) {
+        std::vector<LinkedObjectSet*> Dependencies;
+        auto *OuterDependencies = PendingDependencies;
+        PendingDependencies = &Dependencies;
+        S->Finalize();
+        PendingDependencies = OuterDependencies;
+        S->Dependencies = std::move(Dependencies);
+        FinalizedHere = true;
+      }
+      Worklist.append(S->Dependencies.begin(), S->Dependencies.end());
+    }
+
+    if (FinalizedHere && S->NotifyFinalized)
+      S->NotifyFinalized();
+  }
+
+  // Only now can the code of the visited sets run: everything it refers to
+  // has been finalized, by this thread or by another one.
+  for (LinkedObjectSet *S : Visited)
+    S->Ready = true;
+}
+
+} // End namespace orc.
+} // End namespace llvm.
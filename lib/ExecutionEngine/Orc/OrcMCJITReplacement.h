@@ -234,6 +234,8 @@ public:
     CompileLayer.setObjectCache(NewCache);
   }
 
+  TargetMachine *getTargetMachine() override { return TM.get(); }
+
 private:
 
   RuntimeDyld::SymbolInfo findMangledSymbol(StringRef Name) {
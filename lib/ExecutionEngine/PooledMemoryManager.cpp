@@ -0,0 +1,311 @@
+//===- PooledMemoryManager.cpp - Memory manager sharing slabs -------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements JITMemoryPool and PooledMemoryManager.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/PooledMemoryManager.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/MutexGuard.h"
+#include "llvm/Support/Process.h"
+#include <algorithm>
+#include <iterator>
+
+using namespace llvm;
+
+//===----------------------------------------------------------------------===//
+// JITMemoryPool
+//===----------------------------------------------------------------------===//
+
+const size_t JITMemoryPool::HugePageSize;
+
+JITMemoryPool::JITMemoryPool(size_t SlabSize, bool UseHugePages)
+    : PageSize(sys::Process::getPageSize()), UseHugePages(UseHugePages) {
+  size_t Granularity = UseHugePages ? HugePageSize : PageSize;
+  this->SlabSize = RoundUpToAlignment(std::max<size_t>(SlabSize, 1),
+                                      Granularity);
+}
+
+JITMemoryPool::~JITMemoryPool() {
+  for (SlabList &List : Lists)
+    for (auto &Entry : List.Slabs)
+      destroySlab(*Entry.second);
+}
+
+JITMemoryPool::Slab *JITMemoryPool::createSlab(MemoryKind K, size_t MinSize) {
+  size_t Granularity = UseHugePages ? HugePageSize : PageSize;
+  size_t Size = RoundUpToAlignment(std::max(MinSize, SlabSize), Granularity);
+  // Map enough to find an aligned slab inside the mapping.  The pages before
+  // and after it are never touched, so they only take address space.
+  size_t MapSize = Size + (Granularity - PageSize);
+
+  // Keep all the slabs close together, so that the code of one module can
+  // refer to the data of another with PC-relative relocations.
+  const sys::MemoryBlock *Near = nullptr;
+  for (SlabList &List : Lists)
+    if (!List.Slabs.empty())
+      Near = &List.Slabs.rbegin()->second->Mapping;
+
+  unsigned Flags = sys::Memory::MF_READ | sys::Memory::MF_WRITE;
+  if (hasFixedPermissions() && K == Code)
+    Flags |= sys::Memory::MF_EXEC;
+  std::error_code EC;
+  sys::MemoryBlock Mapping =
+      sys::Memory::allocateMappedMemory(MapSize, Near, Flags, EC);
+  if (EC)
+    return nullptr;
+
+  auto S = llvm::make_unique<Slab>();
+  S->Mapping = Mapping;
+  S->Base = RoundUpToAlignment(reinterpret_cast<uintptr_t>(Mapping.base()),
+                               Granularity);
+  S->Size = Size;
+  S->Free[S->Base] = Size;
+  S->FreeSize = Size;
+  if (UseHugePages)
+    sys::Memory::adviseHugePages(
+        sys::MemoryBlock(reinterpret_cast<void *>(S->Base), Size));
+  return S.release();
+}
+
+void JITMemoryPool::destroySlab(Slab &S) {
+  sys::Memory::releaseMappedMemory(S.Mapping);
+}
+
+sys::MemoryBlock JITMemoryPool::allocate(MemoryKind K, size_t Size) {
+  Size = RoundUpToAlignment(std::max<size_t>(Size, 1), PageSize);
+  MutexGuard Locked(Lock);
+  SlabList &List = Lists[K];
+
+  // Take the first free range large enough, by address.
+  Slab *S = nullptr;
+  std::map<uintptr_t, size_t>::iterator Range;
+  for (auto &Entry : List.Slabs) {
+    Slab &Candidate = *Entry.second;
+    if (Candidate.FreeSize < Size)
+      continue;
+    for (Range = Candidate.Free.begin(); Range != Candidate.Free.end();
+         ++Range)
+      if (Range->second >= Size)
+        break;
+    if (Range != Candidate.Free.end()) {
+      S = &Candidate;
+      break;
+    }
+  }
+
+  if (!S) {
+    S = createSlab(K, Size);
+    if (!S)
+      return sys::MemoryBlock();
+    List.Slabs[S->Base].reset(S);
+    Range = S->Free.begin();
+  }
+
+  uintptr_t Addr = Range->first;
+  size_t Remaining = Range->second - Size;
+  S->Free.erase(Range);
+  if (Remaining)
+    S->Free[Addr + Size] = Remaining;
+  S->FreeSize -= Size;
+  List.AllocatedSize += Size;
+  return sys::MemoryBlock(reinterpret_cast<void *>(Addr), Size);
+}
+
+void JITMemoryPool::release(MemoryKind K, const sys::MemoryBlock &Block) {
+  if (!Block.base() || !Block.size())
+    return;
+  uintptr_t Addr = reinterpret_cast<uintptr_t>(Block.base());
+  size_t Size = RoundUpToAlignment(Block.size(), PageSize);
+  assert(Addr % PageSize == 0 && "Released block is not page aligned!");
+
+  // The pages may have been made executable or read-only.
+  if (!hasFixedPermissions())
+    sys::Memory::protectMappedMemory(
+        sys::MemoryBlock(Block.base(), Size),
+        sys::Memory::MF_READ | sys::Memory::MF_WRITE);
+
+  MutexGuard Locked(Lock);
+  SlabList &List = Lists[K];
+  auto SI = List.Slabs.upper_bound(Addr);
+  assert(SI != List.Slabs.begin() && "Block not allocated from this pool!");
+  Slab &S = *(--SI)->second;
+  assert(Addr + Size <= S.Base + S.Size && "Block not allocated from slab!");
+
+  // Coalesce the range with its free neighbours.
+  auto Next = S.Free.lower_bound(Addr);
+  assert((Next == S.Free.end() || Next->first >= Addr + Size) &&
+         "Block released twice!");
+  uintptr_t Start = Addr;
+  size_t Length = Size;
+  if (Next != S.Free.begin()) {
+    auto Prev = std::prev(Next);
+    assert(Prev->first + Prev->second <= Addr && "Block released twice!");
+    if (Prev->first + Prev->second == Addr) {
+      Start = Prev->first;
+      Length += Prev->second;
+      S.Free.erase(Prev);
+    }
+  }
+  if (Next != S.Free.end() && Next->first == Addr + Size) {
+    Length += Next->second;
+    S.Free.erase(Next);
+  }
+  S.Free[Start] = Length;
+  S.FreeSize += Size;
+  List.AllocatedSize -= Size;
+
+  // Unmap the slab if it is unused, unless it is the only unused one.
+  if (S.FreeSize != S.Size)
+    return;
+  for (auto &Entry : List.Slabs) {
+    Slab &Other = *Entry.second;
+    if (&Other != &S && Other.FreeSize == Other.Size) {
+      destroySlab(S);
+      List.Slabs.erase(SI);
+      return;
+    }
+  }
+}
+
+unsigned JITMemoryPool::getNumSlabs(MemoryKind K) const {
+  MutexGuard Locked(Lock);
+  return Lists[K].Slabs.size();
+}
+
+size_t JITMemoryPool::getAllocatedSize(MemoryKind K) const {
+  MutexGuard Locked(Lock);
+  return Lists[K].AllocatedSize;
+}
+
+//===----------------------------------------------------------------------===//
+// PooledMemoryManager
+//===----------------------------------------------------------------------===//
+
+// The smallest block a memory manager takes from the pool, which saves going
+// to the pool for every section of an object.  The pages it does not use are
+// given back when the memory is finalized.
+static const size_t MinBlockSize = 64 * 1024;
+
+uint8_t *PooledMemoryManager::allocateCodeSection(uintptr_t Size,
+                                                  unsigned Alignment,
+                                                  unsigned SectionID,
+                                                  StringRef SectionName) {
+  return allocateSection(CodeMem, JITMemoryPool::Code, Size, Alignment);
+}
+
+uint8_t *PooledMemoryManager::allocateDataSection(uintptr_t Size,
+                                                  unsigned Alignment,
+                                                  unsigned SectionID,
+                                                  StringRef SectionName,
+                                                  bool IsReadOnly) {
+  if (IsReadOnly)
+    return allocateSection(RODataMem, JITMemoryPool::Data, Size, Alignment);
+  return allocateSection(RWDataMem, JITMemoryPool::Data, Size, Alignment);
+}
+
+uint8_t *PooledMemoryManager::allocateSection(MemoryGroup &MemGroup,
+                                              JITMemoryPool::MemoryKind K,
+                                              uintptr_t Size,
+                                              unsigned Alignment) {
+  if (!Alignment)
+    Alignment = 16;
+
+  assert(!(Alignment & (Alignment - 1)) && "Alignment must be a power of two.");
+
+  uintptr_t Addr = RoundUpToAlignment(MemGroup.Cur, Alignment);
+  if (!MemGroup.Cur || Addr + Size > MemGroup.End) {
+    sys::MemoryBlock MB =
+        Pool.allocate(K, std::max<size_t>(Size + Alignment, MinBlockSize));
+    if (!MB.base()) {
+      // FIXME: Add error propagation to the interface.
+      return nullptr;
+    }
+    MemGroup.Blocks.push_back(MB);
+    MemGroup.Cur = reinterpret_cast<uintptr_t>(MB.base());
+    MemGroup.End = MemGroup.Cur + MB.size();
+    Addr = RoundUpToAlignment(MemGroup.Cur, Alignment);
+  }
+
+  MemGroup.Cur = Addr + Size;
+  return reinterpret_cast<uint8_t *>(Addr);
+}
+
+std::error_code
+PooledMemoryManager::finalizeGroup(MemoryGroup &MemGroup,
+                                   JITMemoryPool::MemoryKind K,
+                                   unsigned Permissions) {
+  if (MemGroup.Unfinalized == MemGroup.Blocks.size())
+    return std::error_code();
+
+  // Sections can no longer be added to the blocks once they are protected,
+  // so give the pages left at the end of the last block back to the pool.
+  static const size_t PageSize = sys::Process::getPageSize();
+  uintptr_t Used = RoundUpToAlignment(MemGroup.Cur, PageSize);
+  if (Used < MemGroup.End) {
+    sys::MemoryBlock &Last = MemGroup.Blocks.back();
+    Pool.release(K, sys::MemoryBlock(reinterpret_cast<void *>(Used),
+                                     MemGroup.End - Used));
+    Last = sys::MemoryBlock(Last.base(),
+                            Used - reinterpret_cast<uintptr_t>(Last.base()));
+  }
+  MemGroup.Cur = MemGroup.End = 0;
+
+  // Protecting the blocks would split the mappings of their slabs.
+  if (Pool.hasFixedPermissions()) {
+    MemGroup.Unfinalized = MemGroup.Blocks.size();
+    return std::error_code();
+  }
+
+  for (unsigned i = MemGroup.Unfinalized, e = MemGroup.Blocks.size(); i != e;
+       ++i)
+    if (std::error_code EC = sys::Memory::protectMappedMemory(
+            MemGroup.Blocks[i], Permissions))
+      return EC;
+  MemGroup.Unfinalized = MemGroup.Blocks.size();
+  return std::error_code();
+}
+
+bool PooledMemoryManager::finalizeMemory(std::string *ErrMsg) {
+  // Read-write data memory already has the correct permissions, and more
+  // sections can be added to its last block.
+  std::error_code EC = finalizeGroup(CodeMem, JITMemoryPool::Code,
+                                     sys::Memory::MF_READ |
+                                         sys::Memory::MF_EXEC);
+  if (!EC)
+    EC = finalizeGroup(RODataMem, JITMemoryPool::Data, sys::Memory::MF_READ);
+  if (EC) {
+    if (ErrMsg)
+      *ErrMsg = EC.message();
+    return true;
+  }
+
+  invalidateInstructionCache();
+  return false;
+}
+
+void PooledMemoryManager::invalidateInstructionCache() {
+  for (const sys::MemoryBlock &MB : CodeMem.Blocks)
+    sys::Memory::InvalidateInstructionCache(MB.base(), MB.size());
+}
+
+void PooledMemoryManager::releaseGroup(MemoryGroup &MemGroup,
+                                       JITMemoryPool::MemoryKind K) {
+  for (const sys::MemoryBlock &MB : MemGroup.Blocks)
+    Pool.release(K, MB);
+  MemGroup.Blocks.clear();
+}
+
+PooledMemoryManager::~PooledMemoryManager() {
+  releaseGroup(CodeMem, JITMemoryPool::Code);
+  releaseGroup(RWDataMem, JITMemoryPool::Data);
+  releaseGroup(RODataMem, JITMemoryPool::Data);
+}
@@ -125,6 +125,7 @@ static std::error_code getOffset(const SymbolRef &Sym, SectionRef Sec,
 std::pair<unsigned, unsigned>
 RuntimeDyldImpl::loadObjectImpl(const object::ObjectFile &Obj) {
   MutexGuard locked(lock);
+  sys::ScopedWriter SymbolsLocked(SymbolTableLock);
 
   // Grab the first Section ID. We'll use this later to construct the underlying
   // range for the returned LoadedObjectInfo.
@@ -742,6 +743,7 @@ void RuntimeDyldImpl::reassignSectionAddress(unsigned SectionID,
   // Addr is a uint64_t because we can't assume the pointer width
   // of the target is the same as that of the host. Just use a generic
   // "big enough" type.
+  sys::ScopedWriter SymbolsLocked(SymbolTableLock);
   DEBUG(dbgs() << "Reassigning address for section "
                << SectionID << " (" << Sections[SectionID].Name << "): "
                << format("0x%016" PRIx64, Sections[SectionID].LoadAddress) << " -> "
@@ -880,6 +882,15 @@ createRuntimeDyldMachO(Triple::ArchType Arch, RuntimeDyld::MemoryManager &MM,
 
 std::unique_ptr<RuntimeDyld::LoadedObjectInfo>
 RuntimeDyld::loadObject(const ObjectFile &Obj) {
+  RuntimeDyldImpl *Impl = getOrCreateImpl(Obj);
+  if (!Impl->isCompatibleFile(Obj))
+    report_fatal_error("Incompatible object format!");
+
+  return Impl->loadObject(Obj);
+}
+
+RuntimeDyldImpl *RuntimeDyld::getOrCreateImpl(const ObjectFile &Obj) {
+  MutexGuard Locked(DyldLock);
   if (!Dyld) {
     if (Obj.isELF())
       Dyld = createRuntimeDyldELF(MemMgr, Resolver, ProcessAllSections, Checker);
@@ -894,23 +905,26 @@ RuntimeDyld::loadObject(const ObjectFile &Obj) {
     else
       report_fatal_error("Incompatible object format!");
   }
+  return Dyld.get();
+}
 
-  if (!Dyld->isCompatibleFile(Obj))
-    report_fatal_error("Incompatible object format!");
-
-  return Dyld->loadObject(Obj);
+RuntimeDyldImpl *RuntimeDyld::getImpl() const {
+  MutexGuard Locked(DyldLock);
+  return Dyld.get();
 }
 
 void *RuntimeDyld::getSymbolLocalAddress(StringRef Name) const {
-  if (!Dyld)
+  RuntimeDyldImpl *Impl = getImpl();
+  if (!Impl)
     return nullptr;
-  return Dyld->getSymbolLocalAddress(Name);
+  return Impl->getSymbolLocalAddress(Name);
 }
 
 RuntimeDyld::SymbolInfo RuntimeDyld::getSymbol(StringRef Name) const {
-  if (!Dyld)
+  RuntimeDyldImpl *Impl = getImpl();
+  if (!Impl)
     return nullptr;
-  return Dyld->getSymbol(Name);
+  return Impl->getSymbol(Name);
 }
 
 void RuntimeDyld::resolveRelocations() { Dyld->resolveRelocations(); }
@@ -27,6 +27,7 @@
 #include "llvm/Support/Format.h"
 #include "llvm/Support/Host.h"
 #include "llvm/Support/Mutex.h"
+#include "llvm/Support/RWMutex.h"
 #include "llvm/Support/SwapByteOrder.h"
 #include "llvm/Support/raw_ostream.h"
 #include <map>
@@ -255,6 +256,12 @@ protected:
   // the end of the list while the list is being processed.
   sys::Mutex lock;
 
+  // Symbol lookups don't take the lock above, as the symbol resolvers of
+  // objects that are being linked on other threads may call them.  Instead,
+  // this guards the symbol and section tables against objects being loaded or
+  // sections being moved at the same time.
+  mutable sys::RWMutex SymbolTableLock;
+
   virtual unsigned getMaxStubSize() = 0;
   virtual unsigned getStubAlignment() = 0;
 
@@ -403,6 +410,7 @@ public:
   uint8_t* getSymbolLocalAddress(StringRef Name) const {
     // FIXME: Just look up as a function for now. Overly simple of course.
     // Work in progress.
+    sys::ScopedReader Locked(SymbolTableLock);
     RTDyldSymbolTable::const_iterator pos = GlobalSymbolTable.find(Name);
     if (pos == GlobalSymbolTable.end())
       return nullptr;
@@ -413,6 +421,7 @@ public:
   RuntimeDyld::SymbolInfo getSymbol(StringRef Name) const {
     // FIXME: Just look up as a function for now. Overly simple of course.
     // Work in progress.
+    sys::ScopedReader Locked(SymbolTableLock);
     RTDyldSymbolTable::const_iterator pos = GlobalSymbolTable.find(Name);
     if (pos == GlobalSymbolTable.end())
       return nullptr;
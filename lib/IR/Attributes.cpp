@@ -34,6 +34,7 @@ using namespace llvm;
 Attribute Attribute::get(LLVMContext &Context, Attribute::AttrKind Kind,
                          uint64_t Val) {
   LLVMContextImpl *pImpl = Context.pImpl;
+  ContextGuard Guard(pImpl, LLVMContextImpl::AttributeLock);
   FoldingSetNodeID ID;
   ID.AddInteger(Kind);
   if (Val) ID.AddInteger(Val);
@@ -57,6 +58,7 @@ Attribute Attribute::get(LLVMContext &Context, Attribute::AttrKind Kind,
 
 Attribute Attribute::get(LLVMContext &Context, StringRef Kind, StringRef Val) {
   LLVMContextImpl *pImpl = Context.pImpl;
+  ContextGuard Guard(pImpl, LLVMContextImpl::AttributeLock);
   FoldingSetNodeID ID;
   ID.AddString(Kind);
   if (!Val.empty()) ID.AddString(Val);
@@ -467,6 +469,7 @@ AttributeSetNode *AttributeSetNode::get(LLVMContext &C,
 
   // Otherwise, build a key to look up the existing attributes.
   LLVMContextImpl *pImpl = C.pImpl;
+  ContextGuard Guard(pImpl, LLVMContextImpl::AttributeLock);
   FoldingSetNodeID ID;
 
   SmallVector<Attribute, 8> SortedAttrs(Attrs.begin(), Attrs.end());
@@ -607,6 +610,7 @@ AttributeSet
 AttributeSet::getImpl(LLVMContext &C,
                       ArrayRef<std::pair<unsigned, AttributeSetNode*> > Attrs) {
   LLVMContextImpl *pImpl = C.pImpl;
+  ContextGuard Guard(pImpl, LLVMContextImpl::AttributeLock);
   FoldingSetNodeID ID;
   AttributeSetImpl::Profile(ID, Attrs);
 
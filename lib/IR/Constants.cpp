@@ -277,6 +277,9 @@ Constant *Constant::getAggregateElement(Constant *Elt) const {
 }
 
 void Constant::destroyConstant() {
+  ContextGuard Guard(getContext(), LLVMContextImpl::ConstantLock);
+  getContext().pImpl->DeferredDeadConstantUsers.erase(this);
+
   /// First call destroyConstantImpl on the subclass.  This gives the subclass
   /// a chance to remove the constant from any maps/pools it's contained in.
   switch (getValueID()) {
@@ -485,6 +488,20 @@ static bool removeDeadUsersOfConstant(const Constant *C) {
 /// that want to check to see if a global is unused, but don't want to deal
 /// with potentially dead constants hanging off of the globals.
 void Constant::removeDeadConstantUsers() const {
+  // While the context is multithreaded, another thread may have just looked
+  // up one of the dead users and be about to use it, so only note the
+  // constant users here.  LLVMContext::setMultithreaded(false) removes the
+  // dead ones once no other thread can refer to them.
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  if (pImpl->Multithreaded) {
+    ContextGuard Guard(pImpl, LLVMContextImpl::ConstantLock);
+    UseListGuard UseGuard(this);
+    for (const User *U : users())
+      if (isa<Constant>(U) && !isa<GlobalValue>(U))
+        pImpl->DeferredDeadConstantUsers.insert(cast<Constant>(U));
+    return;
+  }
+
   Value::const_user_iterator I = user_begin(), E = user_end();
   Value::const_user_iterator LastNonDeadUser = E;
   while (I != E) {
@@ -529,6 +546,7 @@ ConstantInt::ConstantInt(IntegerType *Ty, const APInt& V)
 
 ConstantInt *ConstantInt::getTrue(LLVMContext &Context) {
   LLVMContextImpl *pImpl = Context.pImpl;
+  ContextGuard Guard(pImpl, LLVMContextImpl::ConstantLock);
   if (!pImpl->TheTrueVal)
     pImpl->TheTrueVal = ConstantInt::get(Type::getInt1Ty(Context), 1);
   return pImpl->TheTrueVal;
@@ -536,6 +554,7 @@ ConstantInt *ConstantInt::getTrue(LLVMContext &Context) {
 
 ConstantInt *ConstantInt::getFalse(LLVMContext &Context) {
   LLVMContextImpl *pImpl = Context.pImpl;
+  ContextGuard Guard(pImpl, LLVMContextImpl::ConstantLock);
   if (!pImpl->TheFalseVal)
     pImpl->TheFalseVal = ConstantInt::get(Type::getInt1Ty(Context), 0);
   return pImpl->TheFalseVal;
@@ -569,6 +588,7 @@ Constant *ConstantInt::getFalse(Type *Ty) {
 ConstantInt *ConstantInt::get(LLVMContext &Context, const APInt &V) {
   // get an existing value or the insertion position
   LLVMContextImpl *pImpl = Context.pImpl;
+  ContextGuard Guard(pImpl, LLVMContextImpl::ConstantLock);
   ConstantInt *&Slot = pImpl->IntConstants[V];
   if (!Slot) {
     // Get the corresponding integer type for the bit width of the value.
@@ -713,6 +733,7 @@ Constant *ConstantFP::getZeroValueForNegation(Type *Ty) {
 // ConstantFP accessors.
 ConstantFP* ConstantFP::get(LLVMContext &Context, const APFloat& V) {
   LLVMContextImpl* pImpl = Context.pImpl;
+  ContextGuard Guard(pImpl, LLVMContextImpl::ConstantLock);
 
   ConstantFP *&Slot = pImpl->FPConstants[V];
 
@@ -873,6 +894,7 @@ ConstantArray::ConstantArray(ArrayType *T, ArrayRef<Constant *> V)
 Constant *ConstantArray::get(ArrayType *Ty, ArrayRef<Constant*> V) {
   if (Constant *C = getImpl(Ty, V))
     return C;
+  ContextGuard Guard(Ty->getContext(), LLVMContextImpl::ConstantLock);
   return Ty->getContext().pImpl->ArrayConstants.getOrCreate(Ty, V);
 }
 Constant *ConstantArray::getImpl(ArrayType *Ty, ArrayRef<Constant*> V) {
@@ -1030,6 +1052,7 @@ Constant *ConstantStruct::get(StructType *ST, ArrayRef<Constant*> V) {
   if (isUndef)
     return UndefValue::get(ST);
 
+  ContextGuard Guard(ST->getContext(), LLVMContextImpl::ConstantLock);
   return ST->getContext().pImpl->StructConstants.getOrCreate(ST, V);
 }
 
@@ -1058,6 +1081,7 @@ Constant *ConstantVector::get(ArrayRef<Constant*> V) {
   if (Constant *C = getImpl(V))
     return C;
   VectorType *Ty = VectorType::get(V.front()->getType(), V.size());
+  ContextGuard Guard(Ty->getContext(), LLVMContextImpl::ConstantLock);
   return Ty->getContext().pImpl->VectorConstants.getOrCreate(Ty, V);
 }
 Constant *ConstantVector::getImpl(ArrayRef<Constant*> V) {
@@ -1378,6 +1402,7 @@ ConstantAggregateZero *ConstantAggregateZero::get(Type *Ty) {
   assert((Ty->isStructTy() || Ty->isArrayTy() || Ty->isVectorTy()) &&
          "Cannot create an aggregate zero of non-aggregate type!");
   
+  ContextGuard Guard(Ty->getContext(), LLVMContextImpl::ConstantLock);
   ConstantAggregateZero *&Entry = Ty->getContext().pImpl->CAZConstants[Ty];
   if (!Entry)
     Entry = new ConstantAggregateZero(Ty);
@@ -1453,6 +1478,7 @@ const APInt &Constant::getUniqueInteger() const {
 //
 
 ConstantPointerNull *ConstantPointerNull::get(PointerType *Ty) {
+  ContextGuard Guard(Ty->getContext(), LLVMContextImpl::ConstantLock);
   ConstantPointerNull *&Entry = Ty->getContext().pImpl->CPNConstants[Ty];
   if (!Entry)
     Entry = new ConstantPointerNull(Ty);
@@ -1471,6 +1497,7 @@ void ConstantPointerNull::destroyConstantImpl() {
 //
 
 UndefValue *UndefValue::get(Type *Ty) {
+  ContextGuard Guard(Ty->getContext(), LLVMContextImpl::ConstantLock);
   UndefValue *&Entry = Ty->getContext().pImpl->UVConstants[Ty];
   if (!Entry)
     Entry = new UndefValue(Ty);
@@ -1494,6 +1521,7 @@ BlockAddress *BlockAddress::get(BasicBlock *BB) {
 }
 
 BlockAddress *BlockAddress::get(Function *F, BasicBlock *BB) {
+  ContextGuard Guard(F->getContext(), LLVMContextImpl::ConstantLock);
   BlockAddress *&BA =
     F->getContext().pImpl->BlockAddresses[std::make_pair(F, BB)];
   if (!BA)
@@ -1517,6 +1545,7 @@ BlockAddress *BlockAddress::lookup(const BasicBlock *BB) {
 
   const Function *F = BB->getParent();
   assert(F && "Block must have a parent");
+  ContextGuard Guard(F->getContext(), LLVMContextImpl::ConstantLock);
   BlockAddress *BA =
       F->getContext().pImpl->BlockAddresses.lookup(std::make_pair(F, BB));
   assert(BA && "Refcount and block address map disagree!");
@@ -1581,6 +1610,7 @@ static Constant *getFoldedCast(Instruction::CastOps opc, Constant *C, Type *Ty,
     return nullptr;
 
   LLVMContextImpl *pImpl = Ty->getContext().pImpl;
+  ContextGuard Guard(pImpl, LLVMContextImpl::ConstantLock);
 
   // Look up the constant in the table first to ensure uniqueness.
   ConstantExprKeyType Key(opc, C);
@@ -1942,6 +1972,7 @@ Constant *ConstantExpr::get(unsigned Opcode, Constant *C1, Constant *C2,
   ConstantExprKeyType Key(Opcode, ArgVec, 0, Flags);
 
   LLVMContextImpl *pImpl = C1->getContext().pImpl;
+  ContextGuard Guard(pImpl, LLVMContextImpl::ConstantLock);
   return pImpl->ExprConstants.getOrCreate(C1->getType(), Key);
 }
 
@@ -2023,6 +2054,7 @@ Constant *ConstantExpr::getSelect(Constant *C, Constant *V1, Constant *V2,
   ConstantExprKeyType Key(Instruction::Select, ArgVec);
 
   LLVMContextImpl *pImpl = C->getContext().pImpl;
+  ContextGuard Guard(pImpl, LLVMContextImpl::ConstantLock);
   return pImpl->ExprConstants.getOrCreate(V1->getType(), Key);
 }
 
@@ -2068,6 +2100,7 @@ Constant *ConstantExpr::getGetElementPtr(Type *Ty, Constant *C,
                                 Ty);
 
   LLVMContextImpl *pImpl = C->getContext().pImpl;
+  ContextGuard Guard(pImpl, LLVMContextImpl::ConstantLock);
   return pImpl->ExprConstants.getOrCreate(ReqTy, Key);
 }
 
@@ -2093,6 +2126,7 @@ Constant *ConstantExpr::getICmp(unsigned short pred, Constant *LHS,
     ResultTy = VectorType::get(ResultTy, VT->getNumElements());
 
   LLVMContextImpl *pImpl = LHS->getType()->getContext().pImpl;
+  ContextGuard Guard(pImpl, LLVMContextImpl::ConstantLock);
   return pImpl->ExprConstants.getOrCreate(ResultTy, Key);
 }
 
@@ -2117,6 +2151,7 @@ Constant *ConstantExpr::getFCmp(unsigned short pred, Constant *LHS,
     ResultTy = VectorType::get(ResultTy, VT->getNumElements());
 
   LLVMContextImpl *pImpl = LHS->getType()->getContext().pImpl;
+  ContextGuard Guard(pImpl, LLVMContextImpl::ConstantLock);
   return pImpl->ExprConstants.getOrCreate(ResultTy, Key);
 }
 
@@ -2139,6 +2174,7 @@ Constant *ConstantExpr::getExtractElement(Constant *Val, Constant *Idx,
   const ConstantExprKeyType Key(Instruction::ExtractElement, ArgVec);
 
   LLVMContextImpl *pImpl = Val->getContext().pImpl;
+  ContextGuard Guard(pImpl, LLVMContextImpl::ConstantLock);
   return pImpl->ExprConstants.getOrCreate(ReqTy, Key);
 }
 
@@ -2162,6 +2198,7 @@ Constant *ConstantExpr::getInsertElement(Constant *Val, Constant *Elt,
   const ConstantExprKeyType Key(Instruction::InsertElement, ArgVec);
 
   LLVMContextImpl *pImpl = Val->getContext().pImpl;
+  ContextGuard Guard(pImpl, LLVMContextImpl::ConstantLock);
   return pImpl->ExprConstants.getOrCreate(Val->getType(), Key);
 }
 
@@ -2185,6 +2222,7 @@ Constant *ConstantExpr::getShuffleVector(Constant *V1, Constant *V2,
   const ConstantExprKeyType Key(Instruction::ShuffleVector, ArgVec);
 
   LLVMContextImpl *pImpl = ShufTy->getContext().pImpl;
+  ContextGuard Guard(pImpl, LLVMContextImpl::ConstantLock);
   return pImpl->ExprConstants.getOrCreate(ShufTy, Key);
 }
 
@@ -2209,6 +2247,7 @@ Constant *ConstantExpr::getInsertValue(Constant *Agg, Constant *Val,
   const ConstantExprKeyType Key(Instruction::InsertValue, ArgVec, 0, 0, Idxs);
 
   LLVMContextImpl *pImpl = Agg->getContext().pImpl;
+  ContextGuard Guard(pImpl, LLVMContextImpl::ConstantLock);
   return pImpl->ExprConstants.getOrCreate(ReqTy, Key);
 }
 
@@ -2233,6 +2272,7 @@ Constant *ConstantExpr::getExtractValue(Constant *Agg, ArrayRef<unsigned> Idxs,
   const ConstantExprKeyType Key(Instruction::ExtractValue, ArgVec, 0, 0, Idxs);
 
   LLVMContextImpl *pImpl = Agg->getContext().pImpl;
+  ContextGuard Guard(pImpl, LLVMContextImpl::ConstantLock);
   return pImpl->ExprConstants.getOrCreate(ReqTy, Key);
 }
 
@@ -2485,6 +2525,7 @@ Constant *ConstantDataSequential::getImpl(StringRef Elements, Type *Ty) {
     return ConstantAggregateZero::get(Ty);
 
   // Do a lookup to see if we have already formed one of these.
+  ContextGuard Guard(Ty->getContext(), LLVMContextImpl::ConstantLock);
   auto &Slot =
       *Ty->getContext()
            .pImpl->CDSConstants.insert(std::make_pair(Elements, nullptr))
@@ -2838,6 +2879,7 @@ Constant *ConstantDataVector::getSplatValue() const {
 /// array instance.
 ///
 void Constant::handleOperandChange(Value *From, Value *To, Use *U) {
+  ContextGuard Guard(getContext(), LLVMContextImpl::ConstantLock);
   Value *Replacement = nullptr;
   switch (getValueID()) {
   default:
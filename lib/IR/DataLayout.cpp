@@ -17,6 +17,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/IR/DataLayout.h"
+#include "LLVMContextImpl.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/Triple.h"
@@ -549,6 +550,8 @@ DataLayout::~DataLayout() {
 }
 
 const StructLayout *DataLayout::getStructLayout(StructType *Ty) const {
+  // The layout of a module is shared by all of its functions.
+  ContextGuard Guard(Ty->getContext(), LLVMContextImpl::LayoutLock);
   if (!LayoutMap)
     LayoutMap = new StructLayoutMap();
 
@@ -46,6 +46,7 @@ DILocation *DILocation::getImpl(LLVMContext &Context, unsigned Line,
   adjustColumn(Column);
 
   assert(Scope && "Expected scope");
+  ContextGuard Guard(Context, LLVMContextImpl::MetadataLock);
   if (Storage == Uniqued) {
     if (auto *N =
             getUniqued(Context.pImpl->DILocations,
@@ -80,6 +81,7 @@ unsigned DILocation::computeNewDiscriminator() const {
   // AddDiscriminators::runOnFunction(), where it doesn't pollute the
   // LLVMContext.
   std::pair<const char *, unsigned> Key(getFilename().data(), getLine());
+  ContextGuard Guard(getContext(), LLVMContextImpl::MetadataLock);
   return ++getContext().pImpl->DiscriminatorTable[Key];
 }
 
@@ -177,6 +179,7 @@ GenericDINode *GenericDINode::getImpl(LLVMContext &Context, unsigned Tag,
                                       MDString *Header,
                                       ArrayRef<Metadata *> DwarfOps,
                                       StorageType Storage, bool ShouldCreate) {
+  ContextGuard Guard(Context, LLVMContextImpl::MetadataLock);
   unsigned Hash = 0;
   if (Storage == Uniqued) {
     GenericDINodeInfo::KeyTy Key(Tag, getString(Header), DwarfOps);
@@ -204,6 +207,7 @@ void GenericDINode::recalculateHash() {
 #define UNWRAP_ARGS_IMPL(...) __VA_ARGS__
 #define UNWRAP_ARGS(ARGS) UNWRAP_ARGS_IMPL ARGS
 #define DEFINE_GETIMPL_LOOKUP(CLASS, ARGS)                                     \
+  ContextGuard Guard(Context, LLVMContextImpl::MetadataLock);                  \
   do {                                                                         \
     if (Storage == Uniqued) {                                                  \
       if (auto *N = getUniqued(Context.pImpl->CLASS##s,                        \
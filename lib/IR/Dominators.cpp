@@ -25,6 +25,7 @@
 #include "llvm/Support/Compiler.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/GenericDomTreeConstruction.h"
+#include "llvm/Support/GenericDomTreeUpdate.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 using namespace llvm;
@@ -39,6 +40,11 @@ static cl::opt<bool,true>
 VerifyDomInfoX("verify-dom-info", cl::location(VerifyDomInfo),
                cl::desc("Verify dominator info (time consuming)"));
 
+static cl::opt<bool> VerifyDomUpdates(
+    "verify-dom-updates", cl::Hidden,
+    cl::desc("Verify the dominator tree after each incremental update "
+             "(time consuming)"));
+
 bool BasicBlockEdge::isSingleEdge() const {
   const TerminatorInst *TI = Start->getTerminator();
   unsigned NumEdgesToEnd = 0;
@@ -277,12 +283,36 @@ bool DominatorTree::isReachableFromEntry(const Use &U) const {
   return isReachableFromEntry(I->getParent());
 }
 
+void DominatorTree::applyUpdates(ArrayRef<UpdateType> Updates) {
+  Base::applyUpdates(Updates);
+  if (VerifyDomUpdates)
+    verifyDomTree();
+}
+
+void DominatorTree::insertEdge(BasicBlock *From, BasicBlock *To) {
+  UpdateType Update = {Insert, From, To};
+  applyUpdates(Update);
+}
+
+void DominatorTree::deleteEdge(BasicBlock *From, BasicBlock *To) {
+  UpdateType Update = {Delete, From, To};
+  applyUpdates(Update);
+}
+
 void DominatorTree::verifyDomTree() const {
   Function &F = *getRoot()->getParent();
 
+  // The levels of the nodes are maintained as the tree is updated.
+  bool LevelsValid = true;
+  for (const auto &Node : DomTreeNodes) {
+    const DomTreeNode *N = Node.second.get();
+    if (N && N->getLevel() != (N->getIDom() ? N->getIDom()->getLevel() + 1 : 0))
+      LevelsValid = false;
+  }
+
   DominatorTree OtherDT;
   OtherDT.recalculate(F);
-  if (compare(OtherDT)) {
+  if (!LevelsValid || compare(OtherDT)) {
     errs() << "DominatorTree is not up to date!\nComputed:\n";
     print(errs());
     errs() << "\nActual:\n";
@@ -31,6 +31,7 @@ InlineAsm *InlineAsm::get(FunctionType *Ty, StringRef AsmString,
   InlineAsmKeyType Key(AsmString, Constraints, hasSideEffects, isAlignStack,
                        asmDialect);
   LLVMContextImpl *pImpl = Ty->getContext().pImpl;
+  ContextGuard Guard(pImpl, LLVMContextImpl::ConstantLock);
   return pImpl->InlineAsms.getOrCreate(PointerType::getUnqual(Ty), Key);
 }
 
@@ -48,6 +49,7 @@ InlineAsm::InlineAsm(PointerType *Ty, const std::string &asmString,
 }
 
 void InlineAsm::destroyConstant() {
+  ContextGuard Guard(getContext(), LLVMContextImpl::ConstantLock);
   getType()->getContext().pImpl->InlineAsms.remove(this);
   delete this;
 }
@@ -22,6 +22,7 @@
 #include "llvm/IR/Metadata.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/ThreadLocal.h"
 #include <cctype>
 using namespace llvm;
 
@@ -166,6 +167,38 @@ void LLVMContext::yield() {
     pImpl->YieldCallback(this, pImpl->YieldOpaqueHandle);
 }
 
+size_t LLVMContext::getIRArenaSize() const {
+  ContextGuard Guard(pImpl, LLVMContextImpl::ArenaLock);
+  return pImpl->IRArena.getTotalMemory();
+}
+
+void LLVMContext::setMultithreaded(bool Multithreaded) {
+  pImpl->setMultithreaded(Multithreaded);
+}
+
+bool LLVMContext::isMultithreaded() const { return pImpl->Multithreaded; }
+
+//===----------------------------------------------------------------------===//
+// IRArenaScope Implementation
+//===----------------------------------------------------------------------===//
+
+static ManagedStatic<sys::ThreadLocal<LLVMContextImpl>> ActiveIRArena;
+
+LLVMContextImpl *LLVMContextImpl::getActiveIRArena() {
+  return ActiveIRArena->get();
+}
+
+IRArenaScope::IRArenaScope(LLVMContext &C) : Prev(ActiveIRArena->get()) {
+  ActiveIRArena->set(C.pImpl);
+}
+
+IRArenaScope::~IRArenaScope() {
+  if (Prev)
+    ActiveIRArena->set(Prev);
+  else
+    ActiveIRArena->erase();
+}
+
 void LLVMContext::emitError(const Twine &ErrorStr) {
   diagnose(DiagnosticInfoInlineAsm(ErrorStr));
 }
@@ -243,6 +276,7 @@ void LLVMContext::emitError(unsigned LocCookie, const Twine &ErrorStr) {
 
 /// Return a unique non-zero ID for the specified metadata kind.
 unsigned LLVMContext::getMDKindID(StringRef Name) const {
+  ContextGuard Guard(pImpl, LLVMContextImpl::MetadataLock);
   // If this is new, assign it its ID.
   return pImpl->CustomMDKindNames.insert(
                                      std::make_pair(
@@ -253,6 +287,7 @@ unsigned LLVMContext::getMDKindID(StringRef Name) const {
 /// getHandlerNames - Populate client supplied smallvector using custome
 /// metadata name and ID.
 void LLVMContext::getMDKindNames(SmallVectorImpl<StringRef> &Names) const {
+  ContextGuard Guard(pImpl, LLVMContextImpl::MetadataLock);
   Names.resize(pImpl->CustomMDKindNames.size());
   for (StringMap<unsigned>::const_iterator I = pImpl->CustomMDKindNames.begin(),
        E = pImpl->CustomMDKindNames.end(); I != E; ++I)
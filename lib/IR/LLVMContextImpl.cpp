@@ -45,6 +45,7 @@ LLVMContextImpl::LLVMContextImpl(LLVMContext &C)
   YieldCallback = nullptr;
   YieldOpaqueHandle = nullptr;
   NamedStructTypesUniqueID = 0;
+  Multithreaded = false;
 }
 
 namespace {
@@ -68,6 +69,9 @@ struct DropFirst {
 }
 
 LLVMContextImpl::~LLVMContextImpl() {
+  // The context is only destroyed once no other thread uses it.
+  setMultithreaded(false);
+
   // NOTE: We need to delete the contents of OwnedModules, but Module's dtor
   // will call LLVMContextImpl::removeModule, thus invalidating iterators into
   // the container. Avoid iterators during this operation:
@@ -239,3 +243,45 @@ void GetElementPtrConstantExpr::anchor() { }
 
 void CompareConstantExpr::anchor() { }
 
+#ifndef NDEBUG
+/// How often the calling thread holds each of the context locks.
+static LLVM_THREAD_LOCAL unsigned HeldLocks[LLVMContextImpl::NumLockKinds];
+#endif
+
+void LLVMContextImpl::lock(LockKind Kind) {
+#ifndef NDEBUG
+  for (unsigned Later = Kind + 1; Later < NumLockKinds; ++Later)
+    assert(!HeldLocks[Later] && "Context locks taken out of order!");
+  ++HeldLocks[Kind];
+#endif
+  Locks[Kind].lock();
+}
+
+void LLVMContextImpl::unlock(LockKind Kind) {
+  Locks[Kind].unlock();
+#ifndef NDEBUG
+  --HeldLocks[Kind];
+#endif
+}
+
+void LLVMContextImpl::setMultithreaded(bool Enable) {
+  if (Multithreaded == Enable)
+    return;
+  Multithreaded = Enable;
+  if (Enable) {
+    ++Value::NumMultithreadedContexts;
+    return;
+  }
+  --Value::NumMultithreadedContexts;
+
+  // No other thread uses the context anymore, so the constant users that
+  // removeDeadConstantUsers left behind can be destroyed if they are dead.
+  // Destroying one removes it and its dead users from the set.
+  while (!DeferredDeadConstantUsers.empty()) {
+    Constant *C = const_cast<Constant *>(*DeferredDeadConstantUsers.begin());
+    DeferredDeadConstantUsers.erase(C);
+    C->removeDeadConstantUsers();
+    if (C->use_empty())
+      C->destroyConstant();
+  }
+}
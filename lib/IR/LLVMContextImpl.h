@@ -32,6 +32,7 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Metadata.h"
 #include "llvm/IR/ValueHandle.h"
+#include "llvm/Support/Mutex.h"
 #include <vector>
 
 namespace llvm {
@@ -923,6 +924,67 @@ public:
 
 class LLVMContextImpl {
 public:
+  /// IRArena - Users created inside an IRArenaScope for this context live
+  /// here.  It is declared first so that it is destroyed last, after every
+  /// User that may reside in it.
+  BumpPtrAllocator IRArena;
+
+  /// getActiveIRArena - Returns the context whose IRArena serves User
+  /// allocations on the calling thread, or null to use the heap.
+  static LLVMContextImpl *getActiveIRArena();
+
+  /// Multithreaded - Set while several threads may be working on the IR of
+  /// this context; see LLVMContext::setMultithreaded.
+  bool Multithreaded;
+
+  /// LockKind - The locks that serialize access to the state below that all
+  /// the functions of the context share, while the context is multithreaded.
+  /// Each one guards a group of tables, so that threads creating different
+  /// kinds of IR do not wait for each other.  Take them with a ContextGuard.
+  /// They are recursive, since creating a uniqued object often creates others
+  /// of its kind.  A thread that holds a lock may only take the ones that come
+  /// after it here, which keeps threads from deadlocking.
+  enum LockKind {
+    ModuleLock,      ///< Global lists and symbol tables of the modules.
+    AttributeLock,   ///< Attribute uniquing tables.
+    ConstantLock,    ///< Constant and inline asm uniquing tables.
+    MetadataLock,    ///< Metadata uniquing tables and attachments.
+    LayoutLock,      ///< Struct layouts cached by the modules' data layouts.
+    TypeLock,        ///< Type uniquing tables and TypeAllocator.
+    ValueHandleLock, ///< ValueHandles, and the handles of shared values.
+    ValueNameLock,   ///< ValueNames.
+    ArenaLock,       ///< IRArena.
+    NumLockKinds
+  };
+  sys::Mutex Locks[NumLockKinds];
+
+  /// UseListLocks - Serialize changes to the use lists of the values that all
+  /// functions can refer to, such as constants and globals, while the context
+  /// is multithreaded.  Values are spread over the locks by their address, so
+  /// threads rarely wait for each other.  Take them with a UseListGuard.  None
+  /// of Locks is taken while one of these is held, and no thread holds more
+  /// than one of these at a time.
+  enum { NumUseListLocks = 64 };
+  sys::Mutex UseListLocks[NumUseListLocks];
+
+  sys::Mutex &getUseListLock(const Value *V) {
+    return UseListLocks[(reinterpret_cast<uintptr_t>(V) >> 4) %
+                        NumUseListLocks];
+  }
+
+  /// DeferredDeadConstantUsers - Constant users of the values that
+  /// Constant::removeDeadConstantUsers was called on while the context was
+  /// multithreaded.  Another thread may still hold a pointer to one of them,
+  /// so they are only destroyed, if dead, once the context stops being
+  /// multithreaded.  Guarded by ConstantLock.
+  SmallPtrSet<const Constant *, 16> DeferredDeadConstantUsers;
+
+  /// lock/unlock - Take and release one of Locks.  Prefer a ContextGuard.
+  void lock(LockKind Kind);
+  void unlock(LockKind Kind);
+
+  void setMultithreaded(bool Enable);
+
   /// OwnedModules - The set of modules instantiated in this context, and which
   /// will be automatically deleted if this context is deleted.
   SmallPtrSet<Module*, 4> OwnedModules;
@@ -1054,6 +1116,42 @@ public:
   void dropTriviallyDeadConstantArrays();
 };
 
+/// \brief Holds one of the locks of a context while it is multithreaded, and
+/// does nothing otherwise.
+class ContextGuard {
+  LLVMContextImpl *Impl;
+  LLVMContextImpl::LockKind Kind;
+
+  ContextGuard(const ContextGuard &) = delete;
+  void operator=(const ContextGuard &) = delete;
+
+public:
+  ContextGuard(LLVMContextImpl *Impl, LLVMContextImpl::LockKind Kind)
+      : Impl(Impl->Multithreaded ? Impl : nullptr), Kind(Kind) {
+    if (this->Impl)
+      this->Impl->lock(Kind);
+  }
+  ContextGuard(LLVMContext &C, LLVMContextImpl::LockKind Kind)
+      : ContextGuard(C.pImpl, Kind) {}
+  ~ContextGuard() {
+    if (Impl)
+      Impl->unlock(Kind);
+  }
+};
+
+/// \brief Holds the use list lock of a value, if its use list is shared by
+/// the threads of a multithreaded context (see Value::lockUseList).
+class UseListGuard {
+  const Value *V;
+
+  UseListGuard(const UseListGuard &) = delete;
+  void operator=(const UseListGuard &) = delete;
+
+public:
+  explicit UseListGuard(const Value *V) : V(V) { V->lockUseList(); }
+  ~UseListGuard() { V->unlockUseList(); }
+};
+
 }
 
 #endif
@@ -21,12 +21,15 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/Mutex.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/TimeValue.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
+#include <atomic>
 #include <map>
 using namespace llvm;
 using namespace llvm::legacy;
@@ -115,6 +118,36 @@ bool PMDataManager::isPassDebuggingExecutionsOrMore() const {
   return PassDebugging >= Executions;
 }
 
+/// This is a utility to check whether passes may run on several functions at
+/// once, which would interleave the output of the options that print per
+/// pass.
+static bool canRunFunctionsInParallel() {
+  return PassDebugging < Executions && !PrintBeforeAll && !PrintAfterAll &&
+         PrintBefore.empty() && PrintAfter.empty();
+}
+
+/// The function passes that may run on several functions at once.  Functions
+/// share the constants and globals of their module, so a pass is only listed
+/// once it has been checked not to walk the use lists of shared values, not
+/// to look at instructions of other functions, and not to add globals or
+/// declarations to the module.  Each of them has a test in
+/// test/Other/opt-threads-*.ll, which catches races when LLVM is built with
+/// LLVM_USE_SANITIZER=Thread.
+static const char *const ThreadSafePasses[] = {
+  "domtree", "early-cse", "mem2reg", "sroa", "verify"
+};
+
+/// This is a utility to check whether the pass with the given ID is one of
+/// ThreadSafePasses.
+static bool isThreadSafePass(const PassInfo *PI) {
+  if (!PI)
+    return false;
+  for (const char *Name : ThreadSafePasses)
+    if (StringRef(PI->getPassArgument()) == Name)
+      return true;
+  return false;
+}
+
 
 
 
@@ -434,6 +467,18 @@ public:
     MPPassManager *MP = static_cast<MPPassManager *>(PassManagers[N]);
     return MP;
   }
+
+  /// Top level managers built from the same pipeline as this one, whose
+  /// function pass managers run on other threads.
+  SmallVector<PassManagerImpl *, 4> ThreadCopies;
+
+private:
+  /// Initialize the thread copies and hand their function pass managers to
+  /// the matching managers of this one.
+  bool prepareThreadCopies(Module &M);
+
+  /// Undo prepareThreadCopies.
+  bool finishThreadCopies(Module &M);
 };
 
 void PassManagerImpl::anchor() {}
@@ -486,9 +531,23 @@ public:
   }
 };
 
+/// PassTraceInfo - Records the passes that run for -time-passes-trace, and
+/// writes the trace on exit.
+class PassTraceInfo {
+public:
+  TimeTraceProfiler Profiler;
+
+  ~PassTraceInfo();
+
+  // createThePassTrace - Initialize ThePassTrace if -time-passes-trace is
+  // enabled. It may be called multiple times.
+  static void createThePassTrace();
+};
+
 } // End of anon namespace
 
 static TimingInfo *TheTimeInfo;
+static PassTraceInfo *ThePassTrace;
 
 //===----------------------------------------------------------------------===//
 // PMTopLevelManager implementation
@@ -1113,6 +1172,75 @@ Pass *PMDataManager::findAnalysisPass(AnalysisID AID, bool SearchParent) {
   return nullptr;
 }
 
+bool PMDataManager::isSelfContained() {
+  SmallPtrSet<AnalysisID, 32> Provided;
+  SmallVector<AnalysisID, 32> Required;
+
+  SmallVector<PMDataManager *, 4> Worklist(1, this);
+  while (!Worklist.empty()) {
+    PMDataManager *PM = Worklist.pop_back_val();
+    for (Pass *P : PM->PassVector) {
+      AnalysisUsage *AnUsage = TPM->findAnalysisUsage(P);
+      Required.append(AnUsage->getRequiredSet().begin(),
+                      AnUsage->getRequiredSet().end());
+      Required.append(AnUsage->getRequiredTransitiveSet().begin(),
+                      AnUsage->getRequiredTransitiveSet().end());
+
+      if (PMDataManager *Nested = P->getAsPMDataManager()) {
+        Worklist.push_back(Nested);
+        continue;
+      }
+
+      Provided.insert(P->getPassID());
+      if (const PassInfo *PI = TPM->findAnalysisPassInfo(P->getPassID()))
+        for (const PassInfo *Interface : PI->getInterfacesImplemented())
+          Provided.insert(Interface->getTypeInfo());
+    }
+  }
+
+  for (AnalysisID AID : Required) {
+    if (Provided.count(AID))
+      continue;
+    Pass *Impl = TPM->findAnalysisPass(AID);
+    if (!Impl || !Impl->getAsImmutablePass())
+      return false;
+  }
+  return true;
+}
+
+bool PMDataManager::hasOnlyThreadSafePasses() {
+  for (Pass *P : PassVector) {
+    if (PMDataManager *Nested = P->getAsPMDataManager()) {
+      if (!Nested->hasOnlyThreadSafePasses())
+        return false;
+      continue;
+    }
+    if (!isThreadSafePass(TPM->findAnalysisPassInfo(P->getPassID())))
+      return false;
+  }
+  return true;
+}
+
+bool PMDataManager::hasSamePasses(const PMDataManager &Other) const {
+  if (PassVector.size() != Other.PassVector.size())
+    return false;
+
+  for (unsigned Index = 0; Index < PassVector.size(); ++Index) {
+    Pass *P = PassVector[Index];
+    Pass *OtherP = Other.PassVector[Index];
+    if (P->getPassID() != OtherP->getPassID())
+      return false;
+
+    PMDataManager *Nested = P->getAsPMDataManager();
+    PMDataManager *OtherNested = OtherP->getAsPMDataManager();
+    if (!Nested != !OtherNested)
+      return false;
+    if (Nested && !Nested->hasSamePasses(*OtherNested))
+      return false;
+  }
+  return true;
+}
+
 // Print list of passes that are last used by P.
 void PMDataManager::dumpLastUses(Pass *P, unsigned Offset) const{
 
@@ -1301,6 +1429,7 @@ bool BBPassManager::runOnFunction(Function &F) {
         // If the pass crashes, remember this.
         PassManagerPrettyStackEntry X(BP, *I);
         TimeRegion PassTimer(getPassTimer(BP));
+        PassTraceRegion PassTrace(BP, F.getName());
 
         LocalChanged |= BP->runOnBasicBlock(*I);
       }
@@ -1463,6 +1592,7 @@ void FunctionPassManagerImpl::releaseMemoryOnTheFly() {
 bool FunctionPassManagerImpl::run(Function &F) {
   bool Changed = false;
   TimingInfo::createTheTimeInfo();
+  PassTraceInfo::createThePassTrace();
 
   initializeAllAnalysisInfo();
   for (unsigned Index = 0; Index < getNumContainedManagers(); ++Index) {
@@ -1483,7 +1613,10 @@ bool FunctionPassManagerImpl::run(Function &F) {
 char FPPassManager::ID = 0;
 /// Print passes managed by this manager
 void FPPassManager::dumpPassStructure(unsigned Offset) {
-  dbgs().indent(Offset*2) << "FunctionPass Manager\n";
+  dbgs().indent(Offset*2) << "FunctionPass Manager";
+  if (!ThreadCopies.empty())
+    dbgs() << " (" << ThreadCopies.size() + 1 << " threads)";
+  dbgs() << "\n";
   for (unsigned Index = 0; Index < getNumContainedPasses(); ++Index) {
     FunctionPass *FP = getContainedPass(Index);
     FP->dumpPassStructure(Offset + 1);
@@ -1516,6 +1649,7 @@ bool FPPassManager::runOnFunction(Function &F) {
     {
       PassManagerPrettyStackEntry X(FP, F);
       TimeRegion PassTimer(getPassTimer(FP));
+      PassTraceRegion PassTrace(FP, F.getName());
 
       LocalChanged |= FP->runOnFunction(F);
     }
@@ -1534,6 +1668,9 @@ bool FPPassManager::runOnFunction(Function &F) {
 }
 
 bool FPPassManager::runOnModule(Module &M) {
+  if (!ThreadCopies.empty())
+    return runOnFunctionsInParallel(M);
+
   bool Changed = false;
 
   for (Function &F : M)
@@ -1542,6 +1679,59 @@ bool FPPassManager::runOnModule(Module &M) {
   return Changed;
 }
 
+bool FPPassManager::runOnFunctionsInParallel(Module &M) {
+  bool Changed = false;
+
+  // The passes of this manager were initialized with the module passes.
+  for (FPPassManager *Copy : ThreadCopies)
+    Changed |= Copy->doInitialization(M);
+
+  SmallVector<FPPassManager *, 8> Managers(1, this);
+  Managers.append(ThreadCopies.begin(), ThreadCopies.end());
+
+  // Collect the functions up front, as the passes may add declarations to
+  // the module while they run.
+  std::vector<Function *> Functions;
+  for (Function &F : M)
+    if (!F.isDeclaration())
+      Functions.push_back(&F);
+
+  LLVMContext &Context = M.getContext();
+  bool WasMultithreaded = Context.isMultithreaded();
+  Context.setMultithreaded(true);
+  {
+    // Each manager takes the next function that no other manager has taken
+    // until none are left, so that the work balances itself.
+    std::atomic<size_t> NextFunction(0);
+    std::atomic<bool> AnyChanged(false);
+    ThreadPool Pool(Managers.size());
+    for (FPPassManager *FPPM : Managers)
+      Pool.async([&, FPPM] {
+        bool LocalChanged = false;
+        for (size_t Index = NextFunction++; Index < Functions.size();
+             Index = NextFunction++)
+          LocalChanged |= FPPM->runOnFunction(*Functions[Index]);
+        if (LocalChanged)
+          AnyChanged = true;
+      });
+    Pool.wait();
+    Changed |= AnyChanged;
+  }
+  Context.setMultithreaded(WasMultithreaded);
+
+  // The immutable passes of each manager only saw some of the functions
+  // change, so drop anything they cached about functions.
+  for (FPPassManager *FPPM : Managers)
+    for (ImmutablePass *ImPass :
+         FPPM->getTopLevelManager()->getImmutablePasses())
+      ImPass->releaseMemory();
+
+  for (FPPassManager *Copy : ThreadCopies)
+    Changed |= Copy->doFinalization(M);
+
+  return Changed;
+}
+
 bool FPPassManager::doInitialization(Module &M) {
   bool Changed = false;
 
@@ -1592,6 +1782,7 @@ MPPassManager::runOnModule(Module &M) {
     {
       PassManagerPrettyStackEntry X(MP, M);
       TimeRegion PassTimer(getPassTimer(MP));
+      PassTraceRegion PassTrace(MP, M.getModuleIdentifier());
 
       LocalChanged |= MP->runOnModule(M);
     }
@@ -1686,6 +1877,13 @@ Pass* MPPassManager::getOnTheFlyPass(Pass *MP, AnalysisID PI, Function &F){
 bool PassManagerImpl::run(Module &M) {
   bool Changed = false;
   TimingInfo::createTheTimeInfo();
+  PassTraceInfo::createThePassTrace();
+
+  // Pair up the function pass managers with their thread copies first, so
+  // that the structure shows which of them run on several threads.
+  bool Parallel = !ThreadCopies.empty() && canRunFunctionsInParallel();
+  if (Parallel)
+    Changed |= prepareThreadCopies(M);
 
   dumpArguments();
   dumpPasses();
@@ -1694,22 +1892,93 @@ bool PassManagerImpl::run(Module &M) {
     Changed |= ImPass->doInitialization(M);
 
   initializeAllAnalysisInfo();
+
   for (unsigned Index = 0; Index < getNumContainedManagers(); ++Index) {
     Changed |= getContainedManager(Index)->runOnModule(M);
     M.getContext().yield();
   }
 
+  if (Parallel)
+    Changed |= finishThreadCopies(M);
+
   for (ImmutablePass *ImPass : getImmutablePasses())
     Changed |= ImPass->doFinalization(M);
 
   return Changed;
 }
 
+/// Return P as a function pass manager, or null if it is not one.
+static FPPassManager *getAsFPPassManager(Pass *P) {
+  PMDataManager *PM = P->getAsPMDataManager();
+  if (!PM || PM->getPassManagerType() != PMT_FunctionPassManager)
+    return nullptr;
+  return static_cast<FPPassManager *>(PM);
+}
+
+bool PassManagerImpl::prepareThreadCopies(Module &M) {
+  bool Changed = false;
+
+  for (PassManagerImpl *Copy : ThreadCopies) {
+    for (ImmutablePass *ImPass : Copy->getImmutablePasses())
+      Changed |= ImPass->doInitialization(M);
+    Copy->initializeAllAnalysisInfo();
+  }
+
+  // Pair up each function pass manager that can run on its own with the
+  // managers at the same place in the copies.
+  for (unsigned Index = 0; Index < getNumContainedManagers(); ++Index) {
+    MPPassManager *MP = getContainedManager(Index);
+    for (unsigned PassIndex = 0; PassIndex < MP->getNumContainedPasses();
+         ++PassIndex) {
+      FPPassManager *FPPM = getAsFPPassManager(MP->getContainedPass(PassIndex));
+      if (!FPPM || !FPPM->isSelfContained() ||
+          !FPPM->hasOnlyThreadSafePasses())
+        continue;
+
+      SmallVector<FPPassManager *, 4> Copies;
+      for (PassManagerImpl *Copy : ThreadCopies) {
+        FPPassManager *CopyFPPM = nullptr;
+        if (Index < Copy->getNumContainedManagers()) {
+          MPPassManager *CopyMP = Copy->getContainedManager(Index);
+          if (PassIndex < CopyMP->getNumContainedPasses())
+            CopyFPPM = getAsFPPassManager(CopyMP->getContainedPass(PassIndex));
+        }
+        if (!CopyFPPM || !FPPM->hasSamePasses(*CopyFPPM))
+          break;
+        Copies.push_back(CopyFPPM);
+      }
+      if (Copies.size() == ThreadCopies.size())
+        FPPM->setThreadCopies(Copies);
+    }
+  }
+
+  return Changed;
+}
+
+bool PassManagerImpl::finishThreadCopies(Module &M) {
+  bool Changed = false;
+
+  for (unsigned Index = 0; Index < getNumContainedManagers(); ++Index) {
+    MPPassManager *MP = getContainedManager(Index);
+    for (unsigned PassIndex = 0; PassIndex < MP->getNumContainedPasses();
+         ++PassIndex)
+      if (FPPassManager *FPPM =
+              getAsFPPassManager(MP->getContainedPass(PassIndex)))
+        FPPM->setThreadCopies(None);
+  }
+
+  for (PassManagerImpl *Copy : ThreadCopies)
+    for (ImmutablePass *ImPass : Copy->getImmutablePasses())
+      Changed |= ImPass->doFinalization(M);
+
+  return Changed;
+}
+
 //===----------------------------------------------------------------------===//
 // PassManager implementation
 
 /// Create new pass manager
-PassManager::PassManager() {
+PassManager::PassManager() : Threads(1) {
   PM = new PassManagerImpl();
   // PM is the top level manager
   PM->setTopLevelManager(PM);
@@ -1726,9 +1995,22 @@ void PassManager::add(Pass *P) {
 /// run - Execute all of the passes scheduled for execution.  Keep track of
 /// whether any of the passes modifies the module, and if so, return true.
 bool PassManager::run(Module &M) {
+  // Build the copies of the pipeline the first time they are needed.
+  while (ThreadCopies.size() + 1 < Threads) {
+    ThreadCopies.push_back(llvm::make_unique<PassManager>());
+    AddPasses(*ThreadCopies.back());
+    PM->ThreadCopies.push_back(ThreadCopies.back()->PM);
+  }
   return PM->run(M);
 }
 
+void PassManager::setFunctionPassThreads(
+    unsigned Threads, std::function<void(PassManagerBase &)> AddPasses) {
+  assert(ThreadCopies.empty() && "Pipeline copies were already built!");
+  this->Threads = Threads;
+  this->AddPasses = std::move(AddPasses);
+}
+
 //===----------------------------------------------------------------------===//
 // TimingInfo implementation
 
@@ -1750,6 +2032,40 @@ void TimingInfo::createTheTimeInfo() {
   TheTimeInfo = &*TTI;
 }
 
+//===----------------------------------------------------------------------===//
+// PassTraceInfo implementation
+
+static cl::opt<std::string> PassTraceFilename(
+    "time-passes-trace", cl::value_desc("filename"),
+    cl::desc("Record when each pass ran on each function, and how much the "
+             "resident memory grew, as a Chrome trace written on exit"));
+
+void PassTraceInfo::createThePassTrace() {
+  if (PassTraceFilename.empty() || ThePassTrace) return;
+
+  // Like TimingInfo, constructed the first time this is called so that it is
+  // destroyed, and writes the trace, before static globals.
+  static ManagedStatic<PassTraceInfo> PTI;
+  ThePassTrace = &*PTI;
+}
+
+PassTraceInfo::~PassTraceInfo() {
+  std::error_code EC;
+  raw_fd_ostream OS(PassTraceFilename, EC, sys::fs::F_Text);
+  if (EC) {
+    errs() << "Error opening pass trace file '" << PassTraceFilename
+           << "': " << EC.message() << '\n';
+    return;
+  }
+  Profiler.write(OS);
+}
+
+PassTraceRegion::PassTraceRegion(Pass *P, StringRef Detail)
+    : Region(ThePassTrace ? &ThePassTrace->Profiler : nullptr,
+             ThePassTrace ? P->getPassName() : "", Detail) {}
+
+bool PassTraceRegion::isEnabled() { return ThePassTrace; }
+
 /// If TimingInfo is enabled then start pass timer.
 Timer *llvm::getPassTimer(Pass *P) {
   if (TheTimeInfo)
@@ -35,6 +35,7 @@ MetadataAsValue::MetadataAsValue(Type *Ty, Metadata *MD)
 }
 
 MetadataAsValue::~MetadataAsValue() {
+  ContextGuard Guard(getContext(), LLVMContextImpl::MetadataLock);
   getType()->getContext().pImpl->MetadataAsValues.erase(MD);
   untrack();
 }
@@ -74,6 +75,7 @@ static Metadata *canonicalizeMetadataForValue(LLVMContext &Context,
 
 MetadataAsValue *MetadataAsValue::get(LLVMContext &Context, Metadata *MD) {
   MD = canonicalizeMetadataForValue(Context, MD);
+  ContextGuard Guard(Context, LLVMContextImpl::MetadataLock);
   auto *&Entry = Context.pImpl->MetadataAsValues[MD];
   if (!Entry)
     Entry = new MetadataAsValue(Type::getMetadataTy(Context), MD);
@@ -83,6 +85,7 @@ MetadataAsValue *MetadataAsValue::get(LLVMContext &Context, Metadata *MD) {
 MetadataAsValue *MetadataAsValue::getIfExists(LLVMContext &Context,
                                               Metadata *MD) {
   MD = canonicalizeMetadataForValue(Context, MD);
+  ContextGuard Guard(Context, LLVMContextImpl::MetadataLock);
   auto &Store = Context.pImpl->MetadataAsValues;
   return Store.lookup(MD);
 }
@@ -90,6 +93,7 @@ MetadataAsValue *MetadataAsValue::getIfExists(LLVMContext &Context,
 void MetadataAsValue::handleChangedMetadata(Metadata *MD) {
   LLVMContext &Context = getContext();
   MD = canonicalizeMetadataForValue(Context, MD);
+  ContextGuard Guard(Context, LLVMContextImpl::MetadataLock);
   auto &Store = Context.pImpl->MetadataAsValues;
 
   // Stop tracking the old metadata.
@@ -121,6 +125,7 @@ void MetadataAsValue::untrack() {
 }
 
 void ReplaceableMetadataImpl::addRef(void *Ref, OwnerTy Owner) {
+  ContextGuard Guard(Context, LLVMContextImpl::MetadataLock);
   bool WasInserted =
       UseMap.insert(std::make_pair(Ref, std::make_pair(Owner, NextIndex)))
           .second;
@@ -132,6 +137,7 @@ void ReplaceableMetadataImpl::addRef(void *Ref, OwnerTy Owner) {
 }
 
 void ReplaceableMetadataImpl::dropRef(void *Ref) {
+  ContextGuard Guard(Context, LLVMContextImpl::MetadataLock);
   bool WasErased = UseMap.erase(Ref);
   (void)WasErased;
   assert(WasErased && "Expected to drop a reference");
@@ -139,6 +145,7 @@ void ReplaceableMetadataImpl::dropRef(void *Ref) {
 
 void ReplaceableMetadataImpl::moveRef(void *Ref, void *New,
                                       const Metadata &MD) {
+  ContextGuard Guard(Context, LLVMContextImpl::MetadataLock);
   auto I = UseMap.find(Ref);
   assert(I != UseMap.end() && "Expected to move a reference");
   auto OwnerAndIndex = I->second;
@@ -159,6 +166,7 @@ void ReplaceableMetadataImpl::replaceAllUsesWith(Metadata *MD) {
   assert(!(MD && isa<MDNode>(MD) && cast<MDNode>(MD)->isTemporary()) &&
          "Expected non-temp node");
 
+  ContextGuard Guard(Context, LLVMContextImpl::MetadataLock);
   if (UseMap.empty())
     return;
 
@@ -207,6 +215,7 @@ void ReplaceableMetadataImpl::replaceAllUsesWith(Metadata *MD) {
 }
 
 void ReplaceableMetadataImpl::resolveAllUses(bool ResolveUsers) {
+  ContextGuard Guard(Context, LLVMContextImpl::MetadataLock);
   if (UseMap.empty())
     return;
 
@@ -252,6 +261,7 @@ ValueAsMetadata *ValueAsMetadata::get(Value *V) {
   assert(V && "Unexpected null Value");
 
   auto &Context = V->getContext();
+  ContextGuard Guard(Context, LLVMContextImpl::MetadataLock);
   auto *&Entry = Context.pImpl->ValuesAsMetadata[V];
   if (!Entry) {
     assert((isa<Constant>(V) || isa<Argument>(V) || isa<Instruction>(V)) &&
@@ -270,12 +280,14 @@ ValueAsMetadata *ValueAsMetadata::get(Value *V) {
 
 ValueAsMetadata *ValueAsMetadata::getIfExists(Value *V) {
   assert(V && "Unexpected null Value");
+  ContextGuard Guard(V->getContext(), LLVMContextImpl::MetadataLock);
   return V->getContext().pImpl->ValuesAsMetadata.lookup(V);
 }
 
 void ValueAsMetadata::handleDeletion(Value *V) {
   assert(V && "Expected valid value");
 
+  ContextGuard Guard(V->getContext(), LLVMContextImpl::MetadataLock);
   auto &Store = V->getType()->getContext().pImpl->ValuesAsMetadata;
   auto I = Store.find(V);
   if (I == Store.end())
@@ -299,6 +311,7 @@ void ValueAsMetadata::handleRAUW(Value *From, Value *To) {
   assert(From->getType() == To->getType() && "Unexpected type change");
 
   LLVMContext &Context = From->getType()->getContext();
+  ContextGuard Guard(Context, LLVMContextImpl::MetadataLock);
   auto &Store = Context.pImpl->ValuesAsMetadata;
   auto I = Store.find(From);
   if (I == Store.end()) {
@@ -358,6 +371,7 @@ void ValueAsMetadata::handleRAUW(Value *From, Value *To) {
 //
 
 MDString *MDString::get(LLVMContext &Context, StringRef Str) {
+  ContextGuard Guard(Context, LLVMContextImpl::MetadataLock);
   auto &Store = Context.pImpl->MDStringCache;
   auto I = Store.find(Str);
   if (I != Store.end())
@@ -594,6 +608,7 @@ void MDNode::handleChangedOperand(void *Ref, Metadata *New) {
   }
 
   // This node is uniqued.
+  ContextGuard Guard(getContext(), LLVMContextImpl::MetadataLock);
   eraseFromStore();
 
   Metadata *Old = getOperand(Op);
@@ -667,6 +682,7 @@ template <class NodeTy> struct MDNode::HasCachedHash {
 
 MDNode *MDNode::uniquify() {
   assert(!hasSelfReference(this) && "Cannot uniquify a self-referencing node");
+  ContextGuard Guard(getContext(), LLVMContextImpl::MetadataLock);
 
   // Try to insert into uniquing store.
   switch (getMetadataID()) {
@@ -685,6 +701,7 @@ MDNode *MDNode::uniquify() {
 }
 
 void MDNode::eraseFromStore() {
+  ContextGuard Guard(getContext(), LLVMContextImpl::MetadataLock);
   switch (getMetadataID()) {
   default:
     llvm_unreachable("Invalid subclass of MDNode");
@@ -698,6 +715,7 @@ void MDNode::eraseFromStore() {
 
 MDTuple *MDTuple::getImpl(LLVMContext &Context, ArrayRef<Metadata *> MDs,
                           StorageType Storage, bool ShouldCreate) {
+  ContextGuard Guard(Context, LLVMContextImpl::MetadataLock);
   unsigned Hash = 0;
   if (Storage == Uniqued) {
     MDTupleInfo::KeyTy Key(MDs);
@@ -737,6 +755,7 @@ void MDNode::storeDistinctInContext() {
 #include "llvm/IR/Metadata.def"
   }
 
+  ContextGuard Guard(getContext(), LLVMContextImpl::MetadataLock);
   getContext().pImpl->DistinctMDNodes.insert(this);
 }
 
@@ -1056,6 +1075,7 @@ void Instruction::dropUnknownMetadata(ArrayRef<unsigned> KnownIDs) {
   if (!hasMetadataHashEntry())
     return; // Nothing to remove!
 
+  ContextGuard Guard(getContext(), LLVMContextImpl::MetadataLock);
   auto &InstructionMetadata = getContext().pImpl->InstructionMetadata;
 
   if (KnownSet.empty()) {
@@ -1089,7 +1109,9 @@ void Instruction::setMetadata(unsigned KindID, MDNode *Node) {
     DbgLoc = DebugLoc(Node);
     return;
   }
-  
+
+  ContextGuard Guard(getContext(), LLVMContextImpl::MetadataLock);
+
   // Handle the case when we're adding/updating metadata on an instruction.
   if (Node) {
     auto &Info = getContext().pImpl->InstructionMetadata[this];
@@ -1132,6 +1154,7 @@ MDNode *Instruction::getMetadataImpl(unsigned KindID) const {
 
   if (!hasMetadataHashEntry())
     return nullptr;
+  ContextGuard Guard(getContext(), LLVMContextImpl::MetadataLock);
   auto &Info = getContext().pImpl->InstructionMetadata[this];
   assert(!Info.empty() && "bit out of sync with hash table");
 
@@ -1149,6 +1172,7 @@ void Instruction::getAllMetadataImpl(
     if (!hasMetadataHashEntry()) return;
   }
 
+  ContextGuard Guard(getContext(), LLVMContextImpl::MetadataLock);
   assert(hasMetadataHashEntry() &&
          getContext().pImpl->InstructionMetadata.count(this) &&
          "Shouldn't have called this");
@@ -1160,6 +1184,7 @@ void Instruction::getAllMetadataImpl(
 void Instruction::getAllMetadataOtherThanDebugLocImpl(
     SmallVectorImpl<std::pair<unsigned, MDNode *>> &Result) const {
   Result.clear();
+  ContextGuard Guard(getContext(), LLVMContextImpl::MetadataLock);
   assert(hasMetadataHashEntry() &&
          getContext().pImpl->InstructionMetadata.count(this) &&
          "Shouldn't have called this");
@@ -1172,6 +1197,7 @@ void Instruction::getAllMetadataOtherThanDebugLocImpl(
 /// this instruction.
 void Instruction::clearMetadataHashEntries() {
   assert(hasMetadataHashEntry() && "Caller should check");
+  ContextGuard Guard(getContext(), LLVMContextImpl::MetadataLock);
   getContext().pImpl->InstructionMetadata.erase(this);
   setHasMetadataHashEntry(false);
 }
@@ -1179,6 +1205,7 @@ void Instruction::clearMetadataHashEntries() {
 MDNode *Function::getMetadata(unsigned KindID) const {
   if (!hasMetadata())
     return nullptr;
+  ContextGuard Guard(getContext(), LLVMContextImpl::MetadataLock);
   return getContext().pImpl->FunctionMetadata[this].lookup(KindID);
 }
 
@@ -1189,6 +1216,7 @@ MDNode *Function::getMetadata(StringRef Kind) const {
 }
 
 void Function::setMetadata(unsigned KindID, MDNode *MD) {
+  ContextGuard Guard(getContext(), LLVMContextImpl::MetadataLock);
   if (MD) {
     if (!hasMetadata())
       setHasMetadataHashEntry(true);
@@ -1220,6 +1248,7 @@ void Function::getAllMetadata(
   if (!hasMetadata())
     return;
 
+  ContextGuard Guard(getContext(), LLVMContextImpl::MetadataLock);
   getContext().pImpl->FunctionMetadata[this].getAll(MDs);
 }
 
@@ -1234,6 +1263,7 @@ void Function::dropUnknownMetadata(ArrayRef<unsigned> KnownIDs) {
   SmallSet<unsigned, 5> KnownSet;
   KnownSet.insert(KnownIDs.begin(), KnownIDs.end());
 
+  ContextGuard Guard(getContext(), LLVMContextImpl::MetadataLock);
   auto &Store = getContext().pImpl->FunctionMetadata[this];
   assert(!Store.empty());
 
@@ -1248,6 +1278,7 @@ void Function::dropUnknownMetadata(ArrayRef<unsigned> KnownIDs) {
 void Function::clearMetadata() {
   if (!hasMetadata())
     return;
+  ContextGuard Guard(getContext(), LLVMContextImpl::MetadataLock);
   getContext().pImpl->FunctionMetadata.erase(this);
   setHasMetadataHashEntry(false);
 }
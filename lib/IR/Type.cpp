@@ -317,6 +317,7 @@ IntegerType *IntegerType::get(LLVMContext &C, unsigned NumBits) {
     break;
   }
   
+  ContextGuard Guard(C, LLVMContextImpl::TypeLock);
   IntegerType *&Entry = C.pImpl->IntegerTypes[NumBits];
 
   if (!Entry)
@@ -361,6 +362,7 @@ FunctionType::FunctionType(Type *Result, ArrayRef<Type*> Params,
 FunctionType *FunctionType::get(Type *ReturnType,
                                 ArrayRef<Type*> Params, bool isVarArg) {
   LLVMContextImpl *pImpl = ReturnType->getContext().pImpl;
+  ContextGuard Guard(pImpl, LLVMContextImpl::TypeLock);
   FunctionTypeKeyInfo::KeyTy Key(ReturnType, Params, isVarArg);
   auto I = pImpl->FunctionTypes.find_as(Key);
   FunctionType *FT;
@@ -404,6 +406,7 @@ bool FunctionType::isValidArgumentType(Type *ArgTy) {
 StructType *StructType::get(LLVMContext &Context, ArrayRef<Type*> ETypes, 
                             bool isPacked) {
   LLVMContextImpl *pImpl = Context.pImpl;
+  ContextGuard Guard(pImpl, LLVMContextImpl::TypeLock);
   AnonStructTypeKeyInfo::KeyTy Key(ETypes, isPacked);
   auto I = pImpl->AnonStructTypes.find_as(Key);
   StructType *ST;
@@ -429,6 +432,7 @@ void StructType::setBody(ArrayRef<Type*> Elements, bool isPacked) {
     setSubclassData(getSubclassData() | SCDB_Packed);
 
   unsigned NumElements = Elements.size();
+  ContextGuard Guard(getContext(), LLVMContextImpl::TypeLock);
   Type **Elts = getContext().pImpl->TypeAllocator.Allocate<Type*>(NumElements);
   memcpy(Elts, Elements.data(), sizeof(Elements[0]) * NumElements);
   
@@ -437,6 +441,7 @@ void StructType::setBody(ArrayRef<Type*> Elements, bool isPacked) {
 }
 
 void StructType::setName(StringRef Name) {
+  ContextGuard Guard(getContext(), LLVMContextImpl::TypeLock);
   if (Name == getName()) return;
 
   StringMap<StructType *> &SymbolTable = getContext().pImpl->NamedStructTypes;
@@ -488,6 +493,7 @@ void StructType::setName(StringRef Name) {
 // StructType Helper functions.
 
 StructType *StructType::create(LLVMContext &Context, StringRef Name) {
+  ContextGuard Guard(Context, LLVMContextImpl::TypeLock);
   StructType *ST = new (Context.pImpl->TypeAllocator) StructType(Context);
   if (!Name.empty())
     ST->setName(Name);
@@ -623,6 +629,7 @@ bool StructType::isLayoutIdentical(StructType *Other) const {
 /// getTypeByName - Return the type with the specified name, or null if there
 /// is none by that name.
 StructType *Module::getTypeByName(StringRef Name) const {
+  ContextGuard Guard(getContext(), LLVMContextImpl::TypeLock);
   return getContext().pImpl->NamedStructTypes.lookup(Name);
 }
 
@@ -688,6 +695,7 @@ ArrayType *ArrayType::get(Type *elementType, uint64_t NumElements) {
   assert(isValidElementType(ElementType) && "Invalid type for array element!");
     
   LLVMContextImpl *pImpl = ElementType->getContext().pImpl;
+  ContextGuard Guard(pImpl, LLVMContextImpl::TypeLock);
   ArrayType *&Entry = 
     pImpl->ArrayTypes[std::make_pair(ElementType, NumElements)];
 
@@ -718,6 +726,7 @@ VectorType *VectorType::get(Type *elementType, unsigned NumElements) {
                                             "pointer type.");
 
   LLVMContextImpl *pImpl = ElementType->getContext().pImpl;
+  ContextGuard Guard(pImpl, LLVMContextImpl::TypeLock);
   VectorType *&Entry = ElementType->getContext().pImpl
     ->VectorTypes[std::make_pair(ElementType, NumElements)];
 
@@ -740,6 +749,7 @@ PointerType *PointerType::get(Type *EltTy, unsigned AddressSpace) {
   assert(isValidElementType(EltTy) && "Invalid type for pointer element!");
   
   LLVMContextImpl *CImpl = EltTy->getContext().pImpl;
+  ContextGuard Guard(CImpl, LLVMContextImpl::TypeLock);
   
   // Since AddressSpace #0 is the common case, we special case it.
   PointerType *&Entry = AddressSpace == 0 ? CImpl->PointerTypes[EltTy]
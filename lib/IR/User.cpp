@@ -8,6 +8,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/IR/User.h"
+#include "LLVMContextImpl.h"
 #include "llvm/IR/Constant.h"
 #include "llvm/IR/GlobalValue.h"
 #include "llvm/IR/Operator.h"
@@ -15,6 +16,10 @@
 namespace llvm {
 class BasicBlock;
 
+/// Alignment of User objects and operand lists carved out of an IR arena.
+static const size_t ArenaAlignment =
+    AlignOf<AlignedCharArrayUnion<Use, uint64_t, double>>::Alignment;
+
 //===----------------------------------------------------------------------===//
 //                                 User Class
 //===----------------------------------------------------------------------===//
@@ -54,7 +59,14 @@ void User::allocHungoffUses(unsigned N, bool IsPhi) {
   size_t size = N * sizeof(Use) + sizeof(Use::UserRef);
   if (IsPhi)
     size += N * sizeof(BasicBlock *);
-  Use *Begin = static_cast<Use*>(::operator new(size));
+  Use *Begin;
+  if (IsArenaAllocated) {
+    ContextGuard Guard(getContext(), LLVMContextImpl::ArenaLock);
+    Begin = static_cast<Use *>(
+        getContext().pImpl->IRArena.Allocate(size, ArenaAlignment));
+  } else {
+    Begin = static_cast<Use *>(::operator new(size));
+  }
   Use *End = Begin + N;
   (void) new(End) Use::UserRef(const_cast<User*>(this), 1);
   setOperandList(Use::initTags(Begin, End));
@@ -84,32 +96,52 @@ void User::growHungoffUses(unsigned NewNumUses, bool IsPhi) {
         reinterpret_cast<char *>(NewOps + NewNumUses) + sizeof(Use::UserRef);
     std::copy(OldPtr, OldPtr + (OldNumUses * sizeof(BasicBlock *)), NewPtr);
   }
-  Use::zap(OldOps, OldOps + OldNumUses, true);
+  Use::zap(OldOps, OldOps + OldNumUses, /* Delete */ !IsArenaAllocated);
 }
 
 //===----------------------------------------------------------------------===//
 //                         User operator new Implementations
 //===----------------------------------------------------------------------===//
 
+/// Allocate \p Size bytes for a new User and its prefix, either from the
+/// calling thread's active IR arena or from the heap.
+static void *allocateUserStorage(size_t Size, bool &InArena) {
+  LLVMContextImpl *Arena = LLVMContextImpl::getActiveIRArena();
+  InArena = Arena != nullptr;
+  if (InArena) {
+    ContextGuard Guard(Arena, LLVMContextImpl::ArenaLock);
+    return Arena->IRArena.Allocate(Size, ArenaAlignment);
+  }
+  return ::operator new(Size);
+}
+
+bool User::isInActiveArenaContext() const {
+  return LLVMContextImpl::getActiveIRArena() == getContext().pImpl;
+}
+
 void *User::operator new(size_t Size, unsigned Us) {
   assert(Us < (1u << NumUserOperandsBits) && "Too many operands");
-  void *Storage = ::operator new(Size + sizeof(Use) * Us);
+  bool InArena;
+  void *Storage = allocateUserStorage(Size + sizeof(Use) * Us, InArena);
   Use *Start = static_cast<Use*>(Storage);
   Use *End = Start + Us;
   User *Obj = reinterpret_cast<User*>(End);
   Obj->NumUserOperands = Us;
   Obj->HasHungOffUses = false;
+  Obj->IsArenaAllocated = InArena;
   Use::initTags(Start, End);
   return Obj;
 }
 
 void *User::operator new(size_t Size) {
   // Allocate space for a single Use*
-  void *Storage = ::operator new(Size + sizeof(Use *));
+  bool InArena;
+  void *Storage = allocateUserStorage(Size + sizeof(Use *), InArena);
   Use **HungOffOperandList = static_cast<Use **>(Storage);
   User *Obj = reinterpret_cast<User *>(HungOffOperandList + 1);
   Obj->NumUserOperands = 0;
   Obj->HasHungOffUses = true;
+  Obj->IsArenaAllocated = InArena;
   *HungOffOperandList = nullptr;
   return Obj;
 }
@@ -120,19 +152,23 @@ void *User::operator new(size_t Size) {
 
 void User::operator delete(void *Usr) {
   // Hung off uses use a single Use* before the User, while other subclasses
-  // use a Use[] allocated prior to the user.
+  // use a Use[] allocated prior to the user.  Arena memory is only released
+  // along with the owning context.
   User *Obj = static_cast<User *>(Usr);
+  bool InArena = Obj->IsArenaAllocated;
   if (Obj->HasHungOffUses) {
     Use **HungOffOperandList = static_cast<Use **>(Usr) - 1;
     // drop the hung off uses.
     Use::zap(*HungOffOperandList, *HungOffOperandList + Obj->NumUserOperands,
-             /* Delete */ true);
-    ::operator delete(HungOffOperandList);
+             /* Delete */ !InArena);
+    if (!InArena)
+      ::operator delete(HungOffOperandList);
   } else {
     Use *Storage = static_cast<Use *>(Usr) - Obj->NumUserOperands;
     Use::zap(Storage, Storage + Obj->NumUserOperands,
              /* Delete */ false);
-    ::operator delete(Storage);
+    if (!InArena)
+      ::operator delete(Storage);
   }
 }
 
@@ -39,6 +39,8 @@ using namespace llvm;
 //===----------------------------------------------------------------------===//
 //                                Value Class
 //===----------------------------------------------------------------------===//
+std::atomic<unsigned> Value::NumMultithreadedContexts(0);
+
 static inline Type *checkType(Type *Ty) {
   assert(Ty && "Value defined with a null type: Error!");
   return Ty;
@@ -93,7 +95,50 @@ void Value::destroyValueName() {
   setValueName(nullptr);
 }
 
+void Value::addUseLocked(Use &U) {
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  if (!pImpl->Multithreaded)
+    return U.addToList(&UseList);
+  sys::ScopedLock Guard(pImpl->getUseListLock(this));
+  U.addToList(&UseList);
+}
+
+void Value::removeUseLocked(Use &U) {
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  if (!pImpl->Multithreaded)
+    return U.removeFromList();
+  sys::ScopedLock Guard(pImpl->getUseListLock(this));
+  U.removeFromList();
+}
+
+void Value::lockUseList() const {
+  if (!needsUseListLock())
+    return;
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  if (pImpl->Multithreaded)
+    pImpl->getUseListLock(this).lock();
+}
+
+void Value::unlockUseList() const {
+  if (!needsUseListLock())
+    return;
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  if (pImpl->Multithreaded)
+    pImpl->getUseListLock(this).unlock();
+}
+
+bool Value::hasNUsesLocked(unsigned N, bool OrMore) const {
+  UseListGuard Guard(this);
+  const_use_iterator UI = use_begin(), E = use_end();
+
+  for (; N; --N, ++UI)
+    if (UI == E) return false;  // Too few.
+  return OrMore || UI == E;
+}
+
 bool Value::hasNUses(unsigned N) const {
+  if (LLVM_UNLIKELY(needsUseListLock()))
+    return hasNUsesLocked(N, /*OrMore=*/false);
   const_use_iterator UI = use_begin(), E = use_end();
 
   for (; N; --N, ++UI)
@@ -102,6 +147,8 @@ bool Value::hasNUses(unsigned N) const {
 }
 
 bool Value::hasNUsesOrMore(unsigned N) const {
+  if (LLVM_UNLIKELY(needsUseListLock()))
+    return hasNUsesLocked(N, /*OrMore=*/true);
   const_use_iterator UI = use_begin(), E = use_end();
 
   for (; N; --N, ++UI)
@@ -117,6 +164,7 @@ bool Value::isUsedInBasicBlock(const BasicBlock *BB) const {
   //
   // Scan both lists simultaneously until one is exhausted. This limits the
   // search to the shorter list.
+  UseListGuard Guard(this);
   BasicBlock::const_iterator BI = BB->begin(), BE = BB->end();
   const_user_iterator UI = user_begin(), UE = user_end();
   for (; BI != BE && UI != UE; ++BI, ++UI) {
@@ -132,6 +180,7 @@ bool Value::isUsedInBasicBlock(const BasicBlock *BB) const {
 }
 
 unsigned Value::getNumUses() const {
+  UseListGuard Guard(this);
   return (unsigned)std::distance(use_begin(), use_end());
 }
 
@@ -161,6 +210,7 @@ ValueName *Value::getValueName() const {
   if (!HasName) return nullptr;
 
   LLVMContext &Ctx = getContext();
+  ContextGuard Guard(Ctx, LLVMContextImpl::ValueNameLock);
   auto I = Ctx.pImpl->ValueNames.find(this);
   assert(I != Ctx.pImpl->ValueNames.end() &&
          "No name entry found!");
@@ -170,6 +220,7 @@ ValueName *Value::getValueName() const {
 
 void Value::setValueName(ValueName *VN) {
   LLVMContext &Ctx = getContext();
+  ContextGuard Guard(Ctx, LLVMContextImpl::ValueNameLock);
 
   assert(HasName == Ctx.pImpl->ValueNames.count(this) &&
          "HasName bit out of sync!");
@@ -215,6 +266,11 @@ void Value::setNameImpl(const Twine &NewName) {
   if (getSymTab(this, ST))
     return;  // Cannot set a name on this value (e.g. constant).
 
+  // The symbol table of a module is shared by all of its functions.
+  std::unique_ptr<ContextGuard> Guard;
+  if (isa<GlobalValue>(this))
+    Guard.reset(new ContextGuard(getContext(), LLVMContextImpl::ModuleLock));
+
   if (!ST) { // No symbol table to update?  Just do the change.
     if (NameRef.empty()) {
       // Free the name for this value.
@@ -254,6 +310,10 @@ void Value::setName(const Twine &NewName) {
 }
 
 void Value::takeName(Value *V) {
+  std::unique_ptr<ContextGuard> Guard;
+  if (isa<GlobalValue>(this) || isa<GlobalValue>(V))
+    Guard.reset(new ContextGuard(getContext(), LLVMContextImpl::ModuleLock));
+
   ValueSymbolTable *ST = nullptr;
   // If this value has a name, drop it.
   if (hasName()) {
@@ -568,6 +628,7 @@ void ValueHandleBase::AddToUseList() {
   assert(V && "Null pointer doesn't have a use list!");
 
   LLVMContextImpl *pImpl = V->getContext().pImpl;
+  ContextGuard Guard(pImpl, LLVMContextImpl::ValueHandleLock);
 
   if (V->HasValueHandle) {
     // If this value already has a ValueHandle, then it must be in the
@@ -610,6 +671,7 @@ void ValueHandleBase::AddToUseList() {
 void ValueHandleBase::RemoveFromUseList() {
   assert(V && V->HasValueHandle &&
          "Pointer doesn't have a use list!");
+  ContextGuard Guard(V->getContext(), LLVMContextImpl::ValueHandleLock);
 
   // Unlink this from its use list.
   ValueHandleBase **PrevPtr = getPrevPtr();
@@ -633,14 +695,36 @@ void ValueHandleBase::RemoveFromUseList() {
   }
 }
 
+/// Return true if \p V is a value that any function can refer to, such as a
+/// constant or global, rather than one that belongs to a single function.
+static bool isSharedByFunctions(const Value *V) {
+  return !isa<Instruction>(V) && !isa<Argument>(V) && !isa<BasicBlock>(V);
+}
+
+/// Return the first of the value handles of \p V.
+static ValueHandleBase *getValueHandles(LLVMContextImpl *pImpl, Value *V) {
+  ContextGuard Guard(pImpl, LLVMContextImpl::ValueHandleLock);
+  return pImpl->ValueHandles.lookup(V);
+}
 
 void ValueHandleBase::ValueIsDeleted(Value *V) {
   assert(V->HasValueHandle && "Should only be called if ValueHandles present");
 
+  // Only the thread working on the function of a value changes its handles,
+  // unless any function can refer to the value. In that case, keep the
+  // handles locked while walking them, but run the callbacks once the lock is
+  // released: they may create constants or metadata, whose locks come before
+  // ValueHandleLock.
+  LLVMContextImpl *pImpl = V->getContext().pImpl;
+  std::unique_ptr<ContextGuard> Guard;
+  bool DeferCallbacks = pImpl->Multithreaded && isSharedByFunctions(V);
+  SmallVector<CallbackVH *, 4> Callbacks;
+  if (DeferCallbacks)
+    Guard.reset(new ContextGuard(pImpl, LLVMContextImpl::ValueHandleLock));
+
   // Get the linked list base, which is guaranteed to exist since the
   // HasValueHandle flag is set.
-  LLVMContextImpl *pImpl = V->getContext().pImpl;
-  ValueHandleBase *Entry = pImpl->ValueHandles[V];
+  ValueHandleBase *Entry = getValueHandles(pImpl, V);
   assert(Entry && "Value bit set but no entries exist");
 
   // We use a local ValueHandleBase as an iterator so that ValueHandles can add
@@ -671,11 +755,29 @@ void ValueHandleBase::ValueIsDeleted(Value *V) {
       break;
     case Callback:
       // Forward to the subclass's implementation.
-      static_cast<CallbackVH*>(Entry)->deleted();
+      if (DeferCallbacks)
+        Callbacks.push_back(static_cast<CallbackVH *>(Entry));
+      else
+        static_cast<CallbackVH*>(Entry)->deleted();
       break;
     }
   }
 
+  // A callback may have dropped the handles of others, so only run those
+  // that still watch V.
+  Guard.reset();
+  for (CallbackVH *CB : Callbacks) {
+    ValueHandleBase *Entry;
+    {
+      ContextGuard Lock(pImpl, LLVMContextImpl::ValueHandleLock);
+      Entry = pImpl->ValueHandles.lookup(V);
+      while (Entry && Entry != CB)
+        Entry = Entry->Next;
+    }
+    if (Entry)
+      CB->deleted();
+  }
+
   // All callbacks, weak references, and assertingVHs should be dropped by now.
   if (V->HasValueHandle) {
 #ifndef NDEBUG      // Only in +Asserts mode...
@@ -697,10 +799,18 @@ void ValueHandleBase::ValueIsRAUWd(Value *Old, Value *New) {
   assert(Old->getType() == New->getType() &&
          "replaceAllUses of value with new value of different type!");
 
+  // Walk the handles of a shared value locked, but run the callbacks with
+  // the lock released, as ValueIsDeleted does.
+  LLVMContextImpl *pImpl = Old->getContext().pImpl;
+  std::unique_ptr<ContextGuard> Guard;
+  bool DeferCallbacks = pImpl->Multithreaded && isSharedByFunctions(Old);
+  SmallVector<CallbackVH *, 4> Callbacks;
+  if (DeferCallbacks)
+    Guard.reset(new ContextGuard(pImpl, LLVMContextImpl::ValueHandleLock));
+
   // Get the linked list base, which is guaranteed to exist since the
   // HasValueHandle flag is set.
-  LLVMContextImpl *pImpl = Old->getContext().pImpl;
-  ValueHandleBase *Entry = pImpl->ValueHandles[Old];
+  ValueHandleBase *Entry = getValueHandles(pImpl, Old);
 
   assert(Entry && "Value bit set but no entries exist");
 
@@ -730,16 +840,32 @@ void ValueHandleBase::ValueIsRAUWd(Value *Old, Value *New) {
       break;
     case Callback:
       // Forward to the subclass's implementation.
-      static_cast<CallbackVH*>(Entry)->allUsesReplacedWith(New);
+      if (DeferCallbacks)
+        Callbacks.push_back(static_cast<CallbackVH *>(Entry));
+      else
+        static_cast<CallbackVH*>(Entry)->allUsesReplacedWith(New);
       break;
     }
   }
 
+  Guard.reset();
+  for (CallbackVH *CB : Callbacks) {
+    ValueHandleBase *Entry;
+    {
+      ContextGuard Lock(pImpl, LLVMContextImpl::ValueHandleLock);
+      Entry = pImpl->ValueHandles.lookup(Old);
+      while (Entry && Entry != CB)
+        Entry = Entry->Next;
+    }
+    if (Entry)
+      CB->allUsesReplacedWith(New);
+  }
+
 #ifndef NDEBUG
   // If any new tracking or weak value handles were added while processing the
   // list, then complain about it now.
   if (Old->HasValueHandle)
-    for (Entry = pImpl->ValueHandles[Old]; Entry; Entry = Entry->Next)
+    for (Entry = getValueHandles(pImpl, Old); Entry; Entry = Entry->Next)
       switch (Entry->getKind()) {
       case Tracking:
       case Weak:
@@ -18,6 +18,7 @@
 #include "llvm/Analysis/TargetLibraryInfo.h"
 #include "llvm/Analysis/TargetTransformInfo.h"
 #include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/CodeGen/ParallelCG.h"
 #include "llvm/CodeGen/RuntimeLibcalls.h"
 #include "llvm/Config/config.h"
 #include "llvm/IR/Constants.h"
@@ -52,6 +53,7 @@
 #include "llvm/Transforms/IPO.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
 #include "llvm/Transforms/ObjCARC.h"
+#include <list>
 #include <system_error>
 using namespace llvm;
 
@@ -305,19 +307,19 @@ bool LTOCodeGenerator::determineTarget(std::string &errMsg) {
   if (TargetMach)
     return true;
 
-  std::string TripleStr = IRLinker.getModule()->getTargetTriple();
+  TripleStr = IRLinker.getModule()->getTargetTriple();
   if (TripleStr.empty())
     TripleStr = sys::getDefaultTargetTriple();
   llvm::Triple Triple(TripleStr);
 
   // create target machine from info for merged modules
-  const Target *march = TargetRegistry::lookupTarget(TripleStr, errMsg);
-  if (!march)
+  MArch = TargetRegistry::lookupTarget(TripleStr, errMsg);
+  if (!MArch)
     return false;
 
   // The relocation model is actually a static member of TargetMachine and
   // needs to be set before the TargetMachine is instantiated.
-  Reloc::Model RelocModel = Reloc::Default;
+  RelocModel = Reloc::Default;
   switch (CodeModel) {
   case LTO_CODEGEN_PIC_MODEL_STATIC:
     RelocModel = Reloc::Static;
@@ -337,7 +339,7 @@ bool LTOCodeGenerator::determineTarget(std::string &errMsg) {
   // the default set of features.
   SubtargetFeatures Features(MAttr);
   Features.getDefaultSubtargetFeatures(Triple);
-  std::string FeatureStr = Features.getString();
+  FeatureStr = Features.getString();
   // Set a default CPU for Darwin triples.
   if (MCpu.empty() && Triple.isOSDarwin()) {
     if (Triple.getArch() == llvm::Triple::x86_64)
@@ -348,7 +350,6 @@ bool LTOCodeGenerator::determineTarget(std::string &errMsg) {
       MCpu = "cyclone";
   }
 
-  CodeGenOpt::Level CGOptLevel;
   switch (OptLevel) {
   case 0:
     CGOptLevel = CodeGenOpt::None;
@@ -364,12 +365,16 @@ bool LTOCodeGenerator::determineTarget(std::string &errMsg) {
     break;
   }
 
-  TargetMach = march->createTargetMachine(TripleStr, MCpu, FeatureStr, Options,
-                                          RelocModel, CodeModel::Default,
-                                          CGOptLevel);
+  TargetMach = createTargetMachine().release();
   return true;
 }
 
+std::unique_ptr<TargetMachine> LTOCodeGenerator::createTargetMachine() {
+  return std::unique_ptr<TargetMachine>(MArch->createTargetMachine(
+      TripleStr, MCpu, FeatureStr, Options, RelocModel, CodeModel::Default,
+      CGOptLevel));
+}
+
 void LTOCodeGenerator::
 applyRestriction(GlobalValue &GV,
                  ArrayRef<StringRef> Libcalls,
@@ -578,6 +583,55 @@ bool LTOCodeGenerator::compileOptimized(raw_pwrite_stream &out,
   return true;
 }
 
+bool LTOCodeGenerator::compileOptimized(ArrayRef<raw_pwrite_stream *> Out,
+                                        std::string &errMsg) {
+  if (Out.size() == 1)
+    return compileOptimized(*Out[0], errMsg);
+
+  if (!this->determineTarget(errMsg))
+    return false;
+
+  Module *mergedModule = IRLinker.getModule();
+
+  // If the bitcode files contain ARC code and were compiled with optimization,
+  // the ObjCARCContractPass must be run, so do it unconditionally here. It
+  // only needs to run once, before the module is split.
+  legacy::PassManager preCodeGenPasses;
+  preCodeGenPasses.add(createObjCARCContractPass());
+  preCodeGenPasses.run(*mergedModule);
+
+  // Each partition is compiled in its own context by its own TargetMachine;
+  // they are all created with the options TargetMach was created with.
+  return !splitCodeGen(*mergedModule, Out,
+                       [this] { return createTargetMachine(); }, errMsg);
+}
+
+std::vector<std::unique_ptr<MemoryBuffer>>
+LTOCodeGenerator::compileOptimized(unsigned Parallelism, std::string &errMsg) {
+  std::vector<std::unique_ptr<MemoryBuffer>> Objects;
+  if (Parallelism <= 1) {
+    if (std::unique_ptr<MemoryBuffer> Object = compileOptimized(errMsg))
+      Objects.push_back(std::move(Object));
+    return Objects;
+  }
+
+  std::vector<SmallString<0>> Buffers(Parallelism);
+  std::list<raw_svector_ostream> OSs;
+  std::vector<raw_pwrite_stream *> OSPtrs;
+  for (SmallString<0> &Buffer : Buffers) {
+    OSs.emplace_back(Buffer);
+    OSPtrs.push_back(&OSs.back());
+  }
+  if (!compileOptimized(OSPtrs, errMsg))
+    return Objects;
+
+  unsigned I = 0;
+  for (raw_svector_ostream &OS : OSs)
+    Objects.push_back(MemoryBuffer::getMemBufferCopy(
+        OS.str(), "lto-llvm-" + Twine(I++) + ".o"));
+  return Objects;
+}
+
 /// setCodeGenDebugOptions - Set codegen debugging options to aid in debugging
 /// LTO problems.
 void LTOCodeGenerator::setCodeGenDebugOptions(const char *options) {
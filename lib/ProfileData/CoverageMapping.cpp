@@ -16,11 +16,15 @@
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/SmallBitVector.h"
+#include "llvm/ADT/SmallString.h"
 #include "llvm/ProfileData/CoverageMappingReader.h"
 #include "llvm/ProfileData/InstrProfReader.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/Errc.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/FileCache.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/raw_ostream.h"
@@ -234,14 +238,92 @@ CoverageMapping::load(CoverageMappingReader &CoverageReader,
   return std::move(Coverage);
 }
 
-ErrorOr<std::unique_ptr<CoverageMapping>>
-CoverageMapping::load(StringRef ObjectFilename, StringRef ProfileFilename,
-                      StringRef Arch) {
+/// \brief Return the key of the cache entry of the coverage mapping of
+/// \p Arch in \p ObjectFilename, which changes whenever the object does.
+static std::error_code getCacheKey(StringRef ObjectFilename, StringRef Arch,
+                                   std::string &Key) {
+  SmallString<128> AbsolutePath(ObjectFilename);
+  if (std::error_code EC = sys::fs::make_absolute(AbsolutePath))
+    return EC;
+  sys::fs::file_status Status;
+  if (std::error_code EC = sys::fs::status(AbsolutePath, Status))
+    return EC;
+
+  MD5 Hash;
+  SmallString<32> Stamp;
+  Hash.update("covmap");
+  Hash.update(AbsolutePath);
+  Hash.update(Arch);
+  raw_svector_ostream(Stamp)
+      << Status.getSize() << ':'
+      << Status.getLastModificationTime().seconds() << ':'
+      << Status.getLastModificationTime().nanoseconds();
+  Hash.update(Stamp);
+  Key = FileCache::getKey(Hash);
+  return std::error_code();
+}
+
+/// \brief Create a reader for the coverage mapping of \p Arch in
+/// \p ObjectFilename, reading it from the cache in \p CacheDir if there is
+/// one, and adding it to the cache otherwise, after which the cache is pruned
+/// to \p CacheSizeLimit bytes unless that is 0. The reader refers to the data
+/// of \p ObjectBuffer, which must outlive it.
+static ErrorOr<std::unique_ptr<CoverageMappingReader>>
+createCoverageReader(StringRef ObjectFilename, StringRef Arch,
+                     StringRef CacheDir, uint64_t CacheSizeLimit,
+                     std::unique_ptr<MemoryBuffer> &ObjectBuffer) {
+  FileCache Cache(CacheDir);
+  std::string CacheKey;
+  bool UseCache = !CacheDir.empty() && ObjectFilename != "-" &&
+                  !getCacheKey(ObjectFilename, Arch, CacheKey);
+  if (UseCache) {
+    // An entry that cannot be read, say because it was written by another
+    // kind of host, is simply written again.
+    auto CacheBuff = Cache.lookup(CacheKey);
+    if (CacheBuff) {
+      auto CachedReaderOrErr =
+          CachedCoverageReader::create(std::move(CacheBuff.get()));
+      if (CachedReaderOrErr)
+        return std::unique_ptr<CoverageMappingReader>(
+            std::move(CachedReaderOrErr.get()));
+    }
+  }
+
   auto CounterMappingBuff = MemoryBuffer::getFileOrSTDIN(ObjectFilename);
   if (std::error_code EC = CounterMappingBuff.getError())
     return EC;
-  auto CoverageReaderOrErr =
-      BinaryCoverageReader::create(CounterMappingBuff.get(), Arch);
+  ObjectBuffer = std::move(CounterMappingBuff.get());
+  auto CoverageReaderOrErr = BinaryCoverageReader::create(ObjectBuffer, Arch);
+  if (std::error_code EC = CoverageReaderOrErr.getError())
+    return EC;
+  if (!UseCache)
+    return std::unique_ptr<CoverageMappingReader>(
+        std::move(CoverageReaderOrErr.get()));
+
+  SmallString<0> Data;
+  raw_svector_ostream OS(Data);
+  if (std::error_code EC =
+          CachedCoverageReader::write(*CoverageReaderOrErr.get(), OS))
+    return EC;
+  OS.flush();
+  // Failing to save the cache is not an error, only a missed speedup.
+  if (!Cache.store(CacheKey, Data) && CacheSizeLimit)
+    Cache.prune(CacheSizeLimit);
+  auto CachedReaderOrErr = CachedCoverageReader::create(
+      MemoryBuffer::getMemBufferCopy(Data, Cache.getEntryPath(CacheKey)));
+  if (std::error_code EC = CachedReaderOrErr.getError())
+    return EC;
+  return std::unique_ptr<CoverageMappingReader>(
+      std::move(CachedReaderOrErr.get()));
+}
+
+ErrorOr<std::unique_ptr<CoverageMapping>>
+CoverageMapping::load(StringRef ObjectFilename, StringRef ProfileFilename,
+                      StringRef Arch, StringRef CacheDir,
+                      uint64_t CacheSizeLimit) {
+  std::unique_ptr<MemoryBuffer> ObjectBuffer;
+  auto CoverageReaderOrErr = createCoverageReader(
+      ObjectFilename, Arch, CacheDir, CacheSizeLimit, ObjectBuffer);
   if (std::error_code EC = CoverageReaderOrErr.getError())
     return EC;
   auto CoverageReader = std::move(CoverageReaderOrErr.get());
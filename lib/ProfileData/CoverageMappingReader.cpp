@@ -557,3 +557,245 @@ BinaryCoverageReader::readNextRecord(CoverageMappingRecord &Record) {
   ++CurrentRecord;
   return std::error_code();
 }
+
+namespace {
+/// The header of a cache of decoded coverage mapping records. The arrays of
+/// the cache follow it in the order of the fields giving their sizes, each
+/// padded to a multiple of 8 bytes.
+struct CacheHeader {
+  uint64_t Magic;
+  uint64_t Version;
+  uint64_t ExpressionSize;
+  uint64_t RegionSize;
+  uint64_t NumRecords;
+  uint64_t NumFilenames;
+  uint64_t NumExpressions;
+  uint64_t NumRegions;
+  uint64_t NumStrings;
+  uint64_t StringDataSize;
+};
+
+/// The location of a string in the string data of a cache.
+struct CachedString {
+  uint32_t Offset;
+  uint32_t Size;
+};
+
+const uint64_t CacheMagic = 0x6568636163766f63ULL; // "covcache"
+const uint64_t CacheVersion = 1;
+}
+
+static uint64_t alignedSize(uint64_t Size) { return RoundUpToAlignment(Size, 8); }
+
+// The cache is written byte for byte from these types, so any padding in
+// them would carry whatever was in memory into the cache.
+static_assert(sizeof(Counter) ==
+                  sizeof(Counter::CounterKind) + sizeof(unsigned),
+              "Counter has padding");
+static_assert(sizeof(CounterExpression) ==
+                  sizeof(CounterExpression::ExprKind) + 2 * sizeof(Counter),
+              "CounterExpression has padding");
+static_assert(sizeof(CounterMappingRegion) ==
+                  sizeof(Counter) + 6 * sizeof(unsigned) +
+                      sizeof(CounterMappingRegion::RegionKind),
+              "CounterMappingRegion has padding");
+
+/// Write the \p Count elements at \p Data, followed by zeros up to a
+/// multiple of 8 bytes.
+template <typename T>
+static void writeArray(raw_ostream &OS, const T *Data, size_t Count) {
+  static const char Padding[8] = {0};
+  size_t Size = Count * sizeof(T);
+  OS.write(reinterpret_cast<const char *>(Data), Size);
+  OS.write(Padding, alignedSize(Size) - Size);
+}
+
+std::error_code CachedCoverageReader::write(CoverageMappingReader &Reader,
+                                            raw_ostream &OS) {
+  std::vector<CachedRecord> Records;
+  std::vector<uint32_t> FilenameRefs;
+  std::vector<CounterExpression> Expressions;
+  std::vector<CounterMappingRegion> Regions;
+  StringMap<uint32_t> StringIDs;
+  std::vector<StringRef> Strings;
+  auto getStringID = [&](StringRef S) {
+    auto Entry = StringIDs.insert(std::make_pair(S, uint32_t(Strings.size())));
+    if (Entry.second)
+      Strings.push_back(Entry.first->getKey());
+    return Entry.first->getValue();
+  };
+
+  CoverageMappingRecord Record;
+  std::error_code EC;
+  while (!(EC = Reader.readNextRecord(Record))) {
+    // Value-initialize the record, which zeroes its padding as well.
+    CachedRecord R = CachedRecord();
+    R.FunctionHash = Record.FunctionHash;
+    R.FunctionName = getStringID(Record.FunctionName);
+    R.FilenamesBegin = FilenameRefs.size();
+    R.NumFilenames = Record.Filenames.size();
+    R.NumExpressions = Record.Expressions.size();
+    R.NumRegions = Record.MappingRegions.size();
+    Records.push_back(R);
+    for (StringRef Filename : Record.Filenames)
+      FilenameRefs.push_back(getStringID(Filename));
+    Expressions.insert(Expressions.end(), Record.Expressions.begin(),
+                       Record.Expressions.end());
+    Regions.insert(Regions.end(), Record.MappingRegions.begin(),
+                   Record.MappingRegions.end());
+  }
+  if (EC != coveragemap_error::eof)
+    return EC;
+
+  std::vector<CachedString> StringTable;
+  uint64_t StringDataSize = 0;
+  for (StringRef S : Strings) {
+    CachedString Entry = CachedString();
+    Entry.Offset = StringDataSize;
+    Entry.Size = S.size();
+    StringTable.push_back(Entry);
+    StringDataSize += S.size();
+  }
+  if (StringDataSize > std::numeric_limits<uint32_t>::max())
+    return coveragemap_error::malformed;
+
+  CacheHeader Header = CacheHeader();
+  Header.Magic = CacheMagic;
+  Header.Version = CacheVersion;
+  Header.ExpressionSize = sizeof(CounterExpression);
+  Header.RegionSize = sizeof(CounterMappingRegion);
+  Header.NumRecords = Records.size();
+  Header.NumFilenames = FilenameRefs.size();
+  Header.NumExpressions = Expressions.size();
+  Header.NumRegions = Regions.size();
+  Header.NumStrings = Strings.size();
+  Header.StringDataSize = StringDataSize;
+  writeArray(OS, &Header, 1);
+  writeArray(OS, Records.data(), Records.size());
+  writeArray(OS, FilenameRefs.data(), FilenameRefs.size());
+  writeArray(OS, Expressions.data(), Expressions.size());
+  writeArray(OS, Regions.data(), Regions.size());
+  writeArray(OS, StringTable.data(), StringTable.size());
+  for (StringRef S : Strings)
+    OS << S;
+  return std::error_code();
+}
+
+/// Set \p Result to the array of \p Count elements of type T at \p Cur and
+/// move \p Cur past it, or return false if it does not fit before \p End.
+template <typename T>
+static bool readArray(const char *&Cur, const char *End, uint64_t Count,
+                      ArrayRef<T> &Result) {
+  uint64_t Size = Count * sizeof(T);
+  if (Count > uint64_t(End - Cur) / sizeof(T) ||
+      alignedSize(Size) > uint64_t(End - Cur))
+    return false;
+  Result = makeArrayRef(reinterpret_cast<const T *>(Cur), Count);
+  Cur += alignedSize(Size);
+  return true;
+}
+
+static bool isValidCounter(Counter C, uint64_t NumExpressions) {
+  if (C.isExpression())
+    return C.getExpressionID() < NumExpressions;
+  return unsigned(C.getKind()) <= Counter::CounterValueReference;
+}
+
+std::error_code CachedCoverageReader::readCache() {
+  const char *Cur = Buffer->getBufferStart();
+  const char *End = Buffer->getBufferEnd();
+  if (reinterpret_cast<uintptr_t>(Cur) % alignOf<uint64_t>())
+    return coveragemap_error::malformed;
+
+  ArrayRef<CacheHeader> Headers;
+  if (!readArray(Cur, End, 1, Headers))
+    return coveragemap_error::truncated;
+  const CacheHeader &Header = Headers[0];
+  if (Header.Magic != CacheMagic ||
+      Header.ExpressionSize != sizeof(CounterExpression) ||
+      Header.RegionSize != sizeof(CounterMappingRegion))
+    return coveragemap_error::malformed;
+  if (Header.Version != CacheVersion)
+    return coveragemap_error::unsupported_version;
+
+  ArrayRef<uint32_t> FilenameRefs;
+  ArrayRef<CachedString> StringTable;
+  if (!readArray(Cur, End, Header.NumRecords, Records) ||
+      !readArray(Cur, End, Header.NumFilenames, FilenameRefs) ||
+      !readArray(Cur, End, Header.NumExpressions, Expressions) ||
+      !readArray(Cur, End, Header.NumRegions, MappingRegions) ||
+      !readArray(Cur, End, Header.NumStrings, StringTable) ||
+      Header.StringDataSize != uint64_t(End - Cur))
+    return coveragemap_error::truncated;
+
+  for (const CachedString &S : StringTable) {
+    if (uint64_t(S.Offset) + S.Size > Header.StringDataSize)
+      return coveragemap_error::malformed;
+    Strings.push_back(StringRef(Cur + S.Offset, S.Size));
+  }
+  for (uint32_t ID : FilenameRefs) {
+    if (ID >= Strings.size())
+      return coveragemap_error::malformed;
+    Filenames.push_back(Strings[ID]);
+  }
+
+  // Check that the records cover the arrays, and that their counters and
+  // file IDs are in range, so that clients can trust them as they trust
+  // decoded ones.
+  uint64_t NumExpressions = 0, NumRegions = 0;
+  for (const CachedRecord &R : Records) {
+    if (R.FunctionName >= Strings.size() ||
+        uint64_t(R.FilenamesBegin) + R.NumFilenames > Filenames.size() ||
+        NumExpressions + R.NumExpressions > Expressions.size() ||
+        NumRegions + R.NumRegions > MappingRegions.size())
+      return coveragemap_error::malformed;
+    for (const CounterExpression &E :
+         Expressions.slice(NumExpressions, R.NumExpressions))
+      if (unsigned(E.Kind) > CounterExpression::Add ||
+          !isValidCounter(E.LHS, R.NumExpressions) ||
+          !isValidCounter(E.RHS, R.NumExpressions))
+        return coveragemap_error::malformed;
+    for (const CounterMappingRegion &CMR :
+         MappingRegions.slice(NumRegions, R.NumRegions))
+      if (unsigned(CMR.Kind) > CounterMappingRegion::SkippedRegion ||
+          !isValidCounter(CMR.Count, R.NumExpressions) ||
+          CMR.FileID >= R.NumFilenames ||
+          (CMR.Kind == CounterMappingRegion::ExpansionRegion &&
+           CMR.ExpandedFileID >= R.NumFilenames))
+        return coveragemap_error::malformed;
+    NumExpressions += R.NumExpressions;
+    NumRegions += R.NumRegions;
+  }
+  if (NumExpressions != Expressions.size() ||
+      NumRegions != MappingRegions.size())
+    return coveragemap_error::malformed;
+  return std::error_code();
+}
+
+ErrorOr<std::unique_ptr<CachedCoverageReader>>
+CachedCoverageReader::create(std::unique_ptr<MemoryBuffer> Buffer) {
+  std::unique_ptr<CachedCoverageReader> Reader(
+      new CachedCoverageReader(std::move(Buffer)));
+  if (std::error_code EC = Reader->readCache())
+    return EC;
+  return std::move(Reader);
+}
+
+std::error_code
+CachedCoverageReader::readNextRecord(CoverageMappingRecord &Record) {
+  if (CurrentRecord >= Records.size())
+    return coveragemap_error::eof;
+
+  const CachedRecord &R = Records[CurrentRecord];
+  Record.FunctionName = Strings[R.FunctionName];
+  Record.FunctionHash = R.FunctionHash;
+  Record.Filenames =
+      makeArrayRef(Filenames).slice(R.FilenamesBegin, R.NumFilenames);
+  Record.Expressions = Expressions.slice(CurrentExpression, R.NumExpressions);
+  Record.MappingRegions = MappingRegions.slice(CurrentRegion, R.NumRegions);
+
+  CurrentExpression += R.NumExpressions;
+  CurrentRegion += R.NumRegions;
+  ++CurrentRecord;
+  return std::error_code();
+}
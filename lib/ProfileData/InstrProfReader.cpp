@@ -67,8 +67,13 @@ InstrProfReader::create(std::unique_ptr<MemoryBuffer> Buffer) {
 
 ErrorOr<std::unique_ptr<IndexedInstrProfReader>>
 IndexedInstrProfReader::create(std::string Path) {
-  // Set up the buffer to read.
-  auto BufferOrError = setupMemoryBuffer(Path);
+  // Set up the buffer to read. The indexed format is only ever looked up in,
+  // so map the file whatever its size instead of copying it to add a null
+  // terminator.
+  ErrorOr<std::unique_ptr<MemoryBuffer>> BufferOrError =
+      Path == "-" ? MemoryBuffer::getSTDIN()
+                  : MemoryBuffer::getFile(Path, /*FileSize=*/-1,
+                                          /*RequiresNullTerminator=*/false);
   if (std::error_code EC = BufferOrError.getError())
     return EC;
   return IndexedInstrProfReader::create(std::move(BufferOrError.get()));
@@ -312,7 +317,6 @@ data_type InstrProfLookupTrait::ReadData(StringRef K, const unsigned char *D,
   DataBuffer.clear();
   uint64_t NumCounts;
   uint64_t NumEntries = N / sizeof(uint64_t);
-  std::vector<uint64_t> CounterBuffer;
   for (uint64_t I = 0; I < NumEntries; I += NumCounts) {
     using namespace support;
     // The function hash comes first.
@@ -333,11 +337,12 @@ data_type InstrProfLookupTrait::ReadData(StringRef K, const unsigned char *D,
     if (I + NumCounts > NumEntries)
       return data_type();
 
-    CounterBuffer.clear();
-    for (unsigned J = 0; J < NumCounts; ++J)
-      CounterBuffer.push_back(endian::readNext<uint64_t, little, unaligned>(D));
-
-    DataBuffer.push_back(InstrProfRecord(K, Hash, std::move(CounterBuffer)));
+    // The counts are little endian and need not be aligned, which is how
+    // ulittle64_t reads them, so refer to them where they are.
+    DataBuffer.push_back(InstrProfRecordRef(
+        K, Hash, makeArrayRef(reinterpret_cast<const ulittle64_t *>(D),
+                              NumCounts)));
+    D += NumCounts * sizeof(uint64_t);
   }
   return DataBuffer;
 }
@@ -392,17 +397,27 @@ std::error_code IndexedInstrProfReader::readHeader() {
 
 std::error_code IndexedInstrProfReader::getFunctionCounts(
     StringRef FuncName, uint64_t FuncHash, std::vector<uint64_t> &Counts) {
+  ArrayRef<support::ulittle64_t> CountsRef;
+  if (std::error_code EC = getFunctionCounts(FuncName, FuncHash, CountsRef))
+    return EC;
+  Counts.assign(CountsRef.begin(), CountsRef.end());
+  return success();
+}
+
+std::error_code IndexedInstrProfReader::getFunctionCounts(
+    StringRef FuncName, uint64_t FuncHash,
+    ArrayRef<support::ulittle64_t> &Counts) {
   auto Iter = Index->find(FuncName);
   if (Iter == Index->end())
     return error(instrprof_error::unknown_function);
 
   // Found it. Look for counters with the right hash.
-  ArrayRef<InstrProfRecord> Data = (*Iter);
+  ArrayRef<InstrProfRecordRef> Data = (*Iter);
   if (Data.empty())
     return error(instrprof_error::malformed);
 
   for (unsigned I = 0, E = Data.size(); I < E; ++I) {
-    // Check for a match and fill the vector if there is one.
+    // Check for a match and point at the counts if there is one.
     if (Data[I].Hash == FuncHash) {
       Counts = Data[I].Counts;
       return success();
@@ -421,8 +436,11 @@ IndexedInstrProfReader::readNextRecord(InstrProfRecord &Record) {
     return error(instrprof_error::malformed);
 
   static unsigned RecordIndex = 0;
-  ArrayRef<InstrProfRecord> Data = (*RecordIterator);
-  Record = Data[RecordIndex++];
+  ArrayRef<InstrProfRecordRef> Data = (*RecordIterator);
+  const InstrProfRecordRef &Ref = Data[RecordIndex++];
+  Record.Name = Ref.Name;
+  Record.Hash = Ref.Hash;
+  Record.Counts.assign(Ref.Counts.begin(), Ref.Counts.end());
   if (RecordIndex >= Data.size()) {
     ++RecordIterator;
     RecordIndex = 0;
@@ -106,6 +106,29 @@ InstrProfWriter::addFunctionCounts(StringRef FunctionName,
   return instrprof_error::success;
 }
 
+void InstrProfWriter::mergeRecordsFromWriter(
+    InstrProfWriter &&IPW,
+    function_ref<void(StringRef, std::error_code)> Warn) {
+  for (auto &I : IPW.FunctionData) {
+    auto Inserted = FunctionData.insert(
+        std::make_pair(I.getKey(), CounterData()));
+    if (Inserted.second) {
+      // A function we have not seen yet: take its counts as they are.
+      Inserted.first->second = std::move(I.getValue());
+      for (const auto &Counts : Inserted.first->second)
+        if (Counts.second[0] > MaxFunctionCount)
+          MaxFunctionCount = Counts.second[0];
+      continue;
+    }
+    for (auto &Counts : I.getValue())
+      if (std::error_code EC =
+              addFunctionCounts(I.getKey(), Counts.first, Counts.second))
+        Warn(I.getKey(), EC);
+  }
+  IPW.FunctionData.clear();
+  IPW.MaxFunctionCount = 0;
+}
+
 std::pair<uint64_t, uint64_t> InstrProfWriter::writeImpl(raw_ostream &OS) {
   OnDiskChainedHashTableGenerator<InstrProfRecordTrait> Generator;
 
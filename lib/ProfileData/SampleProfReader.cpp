@@ -8,10 +8,11 @@
 //===----------------------------------------------------------------------===//
 //
 // This file implements the class that reads LLVM sample profiles. It
-// supports two file formats: text and binary. The textual representation
-// is useful for debugging and testing purposes. The binary representation
-// is more compact, resulting in smaller file sizes. However, they can
-// both be used interchangeably.
+// supports three file formats: text, binary and indexed binary. The textual
+// representation is useful for debugging and testing purposes. The binary
+// representation is more compact, resulting in smaller file sizes. The
+// indexed binary representation lets the compiler read the profiles of the
+// functions it compiles only. However, they can all be used interchangeably.
 //
 // NOTE: If you are making changes to the file format, please remember
 //       to document them in the Clang documentation at
@@ -92,6 +93,18 @@
 //    instruction that calls one of ``foo()``, ``bar()`` and ``baz()``,
 //    with ``baz()`` being the relatively more frequently called target.
 //
+// Indexed binary format
+// ---------------------
+//
+// The indexed binary format starts with the same header as the binary
+// format, with a magic number of its own. The profile of each function
+// follows, encoded as in the binary format but without the function name.
+// After the profiles comes an on-disk hash table mapping each function name
+// to the offset of its profile, and the file ends with two little endian
+// 64-bit words: the offsets of the entries and of the buckets of the table.
+// This lets the compiler decode the profiles of the functions of the module
+// it compiles only, rather than those of the whole program.
+//
 //===----------------------------------------------------------------------===//
 
 #include "llvm/ProfileData/SampleProfReader.h"
@@ -101,6 +114,7 @@
 #include "llvm/Support/LineIterator.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Regex.h"
+#include <algorithm>
 
 using namespace llvm::sampleprof;
 using namespace llvm;
@@ -119,8 +133,13 @@ void FunctionSamples::print(raw_ostream &OS) {
        << ", number of samples: " << Sample.getSamples();
     if (Sample.hasCalls()) {
       OS << ", calls:";
+      // Print the targets by name, rather than in hash table order.
+      SmallVector<std::pair<StringRef, unsigned>, 8> Targets;
       for (const auto &I : Sample.getCallTargets())
-        OS << " " << I.first() << ":" << I.second;
+        Targets.push_back(std::make_pair(I.first(), I.second));
+      std::sort(Targets.begin(), Targets.end());
+      for (const auto &I : Targets)
+        OS << " " << I.first << ":" << I.second;
     }
     OS << "\n";
   }
@@ -139,8 +158,13 @@ void SampleProfileReader::dumpFunctionProfile(StringRef FName,
 
 /// \brief Dump all the function profiles found on stream \p OS.
 void SampleProfileReader::dump(raw_ostream &OS) {
+  // Dump the functions by name, rather than in hash table order.
+  std::vector<StringRef> Names;
   for (const auto &I : Profiles)
-    dumpFunctionProfile(I.getKey(), OS);
+    Names.push_back(I.getKey());
+  std::sort(Names.begin(), Names.end());
+  for (StringRef Name : Names)
+    dumpFunctionProfile(Name, OS);
 }
 
 /// \brief Load samples from a text file.
@@ -264,68 +288,77 @@ ErrorOr<StringRef> SampleProfileReaderBinary::readString() {
   return Str;
 }
 
-std::error_code SampleProfileReaderBinary::read() {
-  while (!at_eof()) {
-    auto FName(readString());
-    if (std::error_code EC = FName.getError())
-      return EC;
+std::error_code SampleProfileReaderBinary::readProfile(FunctionSamples &FProfile) {
+  auto Val = readNumber<unsigned>();
+  if (std::error_code EC = Val.getError())
+    return EC;
+  FProfile.addTotalSamples(*Val);
 
-    Profiles[*FName] = FunctionSamples();
-    FunctionSamples &FProfile = Profiles[*FName];
+  Val = readNumber<unsigned>();
+  if (std::error_code EC = Val.getError())
+    return EC;
+  FProfile.addHeadSamples(*Val);
 
-    auto Val = readNumber<unsigned>();
-    if (std::error_code EC = Val.getError())
+  // Read the samples in the body.
+  auto NumRecords = readNumber<unsigned>();
+  if (std::error_code EC = NumRecords.getError())
+    return EC;
+  for (unsigned I = 0; I < *NumRecords; ++I) {
+    auto LineOffset = readNumber<uint64_t>();
+    if (std::error_code EC = LineOffset.getError())
       return EC;
-    FProfile.addTotalSamples(*Val);
 
-    Val = readNumber<unsigned>();
-    if (std::error_code EC = Val.getError())
+    auto Discriminator = readNumber<uint64_t>();
+    if (std::error_code EC = Discriminator.getError())
       return EC;
-    FProfile.addHeadSamples(*Val);
 
-    // Read the samples in the body.
-    auto NumRecords = readNumber<unsigned>();
-    if (std::error_code EC = NumRecords.getError())
+    auto NumSamples = readNumber<uint64_t>();
+    if (std::error_code EC = NumSamples.getError())
       return EC;
-    for (unsigned I = 0; I < *NumRecords; ++I) {
-      auto LineOffset = readNumber<uint64_t>();
-      if (std::error_code EC = LineOffset.getError())
-        return EC;
 
-      auto Discriminator = readNumber<uint64_t>();
-      if (std::error_code EC = Discriminator.getError())
-        return EC;
+    auto NumCalls = readNumber<unsigned>();
+    if (std::error_code EC = NumCalls.getError())
+      return EC;
 
-      auto NumSamples = readNumber<uint64_t>();
-      if (std::error_code EC = NumSamples.getError())
+    for (unsigned J = 0; J < *NumCalls; ++J) {
+      auto CalledFunction(readString());
+      if (std::error_code EC = CalledFunction.getError())
         return EC;
 
-      auto NumCalls = readNumber<unsigned>();
-      if (std::error_code EC = NumCalls.getError())
+      auto CalledFunctionSamples = readNumber<uint64_t>();
+      if (std::error_code EC = CalledFunctionSamples.getError())
         return EC;
 
-      for (unsigned J = 0; J < *NumCalls; ++J) {
-        auto CalledFunction(readString());
-        if (std::error_code EC = CalledFunction.getError())
-          return EC;
+      FProfile.addCalledTargetSamples(*LineOffset, *Discriminator,
+                                      *CalledFunction,
+                                      *CalledFunctionSamples);
+    }
 
-        auto CalledFunctionSamples = readNumber<uint64_t>();
-        if (std::error_code EC = CalledFunctionSamples.getError())
-          return EC;
+    FProfile.addBodySamples(*LineOffset, *Discriminator, *NumSamples);
+  }
 
-        FProfile.addCalledTargetSamples(*LineOffset, *Discriminator,
-                                        *CalledFunction,
-                                        *CalledFunctionSamples);
-      }
+  return sampleprof_error::success;
+}
 
-      FProfile.addBodySamples(*LineOffset, *Discriminator, *NumSamples);
-    }
+std::error_code SampleProfileReaderBinary::read() {
+  while (!at_eof()) {
+    auto FName(readString());
+    if (std::error_code EC = FName.getError())
+      return EC;
+
+    Profiles[*FName] = FunctionSamples();
+    if (std::error_code EC = readProfile(Profiles[*FName]))
+      return EC;
   }
 
   return sampleprof_error::success;
 }
 
 std::error_code SampleProfileReaderBinary::readHeader() {
+  return readHeader(SPMagic());
+}
+
+std::error_code SampleProfileReaderBinary::readHeader(uint64_t ExpectedMagic) {
   Data = reinterpret_cast<const uint8_t *>(Buffer->getBufferStart());
   End = Data + Buffer->getBufferSize();
 
@@ -333,7 +366,7 @@ std::error_code SampleProfileReaderBinary::readHeader() {
   auto Magic = readNumber<uint64_t>();
   if (std::error_code EC = Magic.getError())
     return EC;
-  else if (*Magic != SPMagic())
+  else if (*Magic != ExpectedMagic)
     return sampleprof_error::bad_magic;
 
   // Read the version number.
@@ -353,6 +386,81 @@ bool SampleProfileReaderBinary::hasFormat(const MemoryBuffer &Buffer) {
   return Magic == SPMagic();
 }
 
+std::error_code SampleProfileReaderIndexed::readHeader() {
+  if (std::error_code EC = SampleProfileReaderBinary::readHeader(
+          SPIndexedMagic()))
+    return EC;
+
+  // The offsets of the index are the last two words of the file.
+  using namespace support;
+  const uint8_t *Start =
+      reinterpret_cast<const uint8_t *>(Buffer->getBufferStart());
+  const uint64_t TrailerSize = 2 * sizeof(uint64_t);
+  if (uint64_t(End - Data) < TrailerSize)
+    return sampleprof_error::truncated;
+  const uint8_t *Trailer = End - TrailerSize;
+  uint64_t PayloadStart = endian::readNext<uint64_t, little, unaligned>(Trailer);
+  uint64_t BucketsStart = endian::readNext<uint64_t, little, unaligned>(Trailer);
+  uint64_t IndexEnd = End - TrailerSize - Start;
+  if (PayloadStart < uint64_t(Data - Start) || PayloadStart > BucketsStart ||
+      BucketsStart + 2 * sizeof(uint64_t) > IndexEnd || BucketsStart % 4)
+    return sampleprof_error::malformed;
+
+  ProfilesEnd = Start + PayloadStart;
+  Index.reset(SampleProfReaderIndex::Create(
+      Start + BucketsStart, Start + PayloadStart, Start));
+  return sampleprof_error::success;
+}
+
+std::error_code SampleProfileReaderIndexed::readProfileAt(StringRef FName,
+                                                          uint64_t Offset) {
+  const uint8_t *Start =
+      reinterpret_cast<const uint8_t *>(Buffer->getBufferStart());
+  if (Offset >= uint64_t(ProfilesEnd - Start)) {
+    reportParseError(0, "malformed index");
+    return sampleprof_error::malformed;
+  }
+
+  Data = Start + Offset;
+  End = ProfilesEnd;
+  Profiles[FName] = FunctionSamples();
+  return readProfile(Profiles[FName]);
+}
+
+std::error_code SampleProfileReaderIndexed::read() {
+  for (auto I = Index->data_begin(), E = Index->data_end(); I != E; ++I) {
+    SampleProfLookupTrait::data_type Entry = *I;
+    if (std::error_code EC = readProfileAt(Entry.first, Entry.second))
+      return EC;
+  }
+  return sampleprof_error::success;
+}
+
+std::error_code SampleProfileReaderIndexed::readFunctionProfile(StringRef FName) {
+  auto I = Index->find(FName);
+  if (I == Index->end())
+    return sampleprof_error::success;
+  return readProfileAt(FName, (*I).second);
+}
+
+std::error_code
+SampleProfileReaderIndexed::readModuleProfiles(const Module &M) {
+  for (const Function &F : M) {
+    if (F.isDeclaration())
+      continue;
+    if (std::error_code EC = readFunctionProfile(F.getName()))
+      return EC;
+  }
+  return sampleprof_error::success;
+}
+
+bool SampleProfileReaderIndexed::hasFormat(const MemoryBuffer &Buffer) {
+  const uint8_t *Data =
+      reinterpret_cast<const uint8_t *>(Buffer.getBufferStart());
+  uint64_t Magic = decodeULEB128(Data);
+  return Magic == SPIndexedMagic();
+}
+
 /// \brief Prepare a memory buffer for the contents of \p Filename.
 ///
 /// \returns an error code indicating the status of the buffer.
@@ -387,7 +495,9 @@ SampleProfileReader::create(StringRef Filename, LLVMContext &C) {
 
   auto Buffer = std::move(BufferOrError.get());
   std::unique_ptr<SampleProfileReader> Reader;
-  if (SampleProfileReaderBinary::hasFormat(*Buffer))
+  if (SampleProfileReaderIndexed::hasFormat(*Buffer))
+    Reader.reset(new SampleProfileReaderIndexed(std::move(Buffer), C));
+  else if (SampleProfileReaderBinary::hasFormat(*Buffer))
     Reader.reset(new SampleProfileReaderBinary(std::move(Buffer), C));
   else
     Reader.reset(new SampleProfileReaderText(std::move(Buffer), C));
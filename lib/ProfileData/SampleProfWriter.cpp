@@ -8,10 +8,11 @@
 //===----------------------------------------------------------------------===//
 //
 // This file implements the class that writes LLVM sample profiles. It
-// supports two file formats: text and binary. The textual representation
-// is useful for debugging and testing purposes. The binary representation
-// is more compact, resulting in smaller file sizes. However, they can
-// both be used interchangeably.
+// supports three file formats: text, binary and indexed binary. The textual
+// representation is useful for debugging and testing purposes. The binary
+// representation is more compact, resulting in smaller file sizes. The
+// indexed binary representation lets the compiler read the profiles of the
+// functions it compiles only. However, they can all be used interchangeably.
 //
 // See lib/ProfileData/SampleProfReader.cpp for documentation on each of the
 // supported formats.
@@ -24,7 +25,9 @@
 #include "llvm/Support/LEB128.h"
 #include "llvm/Support/LineIterator.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/OnDiskHashTable.h"
 #include "llvm/Support/Regex.h"
+#include <algorithm>
 
 using namespace llvm::sampleprof;
 using namespace llvm;
@@ -47,8 +50,13 @@ bool SampleProfileWriterText::write(StringRef FName, const FunctionSamples &S) {
 
     OS << Sample.getSamples();
 
+    // Write the targets by name, rather than in hash table order.
+    SmallVector<std::pair<StringRef, unsigned>, 8> Targets;
     for (const auto &J : Sample.getCallTargets())
-      OS << " " << J.first() << ":" << J.second;
+      Targets.push_back(std::make_pair(J.first(), J.second));
+    std::sort(Targets.begin(), Targets.end());
+    for (const auto &J : Targets)
+      OS << " " << J.first << ":" << J.second;
     OS << "\n";
   }
 
@@ -56,13 +64,14 @@ bool SampleProfileWriterText::write(StringRef FName, const FunctionSamples &S) {
 }
 
 SampleProfileWriterBinary::SampleProfileWriterBinary(StringRef F,
-                                                     std::error_code &EC)
+                                                     std::error_code &EC,
+                                                     uint64_t Magic)
     : SampleProfileWriter(F, EC, sys::fs::F_None) {
   if (EC)
     return;
 
   // Write the file header.
-  encodeULEB128(SPMagic(), OS);
+  encodeULEB128(Magic, OS);
   encodeULEB128(SPVersion(), OS);
 }
 
@@ -76,6 +85,11 @@ bool SampleProfileWriterBinary::write(StringRef FName,
 
   OS << FName;
   encodeULEB128(0, OS);
+  writeBody(S);
+  return true;
+}
+
+void SampleProfileWriterBinary::writeBody(const FunctionSamples &S) {
   encodeULEB128(S.getTotalSamples(), OS);
   encodeULEB128(S.getHeadSamples(), OS);
   encodeULEB128(S.getBodySamples().size(), OS);
@@ -94,10 +108,77 @@ bool SampleProfileWriterBinary::write(StringRef FName,
       encodeULEB128(CalleeSamples, OS);
     }
   }
+}
+
+namespace {
+/// Trait for the on-disk hash table of the indexed binary format, mapping
+/// function names to the offset of their profile.
+class SampleProfIndexTrait {
+public:
+  typedef StringRef key_type;
+  typedef StringRef key_type_ref;
+
+  typedef uint64_t data_type;
+  typedef uint64_t data_type_ref;
+
+  typedef uint64_t hash_value_type;
+  typedef uint64_t offset_type;
+
+  static hash_value_type ComputeHash(key_type_ref K) { return SPIndexHash(K); }
+
+  static std::pair<offset_type, offset_type>
+  EmitKeyDataLength(raw_ostream &Out, key_type_ref K, data_type_ref) {
+    using namespace llvm::support;
+    endian::Writer<little> LE(Out);
+
+    offset_type N = K.size();
+    LE.write<offset_type>(N);
+    offset_type M = sizeof(uint64_t);
+    LE.write<offset_type>(M);
+    return std::make_pair(N, M);
+  }
+
+  static void EmitKey(raw_ostream &Out, key_type_ref K, offset_type N) {
+    Out.write(K.data(), N);
+  }
 
+  static void EmitData(raw_ostream &Out, key_type_ref, data_type_ref V,
+                       offset_type) {
+    using namespace llvm::support;
+    endian::Writer<little>(Out).write<uint64_t>(V);
+  }
+};
+}
+
+/// \brief Write samples to an indexed binary file.
+///
+/// \returns true if the samples were written successfully, false otherwise.
+bool SampleProfileWriterIndexed::write(StringRef FName,
+                                       const FunctionSamples &S) {
+  if (S.empty())
+    return true;
+
+  Offsets[FName] = OS.tell();
+  writeBody(S);
   return true;
 }
 
+SampleProfileWriterIndexed::~SampleProfileWriterIndexed() {
+  // Write the index, then where to find it, at the very end of the file so
+  // that the output can be streamed.
+  OnDiskChainedHashTableGenerator<SampleProfIndexTrait> Generator;
+  for (const auto &I : Offsets)
+    Generator.insert(I.getKey(), I.getValue());
+
+  uint64_t PayloadStart = OS.tell();
+  uint64_t BucketsStart = Generator.Emit(OS);
+
+  using namespace llvm::support;
+  endian::Writer<little> LE(OS);
+  LE.write<uint64_t>(PayloadStart);
+  LE.write<uint64_t>(BucketsStart);
+}
+
 /// \brief Create a sample profile writer based on the specified format.
 ///
 /// \param Filename The file to create.
@@ -114,6 +195,8 @@ SampleProfileWriter::create(StringRef Filename, SampleProfileFormat Format) {
 
   if (Format == SPF_Binary)
     Writer.reset(new SampleProfileWriterBinary(Filename, EC));
+  else if (Format == SPF_IndexedBinary)
+    Writer.reset(new SampleProfileWriterIndexed(Filename, EC));
   else if (Format == SPF_Text)
     Writer.reset(new SampleProfileWriterText(Filename, EC));
   else
@@ -0,0 +1,149 @@
+//===- FileCache.cpp - Content-addressed file cache -----------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements FileCache, an on-disk cache of build artifacts.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/FileCache.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/Errc.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/LockFileManager.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <vector>
+
+using namespace llvm;
+
+// prune() holds a lock file of this name in the cache directory, so that the
+// processes sharing the directory take turns to prune it.
+static const char PruneLockName[] = "prune";
+
+std::string FileCache::getEntryPath(StringRef Key) const {
+  SmallString<128> Path(Directory);
+  sys::path::append(Path, Key);
+  return Path.str();
+}
+
+ErrorOr<std::unique_ptr<MemoryBuffer>>
+FileCache::lookup(StringRef Key) const {
+  std::string Path = getEntryPath(Key);
+  int FD;
+  if (std::error_code EC = sys::fs::openFileForRead(Path, FD))
+    return EC;
+
+  // Mark the entry as used for prune(). This is best effort: the cache may
+  // be shared with a user who cannot update the time.
+  sys::fs::setLastModificationAndAccessTime(FD, sys::TimeValue::now());
+
+  // Entries are never modified in place, so they can be mapped.
+  auto BufferOrErr =
+      MemoryBuffer::getOpenFile(FD, Path, /*FileSize=*/-1,
+                                /*RequiresNullTerminator=*/false);
+  sys::Process::SafelyCloseFileDescriptor(FD);
+  return BufferOrErr;
+}
+
+std::error_code FileCache::store(StringRef Key, StringRef Data) const {
+  if (std::error_code EC = sys::fs::create_directories(Directory))
+    return EC;
+
+  // Write the entry next to its final location, so that the rename below
+  // does not cross file systems and is atomic.
+  int FD;
+  SmallString<128> TempPath;
+  if (std::error_code EC =
+          sys::fs::createUniqueFile(getEntryPath(Key) + ".tmp-%%%%%%%%", FD,
+                                    TempPath))
+    return EC;
+
+  {
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    OS << Data;
+    OS.close();
+    if (OS.has_error()) {
+      OS.clear_error();
+      sys::fs::remove(TempPath);
+      return make_error_code(errc::io_error);
+    }
+  }
+
+  if (std::error_code EC = sys::fs::rename(TempPath, getEntryPath(Key))) {
+    sys::fs::remove(TempPath);
+    return EC;
+  }
+  return std::error_code();
+}
+
+std::error_code FileCache::prune(uint64_t MaxSize) const {
+  struct CacheFile {
+    std::string Path;
+    uint64_t Size;
+    sys::TimeValue Time;
+  };
+  // If another process is pruning the directory, leave it to that one. If
+  // the directory does not exist yet, there is nothing to prune.
+  LockFileManager Locked(getEntryPath(PruneLockName));
+  if (Locked.getState() != LockFileManager::LFS_Owned)
+    return std::error_code();
+
+  std::vector<CacheFile> Files;
+  uint64_t TotalSize = 0;
+  sys::TimeValue Now = sys::TimeValue::now();
+
+  std::error_code EC;
+  for (sys::fs::directory_iterator I(Directory, EC), E; !EC && I != E;
+       I.increment(EC)) {
+    sys::fs::file_status Status;
+    StringRef Name = sys::path::filename(I->path());
+    if (Name.startswith(PruneLockName) ||
+        I->status(Status) || !sys::fs::is_regular_file(Status))
+      continue;
+    // Leave the temporary files of stores that may still be in progress to
+    // the process that is about to rename them. Older ones were abandoned by
+    // a process that died, and are removed like any other file.
+    if (Name.find(".tmp-") != StringRef::npos &&
+        Now - Status.getLastModificationTime() <
+            sys::TimeValue(TempFileGracePeriod, 0))
+      continue;
+    Files.push_back({I->path(), Status.getSize(),
+                     Status.getLastModificationTime()});
+    TotalSize += Status.getSize();
+  }
+  if (EC)
+    return EC == errc::no_such_file_or_directory ? std::error_code() : EC;
+  if (TotalSize <= MaxSize)
+    return std::error_code();
+
+  std::sort(Files.begin(), Files.end(),
+            [](const CacheFile &A, const CacheFile &B) {
+              return A.Time < B.Time;
+            });
+  for (const CacheFile &File : Files) {
+    if (TotalSize <= MaxSize)
+      break;
+    // A removal that fails because another process got there first is
+    // harmless.
+    sys::fs::remove(File.Path);
+    TotalSize -= File.Size;
+  }
+  return std::error_code();
+}
+
+std::string FileCache::getKey(MD5 &Hash) {
+  MD5::MD5Result Result;
+  Hash.final(Result);
+  SmallString<32> Key;
+  MD5::stringifyResult(Result, Key);
+  return Key.str();
+}
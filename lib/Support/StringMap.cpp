@@ -9,23 +9,184 @@
 //
 // This file implements the StringMap class.
 //
+// The buckets are probed a group of up to 16 at a time. Every bucket has a
+// control byte that says whether it is empty, a tombstone, or full, and for
+// full buckets also holds 7 bits of the key's hash. A probe compares the
+// control bytes of a whole group against the hash bits at once (with SSE2
+// where available), and only looks at the full hash values and keys of the
+// buckets that match. A probe sequence ends at the first group that has an
+// empty bucket.
+//
 //===----------------------------------------------------------------------===//
 
 #include "llvm/ADT/StringMap.h"
-#include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/Compiler.h"
+#include "llvm/Support/MathExtras.h"
+#include <algorithm>
 #include <cassert>
+#include <cstring>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 using namespace llvm;
 
+namespace {
+/// Control byte values. Full buckets have the high bit set and 7 bits of the
+/// hash value in the others. Control bytes past the end of a table with fewer
+/// buckets than a group are Padding, which matches nothing.
+enum : uint8_t { Empty = 0, Tombstone = 1, Padding = 2, Full = 0x80 };
+
+const unsigned GroupWidth = 16;
+
+/// The control bytes of a group of buckets.
+class Group {
+  const uint8_t *Ctrl;
+
+public:
+  explicit Group(const uint8_t *Ctrl) : Ctrl(Ctrl) {}
+
+  /// Return a mask with bit I set if bucket I of the group has control byte
+  /// \p C.
+  unsigned match(uint8_t C) const {
+#if defined(__SSE2__)
+    __m128i Bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(Ctrl));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(Bytes, _mm_set1_epi8(C)));
+#else
+    unsigned Mask = 0;
+    for (unsigned I = 0; I != GroupWidth; ++I)
+      Mask |= unsigned(Ctrl[I] == C) << I;
+    return Mask;
+#endif
+  }
+
+  /// Return a mask of the buckets that are empty or tombstones.
+  unsigned matchAvailable() const {
+    return match(Empty) | match(Tombstone);
+  }
+};
+
+/// Walks the groups a key's probe sequence visits: the group the hash value
+/// selects and then the others in triangular order, which visits all of
+/// them because the number of groups is a power of two.
+class ProbeSequence {
+  unsigned Mask;
+  unsigned Index;
+  unsigned Stride = 0;
+
+public:
+  ProbeSequence(unsigned FullHash, unsigned NumGroups)
+      : Mask(NumGroups - 1), Index(FullHash & Mask) {}
+
+  unsigned getFirstBucket() const { return Index * GroupWidth; }
+
+  void next() {
+    ++Stride;
+    Index = (Index + Stride) & Mask;
+  }
+};
+} // end anonymous namespace
+
+static inline uint8_t getControlByte(unsigned FullHash) {
+  return Full | (FullHash >> 25);
+}
+
+static inline uint64_t read64(const char *P) {
+  uint64_t V;
+  std::memcpy(&V, P, sizeof(V));
+  return V;
+}
+
+static inline uint32_t read32(const char *P) {
+  uint32_t V;
+  std::memcpy(&V, P, sizeof(V));
+  return V;
+}
+
+static inline uint64_t hashPair(uint64_t A, uint64_t B) {
+  const uint64_t Mul = 0x9ddfea08eb382d69ULL;
+  uint64_t H = (A ^ B) * Mul;
+  H ^= H >> 47;
+  H = (B ^ H) * Mul;
+  H ^= H >> 47;
+  return H * Mul;
+}
+
+/// Hash the 16-byte blocks of a key longer than 16 bytes, the last of which
+/// overlaps the one before it. Each block is folded into two 64-bit lanes:
+/// the lane's word, mixed with a key, is split into halves that are
+/// multiplied with each other, and added together with the other lane's
+/// word.
+static uint64_t hashLongKey(const char *P, size_t Len) {
+  const uint64_t K0 = 0xbe4ba423396cfeb8ULL, K1 = 0x1cad21f72c81017cULL;
+  const size_t Last = Len - 16;
+#if defined(__SSE2__)
+  __m128i Acc = _mm_set_epi64x(Len * K1, Len);
+  const __m128i Key = _mm_set_epi64x(K1, K0);
+  for (size_t Offset = 0;; Offset += 16) {
+    if (Offset > Last)
+      Offset = Last;
+    __m128i Data =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(P + Offset));
+    __m128i Mixed = _mm_xor_si128(Data, Key);
+    __m128i High = _mm_shuffle_epi32(Mixed, _MM_SHUFFLE(0, 3, 0, 1));
+    __m128i Product = _mm_mul_epu32(Mixed, High);
+    __m128i Swapped = _mm_shuffle_epi32(Data, _MM_SHUFFLE(1, 0, 3, 2));
+    Acc = _mm_add_epi64(Acc, _mm_add_epi64(Product, Swapped));
+    if (Offset == Last)
+      break;
+  }
+  uint64_t Lanes[2];
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(Lanes), Acc);
+  return hashPair(Lanes[0], Lanes[1]);
+#else
+  uint64_t Acc0 = Len, Acc1 = Len * K1;
+  for (size_t Offset = 0;; Offset += 16) {
+    if (Offset > Last)
+      Offset = Last;
+    uint64_t D0 = read64(P + Offset), D1 = read64(P + Offset + 8);
+    uint64_t M0 = D0 ^ K0, M1 = D1 ^ K1;
+    Acc0 += (M0 & 0xffffffff) * (M0 >> 32) + D1;
+    Acc1 += (M1 & 0xffffffff) * (M1 >> 32) + D0;
+    if (Offset == Last)
+      break;
+  }
+  return hashPair(Acc0, Acc1);
+#endif
+}
+
+/// Hash a key. Unlike HashString, which the on-disk hash tables rely on, this
+/// is free to change, and it reads the key a word at a time.
+static unsigned hashKey(StringRef Key) {
+  const char *P = Key.data();
+  size_t Len = Key.size();
+  uint64_t A, B;
+  if (Len > 16) {
+    return static_cast<unsigned>(hashLongKey(P, Len));
+  } else if (Len >= 8) {
+    A = read64(P);
+    B = read64(P + Len - 8);
+  } else if (Len >= 4) {
+    A = read32(P);
+    B = read32(P + Len - 4);
+  } else if (Len > 0) {
+    A = (unsigned char)P[0] | ((unsigned char)P[Len / 2] << 8) |
+        ((unsigned char)P[Len - 1] << 16);
+    B = 0;
+  } else {
+    A = B = 0;
+  }
+  return static_cast<unsigned>(hashPair(A, B ^ (Len << 56)));
+}
+
 StringMapImpl::StringMapImpl(unsigned InitSize, unsigned itemSize) {
   ItemSize = itemSize;
-  
+
   // If a size is specified, initialize the table with that many buckets.
   if (InitSize) {
     init(InitSize);
     return;
   }
-  
+
   // Otherwise, initialize it with zero buckets to avoid the allocation.
   TheTable = nullptr;
   NumBuckets = 0;
@@ -33,79 +194,101 @@ StringMapImpl::StringMapImpl(unsigned InitSize, unsigned itemSize) {
   NumTombstones = 0;
 }
 
+/// Allocate a table of \p Size buckets, all of them empty.
+static StringMapEntryBase **allocateTable(unsigned Size) {
+  // There are at least GroupWidth control bytes, so that a group can always
+  // be loaded at once.
+  unsigned NumControlBytes = std::max(Size, GroupWidth);
+  StringMapEntryBase **Table = (StringMapEntryBase **)calloc(
+      1, (Size + 1) * (sizeof(StringMapEntryBase *) + sizeof(unsigned)) +
+             NumControlBytes);
+
+  // Allocate one extra bucket, set it to look filled so the iterators stop at
+  // end.
+  Table[Size] = (StringMapEntryBase*)2;
+
+  uint8_t *Ctrl = (uint8_t *)((unsigned *)(Table + Size + 1) + Size + 1);
+  std::memset(Ctrl + Size, Padding, NumControlBytes - Size);
+  return Table;
+}
+
 void StringMapImpl::init(unsigned InitSize) {
   assert((InitSize & (InitSize-1)) == 0 &&
          "Init Size must be a power of 2 or zero!");
   NumBuckets = InitSize ? InitSize : 16;
   NumItems = 0;
   NumTombstones = 0;
-  
-  TheTable = (StringMapEntryBase **)calloc(NumBuckets+1,
-                                           sizeof(StringMapEntryBase **) +
-                                           sizeof(unsigned));
+  TheTable = allocateTable(NumBuckets);
+}
 
-  // Allocate one extra bucket, set it to look filled so the iterators stop at
-  // end.
-  TheTable[NumBuckets] = (StringMapEntryBase*)2;
+unsigned *StringMapImpl::getHashTable() const {
+  return (unsigned *)(TheTable + NumBuckets + 1);
+}
+
+uint8_t *StringMapImpl::getControlBytes() const {
+  return (uint8_t *)(getHashTable() + NumBuckets + 1);
 }
 
+void StringMapImpl::resetBuckets() {
+  std::memset(TheTable, 0, NumBuckets * sizeof(StringMapEntryBase *));
+  std::memset(getControlBytes(), Empty, NumBuckets);
+  NumItems = 0;
+  NumTombstones = 0;
+}
 
 /// LookupBucketFor - Look up the bucket that the specified string should end
 /// up in.  If it already exists as a key in the map, the Item pointer for the
-/// specified bucket will be non-null.  Otherwise, it will be null.  In either
-/// case, the FullHashValue field of the bucket will be set to the hash value
-/// of the string.
+/// specified bucket will be non-null.  Otherwise, it will be null or a
+/// tombstone, and the caller must fill it.  In either case, the FullHashValue
+/// field of the bucket will be set to the hash value of the string.
 unsigned StringMapImpl::LookupBucketFor(StringRef Name) {
-  unsigned HTSize = NumBuckets;
-  if (HTSize == 0) {  // Hash table unallocated so far?
+  if (NumBuckets == 0)  // Hash table unallocated so far?
     init(16);
-    HTSize = NumBuckets;
-  }
-  unsigned FullHashValue = HashString(Name);
-  unsigned BucketNo = FullHashValue & (HTSize-1);
-  unsigned *HashTable = (unsigned *)(TheTable + NumBuckets + 1);
+  unsigned FullHashValue = hashKey(Name);
+  uint8_t H2 = getControlByte(FullHashValue);
+  unsigned *HashTable = getHashTable();
+  uint8_t *Ctrl = getControlBytes();
 
-  unsigned ProbeAmt = 1;
-  int FirstTombstone = -1;
+  ProbeSequence Probe(FullHashValue,
+                      std::max(NumBuckets / GroupWidth, 1u));
+  int FirstAvailable = -1;
   while (1) {
-    StringMapEntryBase *BucketItem = TheTable[BucketNo];
-    // If we found an empty bucket, this key isn't in the table yet, return it.
-    if (LLVM_LIKELY(!BucketItem)) {
-      // If we found a tombstone, we want to reuse the tombstone instead of an
-      // empty bucket.  This reduces probing.
-      if (FirstTombstone != -1) {
-        HashTable[FirstTombstone] = FullHashValue;
-        return FirstTombstone;
-      }
-      
-      HashTable[BucketNo] = FullHashValue;
-      return BucketNo;
-    }
-    
-    if (BucketItem == getTombstoneVal()) {
-      // Skip over tombstones.  However, remember the first one we see.
-      if (FirstTombstone == -1) FirstTombstone = BucketNo;
-    } else if (LLVM_LIKELY(HashTable[BucketNo] == FullHashValue)) {
+    unsigned First = Probe.getFirstBucket();
+    Group G(Ctrl + First);
+
+    for (unsigned Match = G.match(H2); Match; Match &= Match - 1) {
+      unsigned BucketNo = First + countTrailingZeros(Match);
       // If the full hash value matches, check deeply for a match.  The common
-      // case here is that we are only looking at the buckets (for item info
-      // being non-null and for the full hash value) not at the items.  This
-      // is important for cache locality.
-      
-      // Do the comparison like this because Name isn't necessarily
-      // null-terminated!
-      char *ItemStr = (char*)BucketItem+ItemSize;
-      if (Name == StringRef(ItemStr, BucketItem->getKeyLength())) {
-        // We found a match!
-        return BucketNo;
+      // case here is that we are only looking at the control bytes and the
+      // full hash values, not at the items.  This is important for cache
+      // locality.
+      if (LLVM_LIKELY(HashTable[BucketNo] == FullHashValue)) {
+        // Do the comparison like this because Name isn't necessarily
+        // null-terminated!
+        StringMapEntryBase *BucketItem = TheTable[BucketNo];
+        char *ItemStr = (char*)BucketItem+ItemSize;
+        if (Name == StringRef(ItemStr, BucketItem->getKeyLength())) {
+          // We found a match!
+          return BucketNo;
+        }
       }
     }
-    
-    // Okay, we didn't find the item.  Probe to the next bucket.
-    BucketNo = (BucketNo+ProbeAmt) & (HTSize-1);
-    
-    // Use quadratic probing, it has fewer clumping artifacts than linear
-    // probing and has good cache behavior in the common case.
-    ++ProbeAmt;
+
+    // Remember the first bucket we could put the key in. Reusing a tombstone
+    // instead of an empty bucket reduces probing.
+    if (FirstAvailable == -1)
+      if (unsigned Available = G.matchAvailable())
+        FirstAvailable = First + countTrailingZeros(Available);
+
+    // If the group has an empty bucket, this key isn't in the table yet.
+    if (LLVM_LIKELY(G.match(Empty))) {
+      HashTable[FirstAvailable] = FullHashValue;
+      Ctrl[FirstAvailable] = H2;
+      return FirstAvailable;
+    }
+
+    // Okay, we didn't find the item.  Probe the next group.
+    Probe.next();
   }
 }
 
@@ -114,42 +297,38 @@ unsigned StringMapImpl::LookupBucketFor(StringRef Name) {
 /// in the map, return the bucket number of the key.  Otherwise return -1.
 /// This does not modify the map.
 int StringMapImpl::FindKey(StringRef Key) const {
-  unsigned HTSize = NumBuckets;
-  if (HTSize == 0) return -1;  // Really empty table?
-  unsigned FullHashValue = HashString(Key);
-  unsigned BucketNo = FullHashValue & (HTSize-1);
-  unsigned *HashTable = (unsigned *)(TheTable + NumBuckets + 1);
+  if (NumBuckets == 0) return -1;  // Really empty table?
+  unsigned FullHashValue = hashKey(Key);
+  uint8_t H2 = getControlByte(FullHashValue);
+  unsigned *HashTable = getHashTable();
+  uint8_t *Ctrl = getControlBytes();
 
-  unsigned ProbeAmt = 1;
+  ProbeSequence Probe(FullHashValue,
+                      std::max(NumBuckets / GroupWidth, 1u));
   while (1) {
-    StringMapEntryBase *BucketItem = TheTable[BucketNo];
-    // If we found an empty bucket, this key isn't in the table yet, return.
-    if (LLVM_LIKELY(!BucketItem))
-      return -1;
-    
-    if (BucketItem == getTombstoneVal()) {
-      // Ignore tombstones.
-    } else if (LLVM_LIKELY(HashTable[BucketNo] == FullHashValue)) {
-      // If the full hash value matches, check deeply for a match.  The common
-      // case here is that we are only looking at the buckets (for item info
-      // being non-null and for the full hash value) not at the items.  This
-      // is important for cache locality.
-      
-      // Do the comparison like this because NameStart isn't necessarily
-      // null-terminated!
-      char *ItemStr = (char*)BucketItem+ItemSize;
-      if (Key == StringRef(ItemStr, BucketItem->getKeyLength())) {
-        // We found a match!
-        return BucketNo;
+    unsigned First = Probe.getFirstBucket();
+    Group G(Ctrl + First);
+
+    for (unsigned Match = G.match(H2); Match; Match &= Match - 1) {
+      unsigned BucketNo = First + countTrailingZeros(Match);
+      if (LLVM_LIKELY(HashTable[BucketNo] == FullHashValue)) {
+        // Do the comparison like this because NameStart isn't necessarily
+        // null-terminated!
+        StringMapEntryBase *BucketItem = TheTable[BucketNo];
+        char *ItemStr = (char*)BucketItem+ItemSize;
+        if (Key == StringRef(ItemStr, BucketItem->getKeyLength())) {
+          // We found a match!
+          return BucketNo;
+        }
       }
     }
-    
-    // Okay, we didn't find the item.  Probe to the next bucket.
-    BucketNo = (BucketNo+ProbeAmt) & (HTSize-1);
-    
-    // Use quadratic probing, it has fewer clumping artifacts than linear
-    // probing and has good cache behavior in the common case.
-    ++ProbeAmt;
+
+    // If the group has an empty bucket, this key isn't in the table.
+    if (LLVM_LIKELY(G.match(Empty)))
+      return -1;
+
+    // Okay, we didn't find the item.  Probe the next group.
+    Probe.next();
   }
 }
 
@@ -167,10 +346,23 @@ void StringMapImpl::RemoveKey(StringMapEntryBase *V) {
 StringMapEntryBase *StringMapImpl::RemoveKey(StringRef Key) {
   int Bucket = FindKey(Key);
   if (Bucket == -1) return nullptr;
-  
+
   StringMapEntryBase *Result = TheTable[Bucket];
-  TheTable[Bucket] = getTombstoneVal();
   --NumItems;
+
+  // Empty buckets are only ever created in groups that already have one.
+  // Such a group has never been full, so no probe sequence continues past
+  // it, and the bucket can be emptied instead of becoming a tombstone.
+  uint8_t *Ctrl = getControlBytes();
+  unsigned First = Bucket & ~(GroupWidth - 1);
+  if (Group(Ctrl + First).match(Empty)) {
+    TheTable[Bucket] = nullptr;
+    Ctrl[Bucket] = Empty;
+    return Result;
+  }
+
+  TheTable[Bucket] = getTombstoneVal();
+  Ctrl[Bucket] = Tombstone;
   ++NumTombstones;
   assert(NumItems + NumTombstones <= NumBuckets);
 
@@ -183,7 +375,7 @@ StringMapEntryBase *StringMapImpl::RemoveKey(StringRef Key) {
 /// the appropriate mod-of-hashtable-size.
 unsigned StringMapImpl::RehashTable(unsigned BucketNo) {
   unsigned NewSize;
-  unsigned *HashTable = (unsigned *)(TheTable + NumBuckets + 1);
+  unsigned *HashTable = getHashTable();
 
   // If the hash table is now more than 3/4 full, or if fewer than 1/8 of
   // the buckets are empty (meaning that many are filled with tombstones),
@@ -198,46 +390,36 @@ unsigned StringMapImpl::RehashTable(unsigned BucketNo) {
   }
 
   unsigned NewBucketNo = BucketNo;
-  // Allocate one extra bucket which will always be non-empty.  This allows the
-  // iterators to stop at end.
-  StringMapEntryBase **NewTableArray =
-    (StringMapEntryBase **)calloc(NewSize+1, sizeof(StringMapEntryBase *) +
-                                             sizeof(unsigned));
+  StringMapEntryBase **NewTableArray = allocateTable(NewSize);
   unsigned *NewHashArray = (unsigned *)(NewTableArray + NewSize + 1);
-  NewTableArray[NewSize] = (StringMapEntryBase*)2;
+  uint8_t *NewCtrl = (uint8_t *)(NewHashArray + NewSize + 1);
+  unsigned NewNumGroups = std::max(NewSize / GroupWidth, 1u);
 
   // Rehash all the items into their new buckets.  Luckily :) we already have
   // the hash values available, so we don't have to rehash any strings.
   for (unsigned I = 0, E = NumBuckets; I != E; ++I) {
     StringMapEntryBase *Bucket = TheTable[I];
     if (Bucket && Bucket != getTombstoneVal()) {
-      // Fast case, bucket available.
       unsigned FullHash = HashTable[I];
-      unsigned NewBucket = FullHash & (NewSize-1);
-      if (!NewTableArray[NewBucket]) {
-        NewTableArray[FullHash & (NewSize-1)] = Bucket;
-        NewHashArray[FullHash & (NewSize-1)] = FullHash;
-        if (I == BucketNo)
-          NewBucketNo = NewBucket;
-        continue;
-      }
-      
-      // Otherwise probe for a spot.
-      unsigned ProbeSize = 1;
-      do {
-        NewBucket = (NewBucket + ProbeSize++) & (NewSize-1);
-      } while (NewTableArray[NewBucket]);
-      
+      ProbeSequence Probe(FullHash, NewNumGroups);
+      unsigned Available;
+      while (!(Available = Group(NewCtrl + Probe.getFirstBucket())
+                               .match(Empty)))
+        Probe.next();
+
       // Finally found a slot.  Fill it in.
+      unsigned NewBucket =
+          Probe.getFirstBucket() + countTrailingZeros(Available);
       NewTableArray[NewBucket] = Bucket;
       NewHashArray[NewBucket] = FullHash;
+      NewCtrl[NewBucket] = getControlByte(FullHash);
       if (I == BucketNo)
         NewBucketNo = NewBucket;
     }
   }
-  
+
   free(TheTable);
-  
+
   TheTable = NewTableArray;
   NumBuckets = NewSize;
   NumTombstones = 0;
@@ -0,0 +1,227 @@
+//===-- llvm/Support/ThreadPool.cpp - A work-stealing thread pool ---------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the ThreadPool and TaskGroup classes.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/ManagedStatic.h"
+#include <atomic>
+#include <cassert>
+#include <chrono>
+
+using namespace llvm;
+
+static std::atomic<unsigned> MaxThreadCount(0);
+
+void llvm::setMaxThreadCount(unsigned Limit) { MaxThreadCount = Limit; }
+
+unsigned llvm::getMaxThreadCount() { return MaxThreadCount; }
+
+static unsigned clampThreadCount(unsigned Count) {
+  unsigned Limit = MaxThreadCount;
+  if (Limit && Count > Limit)
+    Count = Limit;
+  return Count ? Count : 1;
+}
+
+unsigned llvm::getDefaultThreadCount() {
+#if LLVM_ENABLE_THREADS
+  return clampThreadCount(std::thread::hardware_concurrency());
+#else
+  return 1;
+#endif
+}
+
+static ManagedStatic<ThreadPool> DefaultThreadPool;
+
+ThreadPool &llvm::getDefaultThreadPool() { return *DefaultThreadPool; }
+
+#if LLVM_ENABLE_THREADS
+
+ThreadPool::ThreadPool(unsigned ThreadCount)
+    : ThreadCount(ThreadCount ? clampThreadCount(ThreadCount)
+                              : getDefaultThreadCount()),
+      QueuedTasks(0), ActiveTasks(0), NextQueue(0), Stopping(false) {
+  Queues.reserve(this->ThreadCount);
+  for (unsigned I = 0; I != this->ThreadCount; ++I) {
+    Queues.emplace_back(new WorkQueue());
+    Queues.back()->Index = I;
+  }
+  Threads.reserve(this->ThreadCount);
+  for (unsigned I = 0; I != this->ThreadCount; ++I)
+    Threads.emplace_back([this, I] { workerLoop(I); });
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::unique_lock<std::mutex> LockGuard(StateLock);
+    Stopping = true;
+  }
+  WorkAvailable.notify_all();
+  for (auto &Worker : Threads)
+    Worker.join();
+}
+
+bool ThreadPool::isWorkerThread() const {
+  return CurrentQueue.get() != nullptr;
+}
+
+void ThreadPool::enqueue(TaskTy Task) {
+  // Workers push onto their own deque so that recursively spawned tasks stay
+  // on the thread that produced them; other threads spread tasks round-robin.
+  const WorkQueue *Current = CurrentQueue.get();
+  unsigned Index;
+  {
+    std::unique_lock<std::mutex> LockGuard(StateLock);
+    assert(!Stopping && "Queuing a task on a pool being destroyed");
+    Index = Current ? Current->Index : NextQueue++ % ThreadCount;
+    ++QueuedTasks;
+  }
+  {
+    WorkQueue &Queue = *Queues[Index];
+    std::unique_lock<std::mutex> LockGuard(Queue.Lock);
+    Queue.Tasks.push_back(std::move(Task));
+  }
+  WorkAvailable.notify_one();
+}
+
+bool ThreadPool::runOneTask() {
+  const WorkQueue *Current = CurrentQueue.get();
+  unsigned Self = Current ? Current->Index : 0;
+  TaskTy Task;
+  for (unsigned I = 0; I != ThreadCount && !Task; ++I) {
+    WorkQueue &Queue = *Queues[(Self + I) % ThreadCount];
+    std::unique_lock<std::mutex> LockGuard(Queue.Lock);
+    if (Queue.Tasks.empty())
+      continue;
+    // Take the newest task from our own deque, steal the oldest otherwise.
+    if (Current && I == 0) {
+      Task = std::move(Queue.Tasks.back());
+      Queue.Tasks.pop_back();
+    } else {
+      Task = std::move(Queue.Tasks.front());
+      Queue.Tasks.pop_front();
+    }
+  }
+  if (!Task)
+    return false;
+
+  {
+    std::unique_lock<std::mutex> LockGuard(StateLock);
+    --QueuedTasks;
+    ++ActiveTasks;
+  }
+  Task();
+  {
+    std::unique_lock<std::mutex> LockGuard(StateLock);
+    --ActiveTasks;
+    if (!QueuedTasks && !ActiveTasks)
+      Completion.notify_all();
+  }
+  return true;
+}
+
+void ThreadPool::workerLoop(unsigned Index) {
+  CurrentQueue.set(Queues[Index].get());
+  while (true) {
+    if (runOneTask())
+      continue;
+    std::unique_lock<std::mutex> LockGuard(StateLock);
+    WorkAvailable.wait(LockGuard,
+                       [&] { return Stopping || QueuedTasks != 0; });
+    if (Stopping && !QueuedTasks)
+      return;
+  }
+}
+
+std::shared_future<void> ThreadPool::asyncImpl(TaskTy Task) {
+  auto Promise = std::make_shared<std::promise<void>>();
+  std::shared_future<void> Future = Promise->get_future().share();
+  enqueue([Promise, Task] {
+    Task();
+    Promise->set_value();
+  });
+  return Future;
+}
+
+void ThreadPool::wait() {
+  assert(!isWorkerThread() && "ThreadPool::wait() would deadlock a worker");
+  std::unique_lock<std::mutex> LockGuard(StateLock);
+  Completion.wait(LockGuard,
+                  [&] { return !QueuedTasks && !ActiveTasks; });
+}
+
+#else // LLVM_ENABLE_THREADS
+
+ThreadPool::ThreadPool(unsigned ThreadCount) : ThreadCount(1) {}
+
+ThreadPool::~ThreadPool() {}
+
+bool ThreadPool::isWorkerThread() const { return false; }
+
+void ThreadPool::enqueue(TaskTy Task) { Task(); }
+
+bool ThreadPool::runOneTask() { return false; }
+
+void ThreadPool::workerLoop(unsigned Index) {}
+
+std::shared_future<void> ThreadPool::asyncImpl(TaskTy Task) {
+  std::promise<void> Promise;
+  Task();
+  Promise.set_value();
+  return Promise.get_future().share();
+}
+
+void ThreadPool::wait() {}
+
+#endif // LLVM_ENABLE_THREADS
+
+TaskGroup::TaskGroup(ThreadPool &Pool) : Pool(Pool), Pending(0) {}
+
+TaskGroup::~TaskGroup() { wait(); }
+
+void TaskGroup::spawnImpl(ThreadPool::TaskTy Task) {
+  {
+    std::unique_lock<std::mutex> LockGuard(Lock);
+    ++Pending;
+  }
+  Pool.enqueue([this, Task] {
+    Task();
+    finishTask();
+  });
+}
+
+void TaskGroup::finishTask() {
+  // Notify while holding the lock: as soon as it is released a waiter may
+  // return and destroy the group.
+  std::unique_lock<std::mutex> LockGuard(Lock);
+  if (--Pending == 0)
+    Done.notify_all();
+}
+
+void TaskGroup::wait() {
+  std::unique_lock<std::mutex> LockGuard(Lock);
+  if (!Pool.isWorkerThread()) {
+    Done.wait(LockGuard, [&] { return Pending == 0; });
+    return;
+  }
+
+  // A worker must not block while the tasks it waits on may be sitting in its
+  // own deque, so it keeps executing queued work until the group completes.
+  while (Pending) {
+    LockGuard.unlock();
+    bool RanTask = Pool.runOneTask();
+    LockGuard.lock();
+    if (!RanTask)
+      Done.wait_for(LockGuard, std::chrono::milliseconds(1),
+                    [&] { return Pending == 0; });
+  }
+}
@@ -0,0 +1,117 @@
+//===- TimeTraceProfiler.cpp - Chrome trace recording ---------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the TimeTraceProfiler class.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/TimeTraceProfiler.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MutexGuard.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+
+using namespace llvm;
+
+TimeTraceProfiler::TimeTraceProfiler() : StartTime(sys::TimeValue::now()) {}
+
+uint64_t TimeTraceProfiler::getTimestamp() const {
+  return (sys::TimeValue::now() - StartTime).usec();
+}
+
+void TimeTraceProfiler::addEvent(StringRef Name, StringRef Detail,
+                                 uint64_t Start, uint64_t End,
+                                 int64_t RSSDelta) {
+  MutexGuard Guard(Lock);
+  auto ID = ThreadIDs.insert(
+      std::make_pair(std::this_thread::get_id(), ThreadIDs.size() + 1));
+  Events.push_back(
+      {Name, Detail, ID.first->second, Start, End, RSSDelta});
+}
+
+/// Write \p S as a JSON string.
+static void writeString(raw_ostream &OS, StringRef S) {
+  OS << '"';
+  for (unsigned char C : S) {
+    switch (C) {
+    case '"':
+      OS << "\\\"";
+      break;
+    case '\\':
+      OS << "\\\\";
+      break;
+    case '\n':
+      OS << "\\n";
+      break;
+    case '\t':
+      OS << "\\t";
+      break;
+    default:
+      if (C < 0x20 || C == 0x7f)
+        OS << format("\\u%04x", C);
+      else
+        OS << C;
+    }
+  }
+  OS << '"';
+}
+
+void TimeTraceProfiler::write(raw_ostream &OS) {
+  MutexGuard Guard(Lock);
+
+  // Sort the events by their start, and put an event before the ones it
+  // encloses that start at the same time, which is the order viewers expect.
+  std::vector<const Event *> Sorted;
+  for (const Event &E : Events)
+    Sorted.push_back(&E);
+  std::stable_sort(Sorted.begin(), Sorted.end(),
+                   [](const Event *L, const Event *R) {
+                     if (L->Start != R->Start)
+                       return L->Start < R->Start;
+                     return L->End > R->End;
+                   });
+
+  OS << "{\"traceEvents\":[";
+  bool First = true;
+  for (const Event *E : Sorted) {
+    OS << (First ? "\n" : ",\n");
+    First = false;
+    // Write complete events, which have both a beginning and an end, all in
+    // the same process.
+    OS << "{\"ph\":\"X\",\"cat\":\"pass\",\"pid\":1,\"tid\":" << E->ThreadID
+       << ",\"ts\":" << E->Start << ",\"dur\":" << E->End - E->Start
+       << ",\"name\":";
+    writeString(OS, E->Name);
+    OS << ",\"args\":{\"detail\":";
+    writeString(OS, E->Detail);
+    OS << ",\"rss_delta\":" << E->RSSDelta << "}}";
+  }
+  OS << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+TimeTraceRegion::TimeTraceRegion(TimeTraceProfiler *Profiler, StringRef Name,
+                                 StringRef Detail)
+    : Profiler(Profiler), Start(0), StartRSS(0) {
+  if (!Profiler)
+    return;
+  this->Name = Name;
+  this->Detail = Detail;
+  StartRSS = sys::Process::GetResidentMemoryUsage();
+  Start = Profiler->getTimestamp();
+}
+
+TimeTraceRegion::~TimeTraceRegion() {
+  if (!Profiler)
+    return;
+  uint64_t End = Profiler->getTimestamp();
+  int64_t RSSDelta =
+      int64_t(sys::Process::GetResidentMemoryUsage()) - int64_t(StartRSS);
+  Profiler->addEvent(Name, Detail, Start, End, RSSDelta);
+}
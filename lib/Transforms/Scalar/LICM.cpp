@@ -37,6 +37,7 @@
 #include "llvm/Analysis/ConstantFolding.h"
 #include "llvm/Analysis/LoopInfo.h"
 #include "llvm/Analysis/LoopPass.h"
+#include "llvm/Analysis/MemorySSA.h"
 #include "llvm/Analysis/ScalarEvolution.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
 #include "llvm/Analysis/ValueTracking.h"
@@ -71,11 +72,17 @@ static cl::opt<bool>
 DisablePromotion("disable-licm-promotion", cl::Hidden,
                  cl::desc("Disable memory promotion in LICM pass"));
 
+static cl::opt<bool> EnableMSSALoopDependency(
+    "enable-mssa-loop-dependency", cl::Hidden, cl::init(false),
+    cl::desc("Use MemorySSA rather than alias sets to hoist and sink loads "
+             "and calls in LICM (experimental)"));
+
 static bool inSubLoop(BasicBlock *BB, Loop *CurLoop, LoopInfo *LI);
 static bool isNotUsedInLoop(const Instruction &I, const Loop *CurLoop);
-static bool hoist(Instruction &I, BasicBlock *Preheader);
+static bool hoist(Instruction &I, BasicBlock *Preheader, MemorySSA *MSSA);
 static bool sink(Instruction &I, const LoopInfo *LI, const DominatorTree *DT,
-                 const Loop *CurLoop, AliasSetTracker *CurAST );
+                 const Loop *CurLoop, AliasSetTracker *CurAST,
+                 MemorySSA *MSSA);
 static bool isGuaranteedToExecute(const Instruction &Inst,
                                   const DominatorTree *DT,
                                   const Loop *CurLoop,
@@ -89,6 +96,8 @@ static bool isSafeToExecuteUnconditionally(const Instruction &Inst,
 static bool pointerInvalidatedByLoop(Value *V, uint64_t Size,
                                      const AAMDNodes &AAInfo, 
                                      AliasSetTracker *CurAST);
+static bool memoryInvalidatedByLoop(Instruction *I, const Loop *CurLoop,
+                                    MemorySSA *MSSA);
 static Instruction *CloneInstructionInExitBlock(const Instruction &I,
                                                 BasicBlock &ExitBlock,
                                                 PHINode &PN,
@@ -96,7 +105,8 @@ static Instruction *CloneInstructionInExitBlock(const Instruction &I,
 static bool canSinkOrHoistInst(Instruction &I, AliasAnalysis *AA,
                                DominatorTree *DT, TargetLibraryInfo *TLI,
                                Loop *CurLoop, AliasSetTracker *CurAST,
-                               LICMSafetyInfo *SafetyInfo);
+                               LICMSafetyInfo *SafetyInfo, MemorySSA *MSSA);
+static void removeFromMemorySSA(Instruction &I, MemorySSA *MSSA);
 
 namespace {
   struct LICM : public LoopPass {
@@ -122,6 +132,12 @@ namespace {
       AU.addPreserved<AliasAnalysis>();
       AU.addPreserved<ScalarEvolution>();
       AU.addRequired<TargetLibraryInfoWrapperPass>();
+      // MemorySSA comes last, so that it is built after the loops are put
+      // in the form LICM needs.
+      if (EnableMSSALoopDependency) {
+        AU.addRequired<MemorySSAWrapperPass>();
+        AU.addPreserved<MemorySSAWrapperPass>();
+      }
     }
 
     using llvm::Pass::doFinalization;
@@ -135,6 +151,7 @@ namespace {
     AliasAnalysis *AA;       // Current AliasAnalysis information
     LoopInfo      *LI;       // Current LoopInfo
     DominatorTree *DT;       // Dominator Tree for the current Loop.
+    MemorySSA     *MSSA;     // Memory SSA, if LICM uses it.
 
     TargetLibraryInfo *TLI;  // TargetLibraryInfo for constant folding.
 
@@ -166,6 +183,7 @@ INITIALIZE_PASS_DEPENDENCY(LoopSimplify)
 INITIALIZE_PASS_DEPENDENCY(LCSSA)
 INITIALIZE_PASS_DEPENDENCY(ScalarEvolution)
 INITIALIZE_PASS_DEPENDENCY(TargetLibraryInfoWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(MemorySSAWrapperPass)
 INITIALIZE_AG_DEPENDENCY(AliasAnalysis)
 INITIALIZE_PASS_END(LICM, "licm", "Loop Invariant Code Motion", false, false)
 
@@ -185,6 +203,9 @@ bool LICM::runOnLoop(Loop *L, LPPassManager &LPM) {
   LI = &getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
   AA = &getAnalysis<AliasAnalysis>();
   DT = &getAnalysis<DominatorTreeWrapperPass>().getDomTree();
+  MSSA = EnableMSSALoopDependency
+             ? &getAnalysis<MemorySSAWrapperPass>().getMSSA()
+             : nullptr;
 
   TLI = &getAnalysis<TargetLibraryInfoWrapperPass>().getTLI();
 
@@ -239,10 +260,10 @@ bool LICM::runOnLoop(Loop *L, LPPassManager &LPM) {
   //
   if (L->hasDedicatedExits())
     Changed |= sinkRegion(DT->getNode(L->getHeader()), AA, LI, DT, TLI, CurLoop,
-                          CurAST, &SafetyInfo);
+                          CurAST, &SafetyInfo, MSSA);
   if (Preheader)
     Changed |= hoistRegion(DT->getNode(L->getHeader()), AA, LI, DT, TLI,
-                           CurLoop, CurAST, &SafetyInfo);
+                           CurLoop, CurAST, &SafetyInfo, MSSA);
 
   // Now that all loop invariants have been removed from the loop, promote any
   // memory references to scalars that we can.
@@ -252,11 +273,19 @@ bool LICM::runOnLoop(Loop *L, LPPassManager &LPM) {
     PredIteratorCache PIC;
 
     // Loop over all of the alias sets in the tracker object.
+    bool Promoted = false;
     for (AliasSetTracker::iterator I = CurAST->begin(), E = CurAST->end();
          I != E; ++I)
-      Changed |= promoteLoopAccessesToScalars(*I, ExitBlocks, InsertPts, 
-                                              PIC, LI, DT, CurLoop, 
-                                              CurAST, &SafetyInfo);
+      Promoted |= promoteLoopAccessesToScalars(*I, ExitBlocks, InsertPts,
+                                               PIC, LI, DT, CurLoop,
+                                               CurAST, &SafetyInfo);
+    Changed |= Promoted;
+
+    // Promotion stores to the promoted locations in the exit blocks, which
+    // changes the memory state seen after them. Updating MemorySSA for new
+    // defs is not supported, so build it again.
+    if (MSSA && Promoted)
+      MSSA->recalculate();
 
     // Once we have promoted values across the loop body we have to recursively
     // reform LCSSA as any nested loop may now have values defined within the
@@ -276,6 +305,9 @@ bool LICM::runOnLoop(Loop *L, LPPassManager &LPM) {
   assert((!L->getParentLoop() || L->getParentLoop()->isLCSSAForm(*DT)) &&
          "Parent loop not left in LCSSA form after LICM!");
 
+  if (MSSA && Changed && VerifyMemorySSA)
+    MSSA->verifyMemorySSA();
+
   // Clear out loops state information for the next iteration
   CurLoop = nullptr;
   Preheader = nullptr;
@@ -296,7 +328,8 @@ bool LICM::runOnLoop(Loop *L, LPPassManager &LPM) {
 ///
 bool llvm::sinkRegion(DomTreeNode *N, AliasAnalysis *AA, LoopInfo *LI,
                       DominatorTree *DT, TargetLibraryInfo *TLI, Loop *CurLoop,
-                      AliasSetTracker *CurAST, LICMSafetyInfo *SafetyInfo) {
+                      AliasSetTracker *CurAST, LICMSafetyInfo *SafetyInfo,
+                      MemorySSA *MSSA) {
 
   // Verify inputs.
   assert(N != nullptr && AA != nullptr && LI != nullptr && 
@@ -313,8 +346,8 @@ bool llvm::sinkRegion(DomTreeNode *N, AliasAnalysis *AA, LoopInfo *LI,
   // We are processing blocks in reverse dfo, so process children first.
   const std::vector<DomTreeNode*> &Children = N->getChildren();
   for (unsigned i = 0, e = Children.size(); i != e; ++i)
-    Changed |=
-        sinkRegion(Children[i], AA, LI, DT, TLI, CurLoop, CurAST, SafetyInfo);
+    Changed |= sinkRegion(Children[i], AA, LI, DT, TLI, CurLoop, CurAST,
+                          SafetyInfo, MSSA);
   // Only need to process the contents of this block if it is not part of a
   // subloop (which would already have been processed).
   if (inSubLoop(BB,CurLoop,LI)) return Changed;
@@ -328,6 +361,7 @@ bool llvm::sinkRegion(DomTreeNode *N, AliasAnalysis *AA, LoopInfo *LI,
       DEBUG(dbgs() << "LICM deleting dead inst: " << I << '\n');
       ++II;
       CurAST->deleteValue(&I);
+      removeFromMemorySSA(I, MSSA);
       I.eraseFromParent();
       Changed = true;
       continue;
@@ -339,9 +373,10 @@ bool llvm::sinkRegion(DomTreeNode *N, AliasAnalysis *AA, LoopInfo *LI,
     // operands of the instruction are loop invariant.
     //
     if (isNotUsedInLoop(I, CurLoop) &&
-        canSinkOrHoistInst(I, AA, DT, TLI, CurLoop, CurAST, SafetyInfo)) {
+        canSinkOrHoistInst(I, AA, DT, TLI, CurLoop, CurAST, SafetyInfo,
+                           MSSA)) {
       ++II;
-      Changed |= sink(I, LI, DT, CurLoop, CurAST);
+      Changed |= sink(I, LI, DT, CurLoop, CurAST, MSSA);
     }
   }
   return Changed;
@@ -354,7 +389,8 @@ bool llvm::sinkRegion(DomTreeNode *N, AliasAnalysis *AA, LoopInfo *LI,
 ///
 bool llvm::hoistRegion(DomTreeNode *N, AliasAnalysis *AA, LoopInfo *LI,
                        DominatorTree *DT, TargetLibraryInfo *TLI, Loop *CurLoop,
-                       AliasSetTracker *CurAST, LICMSafetyInfo *SafetyInfo) {
+                       AliasSetTracker *CurAST, LICMSafetyInfo *SafetyInfo,
+                       MemorySSA *MSSA) {
   // Verify inputs.
   assert(N != nullptr && AA != nullptr && LI != nullptr && 
          DT != nullptr && CurLoop != nullptr && CurAST != nullptr && 
@@ -378,6 +414,7 @@ bool llvm::hoistRegion(DomTreeNode *N, AliasAnalysis *AA, LoopInfo *LI,
         DEBUG(dbgs() << "LICM folding inst: " << I << "  --> " << *C << '\n');
         CurAST->copyValue(&I, C);
         CurAST->deleteValue(&I);
+        removeFromMemorySSA(I, MSSA);
         I.replaceAllUsesWith(C);
         I.eraseFromParent();
         continue;
@@ -388,16 +425,17 @@ bool llvm::hoistRegion(DomTreeNode *N, AliasAnalysis *AA, LoopInfo *LI,
       // is safe to hoist the instruction.
       //
       if (CurLoop->hasLoopInvariantOperands(&I) &&
-          canSinkOrHoistInst(I, AA, DT, TLI, CurLoop, CurAST, SafetyInfo) &&
+          canSinkOrHoistInst(I, AA, DT, TLI, CurLoop, CurAST, SafetyInfo,
+                             MSSA) &&
           isSafeToExecuteUnconditionally(I, DT, TLI, CurLoop, SafetyInfo,
                                  CurLoop->getLoopPreheader()->getTerminator()))
-        Changed |= hoist(I, CurLoop->getLoopPreheader());
+        Changed |= hoist(I, CurLoop->getLoopPreheader(), MSSA);
     }
 
   const std::vector<DomTreeNode*> &Children = N->getChildren();
   for (unsigned i = 0, e = Children.size(); i != e; ++i)
-    Changed |=
-        hoistRegion(Children[i], AA, LI, DT, TLI, CurLoop, CurAST, SafetyInfo);
+    Changed |= hoistRegion(Children[i], AA, LI, DT, TLI, CurLoop, CurAST,
+                           SafetyInfo, MSSA);
   return Changed;
 }
 
@@ -429,7 +467,8 @@ void llvm::computeLICMSafetyInfo(LICMSafetyInfo * SafetyInfo, Loop * CurLoop) {
 ///
 bool canSinkOrHoistInst(Instruction &I, AliasAnalysis *AA, DominatorTree *DT,
                         TargetLibraryInfo *TLI, Loop *CurLoop,
-                        AliasSetTracker *CurAST, LICMSafetyInfo *SafetyInfo) {
+                        AliasSetTracker *CurAST, LICMSafetyInfo *SafetyInfo,
+                        MemorySSA *MSSA) {
   // Loads have extra constraints we have to verify before we can hoist them.
   if (LoadInst *LI = dyn_cast<LoadInst>(&I)) {
     if (!LI->isUnordered())
@@ -442,6 +481,9 @@ bool canSinkOrHoistInst(Instruction &I, AliasAnalysis *AA, DominatorTree *DT,
     if (LI->getMetadata(LLVMContext::MD_invariant_load))
       return true;
 
+    if (MSSA)
+      return !memoryInvalidatedByLoop(LI, CurLoop, MSSA);
+
     // Don't hoist loads which have may-aliased stores in loop.
     uint64_t Size = 0;
     if (LI->getType()->isSized())
@@ -461,6 +503,9 @@ bool canSinkOrHoistInst(Instruction &I, AliasAnalysis *AA, DominatorTree *DT,
     if (Behavior == AliasAnalysis::DoesNotAccessMemory)
       return true;
     if (AliasAnalysis::onlyReadsMemory(Behavior)) {
+      if (MSSA)
+        return !memoryInvalidatedByLoop(CI, CurLoop, MSSA);
+
       // If this call only reads from memory and there are no writes to memory
       // in the loop, we can hoist or sink the call as appropriate.
       bool FoundMod = false;
@@ -580,7 +625,8 @@ static Instruction *CloneInstructionInExitBlock(const Instruction &I,
 /// position, and may either delete it or move it to outside of the loop.
 ///
 static bool sink(Instruction &I, const LoopInfo *LI, const DominatorTree *DT,
-                 const Loop *CurLoop, AliasSetTracker *CurAST ) {
+                 const Loop *CurLoop, AliasSetTracker *CurAST,
+                 MemorySSA *MSSA) {
   DEBUG(dbgs() << "LICM sinking instruction: " << I << "\n");
   bool Changed = false;
   if (isa<LoadInst>(I)) ++NumMovedLoads;
@@ -629,15 +675,21 @@ static bool sink(Instruction &I, const LoopInfo *LI, const DominatorTree *DT,
     auto It = SunkCopies.find(ExitBlock);
     if (It != SunkCopies.end())
       New = It->second;
-    else
+    else {
       New = SunkCopies[ExitBlock] =
             CloneInstructionInExitBlock(I, *ExitBlock, *PN, LI);
+      // The clone goes before the instructions sunk earlier, and sees the
+      // memory state at the start of the exit block.
+      if (MSSA && MSSA->getMemoryAccess(&I))
+        MSSA->createMemoryAccessInBB(New, ExitBlock, MemorySSA::Beginning);
+    }
 
     PN->replaceAllUsesWith(New);
     PN->eraseFromParent();
   }
 
   CurAST->deleteValue(&I);
+  removeFromMemorySSA(I, MSSA);
   I.eraseFromParent();
   return Changed;
 }
@@ -645,12 +697,20 @@ static bool sink(Instruction &I, const LoopInfo *LI, const DominatorTree *DT,
 /// When an instruction is found to only use loop invariant operands that
 /// is safe to hoist, this instruction is called to do the dirty work.
 ///
-static bool hoist(Instruction &I, BasicBlock *Preheader) {
+static bool hoist(Instruction &I, BasicBlock *Preheader, MemorySSA *MSSA) {
   DEBUG(dbgs() << "LICM hoisting to " << Preheader->getName() << ": "
         << I << "\n");
   // Move the new node to the Preheader, before its terminator.
   I.moveBefore(Preheader->getTerminator());
 
+  // Only instructions that do not write memory are hoisted, so its access can
+  // simply be recreated at the end of the preheader.
+  if (MSSA)
+    if (MemoryUseOrDef *OldMA = MSSA->getMemoryAccess(&I)) {
+      MSSA->removeMemoryAccess(OldMA);
+      MSSA->createMemoryAccessInBB(&I, Preheader, MemorySSA::End);
+    }
+
   if (isa<LoadInst>(I)) ++NumMovedLoads;
   else if (isa<CallInst>(I)) ++NumMovedCalls;
   ++NumHoisted;
@@ -1015,6 +1075,24 @@ static bool pointerInvalidatedByLoop(Value *V, uint64_t Size,
   return CurAST->getAliasSetForPointer(V, Size, AAInfo).isMod();
 }
 
+/// Return true if something in CurLoop may write the memory the load or call
+/// I reads: that is, if the clobbering access of I is in the loop. The walk
+/// from I goes around the loop through the phi of the header, so it sees all
+/// the writes of the loop.
+static bool memoryInvalidatedByLoop(Instruction *I, const Loop *CurLoop,
+                                    MemorySSA *MSSA) {
+  MemoryAccess *Clobber = MSSA->getWalker()->getClobberingMemoryAccess(I);
+  return !MSSA->isLiveOnEntryDef(Clobber) &&
+         CurLoop->contains(Clobber->getBlock());
+}
+
+/// Remove the access of I, which is about to be deleted, from MemorySSA.
+static void removeFromMemorySSA(Instruction &I, MemorySSA *MSSA) {
+  if (MSSA)
+    if (MemoryUseOrDef *MA = MSSA->getMemoryAccess(&I))
+      MSSA->removeMemoryAccess(MA);
+}
+
 /// Little predicate that returns true if the specified basic block is in
 /// a subloop of the current one, not the current one itself.
 ///
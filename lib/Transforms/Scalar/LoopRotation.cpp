@@ -500,22 +500,18 @@ bool LoopRotate::rotateLoop(Loop *L, bool SimplifiedLatch) {
     // Update DominatorTree to reflect the CFG change we just made.  Then split
     // edges as necessary to preserve LoopSimplify form.
     if (DT) {
-      // Everything that was dominated by the old loop header is now dominated
-      // by the original loop preheader. Conceptually the header was merged
-      // into the preheader, even though we reuse the actual block as a new
-      // loop latch.
-      DomTreeNode *OrigHeaderNode = DT->getNode(OrigHeader);
-      SmallVector<DomTreeNode *, 8> HeaderChildren(OrigHeaderNode->begin(),
-                                                   OrigHeaderNode->end());
-      DomTreeNode *OrigPreheaderNode = DT->getNode(OrigPreheader);
-      for (unsigned I = 0, E = HeaderChildren.size(); I != E; ++I)
-        DT->changeImmediateDominator(HeaderChildren[I], OrigPreheaderNode);
-
-      assert(DT->getNode(Exit)->getIDom() == OrigPreheaderNode);
-      assert(DT->getNode(NewHeader)->getIDom() == OrigPreheaderNode);
-
-      // Update OrigHeader to be dominated by the new header block.
-      DT->changeImmediateDominator(OrigHeader, OrigLatch);
+      // The preheader now branches to the new header and the exit instead of
+      // to the old header. Conceptually the header was merged into the
+      // preheader, even though we reuse the actual block as a new loop latch.
+      DominatorTree::UpdateType Updates[] = {
+          {DominatorTree::Insert, OrigPreheader, NewHeader},
+          {DominatorTree::Insert, OrigPreheader, Exit},
+          {DominatorTree::Delete, OrigPreheader, OrigHeader}};
+      DT->applyUpdates(Updates);
+
+      assert(DT->getNode(Exit)->getIDom() == DT->getNode(OrigPreheader));
+      assert(DT->getNode(NewHeader)->getIDom() == DT->getNode(OrigPreheader));
+      assert(DT->getNode(OrigHeader)->getIDom() == DT->getNode(OrigLatch));
     }
 
     // Right now OrigPreHeader has two successors, NewHeader and ExitBlock, and
@@ -558,38 +554,10 @@ bool LoopRotate::rotateLoop(Loop *L, bool SimplifiedLatch) {
 
     // With our CFG finalized, update DomTree if it is available.
     if (DT) {
-      // Update OrigHeader to be dominated by the new header block.
-      DT->changeImmediateDominator(NewHeader, OrigPreheader);
-      DT->changeImmediateDominator(OrigHeader, OrigLatch);
-
-      // Brute force incremental dominator tree update. Call
-      // findNearestCommonDominator on all CFG predecessors of each child of the
-      // original header.
-      DomTreeNode *OrigHeaderNode = DT->getNode(OrigHeader);
-      SmallVector<DomTreeNode *, 8> HeaderChildren(OrigHeaderNode->begin(),
-                                                   OrigHeaderNode->end());
-      bool Changed;
-      do {
-        Changed = false;
-        for (unsigned I = 0, E = HeaderChildren.size(); I != E; ++I) {
-          DomTreeNode *Node = HeaderChildren[I];
-          BasicBlock *BB = Node->getBlock();
-
-          pred_iterator PI = pred_begin(BB);
-          BasicBlock *NearestDom = *PI;
-          for (pred_iterator PE = pred_end(BB); PI != PE; ++PI)
-            NearestDom = DT->findNearestCommonDominator(NearestDom, *PI);
-
-          // Remember if this changes the DomTree.
-          if (Node->getIDom()->getBlock() != NearestDom) {
-            DT->changeImmediateDominator(BB, NearestDom);
-            Changed = true;
-          }
-        }
-
-      // If the dominator changed, this may have an effect on other
-      // predecessors, continue until we reach a fixpoint.
-      } while (Changed);
+      DominatorTree::UpdateType Updates[] = {
+          {DominatorTree::Insert, OrigPreheader, NewHeader},
+          {DominatorTree::Delete, OrigPreheader, OrigHeader}};
+      DT->applyUpdates(Updates);
     }
   }
 
@@ -750,7 +750,8 @@ bool SampleProfileLoader::doInitialization(Module &M) {
     return false;
   }
   Reader = std::move(ReaderOrErr.get());
-  ProfileIsValid = (Reader->read() == sampleprof_error::success);
+  ProfileIsValid =
+      (Reader->readModuleProfiles(M) == sampleprof_error::success);
   return true;
 }
 
@@ -0,0 +1,112 @@
+//===- SplitModule.cpp - Split a module into partitions -------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the function llvm::SplitModule, which splits a module
+// into multiple linkable partitions. It can be used to implement parallel code
+// generation for link-time optimization.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/Utils/SplitModule.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/GlobalAlias.h"
+#include "llvm/IR/GlobalObject.h"
+#include "llvm/IR/GlobalValue.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include <algorithm>
+
+using namespace llvm;
+
+static void externalize(GlobalValue *GV) {
+  if (GV->hasLocalLinkage()) {
+    GV->setLinkage(GlobalValue::ExternalLinkage);
+    GV->setVisibility(GlobalValue::HiddenVisibility);
+  }
+
+  // Unnamed entities must be named consistently between modules. setName will
+  // give a distinct name to each such entity.
+  if (!GV->hasName())
+    GV->setName("__llvmsplit_unnamed");
+}
+
+/// Returns the global value that decides which partition \p GV goes to: an
+/// alias follows its aliasee and comdat members follow the comdat.
+static const void *getPartitionKey(const GlobalValue *GV) {
+  if (auto *GA = dyn_cast<GlobalAlias>(GV))
+    if (const GlobalObject *Base = GA->getBaseObject())
+      GV = Base;
+  if (const Comdat *C = GV->getComdat())
+    return C;
+  return GV;
+}
+
+static unsigned getWeight(const GlobalValue *GV) {
+  unsigned Weight = 1;
+  if (auto *F = dyn_cast<Function>(GV))
+    for (const BasicBlock &BB : *F)
+      Weight += BB.size();
+  return Weight;
+}
+
+void llvm::SplitModule(
+    Module &M, unsigned N,
+    std::function<void(std::unique_ptr<Module> MPart)> ModuleCallback) {
+  for (Function &F : M)
+    externalize(&F);
+  for (GlobalVariable &GV : M.globals())
+    externalize(&GV);
+  for (GlobalAlias &GA : M.aliases())
+    externalize(&GA);
+
+  // Group the global values that must stay together, remembering the order in
+  // which groups were first seen so that ties are broken deterministically.
+  MapVector<const void *, unsigned> GroupWeights;
+  auto AddToGroup = [&](const GlobalValue &GV) {
+    // Declarations are copied into every partition.
+    if (GV.isDeclaration())
+      return;
+    GroupWeights[getPartitionKey(&GV)] += getWeight(&GV);
+  };
+  std::for_each(M.begin(), M.end(), AddToGroup);
+  std::for_each(M.global_begin(), M.global_end(), AddToGroup);
+  std::for_each(M.alias_begin(), M.alias_end(), AddToGroup);
+
+  // Assign the heaviest groups first, each to the currently lightest
+  // partition.
+  std::vector<std::pair<const void *, unsigned>> Groups(GroupWeights.begin(),
+                                                        GroupWeights.end());
+  std::stable_sort(Groups.begin(), Groups.end(),
+                   [](const std::pair<const void *, unsigned> &A,
+                      const std::pair<const void *, unsigned> &B) {
+                     return A.second > B.second;
+                   });
+  std::vector<uint64_t> PartitionWeights(N, 0);
+  DenseMap<const void *, unsigned> GroupPartition;
+  for (const auto &Group : Groups) {
+    unsigned Lightest =
+        std::min_element(PartitionWeights.begin(), PartitionWeights.end()) -
+        PartitionWeights.begin();
+    PartitionWeights[Lightest] += Group.second;
+    GroupPartition[Group.first] = Lightest;
+  }
+
+  for (unsigned I = 0; I != N; ++I) {
+    ValueToValueMapTy VMap;
+    std::unique_ptr<Module> MPart(
+        CloneModule(&M, VMap, [&](const GlobalValue *GV) {
+          return GroupPartition.lookup(getPartitionKey(GV)) == I;
+        }));
+    if (I != 0)
+      MPart->setModuleInlineAsm("");
+    ModuleCallback(std::move(MPart));
+  }
+}
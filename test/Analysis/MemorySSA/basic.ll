@@ -0,0 +1,57 @@
+; RUN: opt -basicaa -memoryssa -analyze -verify-memoryssa < %s | FileCheck %s
+;
+; Check the accesses of straight-line code and of a diamond.
+
+declare void @clobber()
+declare i32 @reader(i32*) readonly
+
+define i32 @straightline(i32* %a, i32* %b) {
+; CHECK-LABEL: define i32 @straightline
+entry:
+; CHECK: 1 = MemoryDef(liveOnEntry)
+; CHECK-NEXT: store i32 0, i32* %a
+  store i32 0, i32* %a
+; CHECK: MemoryUse(1)
+; CHECK-NEXT: %v = load i32, i32* %b
+  %v = load i32, i32* %b
+; CHECK: 2 = MemoryDef(1)
+; CHECK-NEXT: call void @clobber()
+  call void @clobber()
+; CHECK: MemoryUse(2)
+; CHECK-NEXT: %r = call i32 @reader(i32* %a)
+  %r = call i32 @reader(i32* %a)
+; CHECK-NOT: Memory
+; CHECK: %s = add i32 %v, %r
+  %s = add i32 %v, %r
+  ret i32 %s
+}
+
+define i32 @diamond(i1 %c, i32* %a) {
+; CHECK-LABEL: define i32 @diamond
+entry:
+; CHECK: MemoryUse(liveOnEntry)
+; CHECK-NEXT: %v = load i32, i32* %a
+  %v = load i32, i32* %a
+  br i1 %c, label %left, label %right
+
+left:
+; CHECK: 1 = MemoryDef(liveOnEntry)
+; CHECK-NEXT: store i32 1, i32* %a
+  store i32 1, i32* %a
+  br label %merge
+
+right:
+; CHECK: 2 = MemoryDef(liveOnEntry)
+; CHECK-NEXT: store i32 2, i32* %a
+  store i32 2, i32* %a
+  br label %merge
+
+merge:
+; CHECK: merge:
+; CHECK-NEXT: 3 = MemoryPhi({%left,1},{%right,2})
+; CHECK: MemoryUse(3)
+; CHECK-NEXT: %w = load i32, i32* %a
+  %w = load i32, i32* %a
+  %s = add i32 %v, %w
+  ret i32 %s
+}
@@ -0,0 +1,42 @@
+; RUN: opt -basicaa -memoryssa -analyze -verify-memoryssa < %s | FileCheck %s
+;
+; Check the phis of loops. A loop that does not write memory gets none.
+
+define void @loop(i32* %a, i32* %b, i32 %n) {
+; CHECK-LABEL: define void @loop
+entry:
+; CHECK: 1 = MemoryDef(liveOnEntry)
+  store i32 0, i32* %a
+  br label %outer
+
+outer:
+; CHECK: outer:
+; CHECK-NEXT: 3 = MemoryPhi({%entry,1},{%outer.latch,2})
+  %i = phi i32 [ 0, %entry ], [ %i.next, %outer.latch ]
+  br label %inner
+
+inner:
+; CHECK: inner:
+; CHECK-NOT: MemoryPhi
+; CHECK: MemoryUse(3)
+; CHECK-NEXT: %v = load i32, i32* %b
+  %j = phi i32 [ 0, %outer ], [ %j.next, %inner ]
+  %v = load i32, i32* %b
+  %j.next = add i32 %j, %v
+  %inner.cond = icmp slt i32 %j.next, %n
+  br i1 %inner.cond, label %inner, label %outer.latch
+
+outer.latch:
+; CHECK: 2 = MemoryDef(3)
+; CHECK-NEXT: store i32 %j.next, i32* %a
+  store i32 %j.next, i32* %a
+  %i.next = add i32 %i, 1
+  %outer.cond = icmp slt i32 %i.next, %n
+  br i1 %outer.cond, label %outer, label %exit
+
+exit:
+; CHECK: MemoryUse(2)
+; CHECK-NEXT: %w = load i32, i32* %a
+  %w = load i32, i32* %a
+  ret void
+}
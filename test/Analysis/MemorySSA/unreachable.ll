@@ -0,0 +1,31 @@
+; RUN: opt -basicaa -memoryssa -analyze -verify-memoryssa < %s | FileCheck %s
+;
+; Accesses in unreachable blocks, and phi entries for edges out of them, see
+; the memory state on entry to the function.
+
+define i32 @unreachable(i1 %c, i32* %a) {
+; CHECK-LABEL: define i32 @unreachable
+entry:
+  br i1 %c, label %left, label %merge
+
+left:
+; CHECK: 1 = MemoryDef(liveOnEntry)
+  store i32 1, i32* %a
+  br label %merge
+
+dead:
+; CHECK: MemoryUse(liveOnEntry)
+; CHECK-NEXT: %d = load i32, i32* %a
+; CHECK: 2 = MemoryDef(liveOnEntry)
+; CHECK-NEXT: store i32 %d, i32* %a
+  %d = load i32, i32* %a
+  store i32 %d, i32* %a
+  br label %merge
+
+merge:
+; CHECK: merge:
+; CHECK-NEXT: 3 = MemoryPhi({%entry,liveOnEntry},{%left,1},{%dead,liveOnEntry})
+; CHECK: MemoryUse(3)
+  %v = load i32, i32* %a
+  ret i32 %v
+}
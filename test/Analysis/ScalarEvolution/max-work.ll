@@ -0,0 +1,31 @@
+; RUN: opt < %s -analyze -scalar-evolution | FileCheck %s
+; RUN: opt < %s -analyze -scalar-evolution -scalar-evolution-max-work=1 | FileCheck %s -check-prefix=BUDGET
+
+; Once the work budget of a function is spent, the values not analyzed yet
+; are left unknown and the trip counts not computed yet unpredictable.
+
+; CHECK-LABEL: Printing analysis 'Scalar Evolution Analysis' for function 'f':
+; CHECK: %i.next = add nsw i32 %i, 1
+; CHECK-NEXT: -->  {1,+,1}<nuw><nsw><%loop>
+; CHECK: Loop %loop: backedge-taken count is 99
+
+; BUDGET-LABEL: Printing analysis 'Scalar Evolution Analysis' for function 'f':
+; BUDGET: %i.next = add nsw i32 %i, 1
+; BUDGET-NEXT: -->  %i.next
+; BUDGET: Loop %loop: Unpredictable backedge-taken count.
+
+define void @f(i32* %p) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %gep = getelementptr inbounds i32, i32* %p, i32 %i
+  store i32 %i, i32* %gep
+  %i.next = add nsw i32 %i, 1
+  %cond = icmp slt i32 %i.next, 100
+  br i1 %cond, label %loop, label %exit
+
+exit:
+  ret void
+}
@@ -0,0 +1,45 @@
+; RUN: llvm-as < %s | llvm-bcanalyzer -dump | FileCheck %s -check-prefix=BC
+; RUN: llvm-as < %s | llvm-extract -func=last -S | FileCheck %s -check-prefix=LAST
+; RUN: llvm-as < %s | llvm-extract -func=first -S | FileCheck %s -check-prefix=FIRST
+; Check that a FUNCTION_INDEX block recording where each function body lives
+; is emitted after the bodies, and that lazily reading single functions
+; through it yields the right bodies.
+
+; BC: <FNINDEX
+; BC: <FUNCTION_BLOCK
+; BC: <FUNCTION_BLOCK
+; BC: <FUNCTION_BLOCK
+; BC: <FUNCTION_INDEX_BLOCK
+; BC-NEXT: <ENTRY
+; BC-NEXT: <ENTRY
+; BC-NEXT: <ENTRY
+; BC-NEXT: </FUNCTION_INDEX_BLOCK>
+
+; LAST: declare i32 @middle(i32)
+; LAST: define i32 @last(i32 %x) {
+; LAST-NEXT: %y = call i32 @middle(i32 %x)
+; LAST-NEXT: %z = mul i32 %y, 3
+; LAST-NEXT: ret i32 %z
+
+; FIRST: define i32 @first(i32 %x) {
+; FIRST-NEXT: %y = add i32 %x, 1
+; FIRST-NEXT: ret i32 %y
+
+define i32 @first(i32 %x) {
+  %y = add i32 %x, 1
+  ret i32 %y
+}
+
+declare void @external()
+
+define i32 @middle(i32 %x) {
+  call void @external()
+  %y = call i32 @first(i32 %x)
+  ret i32 %y
+}
+
+define i32 @last(i32 %x) {
+  %y = call i32 @middle(i32 %x)
+  %z = mul i32 %y, 3
+  ret i32 %z
+}
@@ -0,0 +1,79 @@
+; RUN: llvm-as < %s > %t.serial.bc
+; RUN: llvm-as -threads=2 < %s > %t.2.bc
+; RUN: llvm-as -threads=8 < %s > %t.8.bc
+; RUN: cmp %t.serial.bc %t.2.bc
+; RUN: cmp %t.serial.bc %t.8.bc
+; RUN: llvm-as -threads=8 -preserve-bc-uselistorder=false < %s > %t.nouse.bc
+; RUN: llvm-as -preserve-bc-uselistorder=false < %s | cmp - %t.nouse.bc
+; RUN: llvm-dis %t.8.bc -o - | FileCheck %s
+; Check that encoding function bodies on several threads produces the same
+; bitcode as the serial writer.
+
+@g = global i32 0
+@table = global [2 x i8*] [i8* blockaddress(@indirect, %a), i8* blockaddress(@indirect, %b)]
+
+; CHECK: define i32 @first(i32 %x)
+define i32 @first(i32 %x) {
+  %y = add i32 %x, 7
+  %z = mul i32 %y, %y
+  store i32 %z, i32* @g
+  ret i32 %z
+}
+
+; CHECK: define i32 @second(i32 %x)
+define i32 @second(i32 %x) {
+entry:
+  %c = icmp eq i32 %x, 0
+  br i1 %c, label %zero, label %nonzero, !prof !0
+zero:
+  ret i32 7
+nonzero:
+  %r = call i32 @first(i32 %x), !dbg !8
+  ret i32 %r
+}
+
+; CHECK: define i8* @indirect(i32 %i)
+define i8* @indirect(i32 %i) {
+entry:
+  %c = icmp eq i32 %i, 0
+  br i1 %c, label %a, label %b
+a:
+  ret i8* blockaddress(@indirect, %b)
+b:
+  ret i8* blockaddress(@indirect, %a)
+}
+
+; CHECK: define void @uses(i32 %x)
+define void @uses(i32 %x) {
+  %a = add i32 %x, 1
+  %b = add i32 %x, 2
+  %c = add i32 %a, %x
+  call void @llvm.dbg.value(metadata i32 %c, i64 0, metadata !9, metadata !10), !dbg !8
+  store i32 %b, i32* @g
+  ret void
+}
+
+; CHECK: define float @fp(float %f)
+define float @fp(float %f) {
+  %v = fadd float %f, 1.500000e+00
+  %w = fmul float %v, 1.500000e+00
+  ret float %w
+}
+
+declare void @llvm.dbg.value(metadata, i64, metadata, metadata)
+
+!llvm.dbg.cu = !{!1}
+!llvm.module.flags = !{!7}
+
+!0 = !{!"branch_weights", i32 1, i32 9}
+!1 = distinct !DICompileUnit(language: DW_LANG_C99, file: !2, producer: "clang", isOptimized: true, runtimeVersion: 0, emissionKind: 1, subprograms: !3)
+!2 = !DIFile(filename: "t.c", directory: "/tmp")
+!3 = !{!4}
+!4 = distinct !DISubprogram(name: "second", scope: !2, file: !2, line: 1, type: !5, isLocal: false, isDefinition: true, scopeLine: 1, isOptimized: true, function: i32 (i32)* @second)
+!5 = !DISubroutineType(types: !6)
+!6 = !{null}
+!7 = !{i32 2, !"Debug Info Version", i32 3}
+!8 = !DILocation(line: 2, column: 3, scope: !4)
+!9 = !DILocalVariable(tag: DW_TAG_auto_variable, name: "c", scope: !4, file: !2, line: 2, type: !11)
+!10 = !DIExpression()
+!11 = !DIBasicType(name: "int", size: 32, align: 32, encoding: DW_ATE_signed)
@@ -0,0 +1,20 @@
+; RUN: rm -rf %t
+; RUN: llc -mtriple=x86_64-unknown-linux-gnu -cache-dir=%t %s -o %t.1.s
+; RUN: ls %t | count 1
+; RUN: llc -mtriple=x86_64-unknown-linux-gnu -cache-dir=%t %s -o %t.2.s
+; RUN: diff %t.1.s %t.2.s
+; RUN: FileCheck %s < %t.2.s
+; A different command line must not reuse the cached output.
+; RUN: llc -mtriple=x86_64-unknown-linux-gnu -O0 -cache-dir=%t %s -o %t.3.s
+; RUN: ls %t | count 2
+; RUN: not llc -mtriple=x86_64-unknown-linux-gnu -threads=2 -cache-dir=%t %s \
+; RUN:   -o %t.4.s 2>&1 | FileCheck %s --check-prefix=ERR
+
+; CHECK-LABEL: f:
+; CHECK: leal 7(%rdi), %eax
+; ERR: -threads cannot be combined with {{.*}}-cache-dir
+
+define i32 @f(i32 %x) {
+  %y = add i32 %x, 7
+  ret i32 %y
+}
@@ -0,0 +1,30 @@
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -threads=2 -o %t
+; RUN: FileCheck --check-prefix=CHECK0 %s < %t
+; RUN: FileCheck --check-prefix=CHECK1 %s < %t.1
+
+; Declarations are copied into each partition with their own linkage, so the
+; extern_weak reference stays weak in both.
+; CHECK0: {{^}}big:
+; CHECK0: .weak w
+
+; CHECK1: {{^}}small:
+; CHECK1: .weak w
+
+declare extern_weak i32 @w(i32)
+
+define i32 @big(i32 %a, i32 %b) {
+  %1 = add i32 %a, %b
+  %2 = mul i32 %1, %a
+  %3 = sub i32 %2, %b
+  %4 = xor i32 %3, %1
+  %5 = and i32 %4, %2
+  %6 = or i32 %5, %3
+  %7 = shl i32 %6, 3
+  %8 = call i32 @w(i32 %7)
+  ret i32 %8
+}
+
+define i32 @small(i32 %x) {
+  %1 = call i32 @w(i32 %x)
+  ret i32 %1
+}
@@ -0,0 +1,21 @@
+; RUN: llc < %s -mtriple=i686-pc-windows-msvc -threads=2 -o %t
+; RUN: cat %t %t.1 | FileCheck %s
+
+; Each partition is compiled with the library functions of its triple.  The
+; 32-bit MSVC runtime has no sqrtf, so that call must not become an
+; instruction, while sqrt may.
+; CHECK-DAG: fsqrt
+; CHECK-DAG: calll _sqrtf
+
+declare double @sqrt(double) readnone
+declare float @sqrtf(float) readnone
+
+define double @f(double %x) {
+  %r = call double @sqrt(double %x)
+  ret double %r
+}
+
+define float @g(float %x) {
+  %r = call float @sqrtf(float %x)
+  ret float %r
+}
@@ -0,0 +1,38 @@
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -threads=2 -o %t
+; RUN: FileCheck --check-prefix=CHECK0 %s < %t
+; RUN: FileCheck --check-prefix=CHECK1 %s < %t.1
+
+; The heaviest function is placed first; everything else balances against it.
+; CHECK0: .globl big
+; CHECK0: big:
+; CHECK0-NOT: {{^}}small:
+; CHECK0-NOT: {{^}}helper:
+
+; Internal symbols are externalized with hidden visibility so that both
+; partitions can refer to them.
+; CHECK1-DAG: .hidden helper
+; CHECK1-DAG: {{^}}helper:
+; CHECK1-DAG: {{^}}small:
+; CHECK1-NOT: {{^}}big:
+
+define i32 @big(i32 %a, i32 %b) {
+  %1 = add i32 %a, %b
+  %2 = mul i32 %1, %a
+  %3 = sub i32 %2, %b
+  %4 = xor i32 %3, %1
+  %5 = and i32 %4, %2
+  %6 = or i32 %5, %3
+  %7 = shl i32 %6, 3
+  %8 = call i32 @helper(i32 %7)
+  ret i32 %8
+}
+
+define internal i32 @helper(i32 %x) {
+  %1 = add i32 %x, 1
+  ret i32 %1
+}
+
+define i32 @small(i32 %x) {
+  %1 = call i32 @helper(i32 %x)
+  ret i32 %1
+}
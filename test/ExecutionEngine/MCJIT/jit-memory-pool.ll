@@ -0,0 +1,19 @@
+; RUN: %lli -jit-memory-pool %s | FileCheck %s
+; RUN: %lli -jit-huge-pages %s | FileCheck %s
+
+; CHECK: Hello World
+
+@.str = private constant [12 x i8] c"Hello World\00"
+@counter = global i32 0
+
+declare i32 @puts(i8*)
+
+define i32 @main() {
+  %n = load i32, i32* @counter
+  %n1 = add i32 %n, 1
+  store i32 %n1, i32* @counter
+  %s = getelementptr [12 x i8], [12 x i8]* @.str, i64 0, i64 0
+  call i32 @puts(i8* %s)
+  %r = sub i32 %n1, 1
+  ret i32 %r
+}
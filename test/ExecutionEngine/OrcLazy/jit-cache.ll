@@ -0,0 +1,26 @@
+; REQUIRES: asserts
+; RUN: rm -rf %t.cachedir
+; RUN: lli -jit-kind=orc-lazy -jit-cache-dir=%t.cachedir -stats %s 2>&1 \
+; RUN:   | FileCheck %s --check-prefix=FIRST
+; RUN: lli -jit-kind=orc-lazy -jit-cache-dir=%t.cachedir -stats %s 2>&1 \
+; RUN:   | FileCheck %s --check-prefix=SECOND
+;
+; The objects compiled for the partitions of the first run are reused by the
+; second one. The module holding the stubs refers to the addresses of the
+; compile callbacks, which differ from run to run, so it is compiled again.
+;
+; FIRST: object-cache - Number of modules missing from the object cache
+; FIRST-NOT: Number of objects loaded from the object cache
+;
+; SECOND: object-cache - Number of objects loaded from the object cache
+
+define i32 @callee() {
+entry:
+  ret i32 0
+}
+
+define i32 @main(i32 %argc, i8** %argv) {
+entry:
+  %r = call i32 @callee()
+  ret i32 %r
+}
@@ -0,0 +1,29 @@
+; RUN: llvm-as %s -o %t.bc
+; RUN: lli -jit-kind=orc-lazy -orc-lazy-debug=funcs-to-stdout %t.bc \
+; RUN:   | FileCheck %s
+; RUN: lli -jit-kind=orc-lazy -stats %t.bc 2>&1 \
+; RUN:   | FileCheck %s -check-prefix=STATS
+; REQUIRES: asserts
+;
+; Only the bodies of the functions that are called are read from the bitcode.
+;
+; CHECK: [ main ]
+; CHECK-NEXT: [ called ]
+; STATS: 2 bitcode-reader - Number of function bodies read
+
+define i32 @called() {
+entry:
+  ret i32 0
+}
+
+define i32 @uncalled() {
+entry:
+  %r = call i32 @called()
+  ret i32 %r
+}
+
+define i32 @main(i32 %argc, i8** %argv) {
+entry:
+  %r = call i32 @called()
+  ret i32 %r
+}
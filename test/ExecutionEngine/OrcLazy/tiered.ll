@@ -0,0 +1,89 @@
+; RUN: lli -jit-kind=orc-lazy -orc-lazy-hot-call-count=10 \
+; RUN:   -orc-lazy-debug=funcs-to-stdout %s | FileCheck %s
+;
+; The hot function is compiled at -O0 on its first call, and again at -O3
+; once it has been called ten times. The program then waits for the body
+; pointer behind the stub of @add to change, and keeps calling @add through
+; the stub, which now leads to the optimized body.
+;
+; CHECK: [ main ]
+; CHECK: [ add ]
+; CHECK: [ add$orc_opt ]
+; CHECK: repointed
+; CHECK-NOT: not repointed
+
+@"add$orc_addr" = external global i32 (i32, i32)*
+
+@repointed = private constant [11 x i8] c"repointed\0A\00"
+@not_repointed = private constant [15 x i8] c"not repointed\0A\00"
+
+declare i32 @printf(i8*, ...)
+declare i32 @usleep(i32)
+
+define i32 @add(i32 %a, i32 %b) {
+entry:
+  %x = alloca i32
+  store i32 %a, i32* %x
+  %l = load i32, i32* %x
+  %r = add i32 %l, %b
+  ret i32 %r
+}
+
+define i32 @main(i32 %argc, i8** %argv) {
+entry:
+  %first = call i32 @add(i32 0, i32 0)
+  %slow = load atomic i32 (i32, i32)*, i32 (i32, i32)** @"add$orc_addr" unordered, align 8
+  br label %loop
+
+; Call @add a hundred times, which makes it hot.
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %sum = phi i32 [ 0, %entry ], [ %sum.next, %loop ]
+  %sum.next = call i32 @add(i32 %sum, i32 %i)
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, 100
+  br i1 %done, label %wait, label %loop
+
+; Wait up to a minute for the optimized body, checking that @add still
+; computes the right result meanwhile.
+wait:
+  %tries = phi i32 [ 0, %loop ], [ %tries.next, %sleep ]
+  %bad = phi i1 [ false, %loop ], [ %bad.next, %sleep ]
+  %v = call i32 @add(i32 %tries, i32 1)
+  %tries.plus1 = add i32 %tries, 1
+  %wrong = icmp ne i32 %v, %tries.plus1
+  %bad.next = or i1 %bad, %wrong
+  %cur = load atomic i32 (i32, i32)*, i32 (i32, i32)** @"add$orc_addr" unordered, align 8
+  %changed = icmp ne i32 (i32, i32)* %cur, %slow
+  br i1 %changed, label %found, label %sleep
+
+sleep:
+  %tries.next = add i32 %tries, 1
+  %timeout = icmp eq i32 %tries.next, 6000
+  call i32 @usleep(i32 10000)
+  br i1 %timeout, label %missed, label %wait
+
+found:
+  %again = call i32 @add(i32 40, i32 2)
+  %again.ok = icmp eq i32 %again, 42
+  %f = getelementptr [11 x i8], [11 x i8]* @repointed, i32 0, i32 0
+  call i32 (i8*, ...) @printf(i8* %f)
+  br label %exit
+
+missed:
+  %m = getelementptr [15 x i8], [15 x i8]* @not_repointed, i32 0, i32 0
+  call i32 (i8*, ...) @printf(i8* %m)
+  br label %exit
+
+exit:
+  %calls.ok = phi i1 [ %again.ok, %found ], [ true, %missed ]
+  %bad.final = phi i1 [ %bad.next, %found ], [ %bad.next, %missed ]
+  %sum.ok = icmp eq i32 %sum.next, 4950
+  %first.ok = icmp eq i32 %first, 0
+  %ok1 = and i1 %sum.ok, %first.ok
+  %ok2 = and i1 %ok1, %calls.ok
+  %good = xor i1 %bad.final, true
+  %ok = and i1 %ok2, %good
+  %ret = select i1 %ok, i32 0, i32 1
+  ret i32 %ret
+}
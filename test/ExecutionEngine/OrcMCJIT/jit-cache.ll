@@ -0,0 +1,23 @@
+; REQUIRES: asserts
+; RUN: rm -rf %t.cachedir
+; RUN: %lli -jit-kind=orc-mcjit -jit-cache-dir=%t.cachedir -stats %s 2>&1 | FileCheck %s --check-prefix=MISS
+; RUN: ls %t.cachedir | count 1
+; RUN: %lli -jit-kind=orc-mcjit -jit-cache-dir=%t.cachedir -stats %s 2>&1 | FileCheck %s --check-prefix=HIT
+
+; Objects compiled with different options are cached apart.
+; RUN: %lli -jit-kind=orc-mcjit -jit-cache-dir=%t.cachedir -O0 -stats %s 2>&1 | FileCheck %s --check-prefix=MISS
+; RUN: ls %t.cachedir | count 2
+
+; A size limit smaller than one object leaves no object behind.
+; RUN: %lli -jit-kind=orc-mcjit -jit-cache-dir=%t.cachedir -jit-cache-size-limit=1 -O1 -stats %s 2>&1 | FileCheck %s --check-prefix=MISS
+; RUN: ls %t.cachedir | count 0
+
+; MISS: 1 object-cache - Number of modules missing from the object cache
+; MISS-NOT: Number of objects loaded from the object cache
+
+; HIT: 1 object-cache - Number of objects loaded from the object cache
+; HIT-NOT: Number of modules missing from the object cache
+
+define i32 @main() {
+  ret i32 0
+}
@@ -0,0 +1,187 @@
+; RUN: %lli -force-interpreter=true %s | FileCheck %s
+; RUN: %lli -force-interpreter=true -interpreter-bytecode=false %s | FileCheck %s
+
+; Functions are lowered to bytecode unless they use something only the
+; instruction visitor handles, such as i128 in @wide; both must agree.
+
+@.fmt = private constant [4 x i8] c"%d\0A\00"
+@.lfmt = private constant [6 x i8] c"%lld\0A\00"
+@.ffmt = private constant [4 x i8] c"%g\0A\00"
+@table = global [4 x i16] [i16 10, i16 -20, i16 30, i16 -40]
+
+declare i32 @printf(i8*, ...)
+
+define void @print(i32 %v) {
+  %f = getelementptr [4 x i8], [4 x i8]* @.fmt, i32 0, i32 0
+  call i32 (i8*, ...) @printf(i8* %f, i32 %v)
+  ret void
+}
+
+define void @printl(i64 %v) {
+  %f = getelementptr [6 x i8], [6 x i8]* @.lfmt, i32 0, i32 0
+  call i32 (i8*, ...) @printf(i8* %f, i64 %v)
+  ret void
+}
+
+; Swapping PHI nodes must read both values before writing either.
+define i32 @swap(i32 %n) {
+entry:
+  br label %loop
+loop:
+  %a = phi i32 [ 1, %entry ], [ %b, %loop ]
+  %b = phi i32 [ 2, %entry ], [ %a, %loop ]
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+exit:
+  %r = mul i32 %a, 10
+  %s = add i32 %r, %b
+  ret i32 %s
+}
+
+define i32 @classify(i8 %c) {
+entry:
+  switch i8 %c, label %other [
+    i8 -1, label %minus
+    i8 7, label %seven
+    i8 8, label %seven
+  ]
+minus:
+  ret i32 -1
+seven:
+  %p = phi i32 [ 7, %entry ], [ 7, %entry ]
+  ret i32 %p
+other:
+  ret i32 0
+}
+
+; Arithmetic on odd widths must wrap and sign extend at the width.
+define i64 @narrow(i5 %x, i5 %y) {
+  %sum = add i5 %x, %y
+  %quot = sdiv i5 %x, %y
+  %rem = srem i5 %x, %y
+  %sh = ashr i5 %x, 1
+  %s1 = sext i5 %sum to i64
+  %s2 = sext i5 %quot to i64
+  %s3 = sext i5 %rem to i64
+  %s4 = zext i5 %sh to i64
+  %m1 = mul i64 %s1, 1000000
+  %m2 = mul i64 %s2, 10000
+  %m3 = mul i64 %s3, 100
+  %t1 = add i64 %m1, %m2
+  %t2 = add i64 %t1, %m3
+  %t3 = add i64 %t2, %s4
+  ret i64 %t3
+}
+
+define i32 @fcmps(double %a, double %b) {
+  %oeq = fcmp oeq double %a, %b
+  %une = fcmp une double %a, %b
+  %uno = fcmp uno double %a, %b
+  %olt = fcmp olt double %a, %b
+  %e1 = zext i1 %oeq to i32
+  %e2 = zext i1 %une to i32
+  %e3 = zext i1 %uno to i32
+  %e4 = zext i1 %olt to i32
+  %m2 = shl i32 %e2, 1
+  %m3 = shl i32 %e3, 2
+  %m4 = shl i32 %e4, 3
+  %o1 = or i32 %e1, %m2
+  %o2 = or i32 %o1, %m3
+  %o3 = or i32 %o2, %m4
+  ret i32 %o3
+}
+
+; Sum the table through a static and a dynamic alloca.
+define i32 @sum(i32 %n) {
+entry:
+  %acc = alloca i32
+  %flag = alloca i1
+  store i32 0, i32* %acc
+  store i1 true, i1* %flag
+  %buf = alloca i16, i32 %n
+  br label %loop
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %src = getelementptr [4 x i16], [4 x i16]* @table, i32 0, i32 %i
+  %v = load i16, i16* %src
+  %dst = getelementptr i16, i16* %buf, i32 %i
+  store i16 %v, i16* %dst
+  %w = load i16, i16* %dst
+  %wide = sext i16 %w to i32
+  %old = load i32, i32* %acc
+  %new = add i32 %old, %wide
+  store i32 %new, i32* %acc
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+exit:
+  %f = load i1, i1* %flag
+  %r = load i32, i32* %acc
+  %neg = sub i32 0, %r
+  %res = select i1 %f, i32 %neg, i32 %r
+  ret i32 %res
+}
+
+define i32 @wide(i32 %x) {
+  %w = zext i32 %x to i128
+  %s = shl i128 %w, 70
+  %t = lshr i128 %s, 69
+  %r = trunc i128 %t to i32
+  ret i32 %r
+}
+
+define i32 @apply(i32 (i32)* %f, i32 %x) {
+  %r = call i32 %f(i32 %x)
+  ret i32 %r
+}
+
+define float @convert(i32 %x) {
+  %d = sitofp i32 %x to double
+  %h = fmul double %d, 5.000000e-01
+  %f = fptrunc double %h to float
+  %bits = bitcast float %f to i32
+  %back = bitcast i32 %bits to float
+  ret float %back
+}
+
+define i32 @main() {
+  %r1 = call i32 @swap(i32 3)
+  call void @print(i32 %r1)
+; CHECK: 12
+  %r2 = call i32 @swap(i32 4)
+  call void @print(i32 %r2)
+; CHECK-NEXT: 21
+  %r3 = call i32 @classify(i8 255)
+  call void @print(i32 %r3)
+; CHECK-NEXT: -1
+  %r4 = call i32 @classify(i8 8)
+  call void @print(i32 %r4)
+; CHECK-NEXT: 7
+  %r5 = call i32 @classify(i8 9)
+  call void @print(i32 %r5)
+; CHECK-NEXT: 0
+  %r6 = call i64 @narrow(i5 13, i5 -4)
+  call void @printl(i64 %r6)
+; CHECK-NEXT: 8970106
+  %r7 = call i32 @fcmps(double 1.0, double 2.0)
+  call void @print(i32 %r7)
+; CHECK-NEXT: 10
+  %nan = fdiv double 0.0, 0.0
+  %r8 = call i32 @fcmps(double %nan, double 2.0)
+  call void @print(i32 %r8)
+; CHECK-NEXT: 6
+  %r9 = call i32 @sum(i32 4)
+  call void @print(i32 %r9)
+; CHECK-NEXT: 20
+  %r10 = call i32 @apply(i32 (i32)* @wide, i32 5)
+  call void @print(i32 %r10)
+; CHECK-NEXT: 10
+  %r11 = call float @convert(i32 -7)
+  %r11d = fpext float %r11 to double
+  %f = getelementptr [4 x i8], [4 x i8]* @.ffmt, i32 0, i32 0
+  call i32 (i8*, ...) @printf(i8* %f, double %r11d)
+; CHECK-NEXT: -3.5
+  ret i32 0
+}
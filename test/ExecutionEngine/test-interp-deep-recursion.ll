@@ -0,0 +1,37 @@
+; RUN: %lli -force-interpreter=true %s | FileCheck %s
+; RUN: %lli -force-interpreter=true -interpreter-bytecode=false %s | FileCheck %s
+
+; Calls between bytecode functions do not use the native stack, so recursion
+; tens of thousands of calls deep runs.  Each call keeps its own alloca live
+; across the recursive call.
+
+@.fmt = private constant [4 x i8] c"%d\0A\00"
+
+declare i32 @printf(i8*, ...)
+
+define i32 @sum(i32 %n) {
+entry:
+  %slot = alloca i32
+  store i32 %n, i32* %slot
+  %done = icmp eq i32 %n, 0
+  br i1 %done, label %exit, label %recurse
+
+recurse:
+  %m = sub i32 %n, 1
+  %rest = call i32 @sum(i32 %m)
+  %v = load i32, i32* %slot
+  %r = add i32 %v, %rest
+  ret i32 %r
+
+exit:
+  ret i32 0
+}
+
+define i32 @main() {
+  %s = call i32 @sum(i32 30000)
+  %f = getelementptr [4 x i8], [4 x i8]* @.fmt, i32 0, i32 0
+  call i32 (i8*, ...) @printf(i8* %f, i32 %s)
+  ret i32 0
+}
+
+; CHECK: 450015000
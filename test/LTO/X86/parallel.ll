@@ -0,0 +1,19 @@
+; RUN: llvm-as -o %t.bc %s
+; RUN: llvm-lto -exported-symbol=foo -exported-symbol=bar -j2 -o %t.o %t.bc
+; RUN: llvm-nm %t.o | FileCheck --check-prefix=CHECK0 %s
+; RUN: llvm-nm %t.o.1 | FileCheck --check-prefix=CHECK1 %s
+
+target triple = "x86_64-unknown-linux-gnu"
+
+; CHECK0: T foo
+define void @foo() {
+  call void @bar()
+  call void @bar()
+  call void @bar()
+  ret void
+}
+
+; CHECK1: T bar
+define void @bar() {
+  ret void
+}
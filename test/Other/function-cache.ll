@@ -0,0 +1,124 @@
+; REQUIRES: asserts
+; RUN: rm -rf %t
+; RUN: opt -S -instcombine -simplifycfg -function-cache-dir=%t %s -o %t.1.ll \
+; RUN:   -stats -info-output-file - | FileCheck %s --check-prefix=MISS
+; RUN: opt -S -instcombine -simplifycfg -function-cache-dir=%t %s -o %t.2.ll \
+; RUN:   -stats -info-output-file - | FileCheck %s --check-prefix=HIT
+; RUN: diff %t.1.ll %t.2.ll
+; RUN: FileCheck %s < %t.2.ll
+; RUN: not opt -inline -function-cache-dir=%t %s -o %t.3.ll 2>&1 \
+; RUN:   | FileCheck %s --check-prefix=ERR
+; RUN: rm -rf %t.O2
+; RUN: opt -S -O2 -function-cache-dir=%t.O2 %s -o %t.4.ll \
+; RUN:   -stats -info-output-file - | FileCheck %s --check-prefix=O2-MISS
+; RUN: opt -S -O2 -function-cache-dir=%t.O2 %s -o %t.5.ll \
+; RUN:   -stats -info-output-file - | FileCheck %s --check-prefix=O2-HIT
+; RUN: opt -S -O2 %s -o %t.6.ll
+; RUN: diff %t.4.ll %t.5.ll
+; RUN: diff %t.4.ll %t.6.ll
+; Check that opt reuses the optimized bodies of functions it has seen before,
+; and that with -O2 it caches the function passes that run ahead of the
+; standard pipeline.
+
+; MISS-NOT: function-cache
+; MISS: 7 function-cache - Number of function bodies added to the cache
+; MISS: 1 function-cache - Number of functions that cannot be cached
+
+; HIT: 7 function-cache - Number of function bodies reused from the cache
+; HIT-NOT: added to the cache
+; HIT: 1 function-cache - Number of functions that cannot be cached
+
+; ERR: -function-cache-dir cannot be used with pass 'inline'
+
+; O2-MISS: 7 function-cache - Number of function bodies added to the cache
+
+; O2-HIT: 7 function-cache - Number of function bodies reused from the cache
+; O2-HIT-NOT: added to the cache
+
+%pair = type { i32, i32 }
+
+@table = private unnamed_addr constant [2 x i32] [i32 3, i32 5]
+@g = global %pair zeroinitializer
+@buf = internal global [4 x i32] zeroinitializer
+@alias = alias i32 (i32)* @aliased
+
+; CHECK: @buf = internal global [4 x i32] zeroinitializer, align 16
+
+; CHECK-LABEL: define i32 @fold(i32 %x)
+; CHECK-NEXT: ret i32 8
+define i32 @fold(i32 %x) {
+  %a = getelementptr [2 x i32], [2 x i32]* @table, i32 0, i32 0
+  %b = getelementptr [2 x i32], [2 x i32]* @table, i32 0, i32 1
+  %c = load i32, i32* %a
+  %d = load i32, i32* %b
+  %e = add i32 %c, %d
+  ret i32 %e
+}
+
+; CHECK-LABEL: define void @store(i32 %x)
+; CHECK-NEXT: store i32 %x, i32* getelementptr inbounds (%pair, %pair* @g, i64 0, i32 1)
+define void @store(i32 %x) {
+  %p = getelementptr %pair, %pair* @g, i32 0, i32 1
+  store i32 %x, i32* %p
+  ret void
+}
+
+; CHECK-LABEL: define internal i32 @callee(i32 %x)
+define internal i32 @callee(i32 %x) {
+  %y = shl i32 %x, 0
+  ret i32 %y
+}
+
+; CHECK-LABEL: define i32 @caller(i32 %x)
+; CHECK: call i32 @callee(i32 %x), !dbg [[LOC:![0-9]+]]
+define i32 @caller(i32 %x) {
+entry:
+  br label %next
+next:
+  %r = call i32 @callee(i32 %x), !dbg !7
+  ret i32 %r
+}
+
+; CHECK-LABEL: define i32 @aliased(i32 %x)
+define i32 @aliased(i32 %x) {
+  %y = or i32 %x, 0
+  ret i32 %y
+}
+
+; Calls through an alias are folded by what the alias resolves to, which the
+; key does not capture.
+; CHECK-LABEL: define i32 @via_alias(i32 %x)
+define i32 @via_alias(i32 %x) {
+  %y = call i32 @alias(i32 %x)
+  ret i32 %y
+}
+
+; InstCombine raises the alignment of @buf, which must survive a hit.
+; CHECK-LABEL: define void @clear()
+; CHECK-NEXT: store <4 x i32> zeroinitializer, <4 x i32>* bitcast ([4 x i32]* @buf to <4 x i32>*), align 16
+define void @clear() {
+  store <4 x i32> zeroinitializer, <4 x i32>* bitcast ([4 x i32]* @buf to <4 x i32>*), align 1
+  ret void
+}
+
+; CHECK-LABEL: define i32 @lazy(i32 %x)
+; CHECK-NEXT: ret i32 %x
+define i32 @lazy(i32 %x) {
+  %y = xor i32 %x, 0
+  ret i32 %y
+}
+
+; CHECK: [[SP:![0-9]+]] = distinct !DISubprogram(name: "caller"
+; CHECK: [[LOC]] = !DILocation(line: 2, column: 3, scope: [[SP]])
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!6}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, producer: "clang", isOptimized: true, runtimeVersion: 0, emissionKind: 1, subprograms: !2)
+!1 = !DIFile(filename: "t.c", directory: "/tmp")
+!2 = !{!3}
+!3 = distinct !DISubprogram(name: "caller", scope: !1, file: !1, line: 1, type: !4, isLocal: false, isDefinition: true, scopeLine: 1, isOptimized: true, function: i32 (i32)* @caller)
+!4 = !DISubroutineType(types: !5)
+!5 = !{null}
+!6 = !{i32 2, !"Debug Info Version", i32 3}
+!7 = !DILocation(line: 2, column: 3, scope: !3)
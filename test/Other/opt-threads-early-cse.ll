@@ -0,0 +1,80 @@
+; RUN: opt -early-cse -S %s -o %t.serial
+; RUN: opt -early-cse -threads=4 -debug-pass=Structure -S %s -o %t.parallel \
+; RUN:   2>&1 | FileCheck %s --check-prefix=STRUCTURE
+; RUN: diff %t.serial %t.parallel
+; RUN: FileCheck %s < %t.parallel
+; Check that EarlyCSE runs on several functions at once, and that folding
+; constants and removing loads of the shared globals gives the same output as
+; running it on one thread.  In builds with LLVM_USE_SANITIZER=Thread this also
+; checks EarlyCSE for data races.
+
+; STRUCTURE: FunctionPass Manager (4 threads)
+; STRUCTURE: Early CSE
+
+@g = global i32 0
+@h = global [4 x i32] zeroinitializer
+
+declare i32 @pure(i32) readnone
+declare void @llvm.assume(i1)
+
+; CHECK-LABEL: define i32 @f0(
+; CHECK: load i32, i32* @g
+; CHECK-NOT: load
+; CHECK: ret i32
+define i32 @f0() {
+  %a = load i32, i32* @g
+  %b = load i32, i32* @g
+  %r = add i32 %a, %b
+  ret i32 %r
+}
+
+; CHECK-LABEL: define i32 @f1(
+; CHECK: ret i32 %v
+define i32 @f1(i32 %v) {
+  store i32 %v, i32* @g
+  %a = load i32, i32* @g
+  ret i32 %a
+}
+
+; CHECK-LABEL: define i32 @f2(
+; CHECK: call i32 @pure(i32 ptrtoint (i32* @g to i32))
+; CHECK-NOT: call
+define i32 @f2() {
+  %a = call i32 @pure(i32 ptrtoint (i32* @g to i32))
+  %b = call i32 @pure(i32 ptrtoint (i32* @g to i32))
+  %r = add i32 %a, %b
+  ret i32 %r
+}
+
+; CHECK-LABEL: define i32 @f3(
+; CHECK: ret i32 %x
+define i32 @f3(i32 %x) {
+  %a = add i32 %x, 0
+  %p = getelementptr [4 x i32], [4 x i32]* @h, i32 0, i32 2
+  %b = load i32, i32* %p
+  %c = load i32, i32* getelementptr ([4 x i32], [4 x i32]* @h, i32 0, i32 2)
+  %d = sub i32 %b, %c
+  %r = add i32 %a, %d
+  ret i32 %r
+}
+
+; CHECK-LABEL: define i1 @f4(
+; CHECK: ret i1 false
+define i1 @f4(i32 %x) {
+  %m = and i32 %x, 3
+  %c = icmp eq i32 %m, 0
+  call void @llvm.assume(i1 %c)
+  %r = icmp eq i32 %x, 5
+  ret i1 %r
+}
+
+; CHECK-LABEL: define i1 @f5(
+; CHECK: ret i1 false
+define i1 @f5(i32 %x) {
+  %c = icmp eq i32* @g, null
+  %o = or i32 %x, ptrtoint ([4 x i32]* @h to i32)
+  %p = or i32 %o, 1
+  %d = icmp eq i32 %p, 0
+  %r = or i1 %c, %d
+  ret i1 %r
+}
@@ -0,0 +1,122 @@
+; RUN: opt -mem2reg -S %s -o %t.serial
+; RUN: opt -mem2reg -threads=4 -debug-pass=Structure -S %s -o %t.parallel \
+; RUN:   2>&1 | FileCheck %s --check-prefix=STRUCTURE
+; RUN: diff %t.serial %t.parallel
+; RUN: FileCheck %s < %t.parallel
+; Check that mem2reg runs on several functions at once, and that promoting
+; allocas that hold the shared globals and constant expressions gives the same
+; output as running it on one thread.  In builds with
+; LLVM_USE_SANITIZER=Thread this also checks mem2reg for data races.
+
+; STRUCTURE: FunctionPass Manager (4 threads)
+; STRUCTURE-NEXT: Dominator Tree Construction
+; STRUCTURE-NEXT: Promote Memory to Register
+
+@g = global i32 0
+@h = global i32 1
+
+; CHECK-LABEL: define i32* @f0(
+; CHECK-NOT: alloca
+; CHECK: phi i32* [ @g, %then ], [ @h, %else ]
+define i32* @f0(i1 %c) {
+entry:
+  %a = alloca i32*
+  br i1 %c, label %then, label %else
+
+then:
+  store i32* @g, i32** %a
+  br label %exit
+
+else:
+  store i32* @h, i32** %a
+  br label %exit
+
+exit:
+  %v = load i32*, i32** %a
+  ret i32* %v
+}
+
+; CHECK-LABEL: define i32 @f1(
+; CHECK-NOT: alloca
+define i32 @f1(i32 %n) {
+entry:
+  %i = alloca i32
+  %s = alloca i32
+  store i32 0, i32* %i
+  store i32 ptrtoint (i32* @g to i32), i32* %s
+  br label %loop
+
+loop:
+  %iv = load i32, i32* %i
+  %sv = load i32, i32* %s
+  %sn = add i32 %sv, ptrtoint (i32* @h to i32)
+  store i32 %sn, i32* %s
+  %in = add i32 %iv, 1
+  store i32 %in, i32* %i
+  %c = icmp slt i32 %in, %n
+  br i1 %c, label %loop, label %exit
+
+exit:
+  %r = load i32, i32* %s
+  ret i32 %r
+}
+
+; CHECK-LABEL: define i32 @f2(
+; CHECK-NOT: alloca
+define i32 @f2(i32 %x) {
+entry:
+  %a = alloca i32
+  %b = alloca i32*
+  store i32 %x, i32* %a
+  store i32* @g, i32** %b
+  %p = load i32*, i32** %b
+  %v = load i32, i32* %p
+  %w = load i32, i32* %a
+  %r = add i32 %v, %w
+  ret i32 %r
+}
+
+; CHECK-LABEL: define i32* @f3(
+; CHECK-NOT: alloca
+; CHECK: phi i32* [ @h, %then ], [ @g, %entry ]
+define i32* @f3(i1 %c) {
+entry:
+  %a = alloca i32*
+  store i32* @g, i32** %a
+  br i1 %c, label %then, label %exit
+
+then:
+  store i32* @h, i32** %a
+  br label %exit
+
+exit:
+  %v = load i32*, i32** %a
+  ret i32* %v
+}
+
+; CHECK-LABEL: define i32 @f4(
+; CHECK-NOT: alloca
+define i32 @f4(i1 %c) {
+entry:
+  %a = alloca i32
+  br i1 %c, label %then, label %exit
+
+then:
+  store i32 ptrtoint (i32* @h to i32), i32* %a
+  br label %exit
+
+exit:
+  %v = load i32, i32* %a
+  ret i32 %v
+}
+
+; CHECK-LABEL: define void @f5(
+; CHECK-NOT: alloca
+define void @f5(i32 %x) {
+entry:
+  %a = alloca i32*
+  store i32* @h, i32** %a
+  %p = load i32*, i32** %a
+  store i32 %x, i32* %p
+  ret void
+}
@@ -0,0 +1,107 @@
+; RUN: opt -sroa -S %s -o %t.serial
+; RUN: opt -sroa -threads=4 -debug-pass=Structure -S %s -o %t.parallel 2>&1 \
+; RUN:   | FileCheck %s --check-prefix=STRUCTURE
+; RUN: diff %t.serial %t.parallel
+; RUN: FileCheck %s < %t.parallel
+; Check that SROA runs on several functions at once, and that the loads,
+; constant expressions and uses of the shared globals it creates give the same
+; output as running it on one thread.  In builds with
+; LLVM_USE_SANITIZER=Thread this also checks SROA for data races.
+
+; STRUCTURE: FunctionPass Manager (4 threads)
+; STRUCTURE-NEXT: Dominator Tree Construction
+; STRUCTURE-NEXT: SROA
+
+%pair = type { i32, i32 }
+
+@init = constant %pair { i32 1, i32 2 }
+@g = global %pair zeroinitializer
+
+declare void @llvm.memcpy.p0i8.p0i8.i64(i8* nocapture, i8* nocapture readonly, i64, i32, i1)
+
+; CHECK-LABEL: define i32 @f0(
+; CHECK-NOT: alloca
+; CHECK: load i32, i32* getelementptr inbounds (%pair, %pair* @init, i64 0, i32 0)
+define i32 @f0() {
+  %a = alloca %pair
+  %p = bitcast %pair* %a to i8*
+  call void @llvm.memcpy.p0i8.p0i8.i64(i8* %p, i8* bitcast (%pair* @init to i8*), i64 8, i32 4, i1 false)
+  %x = getelementptr %pair, %pair* %a, i32 0, i32 0
+  %y = getelementptr %pair, %pair* %a, i32 0, i32 1
+  %vx = load i32, i32* %x
+  %vy = load i32, i32* %y
+  %r = add i32 %vx, %vy
+  ret i32 %r
+}
+
+; CHECK-LABEL: define i32 @f1(
+; CHECK-NOT: alloca
+; CHECK: load i32, i32* getelementptr inbounds (%pair, %pair* @g, i64 0, i32 1)
+define i32 @f1(i32 %n) {
+  %a = alloca %pair
+  %p = bitcast %pair* %a to i8*
+  call void @llvm.memcpy.p0i8.p0i8.i64(i8* %p, i8* bitcast (%pair* @g to i8*), i64 8, i32 4, i1 false)
+  %y = getelementptr %pair, %pair* %a, i32 0, i32 1
+  %vy = load i32, i32* %y
+  %r = mul i32 %vy, %n
+  ret i32 %r
+}
+
+; CHECK-LABEL: define void @f2(
+; CHECK-NOT: alloca
+define void @f2(i32 %v) {
+  %a = alloca %pair
+  %x = getelementptr %pair, %pair* %a, i32 0, i32 0
+  %y = getelementptr %pair, %pair* %a, i32 0, i32 1
+  store i32 %v, i32* %x
+  store i32 %v, i32* %y
+  %p = bitcast %pair* %a to i8*
+  call void @llvm.memcpy.p0i8.p0i8.i64(i8* bitcast (%pair* @g to i8*), i8* %p, i64 8, i32 4, i1 false)
+  ret void
+}
+
+; CHECK-LABEL: define i32 @f3(
+; CHECK-NOT: alloca
+define i32 @f3(i1 %c) {
+entry:
+  %a = alloca i32
+  br i1 %c, label %then, label %else
+
+then:
+  store i32 ptrtoint (%pair* @g to i32), i32* %a
+  br label %exit
+
+else:
+  store i32 ptrtoint (%pair* @init to i32), i32* %a
+  br label %exit
+
+exit:
+  %v = load i32, i32* %a
+  ret i32 %v
+}
+
+; CHECK-LABEL: define i32 @f4(
+; CHECK-NOT: alloca
+; CHECK: load i32, i32* getelementptr inbounds (%pair, %pair* @init, i64 0, i32 0)
+define i32 @f4() {
+  %a = alloca %pair
+  %p = bitcast %pair* %a to i8*
+  call void @llvm.memcpy.p0i8.p0i8.i64(i8* %p, i8* bitcast (%pair* @init to i8*), i64 8, i32 4, i1 false)
+  %x = getelementptr %pair, %pair* %a, i32 0, i32 0
+  %vx = load i32, i32* %x
+  ret i32 %vx
+}
+
+; CHECK-LABEL: define i32 @f5(
+; CHECK-NOT: alloca
+define i32 @f5(i32 %n) {
+  %a = alloca [4 x i32]
+  %e0 = getelementptr [4 x i32], [4 x i32]* %a, i32 0, i32 0
+  %e3 = getelementptr [4 x i32], [4 x i32]* %a, i32 0, i32 3
+  store i32 %n, i32* %e0
+  store i32 ptrtoint (%pair* @g to i32), i32* %e3
+  %v0 = load i32, i32* %e0
+  %v3 = load i32, i32* %e3
+  %r = xor i32 %v0, %v3
+  ret i32 %r
+}
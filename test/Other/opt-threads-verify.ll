@@ -0,0 +1,58 @@
+; RUN: opt -verify -threads=4 -debug-pass=Structure -S %s -o %t 2>&1 \
+; RUN:   | FileCheck %s --check-prefix=STRUCTURE
+; RUN: FileCheck %s < %t
+; Check that the verifier runs on several functions at once over functions
+; that share globals, constant expressions and metadata.  In builds with
+; LLVM_USE_SANITIZER=Thread this also checks the verifier for data races.
+
+; STRUCTURE: FunctionPass Manager (4 threads)
+; STRUCTURE-NEXT: Module Verifier
+
+@g = global i32 0
+@h = global [4 x i32] zeroinitializer
+
+declare void @use(i32*)
+
+; CHECK-LABEL: define i32 @f0(
+define i32 @f0() {
+  %a = load i32, i32* @g, !tbaa !0
+  ret i32 %a
+}
+
+; CHECK-LABEL: define void @f1(
+define void @f1(i32 %v) {
+  store i32 %v, i32* getelementptr ([4 x i32], [4 x i32]* @h, i32 0, i32 1), !tbaa !0
+  ret void
+}
+
+; CHECK-LABEL: define void @f2(
+define void @f2() {
+  call void @use(i32* @g)
+  call void @use(i32* getelementptr ([4 x i32], [4 x i32]* @h, i32 0, i32 1))
+  ret void
+}
+
+; CHECK-LABEL: define i32 @f3(
+define i32 @f3(i1 %c) {
+entry:
+  br i1 %c, label %then, label %exit, !prof !3
+
+then:
+  %a = load i32, i32* @g, !tbaa !0
+  br label %exit
+
+exit:
+  %r = phi i32 [ %a, %then ], [ ptrtoint (i32* @g to i32), %entry ]
+  ret i32 %r
+}
+
+; CHECK-LABEL: define i32* @f4(
+define i32* @f4(i32 %i) {
+  %p = getelementptr [4 x i32], [4 x i32]* @h, i32 0, i32 %i
+  ret i32* %p
+}
+
+!0 = !{!1, !1, i64 0}
+!1 = !{!"int", !2, i64 0}
+!2 = !{!"tbaa root"}
+!3 = !{!"branch_weights", i32 64, i32 4}
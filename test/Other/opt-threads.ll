@@ -0,0 +1,108 @@
+; RUN: opt -O2 -S %s -o %t.serial
+; RUN: opt -O2 -threads=4 -S %s -o %t.parallel
+; RUN: diff %t.serial %t.parallel
+; RUN: opt -instcombine -simplifycfg -gvn -licm -S %s -o %t.serial
+; RUN: opt -instcombine -simplifycfg -gvn -licm -threads=4 -S %s -o %t.parallel
+; RUN: diff %t.serial %t.parallel
+; RUN: FileCheck %s < %t.parallel
+; RUN: opt -instcombine -sroa -threads=4 -debug-pass=Structure -disable-output \
+; RUN:   %s 2>&1 | FileCheck %s --check-prefix=SERIAL
+; Check that -threads gives the same output as running the passes on one
+; thread, and that groups with passes that are not known to be safe to run on
+; several functions at once run on one thread.  The passes that do run in
+; parallel each have a test of their own in opt-threads-*.ll.
+
+; SERIAL: FunctionPass Manager
+; SERIAL-NOT: threads)
+
+@g = global [16 x i32] zeroinitializer
+@h = global i32 0
+
+; CHECK-LABEL: define i32 @f0(
+; CHECK-NOT: add i32 %x, 0
+; CHECK: ret i32
+define i32 @f0(i32 %x) {
+entry:
+  %a = add i32 %x, 0
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %s = phi i32 [ %a, %entry ], [ %s.next, %loop ]
+  %p = getelementptr [16 x i32], [16 x i32]* @g, i32 0, i32 %i
+  %v = load i32, i32* %p, !tbaa !0
+  %w = load i32, i32* @h, !tbaa !0
+  %t = add i32 %v, %w
+  %s.next = add i32 %s, %t
+  %i.next = add i32 %i, 1
+  %c = icmp ult i32 %i.next, 16
+  br i1 %c, label %loop, label %exit, !prof !3
+
+exit:
+  ret i32 %s.next
+}
+
+; CHECK-LABEL: define i32 @f1(
+define i32 @f1(i32 %x) {
+entry:
+  %a = mul i32 %x, 1
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %s = phi i32 [ %a, %entry ], [ %s.next, %loop ]
+  %p = getelementptr [16 x i32], [16 x i32]* @g, i32 0, i32 %i
+  %v = load i32, i32* %p, !tbaa !0
+  %w = load i32, i32* @h, !tbaa !0
+  %t = xor i32 %v, %w
+  %s.next = add i32 %s, %t
+  store i32 %s.next, i32* %p, !tbaa !0
+  %i.next = add i32 %i, 1
+  %c = icmp ult i32 %i.next, 16
+  br i1 %c, label %loop, label %exit, !prof !3
+
+exit:
+  ret i32 %s.next
+}
+
+; CHECK-LABEL: define i64 @f2(
+define i64 @f2(i64 %x, i64 %y) {
+entry:
+  %c = icmp eq i64 %x, 42
+  br i1 %c, label %then, label %else
+
+then:
+  %a = add i64 %y, 12345678901
+  br label %exit
+
+else:
+  %b = sub i64 %y, 12345678901
+  br label %exit
+
+exit:
+  %r = phi i64 [ %a, %then ], [ %b, %else ]
+  ret i64 %r
+}
+
+; CHECK-LABEL: define <4 x float> @f3(
+define <4 x float> @f3(<4 x float> %x) {
+  %a = fadd <4 x float> %x, <float 1.0, float 2.0, float 3.0, float 4.0>
+  %b = fadd <4 x float> %a, <float 1.0, float 2.0, float 3.0, float 4.0>
+  %c = fmul <4 x float> %b, <float 1.0, float 1.0, float 1.0, float 1.0>
+  ret <4 x float> %c
+}
+
+; CHECK-LABEL: define i32 @f4(
+define i32 @f4(i32 %x) {
+  %a = call i32 @f0(i32 %x)
+  %b = call i32 @f1(i32 %a)
+  %p = getelementptr [16 x i32], [16 x i32]* @g, i32 0, i32 3
+  store i32 %b, i32* %p, !tbaa !0
+  %c = load i32, i32* %p, !tbaa !0
+  ret i32 %c
+}
+
+!0 = !{!1, !1, i64 0}
+!1 = !{!"int", !2, i64 0}
+!2 = !{!"tbaa root"}
+!3 = !{!"branch_weights", i32 64, i32 4}
@@ -0,0 +1,19 @@
+; RUN: opt -instcombine -globaldce -time-passes-trace=%t.json %s -o /dev/null
+; RUN: FileCheck %s < %t.json
+; Check that -time-passes-trace writes an event per pass per function.
+
+; CHECK: {"traceEvents":[
+; CHECK-DAG: "name":"Module Verifier","args":{"detail":"f1","rss_delta":{{-?[0-9]+}}}}
+; CHECK-DAG: "name":"Combine redundant instructions","args":{"detail":"f1",
+; CHECK-DAG: "name":"Combine redundant instructions","args":{"detail":"f\"quoted\\",
+; CHECK-DAG: "name":"Dead Global Elimination","args":{"detail":"{{.*}}time-passes-trace.ll",
+; CHECK: ],"displayTimeUnit":"ms"}
+
+define i32 @f1(i32 %x) {
+  %y = add i32 %x, 0
+  ret i32 %y
+}
+
+define void @"f\22quoted\5C"() {
+  ret void
+}
@@ -1,4 +1,5 @@
 ; RUN: opt < %s -S -basicaa -licm | FileCheck %s
+; RUN: opt < %s -S -basicaa -licm -enable-mssa-loop-dependency -verify-memoryssa | FileCheck %s
 
 ; Check that we can hoist unordered loads
 define i32 @test1(i32* nocapture %y) nounwind uwtable ssp {
@@ -0,0 +1,81 @@
+; RUN: opt -S -basicaa -licm < %s | FileCheck %s --check-prefix=AST
+; RUN: opt -S -basicaa -licm -enable-mssa-loop-dependency -verify-memoryssa < %s | FileCheck %s --check-prefix=MSSA
+;
+; %r may alias both @a and @b, so the alias set tracker puts the three
+; accesses in one set, which the store makes Mod. MemorySSA only sees that
+; the store to @b does not write @a, so the load of @a is hoisted.
+
+@a = global i32 0
+@b = global i32 0
+
+define i32 @f(i32* %r, i32 %n) {
+; AST-LABEL: @f(
+; AST: loop:
+; AST: load i32, i32* @a
+; MSSA-LABEL: @f(
+; MSSA: entry:
+; MSSA-NEXT: %va = load i32, i32* @a
+; MSSA: loop:
+; MSSA-NOT: load i32, i32* @a
+; MSSA: load i32, i32* %r
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %sum = phi i32 [ 0, %entry ], [ %sum.next, %loop ]
+  %va = load i32, i32* @a
+  %vr = load i32, i32* %r
+  store i32 %i, i32* @b
+  %add = add i32 %va, %vr
+  %sum.next = add i32 %sum, %add
+  %i.next = add i32 %i, 1
+  %cond = icmp slt i32 %i.next, %n
+  br i1 %cond, label %loop, label %exit
+
+exit:
+  ret i32 %sum.next
+}
+
+; A store in the loop that may alias the load keeps it in the loop.
+define i32 @g(i32* %r, i32 %n) {
+; MSSA-LABEL: @g(
+; MSSA: loop:
+; MSSA: %va = load i32, i32* @a
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %sum = phi i32 [ 0, %entry ], [ %sum.next, %loop ]
+  %va = load i32, i32* @a
+  store i32 %i, i32* %r
+  %sum.next = add i32 %sum, %va
+  %i.next = add i32 %i, 1
+  %cond = icmp slt i32 %i.next, %n
+  br i1 %cond, label %loop, label %exit
+
+exit:
+  ret i32 %sum.next
+}
+
+; A load that is only used after the loop is sunk into the exit block.
+define i32 @h(i32* %r, i32 %n) {
+; MSSA-LABEL: @h(
+; MSSA: exit:
+; MSSA: %va.le = load i32, i32* @a
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %va = load i32, i32* @a
+  store i32 %i, i32* @b
+  %i.next = add i32 %i, 1
+  %cond = icmp slt i32 %i.next, %n
+  br i1 %cond, label %loop, label %exit
+
+exit:
+  %va.lcssa = phi i32 [ %va, %loop ]
+  ret i32 %va.lcssa
+}
@@ -1,4 +1,5 @@
 ; RUN: opt < %s -licm -S | FileCheck %s
+; RUN: opt < %s -licm -enable-mssa-loop-dependency -verify-memoryssa -S | FileCheck %s
 
 @X = global i32 0		; <i32*> [#uses=1]
 
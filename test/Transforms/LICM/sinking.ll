@@ -1,4 +1,5 @@
 ; RUN: opt < %s -basicaa -licm -S | FileCheck %s
+; RUN: opt < %s -basicaa -licm -enable-mssa-loop-dependency -verify-memoryssa -S | FileCheck %s
 
 declare i32 @strlen(i8*) readonly
 
@@ -1,9 +1,11 @@
-; The two profiles used in this test are the same but encoded in different
-; formats. This checks that we produce the same profile annotations regardless
-; of the profile format.
+; The profiles used in this test are the same but encoded in different
+; formats, the indexed one being converted from the text one. This checks that
+; we produce the same profile annotations regardless of the profile format.
 ;
 ; RUN: opt < %s -sample-profile -sample-profile-file=%S/Inputs/fnptr.prof | opt -analyze -branch-prob | FileCheck %s
 ; RUN: opt < %s -sample-profile -sample-profile-file=%S/Inputs/fnptr.binprof | opt -analyze -branch-prob | FileCheck %s
+; RUN: llvm-profdata merge --sample --indexed-binary %S/Inputs/fnptr.prof -o %t.idxprof
+; RUN: opt < %s -sample-profile -sample-profile-file=%t.idxprof | opt -analyze -branch-prob | FileCheck %s
 
 ; CHECK:   edge for.body3 -> if.then probability is 534 / 2598 = 20.5543%
 ; CHECK:   edge for.body3 -> if.else probability is 2064 / 2598 = 79.4457%
@@ -1,5 +1,19 @@
 // RUN: llvm-cov report %S/Inputs/report.covmapping -instr-profile %S/Inputs/report.profdata -filename-equivalence 2>&1 | FileCheck %s
 // RUN: llvm-cov report %S/Inputs/report.covmapping -instr-profile %S/Inputs/report.profdata -filename-equivalence report.cpp 2>&1 | FileCheck -check-prefix=FILT-NEXT %s
+// RUN: llvm-cov report %S/Inputs/report.covmapping -instr-profile %S/Inputs/report.profdata -filename-equivalence -j 2 2>&1 | FileCheck %s
+// RUN: llvm-cov show %S/Inputs/report.covmapping -instr-profile %S/Inputs/report.profdata -filename-equivalence %s > %t.show
+// RUN: llvm-cov show %S/Inputs/report.covmapping -instr-profile %S/Inputs/report.profdata -filename-equivalence -j 2 %s | diff %t.show -
+// RUN: rm -rf %t.cache
+// RUN: llvm-cov report %S/Inputs/report.covmapping -instr-profile %S/Inputs/report.profdata -filename-equivalence -mapping-cache-dir %t.cache 2>&1 | FileCheck %s
+// RUN: ls %t.cache | count 1
+// RUN: llvm-cov report %S/Inputs/report.covmapping -instr-profile %S/Inputs/report.profdata -filename-equivalence -mapping-cache-dir %t.cache 2>&1 | FileCheck %s
+// RUN: llvm-cov show %S/Inputs/report.covmapping -instr-profile %S/Inputs/report.profdata -filename-equivalence -mapping-cache-dir %t.cache %s | diff %t.show -
+// RUN: %python -c "import os; f = '%t.cache/0123456789abcdef0123456789abcdef'; open(f, 'wb').write(b'\0' * (2 << 20)); os.utime(f, (0, 0))"
+// RUN: cp %S/Inputs/report.covmapping %t.other
+// RUN: llvm-cov report %t.other -instr-profile %S/Inputs/report.profdata -filename-equivalence -mapping-cache-dir %t.cache -mapping-cache-size-limit 1 2>&1 | FileCheck %s
+// RUN: ls %t.cache | count 2
+// RUN: not ls %t.cache/0123456789abcdef0123456789abcdef
+// RUN: not llvm-cov show %S/Inputs/report.covmapping -instr-profile %S/Inputs/report.profdata -filename-equivalence -use-color -j 2 %s 2>&1 | FileCheck %s --check-prefix=COLOR
 
 // CHECK:      Filename   Regions  Miss   Cover  Functions  Executed
 // CHECK-NEXT: ---
@@ -7,6 +21,8 @@
 // CHECK-NEXT: ---
 // CHECK-NEXT: TOTAL            5     2  60.00%          4    75.00%
 
+// COLOR: error: -use-color cannot be combined with -num-threads
+
 // FILT: File 'report.cpp':
 // FILT-NEXT: Name        Regions  Miss   Cover  Lines  Miss   Cover
 // FILT-NEXT: ---
@@ -14,12 +14,14 @@
 
 #include "llvm/Config/config.h" // plugin-api.h requires HAVE_STDINT_H
 #include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
 #include "llvm/Analysis/TargetTransformInfo.h"
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/CodeGen/Analysis.h"
 #include "llvm/CodeGen/CommandFlags.h"
+#include "llvm/CodeGen/ParallelCG.h"
 #include "llvm/IR/AutoUpgrade.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DiagnosticInfo.h"
@@ -92,6 +94,9 @@ namespace options {
   static bool generate_api_file = false;
   static OutputType TheOutputType = OT_NORMAL;
   static unsigned OptLevel = 2;
+  // Number of partitions the merged module is split into for parallel code
+  // generation.
+  static unsigned Parallelism = 1;
   static std::string obj_path;
   static std::string extra_library_path;
   static std::string triple;
@@ -125,6 +130,11 @@ namespace options {
       TheOutputType = OT_SAVE_TEMPS;
     } else if (opt == "disable-output") {
       TheOutputType = OT_DISABLE;
+    } else if (opt.startswith("jobs=")) {
+      if (opt.substr(strlen("jobs=")).getAsInteger(10, Parallelism) ||
+          !Parallelism)
+        message(LDPL_FATAL, "Invalid parallelism level: %s",
+                opt_ + strlen("jobs="));
     } else if (opt.size() == 2 && opt[0] == 'O') {
       if (opt[1] < '0' || opt[1] > '3')
         report_fatal_error("Optimization level must be between 0 and 3");
@@ -739,7 +749,8 @@ static void saveBCFile(StringRef Path, Module &M) {
   raw_fd_ostream OS(Path, EC, sys::fs::OpenFlags::F_None);
   if (EC)
     message(LDPL_FATAL, "Failed to write the output file.");
-  WriteBitcodeToFile(&M, OS, /* ShouldPreserveUseListOrder */ true);
+  WriteBitcodeToFile(&M, OS, /* ShouldPreserveUseListOrder */ true,
+                     options::Parallelism);
 }
 
 static void codegen(Module &M) {
@@ -775,54 +786,77 @@ static void codegen(Module &M) {
     CGOptLevel = CodeGenOpt::Aggressive;
     break;
   }
-  std::unique_ptr<TargetMachine> TM(TheTarget->createTargetMachine(
-      TripleStr, options::mcpu, Features.getString(), Options, RelocationModel,
-      CodeModel::Default, CGOptLevel));
+  std::string FeaturesStr = Features.getString();
+  auto CreateTargetMachine = [&]() {
+    return std::unique_ptr<TargetMachine>(TheTarget->createTargetMachine(
+        TripleStr, options::mcpu, FeaturesStr, Options, RelocationModel,
+        CodeModel::Default, CGOptLevel));
+  };
+  std::unique_ptr<TargetMachine> TM = CreateTargetMachine();
 
   runLTOPasses(M, *TM);
 
   if (options::TheOutputType == options::OT_SAVE_TEMPS)
     saveBCFile(output_name + ".opt.bc", M);
 
-  legacy::PassManager CodeGenPasses;
-
   SmallString<128> Filename;
   if (!options::obj_path.empty())
     Filename = options::obj_path;
   else if (options::TheOutputType == options::OT_SAVE_TEMPS)
     Filename = output_name + ".o";
 
-  int FD;
+  // Open one object file per partition. When the file name is fixed,
+  // partition I > 0 is written to <file>.I.
   bool TempOutFile = Filename.empty();
-  if (TempOutFile) {
-    std::error_code EC =
-        sys::fs::createTemporaryFile("lto-llvm", "o", FD, Filename);
-    if (EC)
-      message(LDPL_FATAL, "Could not create temporary file: %s",
-              EC.message().c_str());
-  } else {
-    std::error_code EC =
-        sys::fs::openFileForWrite(Filename.c_str(), FD, sys::fs::F_None);
-    if (EC)
-      message(LDPL_FATAL, "Could not open file: %s", EC.message().c_str());
+  std::vector<std::string> Filenames;
+  std::list<raw_fd_ostream> OSs;
+  std::vector<raw_pwrite_stream *> OSPtrs;
+  for (unsigned I = 0; I != options::Parallelism; ++I) {
+    SmallString<128> PartFilename;
+    int FD;
+    if (TempOutFile) {
+      std::error_code EC =
+          sys::fs::createTemporaryFile("lto-llvm", "o", FD, PartFilename);
+      if (EC)
+        message(LDPL_FATAL, "Could not create temporary file: %s",
+                EC.message().c_str());
+    } else {
+      PartFilename = Filename;
+      if (I != 0)
+        PartFilename += "." + utostr(I);
+      std::error_code EC = sys::fs::openFileForWrite(PartFilename.c_str(), FD,
+                                                     sys::fs::F_None);
+      if (EC)
+        message(LDPL_FATAL, "Could not open file: %s", EC.message().c_str());
+    }
+    Filenames.push_back(PartFilename.str());
+    OSs.emplace_back(FD, true);
+    OSPtrs.push_back(&OSs.back());
   }
 
-  {
-    raw_fd_ostream OS(FD, true);
-
-    if (TM->addPassesToEmitFile(CodeGenPasses, OS,
+  if (options::Parallelism == 1) {
+    legacy::PassManager CodeGenPasses;
+    if (TM->addPassesToEmitFile(CodeGenPasses, *OSPtrs[0],
                                 TargetMachine::CGFT_ObjectFile))
       message(LDPL_FATAL, "Failed to setup codegen");
     CodeGenPasses.run(M);
+  } else {
+    std::string ErrMsg;
+    if (splitCodeGen(M, OSPtrs, CreateTargetMachine, ErrMsg))
+      message(LDPL_FATAL, "Failed to generate code: %s", ErrMsg.c_str());
   }
+  // Flush and close the object files before handing them to the linker.
+  OSs.clear();
 
-  if (add_input_file(Filename.c_str()) != LDPS_OK)
-    message(LDPL_FATAL,
-            "Unable to add .o file to the link. File left behind in: %s",
-            Filename.c_str());
+  for (const std::string &PartFilename : Filenames) {
+    if (add_input_file(PartFilename.c_str()) != LDPS_OK)
+      message(LDPL_FATAL,
+              "Unable to add .o file to the link. File left behind in: %s",
+              PartFilename.c_str());
 
-  if (TempOutFile)
-    Cleanup.push_back(Filename.c_str());
+    if (TempOutFile)
+      Cleanup.push_back(PartFilename);
+  }
 }
 
 /// gold informs us that all symbols have been read. At this point, we use
@@ -15,12 +15,14 @@
 
 
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
 #include "llvm/CodeGen/CommandFlags.h"
 #include "llvm/CodeGen/LinkAllAsmWriterComponents.h"
 #include "llvm/CodeGen/LinkAllCodegenComponents.h"
 #include "llvm/CodeGen/MIRParser/MIRParser.h"
+#include "llvm/CodeGen/ParallelCG.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/IRPrintingPasses.h"
 #include "llvm/IR/LLVMContext.h"
@@ -32,9 +34,12 @@
 #include "llvm/Pass.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/FileCache.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/FormattedStream.h"
 #include "llvm/Support/Host.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/PluginLoader.h"
 #include "llvm/Support/PrettyStackTrace.h"
@@ -96,8 +101,51 @@ static cl::opt<bool> AsmVerbose("asm-verbose",
                                 cl::desc("Add comments to directives."),
                                 cl::init(true));
 
+static cl::opt<unsigned>
+SplitThreads("threads", cl::init(1u), cl::value_desc("N"),
+             cl::desc("Split the module into N partitions and generate code "
+                      "for them in parallel. Partition I > 0 is written to "
+                      "<output>.I"));
+
+static cl::opt<std::string>
+CacheDir("cache-dir", cl::value_desc("directory"),
+         cl::desc("Reuse the output for a module and command line cached in "
+                  "this directory"));
+
+static cl::opt<unsigned>
+CacheSizeLimit("cache-size-limit", cl::init(1024), cl::value_desc("MB"),
+               cl::desc("Remove the least recently used entries of the cache "
+                        "once it grows past this many megabytes (0 for no "
+                        "limit)"));
+
 static int compileModule(char **, LLVMContext &);
 
+static std::unique_ptr<tool_output_file> OpenOutputFile(StringRef Filename) {
+  // Decide if we need "binary" output.
+  bool Binary = false;
+  switch (FileType) {
+  case TargetMachine::CGFT_AssemblyFile:
+    break;
+  case TargetMachine::CGFT_ObjectFile:
+  case TargetMachine::CGFT_Null:
+    Binary = true;
+    break;
+  }
+
+  // Open the file.
+  std::error_code EC;
+  sys::fs::OpenFlags OpenFlags = sys::fs::F_None;
+  if (!Binary)
+    OpenFlags |= sys::fs::F_Text;
+  auto FDOut = llvm::make_unique<tool_output_file>(Filename, EC, OpenFlags);
+  if (EC) {
+    errs() << EC.message() << '\n';
+    return nullptr;
+  }
+
+  return FDOut;
+}
+
 static std::unique_ptr<tool_output_file>
 GetOutputStream(const char *TargetName, Triple::OSType OS,
                 const char *ProgName) {
@@ -140,30 +188,7 @@ GetOutputStream(const char *TargetName, Triple::OSType OS,
     }
   }
 
-  // Decide if we need "binary" output.
-  bool Binary = false;
-  switch (FileType) {
-  case TargetMachine::CGFT_AssemblyFile:
-    break;
-  case TargetMachine::CGFT_ObjectFile:
-  case TargetMachine::CGFT_Null:
-    Binary = true;
-    break;
-  }
-
-  // Open the file.
-  std::error_code EC;
-  sys::fs::OpenFlags OpenFlags = sys::fs::F_None;
-  if (!Binary)
-    OpenFlags |= sys::fs::F_Text;
-  auto FDOut = llvm::make_unique<tool_output_file>(OutputFilename, EC,
-                                                   OpenFlags);
-  if (EC) {
-    errs() << EC.message() << '\n';
-    return nullptr;
-  }
-
-  return FDOut;
+  return OpenOutputFile(OutputFilename);
 }
 
 // main - Entry point for the llc compiler.
@@ -206,6 +231,50 @@ int main(int argc, char **argv) {
   return 0;
 }
 
+/// Compute the cache key for compiling \p M: a hash of the llc binary, of the
+/// command line, less the input and output files and the cache options, of
+/// the target CPU and features, as resolved for -mcpu=native, and of the
+/// module.
+static std::string getCacheKey(char **argv, StringRef CPUStr,
+                               StringRef FeaturesStr, const Module &M) {
+  MD5 Hash;
+  void *MainAddr = (void *)(intptr_t)getCacheKey;
+  sys::fs::file_status Status;
+  if (!sys::fs::status(sys::fs::getMainExecutable(argv[0], MainAddr),
+                       Status)) {
+    uint64_t Identity[] = {Status.getSize(),
+                           Status.getLastModificationTime().toEpochTime()};
+    Hash.update(ArrayRef<uint8_t>((const uint8_t *)Identity, sizeof(Identity)));
+  }
+
+  for (char **Arg = argv + 1; *Arg; ++Arg) {
+    StringRef A = *Arg;
+    if (A == InputFilename || A.startswith("-o="))
+      continue;
+    if (A.startswith("--"))
+      A = A.drop_front();
+    if (A == "-o" || A == "-cache-dir" || A == "-cache-size-limit") {
+      if (Arg[1])
+        ++Arg;
+      continue;
+    }
+    if (A.startswith("-cache-dir=") || A.startswith("-cache-size-limit="))
+      continue;
+    Hash.update(A);
+    Hash.update(ArrayRef<uint8_t>((const uint8_t *)"", 1));
+  }
+  for (StringRef Str : {CPUStr, FeaturesStr}) {
+    Hash.update(Str);
+    Hash.update(ArrayRef<uint8_t>((const uint8_t *)"", 1));
+  }
+
+  std::string Text;
+  raw_string_ostream OS(Text);
+  M.print(OS, nullptr);
+  Hash.update(OS.str());
+  return FileCache::getKey(Hash);
+}
+
 static int compileModule(char **argv, LLVMContext &Context) {
   // Load the module to be compiled...
   SMDiagnostic Err;
@@ -279,9 +348,12 @@ static int compileModule(char **argv, LLVMContext &Context) {
   Options.MCOptions.MCUseDwarfDirectory = EnableDwarfDirectory;
   Options.MCOptions.AsmVerbose = AsmVerbose;
 
-  std::unique_ptr<TargetMachine> Target(
-      TheTarget->createTargetMachine(TheTriple.getTriple(), CPUStr, FeaturesStr,
-                                     Options, RelocModel, CMModel, OLvl));
+  auto CreateTargetMachine = [=]() {
+    return std::unique_ptr<TargetMachine>(TheTarget->createTargetMachine(
+        TheTriple.getTriple(), CPUStr, FeaturesStr, Options, RelocModel,
+        CMModel, OLvl));
+  };
+  std::unique_ptr<TargetMachine> Target = CreateTargetMachine();
 
   assert(Target && "Could not allocate target machine!");
 
@@ -300,17 +372,6 @@ static int compileModule(char **argv, LLVMContext &Context) {
       GetOutputStream(TheTarget->getName(), TheTriple.getOS(), argv[0]);
   if (!Out) return 1;
 
-  // Build up all of the passes that we want to do to the module.
-  legacy::PassManager PM;
-
-  // Add an appropriate TargetLibraryInfo pass for the module's triple.
-  TargetLibraryInfoImpl TLII(Triple(M->getTargetTriple()));
-
-  // The -disable-simplify-libcalls flag actually disables all builtin optzns.
-  if (DisableSimplifyLibCalls)
-    TLII.disableAllFunctions();
-  PM.add(new TargetLibraryInfoWrapperPass(TLII));
-
   // Add the target data from the target machine, if it exists, or the module.
   if (const DataLayout *DL = Target->getDataLayout())
     M->setDataLayout(*DL);
@@ -324,15 +385,91 @@ static int compileModule(char **argv, LLVMContext &Context) {
     errs() << argv[0]
              << ": warning: ignoring -mc-relax-all because filetype != obj";
 
+  if (SplitThreads > 1) {
+    if (OutputFilename == "-") {
+      errs() << argv[0] << ": -threads requires an output file.\n";
+      return 1;
+    }
+    if (MIR || !RunPass.empty() || !StartAfter.empty() ||
+        !StopAfter.empty() || DisableSimplifyLibCalls || !CacheDir.empty()) {
+      errs() << argv[0] << ": -threads cannot be combined with MIR input, "
+                           "-run-pass, -start-after, -stop-after, "
+                           "-disable-simplify-libcalls or -cache-dir.\n";
+      return 1;
+    }
+
+    // Partition 0 goes to the regular output file, partition I to <output>.I.
+    std::vector<std::unique_ptr<tool_output_file>> PartOuts;
+    SmallVector<raw_pwrite_stream *, 8> OSs;
+    OSs.push_back(&Out->os());
+    for (unsigned I = 1; I != SplitThreads; ++I) {
+      PartOuts.push_back(
+          OpenOutputFile((OutputFilename + "." + Twine(I)).str()));
+      if (!PartOuts.back())
+        return 1;
+      OSs.push_back(&PartOuts.back()->os());
+    }
+
+    // Before executing passes, print the final values of the LLVM options.
+    cl::PrintOptionValues();
+
+    std::string ErrMsg;
+    if (splitCodeGen(*M, OSs, CreateTargetMachine, ErrMsg, FileType)) {
+      errs() << argv[0] << ": " << ErrMsg << "\n";
+      return 1;
+    }
+
+    Out->keep();
+    for (auto &PartOut : PartOuts)
+      PartOut->keep();
+    return 0;
+  }
+
+  // With a cache, output for an unchanged module and command line is copied
+  // from the cache. Machine code is cached per module rather than per
+  // function, because functions are emitted into shared sections.
+  std::unique_ptr<FileCache> Cache;
+  std::string CacheKey;
+  SmallString<0> CacheBuffer;
+  std::unique_ptr<raw_svector_ostream> CacheOS;
+  if (!CacheDir.empty()) {
+    if (MIR) {
+      errs() << argv[0] << ": -cache-dir cannot be used with MIR input.\n";
+      return 1;
+    }
+    Cache = make_unique<FileCache>(CacheDir);
+    CacheKey = getCacheKey(argv, CPUStr, FeaturesStr, *M);
+    if (auto Cached = Cache->lookup(CacheKey)) {
+      Out->os() << (*Cached)->getBuffer();
+      Out->keep();
+      return 0;
+    }
+  }
+
   {
     raw_pwrite_stream *OS = &Out->os();
     std::unique_ptr<buffer_ostream> BOS;
-    if (FileType != TargetMachine::CGFT_AssemblyFile &&
-        !Out->os().supportsSeeking()) {
+    if (Cache) {
+      CacheOS = make_unique<raw_svector_ostream>(CacheBuffer);
+      OS = CacheOS.get();
+    } else if (FileType != TargetMachine::CGFT_AssemblyFile &&
+               !Out->os().supportsSeeking()) {
       BOS = make_unique<buffer_ostream>(*OS);
       OS = BOS.get();
     }
 
+    // Build up all of the passes that we want to do to the module.
+    legacy::PassManager PM;
+
+    // Add an appropriate TargetLibraryInfo pass for the module's triple.
+    TargetLibraryInfoImpl TLII(Triple(M->getTargetTriple()));
+
+    // The -disable-simplify-libcalls flag actually disables all builtin
+    // optzns.
+    if (DisableSimplifyLibCalls)
+      TLII.disableAllFunctions();
+    PM.add(new TargetLibraryInfoWrapperPass(TLII));
+
     AnalysisID StartBeforeID = nullptr;
     AnalysisID StartAfterID = nullptr;
     AnalysisID StopAfterID = nullptr;
@@ -382,6 +519,17 @@ static int compileModule(char **argv, LLVMContext &Context) {
     PM.run(*M);
   }
 
+  // The pass manager is gone, so the output has been flushed to the buffer.
+  if (CacheOS) {
+    Out->os() << CacheOS->str();
+    std::error_code EC = Cache->store(CacheKey, CacheBuffer);
+    if (!EC && CacheSizeLimit)
+      EC = Cache->prune(uint64_t(CacheSizeLimit) << 20);
+    if (EC)
+      errs() << argv[0] << ": warning: cannot write to cache '" << CacheDir
+             << "': " << EC.message() << '\n';
+  }
+
   // Declare success.
   Out->keep();
 
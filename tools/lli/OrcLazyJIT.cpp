@@ -8,9 +8,14 @@
 //===----------------------------------------------------------------------===//
 
 #include "OrcLazyJIT.h"
+#include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/ExecutionEngine/FileObjectCache.h"
 #include "llvm/ExecutionEngine/Orc/OrcTargetSupport.h"
+#include "llvm/IR/LegacyPassManager.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/DynamicLibrary.h"
+#include "llvm/Transforms/IPO/PassManagerBuilder.h"
 #include <cstdio>
 #include <system_error>
 
@@ -39,6 +44,14 @@ namespace {
                                              "working directory. (WARNING: "
                                              "will overwrite existing files)."),
                                   clEnumValEnd));
+
+  cl::opt<unsigned> OrcHotCallCount("orc-lazy-hot-call-count",
+                                    cl::desc("Compile functions at -O0 first, "
+                                             "and again at -O3 in the "
+                                             "background once they have been "
+                                             "called this many times (0 "
+                                             "disables tiered compilation)."),
+                                    cl::init(0));
 }
 
 OrcLazyJIT::CallbackManagerBuilder
@@ -108,8 +121,25 @@ OrcLazyJIT::TransformFtor OrcLazyJIT::createDebugDumper() {
   llvm_unreachable("Unknown DumpKind");
 }
 
+OrcLazyJIT::TransformFtor OrcLazyJIT::createOptimizer(TargetMachine &TM) {
+  TransformFtor Dump = createDebugDumper();
+  return [&TM, Dump](std::unique_ptr<Module> M) {
+    legacy::PassManager PM;
+    PM.add(new TargetLibraryInfoWrapperPass(TM.getTargetTriple()));
+    PM.add(createTargetTransformInfoWrapperPass(TM.getTargetIRAnalysis()));
+    PassManagerBuilder Builder;
+    Builder.OptLevel = 3;
+    Builder.LoopVectorize = true;
+    Builder.SLPVectorize = true;
+    Builder.populateModulePassManager(PM);
+    PM.run(*M);
+    return Dump(std::move(M));
+  };
+}
+
 // Defined in lli.cpp.
 CodeGenOpt::Level getOptLevel();
+std::unique_ptr<FileObjectCache> createJITCache(const TargetMachine &TM);
 
 int llvm::runOrcLazyJIT(std::unique_ptr<Module> M, int ArgC, char* ArgV[]) {
   // Add the program's symbols into the JIT's search space.
@@ -120,8 +150,16 @@ int llvm::runOrcLazyJIT(std::unique_ptr<Module> M, int ArgC, char* ArgV[]) {
 
   // Grab a target machine and try to build a factory function for the
   // target-specific Orc callback manager.
+  // With tiered compilation, compile at -O0 first and keep a second target
+  // machine for the recompilation of hot functions.
   EngineBuilder EB;
-  EB.setOptLevel(getOptLevel());
+  std::unique_ptr<TargetMachine> OptTM;
+  if (OrcHotCallCount) {
+    EB.setOptLevel(CodeGenOpt::Aggressive);
+    OptTM.reset(EB.selectTarget());
+    EB.setOptLevel(CodeGenOpt::None);
+  } else
+    EB.setOptLevel(getOptLevel());
   auto TM = std::unique_ptr<TargetMachine>(EB.selectTarget());
   auto &Context = getGlobalContext();
   auto CallbackMgrBuilder =
@@ -135,8 +173,18 @@ int llvm::runOrcLazyJIT(std::unique_ptr<Module> M, int ArgC, char* ArgV[]) {
     return 1;
   }
 
+  // With -jit-cache-dir, reuse the objects compiled for each partition by
+  // earlier runs. The key of an object includes the target machine that
+  // compiled it, so tiered compilation needs a cache for each.
+  std::unique_ptr<FileObjectCache> Cache = createJITCache(*TM);
+  std::unique_ptr<FileObjectCache> OptCache;
+  if (OptTM)
+    OptCache = createJITCache(*OptTM);
+
   // Everything looks good. Build the JIT.
-  OrcLazyJIT J(std::move(TM), Context, CallbackMgrBuilder);
+  OrcLazyJIT J(std::move(TM), std::move(OptTM), Context, CallbackMgrBuilder,
+               OrcHotCallCount);
+  J.setObjectCaches(Cache.get(), OptCache.get());
 
   // Add the module, look up main and run it.
   auto MainHandle = J.addModule(std::move(M));
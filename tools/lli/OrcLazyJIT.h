@@ -47,15 +47,26 @@ public:
 
   static CallbackManagerBuilder createCallbackManagerBuilder(Triple T);
 
-  OrcLazyJIT(std::unique_ptr<TargetMachine> TM, LLVMContext &Context,
-             CallbackManagerBuilder &BuildCallbackMgr)
-    : TM(std::move(TM)),
+  /// If OptTM is non-null, functions that are called HotCallCount times are
+  /// optimized and compiled again with OptTM in the background.
+  OrcLazyJIT(std::unique_ptr<TargetMachine> TM,
+             std::unique_ptr<TargetMachine> OptTM, LLVMContext &Context,
+             CallbackManagerBuilder &BuildCallbackMgr, unsigned HotCallCount)
+    : TM(std::move(TM)), OptTM(std::move(OptTM)),
       ObjectLayer(),
       CompileLayer(ObjectLayer, orc::SimpleCompiler(*this->TM)),
       IRDumpLayer(CompileLayer, createDebugDumper()),
+      OptCompileLayer(ObjectLayer,
+                      orc::SimpleCompiler(this->OptTM ? *this->OptTM
+                                                      : *this->TM)),
+      OptLayer(OptCompileLayer,
+               createOptimizer(this->OptTM ? *this->OptTM : *this->TM)),
       CCMgr(BuildCallbackMgr(IRDumpLayer, CCMgrMemMgr, Context)),
       CODLayer(IRDumpLayer, *CCMgr, false),
-      CXXRuntimeOverrides([this](const std::string &S) { return mangle(S); }) {}
+      CXXRuntimeOverrides([this](const std::string &S) { return mangle(S); }) {
+    if (this->OptTM)
+      CODLayer.enableTiering(OptLayer, HotCallCount);
+  }
 
   ~OrcLazyJIT() {
     // Run any destructors registered with __cxa_atexit.
@@ -65,6 +76,14 @@ public:
       DtorRunner.runViaLayer(CODLayer);
   }
 
+  /// Look the partitions up in Cache before compiling them, and add the
+  /// objects compiled for them to it. OptCache does the same for the hot
+  /// functions recompiled with OptTM. Either may be null.
+  void setObjectCaches(ObjectCache *Cache, ObjectCache *OptCache) {
+    CompileLayer.setObjectCache(Cache);
+    OptCompileLayer.setObjectCache(OptCache);
+  }
+
   template <typename PtrTy>
   static PtrTy fromTargetAddress(orc::TargetAddress Addr) {
     return reinterpret_cast<PtrTy>(static_cast<uintptr_t>(Addr));
@@ -142,13 +161,17 @@ private:
   }
 
   static TransformFtor createDebugDumper();
+  static TransformFtor createOptimizer(TargetMachine &TM);
 
   std::unique_ptr<TargetMachine> TM;
+  std::unique_ptr<TargetMachine> OptTM;
   SectionMemoryManager CCMgrMemMgr;
 
   ObjLayerT ObjectLayer;
   CompileLayerT CompileLayer;
   IRDumpLayerT IRDumpLayer;
+  CompileLayerT OptCompileLayer;
+  IRDumpLayerT OptLayer;
   std::unique_ptr<CompileCallbackMgr> CCMgr;
   CODLayerT CODLayer;
 
@@ -21,12 +21,14 @@
 #include "llvm/ADT/Triple.h"
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/CodeGen/LinkAllCodegenComponents.h"
+#include "llvm/ExecutionEngine/FileObjectCache.h"
 #include "llvm/ExecutionEngine/GenericValue.h"
 #include "llvm/ExecutionEngine/Interpreter.h"
 #include "llvm/ExecutionEngine/JITEventListener.h"
 #include "llvm/ExecutionEngine/MCJIT.h"
 #include "llvm/ExecutionEngine/ObjectCache.h"
 #include "llvm/ExecutionEngine/OrcMCJITReplacement.h"
+#include "llvm/ExecutionEngine/PooledMemoryManager.h"
 #include "llvm/ExecutionEngine/SectionMemoryManager.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/Module.h"
@@ -173,6 +175,31 @@ namespace {
                            "(must be user writable)"),
                   cl::init(""));
 
+  cl::opt<std::string>
+  JITCacheDir("jit-cache-dir",
+              cl::desc("Reuse the objects compiled from identical modules "
+                       "by keeping them in this directory"),
+              cl::value_desc("directory"), cl::init(""));
+
+  cl::opt<unsigned long long>
+  JITCacheSizeLimit("jit-cache-size-limit",
+                    cl::desc("Remove the least recently used objects from "
+                             "the -jit-cache-dir directory when they take "
+                             "more than this many bytes (0 = no limit)"),
+                    cl::init(0));
+
+  cl::opt<bool>
+  UseJITMemoryPool("jit-memory-pool",
+                   cl::desc("Allocate JIT code and data from large slabs "
+                            "of memory"),
+                   cl::init(false));
+
+  cl::opt<bool>
+  JITHugePages("jit-huge-pages",
+               cl::desc("Ask for the -jit-memory-pool slabs to be backed "
+                        "with huge pages (JIT code then stays writable)"),
+               cl::init(false));
+
   cl::opt<std::string>
   FakeArgv0("fake-argv0",
             cl::desc("Override the 'argv[0]' value passed into the executing"
@@ -315,6 +342,8 @@ private:
 
 static ExecutionEngine *EE = nullptr;
 static LLIObjectCache *CacheManager = nullptr;
+static FileObjectCache *JITCache = nullptr;
+static JITMemoryPool *JITPool = nullptr;
 
 static void do_shutdown() {
   // Cygwin-1.5 invokes DLL's dtors before atexit handler.
@@ -322,6 +351,8 @@ static void do_shutdown() {
   delete EE;
   if (CacheManager)
     delete CacheManager;
+  delete JITCache;
+  delete JITPool;
   llvm_shutdown();
 #endif
 }
@@ -379,6 +410,14 @@ CodeGenOpt::Level getOptLevel() {
   llvm_unreachable("Unrecognized opt level.");
 }
 
+std::unique_ptr<FileObjectCache> createJITCache(const TargetMachine &TM) {
+  if (JITCacheDir.empty())
+    return nullptr;
+  auto Cache = make_unique<FileObjectCache>(JITCacheDir, JITCacheSizeLimit);
+  Cache->setTargetMachine(TM);
+  return Cache;
+}
+
 //===----------------------------------------------------------------------===//
 // main Driver function
 //
@@ -402,9 +441,16 @@ int main(int argc, char **argv, char * const *envp) {
   if (DisableCoreFiles)
     sys::Process::PreventCoreFiles();
 
-  // Load the bitcode...
+  // Load the bitcode...  The lazy JIT defers only function bodies: each one
+  // is read from the (memory mapped) bitcode file when its function is first
+  // called.  Types, globals and constants are still parsed up front, and the
+  // module's metadata is read along with the first body.
   SMDiagnostic Err;
-  std::unique_ptr<Module> Owner = parseIRFile(InputFile, Err, Context);
+  std::unique_ptr<Module> Owner =
+      UseJITKind == JITKind::OrcLazy
+          ? getLazyIRFileModule(InputFile, Err, Context,
+                                /*ShouldLazyLoadMetadata=*/true)
+          : parseIRFile(InputFile, Err, Context);
   Module *Mod = Owner.get();
   if (!Mod) {
     Err.print(argv[0], errs());
@@ -451,7 +497,10 @@ int main(int argc, char **argv, char * const *envp) {
   if (!ForceInterpreter) {
     if (RemoteMCJIT)
       RTDyldMM = new RemoteMemoryManager();
-    else
+    else if (UseJITMemoryPool || JITHugePages) {
+      JITPool = new JITMemoryPool(JITMemoryPool::HugePageSize, JITHugePages);
+      RTDyldMM = new PooledMemoryManager(*JITPool);
+    } else
       RTDyldMM = new SectionMemoryManager();
 
     // Deliberately construct a temp std::unique_ptr to pass in. Do not null out
@@ -484,6 +533,12 @@ int main(int argc, char **argv, char * const *envp) {
   if (EnableCacheManager) {
     CacheManager = new LLIObjectCache(ObjectCacheDir);
     EE->setObjectCache(CacheManager);
+  } else if (!JITCacheDir.empty()) {
+    // Only the JITs, which have a target machine, can use an object cache.
+    if (TargetMachine *TM = EE->getTargetMachine()) {
+      JITCache = createJITCache(*TM).release();
+      EE->setObjectCache(JITCache);
+    }
   }
 
   // Load any additional modules specified on the command line.
@@ -601,7 +656,9 @@ int main(int argc, char **argv, char * const *envp) {
     // invalidated will be known.
     (void)EE->getPointerToFunction(EntryFn);
     // Clear instruction cache before code will be executed.
-    if (RTDyldMM)
+    if (JITPool)
+      static_cast<PooledMemoryManager*>(RTDyldMM)->invalidateInstructionCache();
+    else if (RTDyldMM)
       static_cast<SectionMemoryManager*>(RTDyldMM)->invalidateInstructionCache();
 
     // Run main.
@@ -27,10 +27,12 @@
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Format.h"
 #include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/Mutex.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Process.h"
 #include "llvm/Support/Signals.h"
+#include "llvm/Support/ThreadPool.h"
 #include <functional>
 #include <system_error>
 
@@ -67,6 +69,10 @@ public:
   std::unique_ptr<SourceCoverageView>
   createSourceFileView(StringRef SourceFile, CoverageMapping &Coverage);
 
+  /// \brief Render the coverage of the given source file to the stream.
+  void renderSourceFile(StringRef SourceFile, CoverageMapping &Coverage,
+                        bool ShowFilenames, raw_ostream &OS);
+
   /// \brief Load the coverage mapping data. Return true if an error occured.
   std::unique_ptr<CoverageMapping> load();
 
@@ -87,9 +93,15 @@ public:
   std::vector<std::string> SourceFiles;
   std::vector<std::pair<std::string, std::unique_ptr<MemoryBuffer>>>
       LoadedSourceFiles;
+  /// \brief Guards LoadedSourceFiles, and the error output, when the files
+  /// are rendered on several threads.
+  sys::Mutex LoadedSourceFilesLock;
   bool CompareFilenamesOnly;
   StringMap<std::string> RemappedFilenames;
   std::string CoverageArch;
+  std::string MappingCacheDir;
+  unsigned MappingCacheSizeLimit;
+  unsigned NumThreads;
 };
 }
 
@@ -102,6 +114,7 @@ void CodeCoverageTool::error(const Twine &Message, StringRef Whence) {
 
 ErrorOr<const MemoryBuffer &>
 CodeCoverageTool::getSourceFile(StringRef SourceFile) {
+  sys::ScopedLock Lock(LoadedSourceFilesLock);
   // If we've remapped filenames, look up the real location for this file.
   if (!RemappedFilenames.empty()) {
     auto Loc = RemappedFilenames.find(SourceFile);
@@ -208,8 +221,9 @@ static bool modifiedTimeGT(StringRef LHS, StringRef RHS) {
 std::unique_ptr<CoverageMapping> CodeCoverageTool::load() {
   if (modifiedTimeGT(ObjectFilename, PGOFilename))
     errs() << "warning: profile data may be out of date - object is newer\n";
-  auto CoverageOrErr = CoverageMapping::load(ObjectFilename, PGOFilename,
-                                             CoverageArch);
+  auto CoverageOrErr = CoverageMapping::load(
+      ObjectFilename, PGOFilename, CoverageArch, MappingCacheDir,
+      uint64_t(MappingCacheSizeLimit) << 20);
   if (std::error_code EC = CoverageOrErr.getError()) {
     colored_ostream(errs(), raw_ostream::RED)
         << "error: Failed to load coverage: " << EC.message();
@@ -310,13 +324,39 @@ int CodeCoverageTool::run(Command Cmd, int argc, const char **argv) {
       "use-color", cl::desc("Emit colored output (default=autodetect)"),
       cl::init(cl::BOU_UNSET));
 
+  cl::opt<unsigned, true> NumThreads(
+      "num-threads", cl::location(this->NumThreads), cl::init(1),
+      cl::desc("Number of threads to render the source files with "
+               "(0 = one per core)"));
+  cl::alias NumThreadsA("j", cl::desc("Alias for --num-threads"),
+                        cl::aliasopt(NumThreads));
+
+  cl::opt<std::string, true> MappingCacheDir(
+      "mapping-cache-dir", cl::location(this->MappingCacheDir),
+      cl::desc("Directory to cache the decoded coverage mapping of the "
+               "object file in, to load it faster next time"));
+
+  cl::opt<unsigned, true> MappingCacheSizeLimit(
+      "mapping-cache-size-limit",
+      cl::location(this->MappingCacheSizeLimit), cl::init(1024),
+      cl::value_desc("MB"),
+      cl::desc("Remove the least recently used entries of the mapping cache "
+               "once it grows past this many megabytes (0 for no limit)"));
+
   auto commandLineParser = [&, this](int argc, const char **argv) -> int {
     cl::ParseCommandLineOptions(argc, argv, "LLVM code coverage tool\n");
     ViewOpts.Debug = DebugDump;
     CompareFilenamesOnly = FilenameEquivalence;
 
+    // Output rendered on several threads is buffered, and buffers cannot
+    // hold colors, so colors are only autodetected with one thread.
+    if (UseColor == cl::BOU_TRUE && this->NumThreads != 1) {
+      errs() << "error: -use-color cannot be combined with -num-threads\n";
+      return 1;
+    }
     ViewOpts.Colors = UseColor == cl::BOU_UNSET
-                          ? sys::Process::StandardOutHasColors()
+                          ? this->NumThreads == 1 &&
+                                sys::Process::StandardOutHasColors()
                           : UseColor == cl::BOU_TRUE;
 
     // Create the function filters
@@ -452,27 +492,53 @@ int CodeCoverageTool::show(int argc, const char **argv,
     for (StringRef Filename : Coverage->getUniqueSourceFiles())
       SourceFiles.push_back(Filename);
 
-  for (const auto &SourceFile : SourceFiles) {
-    auto mainView = createSourceFileView(SourceFile, *Coverage);
-    if (!mainView) {
-      ViewOpts.colored_ostream(outs(), raw_ostream::RED)
-          << "warning: The file '" << SourceFile << "' isn't covered.";
-      outs() << "\n";
-      continue;
-    }
+  if (NumThreads == 1) {
+    for (const auto &SourceFile : SourceFiles)
+      renderSourceFile(SourceFile, *Coverage, ShowFilenames, outs());
+    return 0;
+  }
 
-    if (ShowFilenames) {
-      ViewOpts.colored_ostream(outs(), raw_ostream::CYAN) << SourceFile << ":";
-      outs() << "\n";
-    }
-    mainView->render(outs(), /*Wholefile=*/true);
-    if (SourceFiles.size() > 1)
-      outs() << "\n";
+  // Render the files on several threads into buffers, which are printed in
+  // order. Going a batch at a time bounds the memory the buffers take.
+  ThreadPool Pool(NumThreads);
+  size_t BatchSize = 8 * (NumThreads ? NumThreads : getDefaultThreadCount());
+  std::vector<std::string> Buffers;
+  for (size_t Begin = 0; Begin < SourceFiles.size(); Begin += BatchSize) {
+    size_t End = std::min(Begin + BatchSize, SourceFiles.size());
+    Buffers.assign(End - Begin, std::string());
+    for (size_t I = Begin; I != End; ++I)
+      Pool.async([&, I] {
+        raw_string_ostream OS(Buffers[I - Begin]);
+        renderSourceFile(SourceFiles[I], *Coverage, ShowFilenames, OS);
+      });
+    Pool.wait();
+    for (const std::string &Buffer : Buffers)
+      outs() << Buffer;
   }
 
   return 0;
 }
 
+void CodeCoverageTool::renderSourceFile(StringRef SourceFile,
+                                        CoverageMapping &Coverage,
+                                        bool ShowFilenames, raw_ostream &OS) {
+  auto mainView = createSourceFileView(SourceFile, Coverage);
+  if (!mainView) {
+    ViewOpts.colored_ostream(OS, raw_ostream::RED)
+        << "warning: The file '" << SourceFile << "' isn't covered.";
+    OS << "\n";
+    return;
+  }
+
+  if (ShowFilenames) {
+    ViewOpts.colored_ostream(OS, raw_ostream::CYAN) << SourceFile << ":";
+    OS << "\n";
+  }
+  mainView->render(OS, /*Wholefile=*/true);
+  if (SourceFiles.size() > 1)
+    OS << "\n";
+}
+
 int CodeCoverageTool::report(int argc, const char **argv,
                              CommandLineParserType commandLineParser) {
   auto Err = commandLineParser(argc, argv);
@@ -483,7 +549,7 @@ int CodeCoverageTool::report(int argc, const char **argv,
   if (!Coverage)
     return 1;
 
-  CoverageReport Report(ViewOpts, std::move(Coverage));
+  CoverageReport Report(ViewOpts, std::move(Coverage), NumThreads);
   if (SourceFiles.empty())
     Report.renderFileReports(llvm::outs());
   else
@@ -15,6 +15,7 @@
 #include "RenderingSupport.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Format.h"
+#include "llvm/Support/ThreadPool.h"
 
 using namespace llvm;
 namespace {
@@ -200,14 +201,28 @@ void CoverageReport::renderFileReports(raw_ostream &OS) {
      << "\n";
   renderDivider(FileReportColumns, OS);
   OS << "\n";
+  // Summarizing a file is independent of the others, so the summaries can
+  // be computed on several threads, then rendered in order.
+  std::vector<StringRef> Filenames = Coverage->getUniqueSourceFiles();
+  std::vector<FileCoverageSummary> Summaries(Filenames.begin(),
+                                             Filenames.end());
+  auto summarize = [&](size_t I) {
+    for (const auto &F : Coverage->getCoveredFunctions(Filenames[I]))
+      Summaries[I].addFunction(FunctionCoverageSummary::get(F));
+  };
+  if (NumThreads == 1) {
+    for (size_t I = 0, E = Filenames.size(); I != E; ++I)
+      summarize(I);
+  } else {
+    ThreadPool Pool(NumThreads);
+    for (size_t I = 0, E = Filenames.size(); I != E; ++I)
+      Pool.async(summarize, I);
+    Pool.wait();
+  }
+
   FileCoverageSummary Totals("TOTAL");
-  for (StringRef Filename : Coverage->getUniqueSourceFiles()) {
-    FileCoverageSummary Summary(Filename);
-    for (const auto &F : Coverage->getCoveredFunctions(Filename)) {
-      FunctionCoverageSummary Function = FunctionCoverageSummary::get(F);
-      Summary.addFunction(Function);
-      Totals.addFunction(Function);
-    }
+  for (const FileCoverageSummary &Summary : Summaries) {
+    Totals.add(Summary);
     render(Summary, OS);
   }
   renderDivider(FileReportColumns, OS);
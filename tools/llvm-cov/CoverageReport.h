@@ -23,14 +23,19 @@ namespace llvm {
 class CoverageReport {
   const CoverageViewOptions &Options;
   std::unique_ptr<coverage::CoverageMapping> Coverage;
+  unsigned NumThreads;
 
   void render(const FileCoverageSummary &File, raw_ostream &OS);
   void render(const FunctionCoverageSummary &Function, raw_ostream &OS);
 
 public:
+  /// \brief Create a report summarizing the files of \p Coverage on
+  /// \p NumThreads threads, or one per core if it is 0.
   CoverageReport(const CoverageViewOptions &Options,
-                 std::unique_ptr<coverage::CoverageMapping> Coverage)
-      : Options(Options), Coverage(std::move(Coverage)) {}
+                 std::unique_ptr<coverage::CoverageMapping> Coverage,
+                 unsigned NumThreads = 1)
+      : Options(Options), Coverage(std::move(Coverage)),
+        NumThreads(NumThreads) {}
 
   void renderFunctionReports(ArrayRef<std::string> Files, raw_ostream &OS);
 
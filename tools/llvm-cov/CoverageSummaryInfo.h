@@ -149,6 +149,13 @@ struct FileCoverageSummary {
     LineCoverage += Function.LineCoverage;
     FunctionCoverage.addFunction(/*Covered=*/Function.ExecutionCount > 0);
   }
+
+  void add(const FileCoverageSummary &File) {
+    RegionCoverage += File.RegionCoverage;
+    LineCoverage += File.LineCoverage;
+    FunctionCoverage.Executed += File.FunctionCoverage.Executed;
+    FunctionCoverage.NumFunctions += File.FunctionCoverage.NumFunctions;
+  }
 };
 
 } // namespace llvm
@@ -12,6 +12,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/CodeGen/CommandFlags.h"
 #include "llvm/LTO/LTOCodeGenerator.h"
@@ -34,6 +35,12 @@ OptLevel("O",
          cl::ZeroOrMore,
          cl::init('2'));
 
+static cl::opt<unsigned>
+Parallelism("j", cl::Prefix, cl::init(1),
+            cl::desc("Number of backend threads. With N > 1 the output is "
+                     "split into N object files; partition I > 0 is written "
+                     "to <output>.I"));
+
 static cl::opt<bool>
 DisableInline("disable-inlining", cl::init(false),
   cl::desc("Do not run the inliner pass"));
@@ -255,7 +262,39 @@ int main(int argc, char **argv) {
   if (!attrs.empty())
     CodeGen.setAttr(attrs.c_str());
 
-  if (!OutputFilename.empty()) {
+  if (Parallelism > 1 && OutputFilename.empty()) {
+    errs() << argv[0] << ": -j requires an output file.\n";
+    return 1;
+  }
+
+  if (Parallelism > 1) {
+    // Compile the partitions to memory, as libLTO does, and write them out.
+    std::string ErrorInfo;
+    std::vector<std::unique_ptr<MemoryBuffer>> Objects;
+    if (CodeGen.optimize(DisableInline, DisableGVNLoadPRE,
+                         DisableLTOVectorization, ErrorInfo))
+      Objects = CodeGen.compileOptimized(Parallelism, ErrorInfo);
+    if (Objects.empty()) {
+      errs() << argv[0]
+             << ": error compiling the code: " << ErrorInfo << "\n";
+      return 1;
+    }
+
+    for (unsigned I = 0; I != Parallelism; ++I) {
+      std::string PartFilename = OutputFilename;
+      if (I != 0)
+        PartFilename += "." + utostr(I);
+      std::error_code EC;
+      raw_fd_ostream FileStream(PartFilename, EC, sys::fs::F_None);
+      if (EC) {
+        errs() << argv[0] << ": error opening the file '" << PartFilename
+               << "': " << EC.message() << "\n";
+        return 1;
+      }
+      FileStream.write(Objects[I]->getBufferStart(),
+                       Objects[I]->getBufferSize());
+    }
+  } else if (!OutputFilename.empty()) {
     std::string ErrorInfo;
     std::unique_ptr<MemoryBuffer> Code = CodeGen.compile(
         DisableInline, DisableGVNLoadPRE, DisableLTOVectorization, ErrorInfo);
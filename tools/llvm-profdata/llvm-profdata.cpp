@@ -25,7 +25,10 @@
 #include "llvm/Support/Path.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Signals.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <iterator>
 
 using namespace llvm;
 
@@ -41,8 +44,71 @@ namespace {
 enum ProfileKinds { instr, sample };
 }
 
+namespace {
+/// The profile merged from a contiguous range of the inputs, together with
+/// what went wrong reading them, to be reported in input order.
+struct WriterContext {
+  InstrProfWriter Writer;
+  /// The index of the input each function of Writer was first read from.
+  StringMap<size_t> FirstInput;
+  /// The warnings, each with the index of the input it is about.
+  std::vector<std::pair<size_t, std::string>> Warnings;
+  /// The first error, and the index of the input it is about.
+  std::string Error;
+  size_t ErrorInput = 0;
+};
+}
+
+static void loadInput(const cl::list<std::string> &Inputs, size_t Index,
+                      WriterContext &WC) {
+  StringRef Filename = Inputs[Index];
+  auto ReaderOrErr = InstrProfReader::create(Filename);
+  if (std::error_code EC = ReaderOrErr.getError()) {
+    WC.Error = EC.message();
+    WC.ErrorInput = Index;
+    return;
+  }
+
+  auto Reader = std::move(ReaderOrErr.get());
+  for (const auto &I : *Reader) {
+    WC.FirstInput.insert(std::make_pair(I.Name, Index));
+    if (std::error_code EC =
+            WC.Writer.addFunctionCounts(I.Name, I.Hash, I.Counts))
+      WC.Warnings.push_back(std::make_pair(
+          Index, (Filename + ": " + I.Name + ": " + EC.message()).str()));
+  }
+  if (Reader->hasError()) {
+    WC.Error = Reader->getError().message();
+    WC.ErrorInput = Index;
+  }
+}
+
+/// Merge the profile of \p Src into \p Dst, which holds that of the inputs
+/// before those of \p Src. The counts of a function that cannot be merged
+/// are reported against the input of \p Src the function was first read
+/// from.
+static void mergeWriterContexts(const cl::list<std::string> &Inputs,
+                                WriterContext &Dst, WriterContext &Src) {
+  std::move(Src.Warnings.begin(), Src.Warnings.end(),
+            std::back_inserter(Dst.Warnings));
+  Dst.Writer.mergeRecordsFromWriter(
+      std::move(Src.Writer), [&](StringRef Name, std::error_code EC) {
+        size_t Index = Src.FirstInput.lookup(Name);
+        Dst.Warnings.push_back(std::make_pair(
+            Index,
+            (Twine(Inputs[Index]) + ": " + Name + ": " + EC.message()).str()));
+      });
+  for (const auto &I : Src.FirstInput)
+    Dst.FirstInput.insert(std::make_pair(I.getKey(), I.getValue()));
+  Src.FirstInput.clear();
+  if (Dst.Error.empty() && !Src.Error.empty()) {
+    Dst.Error = std::move(Src.Error);
+    Dst.ErrorInput = Src.ErrorInput;
+  }
+}
+
 static void mergeInstrProfile(const cl::list<std::string> &Inputs,
-                              StringRef OutputFilename) {
+                              StringRef OutputFilename, unsigned NumThreads) {
   if (OutputFilename.compare("-") == 0)
     exitWithError("Cannot write indexed profdata format to stdout.");
 
@@ -51,21 +117,70 @@ static void mergeInstrProfile(const cl::list<std::string> &Inputs,
   if (EC)
     exitWithError(EC.message(), OutputFilename);
 
-  InstrProfWriter Writer;
-  for (const auto &Filename : Inputs) {
-    auto ReaderOrErr = InstrProfReader::create(Filename);
-    if (std::error_code ec = ReaderOrErr.getError())
-      exitWithError(ec.message(), Filename);
+  if (NumThreads == 0)
+    NumThreads = getDefaultThreadCount();
+  NumThreads = std::max(1u, std::min<unsigned>(NumThreads, Inputs.size()));
+
+  // Each thread merges a contiguous range of the inputs, reading them one at
+  // a time, into a writer of its own. The writers are then merged pairwise,
+  // in input order, so that the result is the same as merging the inputs one
+  // after the other (unless inputs disagree on a function's counters, where
+  // which of them wins can differ). Each writer may grow to hold the whole
+  // merged profile, so memory use grows with the number of threads.
+  std::vector<std::unique_ptr<WriterContext>> Contexts;
+  for (unsigned I = 0; I < NumThreads; ++I)
+    Contexts.emplace_back(new WriterContext());
+
+  auto LoadRange = [&](unsigned I) {
+    WriterContext &WC = *Contexts[I];
+    size_t Begin = Inputs.size() * I / NumThreads;
+    size_t End = Inputs.size() * (I + 1) / NumThreads;
+    for (size_t J = Begin; J != End && WC.Error.empty(); ++J)
+      loadInput(Inputs, J, WC);
+  };
+
+  if (NumThreads == 1) {
+    LoadRange(0);
+  } else {
+    ThreadPool Pool(NumThreads);
+    for (unsigned I = 0; I < NumThreads; ++I)
+      Pool.async(LoadRange, I);
+    Pool.wait();
+
+    // A range that failed is not merged into, since no input after the one
+    // that failed would have been read.
+    for (unsigned Step = 1; Step < NumThreads; Step *= 2) {
+      for (unsigned I = 0; I + Step < NumThreads; I += 2 * Step)
+        Pool.async([&, I, Step]() {
+          if (Contexts[I]->Error.empty())
+            mergeWriterContexts(Inputs, *Contexts[I], *Contexts[I + Step]);
+        });
+      Pool.wait();
+    }
+  }
 
-    auto Reader = std::move(ReaderOrErr.get());
-    for (const auto &I : *Reader)
-      if (std::error_code EC =
-              Writer.addFunctionCounts(I.Name, I.Hash, I.Counts))
-        errs() << Filename << ": " << I.Name << ": " << EC.message() << "\n";
-    if (Reader->hasError())
-      exitWithError(Reader->getError().message(), Filename);
+  // Report what went wrong in input order, up to the first input that
+  // failed, whose error is reported last.
+  const WriterContext *Failed = nullptr;
+  std::vector<std::pair<size_t, std::string>> Warnings;
+  for (const auto &WC : Contexts) {
+    Warnings.insert(Warnings.end(), WC->Warnings.begin(), WC->Warnings.end());
+    if (!Failed && !WC->Error.empty())
+      Failed = WC.get();
   }
-  Writer.write(Output);
+  std::stable_sort(Warnings.begin(), Warnings.end(),
+                   [](const std::pair<size_t, std::string> &A,
+                      const std::pair<size_t, std::string> &B) {
+                     return A.first < B.first;
+                   });
+  for (const auto &W : Warnings) {
+    if (Failed && W.first > Failed->ErrorInput)
+      break;
+    errs() << W.second << "\n";
+  }
+  if (Failed)
+    exitWithError(Failed->Error, Inputs[Failed->ErrorInput]);
+  Contexts[0]->Writer.write(Output);
 }
 
 static void mergeSampleProfile(const cl::list<std::string> &Inputs,
@@ -119,14 +234,23 @@ static int merge_main(int argc, const char *argv[]) {
       cl::init(sampleprof::SPF_Binary),
       cl::values(clEnumValN(sampleprof::SPF_Binary, "binary",
                             "Binary encoding (default)"),
+                 clEnumValN(sampleprof::SPF_IndexedBinary, "indexed-binary",
+                            "Binary encoding with an index of the functions"),
                  clEnumValN(sampleprof::SPF_Text, "text", "Text encoding"),
                  clEnumValN(sampleprof::SPF_GCC, "gcc", "GCC encoding"),
                  clEnumValEnd));
 
+  cl::opt<unsigned> NumThreads(
+      "num-threads", cl::init(0),
+      cl::desc("Number of threads reading and merging instrumentation "
+               "profiles (0 = one per core)"));
+  cl::alias NumThreadsA("j", cl::desc("Alias for --num-threads"),
+                        cl::aliasopt(NumThreads));
+
   cl::ParseCommandLineOptions(argc, argv, "LLVM profile data merger\n");
 
   if (ProfileKind == instr)
-    mergeInstrProfile(Inputs, OutputFilename);
+    mergeInstrProfile(Inputs, OutputFilename, NumThreads);
   else
     mergeSampleProfile(Inputs, OutputFilename, OutputFormat);
 
@@ -83,7 +83,8 @@ struct LibLTOCodeGenerator : LTOCodeGenerator {
   LibLTOCodeGenerator(std::unique_ptr<LLVMContext> Context)
       : LTOCodeGenerator(std::move(Context)) {}
 
-  std::unique_ptr<MemoryBuffer> NativeObjectFile;
+  unsigned Parallelism = 1;
+  std::vector<std::unique_ptr<MemoryBuffer>> NativeObjectFiles;
 };
 
 }
@@ -304,15 +305,25 @@ bool lto_codegen_write_merged_modules(lto_code_gen_t cg, const char *path) {
   return !unwrap(cg)->writeMergedModules(path, sLastErrorString);
 }
 
+// Generate code for the optimized merged module into one object file per
+// partition, and return the first.
+static const void *compileObjects(LibLTOCodeGenerator *CG, size_t *length) {
+  CG->NativeObjectFiles =
+      CG->compileOptimized(CG->Parallelism, sLastErrorString);
+  if (CG->NativeObjectFiles.empty())
+    return nullptr;
+  *length = CG->NativeObjectFiles[0]->getBufferSize();
+  return CG->NativeObjectFiles[0]->getBufferStart();
+}
+
 const void *lto_codegen_compile(lto_code_gen_t cg, size_t *length) {
   maybeParseOptions(cg);
   LibLTOCodeGenerator *CG = unwrap(cg);
-  CG->NativeObjectFile = CG->compile(DisableInline, DisableGVNLoadPRE,
-                                     DisableLTOVectorization, sLastErrorString);
-  if (!CG->NativeObjectFile)
+  CG->NativeObjectFiles.clear();
+  if (!CG->optimize(DisableInline, DisableGVNLoadPRE, DisableLTOVectorization,
+                    sLastErrorString))
     return nullptr;
-  *length = CG->NativeObjectFile->getBufferSize();
-  return CG->NativeObjectFile->getBufferStart();
+  return compileObjects(CG, length);
 }
 
 bool lto_codegen_optimize(lto_code_gen_t cg) {
@@ -324,16 +335,32 @@ bool lto_codegen_optimize(lto_code_gen_t cg) {
 
 const void *lto_codegen_compile_optimized(lto_code_gen_t cg, size_t *length) {
   maybeParseOptions(cg);
+  return compileObjects(unwrap(cg), length);
+}
+
+void lto_codegen_set_parallelism(lto_code_gen_t cg, unsigned int parallelism) {
+  unwrap(cg)->Parallelism = std::max(parallelism, 1u);
+}
+
+unsigned int lto_codegen_get_num_objects(lto_code_gen_t cg) {
+  return unwrap(cg)->NativeObjectFiles.size();
+}
+
+const void *lto_codegen_get_object(lto_code_gen_t cg, unsigned int index,
+                                   size_t *length) {
   LibLTOCodeGenerator *CG = unwrap(cg);
-  CG->NativeObjectFile = CG->compileOptimized(sLastErrorString);
-  if (!CG->NativeObjectFile)
-    return nullptr;
-  *length = CG->NativeObjectFile->getBufferSize();
-  return CG->NativeObjectFile->getBufferStart();
+  assert(index < CG->NativeObjectFiles.size() && "Object index out of range");
+  *length = CG->NativeObjectFiles[index]->getBufferSize();
+  return CG->NativeObjectFiles[index]->getBufferStart();
 }
 
 bool lto_codegen_compile_to_file(lto_code_gen_t cg, const char **name) {
   maybeParseOptions(cg);
+  if (unwrap(cg)->Parallelism > 1) {
+    sLastErrorString = "lto_codegen_compile_to_file() does not support more "
+                       "than one partition";
+    return true;
+  }
   return !unwrap(cg)->compile_to_file(
       name, DisableInline, DisableGVNLoadPRE,
       DisableLTOVectorization, sLastErrorString);
@@ -0,0 +1,534 @@
+//===- FunctionCache.cpp - Cache of optimized function bodies -------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Implements the function cache used by opt -function-cache-dir.
+///
+/// A cache entry is a bitcode module holding the optimized function together
+/// with declarations of everything it references. Both the key and the entry
+/// are computed from such a standalone copy of the function, so neither
+/// depends on the rest of the module.
+///
+/// Metadata cannot always be matched by content when an entry is loaded:
+/// distinct nodes, such as debug info subprograms, and uniqued nodes that
+/// are part of cycles are never merged with existing ones. The entry
+/// therefore records which of its nodes are copies of the nodes the
+/// unoptimized function referred to, by their position in the order a
+/// ReferenceCollector finds them, and they are mapped back to the module's
+/// nodes found in the same order.
+///
+//===----------------------------------------------------------------------===//
+
+#include "FunctionCache.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/ValueMapper.h"
+#include <algorithm>
+
+using namespace llvm;
+using namespace opt_tool;
+
+#define DEBUG_TYPE "function-cache"
+
+STATISTIC(NumHits, "Number of function bodies reused from the cache");
+STATISTIC(NumMisses, "Number of function bodies added to the cache");
+STATISTIC(NumUncacheable, "Number of functions that cannot be cached");
+
+/// The named metadata listing an entry's copies of the unoptimized function's
+/// metadata nodes, as pairs of a position and a node.
+static const char NodesName[] = "llvm.function.cache.nodes";
+
+struct FunctionCache::Entry {
+  Function *F;
+  std::string Key;
+  /// The metadata nodes the unoptimized function refers to.
+  std::vector<MDNode *> Nodes;
+
+  /// For a cache hit: the cache entry.
+  std::unique_ptr<Module> Cached;
+};
+
+typedef SetVector<const GlobalValue *> GlobalSet;
+
+namespace {
+/// Collects what a function refers to: the globals, including those reached
+/// through constants, metadata and the initializers of constant globals, and
+/// the metadata nodes. Both are listed in a canonical order, which
+/// only depends on the function's contents.
+class ReferenceCollector {
+public:
+  explicit ReferenceCollector(const Function &F);
+
+  GlobalSet Globals;
+  std::vector<MDNode *> Nodes;
+  /// Whether the function refers to a global that a declaration cannot
+  /// stand in for: an unnamed one, which cannot be looked up when loading a
+  /// cache entry, or an alias or weak definition, which constant folding
+  /// treats differently from a declaration.
+  bool HasUnsupportedGlobal = false;
+
+private:
+  void visitAttachments(SmallVectorImpl<std::pair<unsigned, MDNode *>> &MDs);
+  void visitValue(const Value *V);
+  void visitGlobal(const GlobalValue *GV);
+  void visitMetadata(const Metadata *MD);
+
+  const Function &F;
+  SmallVector<StringRef, 16> KindNames;
+  SmallPtrSet<const Constant *, 32> VisitedConstants;
+  SmallPtrSet<const Metadata *, 32> VisitedMetadata;
+};
+
+/// Maps the types of a cache entry to the types of the module it is loaded
+/// into. Reading the entry recreates named struct types, and the reader
+/// renames a struct type whose name is taken by appending a number.
+class EntryTypeMapper : public ValueMapTypeRemapper {
+public:
+  explicit EntryTypeMapper(Module &M) : M(M) {}
+  Type *remapType(Type *SrcTy) override;
+
+private:
+  Module &M;
+  DenseMap<Type *, Type *> MappedTypes;
+};
+} // end anonymous namespace
+
+/// Whether a function pass may look at the initializer of \p GV.
+static bool isConstantDefinition(const GlobalValue *GV) {
+  auto *GVar = dyn_cast<GlobalVariable>(GV);
+  return GVar && GVar->isConstant() && GVar->hasDefinitiveInitializer();
+}
+
+ReferenceCollector::ReferenceCollector(const Function &F) : F(F) {
+  F.getContext().getMDKindNames(KindNames);
+
+  SmallVector<std::pair<unsigned, MDNode *>, 4> MDs;
+  F.getAllMetadata(MDs);
+  visitAttachments(MDs);
+  if (F.hasPersonalityFn())
+    visitValue(F.getPersonalityFn());
+
+  for (const BasicBlock &BB : F)
+    for (const Instruction &I : BB) {
+      for (const Use &Op : I.operands())
+        visitValue(Op);
+      I.getAllMetadata(MDs);
+      visitAttachments(MDs);
+    }
+}
+
+void ReferenceCollector::visitAttachments(
+    SmallVectorImpl<std::pair<unsigned, MDNode *>> &MDs) {
+  // Metadata kind IDs depend on the order in which kinds were registered, so
+  // order the attachments by kind name.
+  std::sort(MDs.begin(), MDs.end(),
+            [&](const std::pair<unsigned, MDNode *> &L,
+                const std::pair<unsigned, MDNode *> &R) {
+              return KindNames[L.first] < KindNames[R.first];
+            });
+  for (const auto &MD : MDs)
+    visitMetadata(MD.second);
+  MDs.clear();
+}
+
+void ReferenceCollector::visitValue(const Value *V) {
+  if (auto *GV = dyn_cast<GlobalValue>(V))
+    return visitGlobal(GV);
+  if (auto *MDV = dyn_cast<MetadataAsValue>(V))
+    return visitMetadata(MDV->getMetadata());
+  if (auto *C = dyn_cast<Constant>(V))
+    if (VisitedConstants.insert(C).second)
+      for (const Use &Op : C->operands())
+        visitValue(Op);
+}
+
+void ReferenceCollector::visitGlobal(const GlobalValue *GV) {
+  if (!Globals.insert(GV))
+    return;
+  if (!GV->hasName() ||
+      (GV != &F && (isa<GlobalAlias>(GV) || GV->hasWeakAnyLinkage())))
+    HasUnsupportedGlobal = true;
+  if (isConstantDefinition(GV))
+    visitValue(cast<GlobalVariable>(GV)->getInitializer());
+}
+
+void ReferenceCollector::visitMetadata(const Metadata *MD) {
+  if (!VisitedMetadata.insert(MD).second)
+    return;
+  if (auto *C = dyn_cast<ConstantAsMetadata>(MD))
+    return visitValue(C->getValue());
+  auto *N = dyn_cast<MDNode>(MD);
+  if (!N)
+    return;
+  Nodes.push_back(const_cast<MDNode *>(N));
+  for (const MDOperand &Op : N->operands())
+    if (Op)
+      visitMetadata(Op);
+}
+
+Type *EntryTypeMapper::remapType(Type *SrcTy) {
+  auto I = MappedTypes.find(SrcTy);
+  if (I != MappedTypes.end())
+    return I->second;
+
+  Type *DstTy = SrcTy;
+  if (auto *ST = dyn_cast<StructType>(SrcTy)) {
+    if (!ST->isLiteral()) {
+      // Undo the renaming by the reader: look for the type named like the
+      // entry's type without its numeric suffix.
+      StringRef Name = ST->getName();
+      std::pair<StringRef, StringRef> Split = Name.rsplit('.');
+      unsigned Suffix;
+      if (!Split.second.empty() && !Split.second.getAsInteger(10, Suffix))
+        if (StructType *Original = M.getTypeByName(Split.first))
+          DstTy = Original;
+      return MappedTypes[SrcTy] = DstTy;
+    }
+  }
+
+  if (SrcTy->getNumContainedTypes() == 0)
+    return MappedTypes[SrcTy] = DstTy;
+
+  SmallVector<Type *, 4> Elements;
+  bool Changed = false;
+  for (Type *Element : SrcTy->subtypes()) {
+    Elements.push_back(remapType(Element));
+    Changed |= Elements.back() != Element;
+  }
+  if (Changed) {
+    switch (SrcTy->getTypeID()) {
+    default:
+      llvm_unreachable("Unknown derived type");
+    case Type::PointerTyID:
+      DstTy = PointerType::get(Elements[0], SrcTy->getPointerAddressSpace());
+      break;
+    case Type::ArrayTyID:
+      DstTy = ArrayType::get(Elements[0], SrcTy->getArrayNumElements());
+      break;
+    case Type::VectorTyID:
+      DstTy = VectorType::get(Elements[0], SrcTy->getVectorNumElements());
+      break;
+    case Type::FunctionTyID:
+      DstTy = FunctionType::get(Elements[0], makeArrayRef(Elements).slice(1),
+                                cast<FunctionType>(SrcTy)->isVarArg());
+      break;
+    case Type::StructTyID:
+      DstTy = StructType::get(SrcTy->getContext(), Elements,
+                              cast<StructType>(SrcTy)->isPacked());
+      break;
+    }
+  }
+  return MappedTypes[SrcTy] = DstTy;
+}
+
+/// Add a declaration of \p GV to \p M.
+static GlobalValue *declareGlobal(const GlobalValue &GV, Module &M,
+                                  ValueMapTypeRemapper *TypeMapper = nullptr) {
+  PointerType *Ty = GV.getType();
+  if (TypeMapper)
+    Ty = cast<PointerType>(TypeMapper->remapType(Ty));
+
+  GlobalValue *NewGV;
+  if (auto *FTy = dyn_cast<FunctionType>(Ty->getElementType())) {
+    Function *NewF =
+        Function::Create(FTy, GlobalValue::ExternalLinkage, GV.getName(), &M);
+    if (auto *F = dyn_cast<Function>(&GV)) {
+      NewF->setAttributes(F->getAttributes());
+      NewF->setCallingConv(F->getCallingConv());
+    }
+    NewGV = NewF;
+  } else {
+    auto *GVar = dyn_cast<GlobalVariable>(&GV);
+    auto *NewGVar = new GlobalVariable(
+        M, Ty->getElementType(), GVar && GVar->isConstant(),
+        GlobalValue::ExternalLinkage, nullptr, GV.getName(), nullptr,
+        GV.getThreadLocalMode(), Ty->getAddressSpace());
+    if (GVar)
+      NewGVar->setAlignment(GVar->getAlignment());
+    NewGV = NewGVar;
+  }
+  if (GV.isDeclaration())
+    NewGV->setLinkage(GV.getLinkage());
+  NewGV->setUnnamedAddr(GV.hasUnnamedAddr());
+  return NewGV;
+}
+
+/// Copy \p F into a new module, together with declarations of the globals in
+/// \p Globals and the initializers of the constants among them. If
+/// \p ModuleLevelChanges is false, the copy shares the metadata of \p F.
+static std::unique_ptr<Module> cloneStandalone(const Function &F,
+                                               const GlobalSet &Globals,
+                                               ValueToValueMapTy &VMap,
+                                               bool ModuleLevelChanges) {
+  const Module &Src = *F.getParent();
+  auto M = llvm::make_unique<Module>("", F.getContext());
+  M->setTargetTriple(Src.getTargetTriple());
+  M->setDataLayout(Src.getDataLayout());
+
+  // Module flags can affect IR passes, and the reader drops debug info from
+  // modules without a debug info version.
+  if (NamedMDNode *Flags = Src.getModuleFlagsMetadata()) {
+    NamedMDNode *NewFlags = M->getOrInsertModuleFlagsMetadata();
+    for (MDNode *Flag : Flags->operands())
+      NewFlags->addOperand(Flag);
+  }
+
+  Function *NewF = Function::Create(F.getFunctionType(), F.getLinkage(),
+                                    F.getName(), M.get());
+  VMap[&F] = NewF;
+  for (const GlobalValue *GV : Globals)
+    if (GV != &F)
+      VMap[GV] = declareGlobal(*GV, *M);
+
+  RemapFlags Flags = ModuleLevelChanges ? RF_None : RF_NoModuleLevelChanges;
+  for (const GlobalValue *GV : Globals)
+    if (isConstantDefinition(GV)) {
+      auto *GVar = cast<GlobalVariable>(GV);
+      auto *NewGVar = cast<GlobalVariable>(VMap[GV]);
+      NewGVar->setInitializer(MapValue(GVar->getInitializer(), VMap, Flags));
+      NewGVar->setLinkage(GVar->getLinkage());
+    }
+
+  Function::arg_iterator NewArg = NewF->arg_begin();
+  for (const Argument &Arg : F.args()) {
+    NewArg->setName(Arg.getName());
+    VMap[&Arg] = NewArg++;
+  }
+
+  SmallVector<ReturnInst *, 8> Returns;
+  CloneFunctionInto(NewF, &F, VMap, ModuleLevelChanges, Returns);
+  // CloneFunctionInto copies the personality without mapping it.
+  if (F.hasPersonalityFn())
+    NewF->setPersonalityFn(
+        cast<Constant>(MapValue(F.getPersonalityFn(), VMap, Flags)));
+  return M;
+}
+
+/// Compute the key of \p F: a hash of the pipeline, of the printed
+/// standalone copy of \p F and of the linkage of the globals it refers to,
+/// which their declarations do not show.
+static std::string computeKey(const Function &F,
+                              const ReferenceCollector &Refs,
+                              StringRef PipelineKey) {
+  ValueToValueMapTy VMap;
+  std::unique_ptr<Module> Standalone =
+      cloneStandalone(F, Refs.Globals, VMap, /*ModuleLevelChanges=*/false);
+
+  std::string Text;
+  raw_string_ostream OS(Text);
+  Standalone->print(OS, nullptr);
+  OS.flush();
+
+  MD5 Hash;
+  Hash.update(PipelineKey);
+  Hash.update(Text);
+  for (const GlobalValue *GV : Refs.Globals) {
+    uint8_t Linkage = GV->getLinkage();
+    Hash.update(GV->getName());
+    Hash.update(makeArrayRef(Linkage));
+  }
+  return FileCache::getKey(Hash);
+}
+
+/// Check that \p Cached is a well-formed entry for the function \p Name,
+/// whose unoptimized body referred to \p NumNodes metadata nodes.
+static bool isValidEntry(Module &Cached, StringRef Name, unsigned NumNodes) {
+  Function *CachedF = Cached.getFunction(Name);
+  NamedMDNode *NMD = Cached.getNamedMetadata(NodesName);
+  if (!CachedF || CachedF->isDeclaration() || !NMD)
+    return false;
+  for (MDNode *Pair : NMD->operands()) {
+    if (Pair->getNumOperands() != 2 || !Pair->getOperand(1))
+      return false;
+    auto *Position = mdconst::dyn_extract<ConstantInt>(Pair->getOperand(0));
+    if (!Position || Position->getZExtValue() >= NumNodes)
+      return false;
+  }
+  return true;
+}
+
+FunctionCache::FunctionCache(StringRef Directory, StringRef PipelineKey,
+                             uint64_t MaxSize)
+    : Cache(Directory), PipelineKey(PipelineKey), MaxSize(MaxSize) {}
+
+FunctionCache::~FunctionCache() {}
+
+void FunctionCache::prepare(Module &M) {
+  for (Function &F : M) {
+    if (F.isDeclaration())
+      continue;
+
+    ReferenceCollector Refs(F);
+    bool Cacheable = F.hasName() && !Refs.HasUnsupportedGlobal &&
+                     !F.hasPrefixData() && !F.hasPrologueData();
+    for (const BasicBlock &BB : F)
+      Cacheable &= !BB.hasAddressTaken();
+    if (!Cacheable) {
+      ++NumUncacheable;
+      continue;
+    }
+
+    auto E = llvm::make_unique<Entry>();
+    E->F = &F;
+    E->Key = computeKey(F, Refs, PipelineKey);
+    E->Nodes = std::move(Refs.Nodes);
+
+    // Load the cache entry now, so that a broken entry is treated as a miss.
+    if (auto Buffer = Cache.lookup(E->Key)) {
+      ErrorOr<std::unique_ptr<Module>> Cached =
+          parseBitcodeFile((*Buffer)->getMemBufferRef(), M.getContext());
+      if (Cached && isValidEntry(**Cached, F.getName(), E->Nodes.size()))
+        E->Cached = std::move(*Cached);
+    }
+
+    if (E->Cached) {
+      // Replace the body with a single unreachable block, which the pipeline
+      // has next to nothing to do on. F stays a definition, so that the
+      // other functions are optimized as they would be without the cache.
+      std::unique_ptr<Function> Body(
+          Function::Create(F.getFunctionType(), GlobalValue::ExternalLinkage));
+      Body->getBasicBlockList().splice(Body->end(), F.getBasicBlockList());
+      Body->dropAllReferences();
+      new UnreachableInst(F.getContext(),
+                          BasicBlock::Create(F.getContext(), "", &F));
+    }
+    Entries.push_back(std::move(E));
+  }
+}
+
+/// Replace the placeholder body prepare() gave E.F with the cached one.
+static void restoreFunction(FunctionCache::Entry &E) {
+  Function &F = *E.F;
+  Module &M = *F.getParent();
+  Function *CachedF = E.Cached->getFunction(F.getName());
+
+  for (BasicBlock &BB : F)
+    BB.dropAllReferences();
+  F.getBasicBlockList().clear();
+  // CloneFunctionInto copies the personality of the cached function, which
+  // is not mapped, along with the other attributes.
+  Constant *Personality = F.hasPersonalityFn() ? F.getPersonalityFn() : nullptr;
+
+  EntryTypeMapper TypeMapper(M);
+  {
+    ValueToValueMapTy VMap;
+    VMap[CachedF] = &F;
+    auto MapGlobal = [&](GlobalValue &GV) {
+      if (&GV == CachedF)
+        return;
+      GlobalValue *Existing = M.getNamedValue(GV.getName());
+      if (!Existing)
+        Existing = declareGlobal(GV, M, &TypeMapper);
+      // Passes such as InstCombine raise the alignment of the globals they
+      // access, and the cached body may rely on it.
+      auto *GO = dyn_cast<GlobalObject>(Existing);
+      if (GO && GV.getAlignment() > GO->getAlignment())
+        GO->setAlignment(GV.getAlignment());
+      VMap[&GV] = ConstantExpr::getPointerBitCastOrAddrSpaceCast(
+          Existing, TypeMapper.remapType(GV.getType()));
+    };
+    for (Function &GV : *E.Cached)
+      MapGlobal(GV);
+    for (GlobalVariable &GV : E.Cached->globals())
+      MapGlobal(GV);
+    for (GlobalAlias &GV : E.Cached->aliases())
+      MapGlobal(GV);
+
+    Function::arg_iterator Arg = F.arg_begin();
+    for (Argument &CachedArg : CachedF->args())
+      VMap[&CachedArg] = Arg++;
+
+    // Map the entry's copies of the nodes F referred to back to them.
+    for (MDNode *Pair : E.Cached->getNamedMetadata(NodesName)->operands()) {
+      uint64_t Position =
+          mdconst::extract<ConstantInt>(Pair->getOperand(0))->getZExtValue();
+      VMap.MD()[Pair->getOperand(1)].reset(E.Nodes[Position]);
+    }
+
+    SmallVector<ReturnInst *, 8> Returns;
+    CloneFunctionInto(&F, CachedF, VMap, /*ModuleLevelChanges=*/true, Returns,
+                      "", nullptr, &TypeMapper);
+  }
+
+  F.setPersonalityFn(Personality);
+  E.Cached.reset();
+}
+
+/// Serialize the optimized body of E.F as a cache entry.
+static void writeEntry(const FunctionCache::Entry &E,
+                       SmallVectorImpl<char> &Buffer) {
+  const Function &F = *E.F;
+  ReferenceCollector Refs(F);
+  ValueToValueMapTy VMap;
+  std::unique_ptr<Module> Standalone =
+      cloneStandalone(F, Refs.Globals, VMap, /*ModuleLevelChanges=*/true);
+
+  // List the copies of the nodes the unoptimized function referred to that
+  // the optimized one still refers to.
+  LLVMContext &Ctx = F.getContext();
+  NamedMDNode *NMD = Standalone->getOrInsertNamedMetadata(NodesName);
+  for (unsigned I = 0, N = E.Nodes.size(); I != N; ++I) {
+    auto Copy = VMap.MD().find(E.Nodes[I]);
+    if (Copy == VMap.MD().end() || !Copy->second)
+      continue;
+    Metadata *Pair[] = {
+        ConstantAsMetadata::get(ConstantInt::get(Type::getInt64Ty(Ctx), I)),
+        Copy->second.get()};
+    NMD->addOperand(MDNode::get(Ctx, Pair));
+  }
+
+  raw_svector_ostream OS(Buffer);
+  WriteBitcodeToFile(Standalone.get(), OS);
+  OS.flush();
+}
+
+std::error_code FunctionCache::finish(Module &M) {
+  std::error_code Result;
+  bool Stored = false;
+  for (const std::unique_ptr<Entry> &E : Entries) {
+    if (E->Cached) {
+      restoreFunction(*E);
+      ++NumHits;
+      continue;
+    }
+
+    SmallString<0> Buffer;
+    writeEntry(*E, Buffer);
+    if (std::error_code EC = Cache.store(E->Key, Buffer)) {
+      if (!Result)
+        Result = EC;
+      continue;
+    }
+    ++NumMisses;
+    Stored = true;
+  }
+  Entries.clear();
+
+  if (Stored && MaxSize)
+    if (std::error_code EC = Cache.prune(MaxSize))
+      if (!Result)
+        Result = EC;
+  return Result;
+}
@@ -0,0 +1,76 @@
+//===- FunctionCache.h - Cache of optimized function bodies -----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief An on-disk cache that lets opt reuse the result of running a
+/// function pass pipeline over a function it has seen before.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TOOLS_OPT_FUNCTIONCACHE_H
+#define LLVM_TOOLS_OPT_FUNCTIONCACHE_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/FileCache.h"
+#include <memory>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace llvm {
+class Function;
+class Module;
+
+namespace opt_tool {
+
+/// \brief Reuses optimized function bodies across runs of opt.
+///
+/// A function is keyed by a hash of the pipeline and of the function itself
+/// together with everything a function pass may look at: the declarations
+/// of the globals it references, the initializers of the constants among
+/// them, and the metadata it refers to. This is only sound for pipelines
+/// made of function, loop, region and basic block passes, which by contract
+/// do not look at the bodies of other functions.
+///
+/// Before the pipeline runs, prepare() replaces the body of every function
+/// that has a cache entry with a placeholder. Afterwards, finish() swaps in
+/// the cached bodies and adds entries for the other functions.
+class FunctionCache {
+public:
+  /// \brief Keep the cache in \p Directory. \p PipelineKey must identify the
+  /// pipeline and everything else that affects its result, such as the
+  /// command line options, the target and the compiler build. Once the
+  /// cache grows past \p MaxSize bytes, the least recently used entries are
+  /// removed; 0 means no limit.
+  FunctionCache(StringRef Directory, StringRef PipelineKey, uint64_t MaxSize);
+  ~FunctionCache();
+
+  /// \brief Look up every function in \p M and drop the bodies of the
+  /// functions that have a cache entry. Entries that cannot be read are
+  /// treated as missing.
+  void prepare(Module &M);
+
+  /// \brief Replace the dropped bodies with the cached ones, cache the
+  /// bodies of the other functions of \p M and prune the cache. Returns the
+  /// first error that occurred while writing the cache.
+  std::error_code finish(Module &M);
+
+  struct Entry;
+
+private:
+  FileCache Cache;
+  std::string PipelineKey;
+  uint64_t MaxSize;
+  std::vector<std::unique_ptr<Entry>> Entries;
+};
+
+} // end namespace opt_tool
+} // end namespace llvm
+
+#endif
@@ -13,6 +13,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "BreakpointPrinter.h"
+#include "FunctionCache.h"
 #include "NewPMDriver.h"
 #include "PassPrinters.h"
 #include "llvm/ADT/Triple.h"
@@ -40,6 +41,7 @@
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Host.h"
+#include "llvm/Support/MD5.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/PluginLoader.h"
 #include "llvm/Support/PrettyStackTrace.h"
@@ -190,6 +192,23 @@ static cl::opt<bool> PreserveAssemblyUseListOrder(
     cl::desc("Preserve use-list order when writing LLVM assembly."),
     cl::init(false), cl::Hidden);
 
+static cl::opt<std::string> FunctionCacheDir(
+    "function-cache-dir",
+    cl::desc("Reuse the optimized bodies of functions cached in this "
+             "directory (function passes only)"),
+    cl::value_desc("directory"));
+
+static cl::opt<unsigned> FunctionCacheSizeLimit(
+    "function-cache-size-limit",
+    cl::desc("Remove the least recently used entries of the function cache "
+             "once it grows past this many megabytes (0 for no limit)"),
+    cl::init(1024), cl::value_desc("MB"));
+
+static cl::opt<unsigned>
+Threads("threads", cl::init(1u), cl::value_desc("N"),
+        cl::desc("Run function passes on N functions at once where they "
+                 "are known to be thread safe"));
+
 static inline void addPass(legacy::PassManagerBase &PM, Pass *P) {
   // Add the pass to the pass manager...
   PM.add(P);
@@ -249,6 +268,142 @@ static void AddStandardLinkPasses(legacy::PassManagerBase &PM) {
   Builder.populateLTOPassManager(PM);
 }
 
+/// Whether the command line asks for one of the standard pipelines.
+static bool usesStandardPipeline() {
+  return OptLevelO1 || OptLevelO2 || OptLevelOs || OptLevelOz || OptLevelO3 ||
+         StandardLinkOpts;
+}
+
+/// Add the passes given on the command line to \p Passes, in command line
+/// order, and the function passes that run ahead of them at -O1 and above to
+/// \p FPasses.  Set \p RunFPasses if \p FPasses needs to be run.  This may be
+/// called more than once to build copies of the pipeline, so it must not
+/// change any options.  Return false on error.
+static bool AddCommandLinePasses(legacy::PassManagerBase &Passes,
+                                 legacy::FunctionPassManager *FPasses,
+                                 const TargetLibraryInfoImpl &TLII,
+                                 TargetMachine *TM, raw_ostream *Out,
+                                 const char *Argv0, bool &RunFPasses) {
+  Passes.add(new TargetLibraryInfoWrapperPass(TLII));
+
+  // Add internal analysis passes from the target machine.
+  Passes.add(createTargetTransformInfoWrapperPass(TM ? TM->getTargetIRAnalysis()
+                                                     : TargetIRAnalysis()));
+
+  if (PrintBreakpoints)
+    Passes.add(createBreakpointPrinter(*Out));
+
+  bool AddStandardLinkOpts = StandardLinkOpts;
+  bool AddO1 = OptLevelO1, AddO2 = OptLevelO2, AddOs = OptLevelOs,
+       AddOz = OptLevelOz, AddO3 = OptLevelO3;
+
+  // Create a new optimization pass for each one specified on the command line
+  for (unsigned i = 0; i < PassList.size(); ++i) {
+    if (AddStandardLinkOpts &&
+        StandardLinkOpts.getPosition() < PassList.getPosition(i)) {
+      AddStandardLinkPasses(Passes);
+      AddStandardLinkOpts = false;
+    }
+
+    if (AddO1 && OptLevelO1.getPosition() < PassList.getPosition(i)) {
+      AddOptimizationPasses(Passes, *FPasses, 1, 0);
+      AddO1 = false;
+    }
+
+    if (AddO2 && OptLevelO2.getPosition() < PassList.getPosition(i)) {
+      AddOptimizationPasses(Passes, *FPasses, 2, 0);
+      AddO2 = false;
+    }
+
+    if (AddOs && OptLevelOs.getPosition() < PassList.getPosition(i)) {
+      AddOptimizationPasses(Passes, *FPasses, 2, 1);
+      AddOs = false;
+    }
+
+    if (AddOz && OptLevelOz.getPosition() < PassList.getPosition(i)) {
+      AddOptimizationPasses(Passes, *FPasses, 2, 2);
+      AddOz = false;
+    }
+
+    if (AddO3 && OptLevelO3.getPosition() < PassList.getPosition(i)) {
+      AddOptimizationPasses(Passes, *FPasses, 3, 0);
+      AddO3 = false;
+    }
+
+    const PassInfo *PassInf = PassList[i];
+    Pass *P = nullptr;
+    if (PassInf->getTargetMachineCtor())
+      P = PassInf->getTargetMachineCtor()(TM);
+    else if (PassInf->getNormalCtor())
+      P = PassInf->getNormalCtor()();
+    else
+      errs() << Argv0 << ": cannot create pass: "
+             << PassInf->getPassName() << "\n";
+    if (P) {
+      PassKind Kind = P->getPassKind();
+      // With a standard pipeline, only the function passes that run ahead of
+      // it are cached.
+      if (!FunctionCacheDir.empty() && !usesStandardPipeline() &&
+          !P->getAsImmutablePass() && Kind != PT_Function &&
+          Kind != PT_Loop && Kind != PT_Region && Kind != PT_BasicBlock) {
+        errs() << Argv0 << ": -function-cache-dir cannot be used with "
+               << "pass '" << PassInf->getPassArgument()
+               << "': it is not a function pass.\n";
+        return false;
+      }
+      addPass(Passes, P);
+
+      if (AnalyzeOnly) {
+        switch (Kind) {
+        case PT_BasicBlock:
+          Passes.add(createBasicBlockPassPrinter(PassInf, *Out, Quiet));
+          break;
+        case PT_Region:
+          Passes.add(createRegionPassPrinter(PassInf, *Out, Quiet));
+          break;
+        case PT_Loop:
+          Passes.add(createLoopPassPrinter(PassInf, *Out, Quiet));
+          break;
+        case PT_Function:
+          Passes.add(createFunctionPassPrinter(PassInf, *Out, Quiet));
+          break;
+        case PT_CallGraphSCC:
+          Passes.add(createCallGraphPassPrinter(PassInf, *Out, Quiet));
+          break;
+        default:
+          Passes.add(createModulePassPrinter(PassInf, *Out, Quiet));
+          break;
+        }
+      }
+    }
+
+    if (PrintEachXForm)
+      Passes.add(
+          createPrintModulePass(errs(), "", PreserveAssemblyUseListOrder));
+  }
+
+  if (AddStandardLinkOpts)
+    AddStandardLinkPasses(Passes);
+
+  if (AddO1)
+    AddOptimizationPasses(Passes, *FPasses, 1, 0);
+
+  if (AddO2)
+    AddOptimizationPasses(Passes, *FPasses, 2, 0);
+
+  if (AddOs)
+    AddOptimizationPasses(Passes, *FPasses, 2, 1);
+
+  if (AddOz)
+    AddOptimizationPasses(Passes, *FPasses, 2, 2);
+
+  if (AddO3)
+    AddOptimizationPasses(Passes, *FPasses, 3, 0);
+
+  RunFPasses = AddO1 || AddO2 || AddOs || AddOz || AddO3;
+  return true;
+}
+
 //===----------------------------------------------------------------------===//
 // CodeGen-related helper functions.
 //
@@ -281,6 +436,48 @@ static TargetMachine* GetTargetMachine(Triple TheTriple, StringRef CPUStr,
                                         GetCodeGenOptLevel());
 }
 
+/// Compute the part of the function cache key that identifies the pipeline:
+/// the opt binary, the command line, less the input and output files and the
+/// cache options, and the target CPU and features, as resolved for
+/// -mcpu=native.
+static std::string getPipelineKey(int argc, char **argv, StringRef CPUStr,
+                                  StringRef FeaturesStr) {
+  MD5 Hash;
+  void *MainAddr = (void *)(intptr_t)getPipelineKey;
+  sys::fs::file_status Status;
+  if (!sys::fs::status(sys::fs::getMainExecutable(argv[0], MainAddr),
+                       Status)) {
+    uint64_t Identity[] = {Status.getSize(),
+                           Status.getLastModificationTime().toEpochTime()};
+    Hash.update(ArrayRef<uint8_t>((const uint8_t *)Identity, sizeof(Identity)));
+  }
+
+  for (int i = 1; i < argc; ++i) {
+    StringRef Arg = argv[i];
+    if (Arg == InputFilename || Arg.startswith("-o="))
+      continue;
+    if (Arg.startswith("--"))
+      Arg = Arg.drop_front();
+    if (Arg.startswith("-function-cache-")) {
+      // Skip the value too when it is a separate argument.
+      if (Arg.find('=') == StringRef::npos)
+        ++i;
+      continue;
+    }
+    if (Arg == "-o") {
+      ++i;
+      continue;
+    }
+    Hash.update(Arg);
+    Hash.update(ArrayRef<uint8_t>((const uint8_t *)"", 1));
+  }
+  for (StringRef Str : {CPUStr, FeaturesStr}) {
+    Hash.update(Str);
+    Hash.update(ArrayRef<uint8_t>((const uint8_t *)"", 1));
+  }
+  return FileCache::getKey(Hash);
+}
+
 #ifdef LINK_POLLY_INTO_TOOLS
 namespace polly {
 void initializePollyPasses(llvm::PassRegistry &Registry);
@@ -338,6 +535,14 @@ int main(int argc, char **argv) {
     return 1;
   }
 
+  if (!FunctionCacheDir.empty() &&
+      (AnalyzeOnly || PrintBreakpoints ||
+       PassPipeline.getNumOccurrences() > 0)) {
+    errs() << argv[0] << ": -function-cache-dir cannot be used with -analyze, "
+                         "-print-breakpoints-for-testing or -passes.\n";
+    return 1;
+  }
+
   SMDiagnostic Err;
 
   // Load the input module...
@@ -440,7 +645,6 @@ int main(int argc, char **argv) {
   // The -disable-simplify-libcalls flag actually disables all builtin optzns.
   if (DisableSimplifyLibCalls)
     TLII.disableAllFunctions();
-  Passes.add(new TargetLibraryInfoWrapperPass(TLII));
 
   // Add an appropriate DataLayout instance for this module.
   const DataLayout &DL = M->getDataLayout();
@@ -448,10 +652,6 @@ int main(int argc, char **argv) {
     M->setDataLayout(DefaultDataLayout);
   }
 
-  // Add internal analysis passes from the target machine.
-  Passes.add(createTargetTransformInfoWrapperPass(TM ? TM->getTargetIRAnalysis()
-                                                     : TargetIRAnalysis()));
-
   std::unique_ptr<legacy::FunctionPassManager> FPasses;
   if (OptLevelO1 || OptLevelO2 || OptLevelOs || OptLevelOz || OptLevelO3) {
     FPasses.reset(new legacy::FunctionPassManager(M.get()));
@@ -473,123 +673,70 @@ int main(int argc, char **argv) {
         return 1;
       }
     }
-    Passes.add(createBreakpointPrinter(Out->os()));
     NoOutput = true;
   }
 
-  // Create a new optimization pass for each one specified on the command line
-  for (unsigned i = 0; i < PassList.size(); ++i) {
-    if (StandardLinkOpts &&
-        StandardLinkOpts.getPosition() < PassList.getPosition(i)) {
-      AddStandardLinkPasses(Passes);
-      StandardLinkOpts = false;
-    }
-
-    if (OptLevelO1 && OptLevelO1.getPosition() < PassList.getPosition(i)) {
-      AddOptimizationPasses(Passes, *FPasses, 1, 0);
-      OptLevelO1 = false;
-    }
-
-    if (OptLevelO2 && OptLevelO2.getPosition() < PassList.getPosition(i)) {
-      AddOptimizationPasses(Passes, *FPasses, 2, 0);
-      OptLevelO2 = false;
-    }
-
-    if (OptLevelOs && OptLevelOs.getPosition() < PassList.getPosition(i)) {
-      AddOptimizationPasses(Passes, *FPasses, 2, 1);
-      OptLevelOs = false;
-    }
-
-    if (OptLevelOz && OptLevelOz.getPosition() < PassList.getPosition(i)) {
-      AddOptimizationPasses(Passes, *FPasses, 2, 2);
-      OptLevelOz = false;
-    }
-
-    if (OptLevelO3 && OptLevelO3.getPosition() < PassList.getPosition(i)) {
-      AddOptimizationPasses(Passes, *FPasses, 3, 0);
-      OptLevelO3 = false;
-    }
-
-    const PassInfo *PassInf = PassList[i];
-    Pass *P = nullptr;
-    if (PassInf->getTargetMachineCtor())
-      P = PassInf->getTargetMachineCtor()(TM.get());
-    else if (PassInf->getNormalCtor())
-      P = PassInf->getNormalCtor()();
-    else
-      errs() << argv[0] << ": cannot create pass: "
-             << PassInf->getPassName() << "\n";
-    if (P) {
-      PassKind Kind = P->getPassKind();
-      addPass(Passes, P);
-
-      if (AnalyzeOnly) {
-        switch (Kind) {
-        case PT_BasicBlock:
-          Passes.add(createBasicBlockPassPrinter(PassInf, Out->os(), Quiet));
-          break;
-        case PT_Region:
-          Passes.add(createRegionPassPrinter(PassInf, Out->os(), Quiet));
-          break;
-        case PT_Loop:
-          Passes.add(createLoopPassPrinter(PassInf, Out->os(), Quiet));
-          break;
-        case PT_Function:
-          Passes.add(createFunctionPassPrinter(PassInf, Out->os(), Quiet));
-          break;
-        case PT_CallGraphSCC:
-          Passes.add(createCallGraphPassPrinter(PassInf, Out->os(), Quiet));
-          break;
-        default:
-          Passes.add(createModulePassPrinter(PassInf, Out->os(), Quiet));
-          break;
-        }
-      }
-    }
-
-    if (PrintEachXForm)
-      Passes.add(
-          createPrintModulePass(errs(), "", PreserveAssemblyUseListOrder));
-  }
-
-  if (StandardLinkOpts) {
-    AddStandardLinkPasses(Passes);
-    StandardLinkOpts = false;
-  }
-
-  if (OptLevelO1)
-    AddOptimizationPasses(Passes, *FPasses, 1, 0);
-
-  if (OptLevelO2)
-    AddOptimizationPasses(Passes, *FPasses, 2, 0);
-
-  if (OptLevelOs)
-    AddOptimizationPasses(Passes, *FPasses, 2, 1);
-
-  if (OptLevelOz)
-    AddOptimizationPasses(Passes, *FPasses, 2, 2);
-
-  if (OptLevelO3)
-    AddOptimizationPasses(Passes, *FPasses, 3, 0);
+  raw_ostream *OS = Out ? &Out->os() : nullptr;
+  bool RunFPasses;
+  if (!AddCommandLinePasses(Passes, FPasses.get(), TLII, TM.get(), OS, argv[0],
+                            RunFPasses))
+    return 1;
 
-  if (OptLevelO1 || OptLevelO2 || OptLevelOs || OptLevelOz || OptLevelO3) {
+  std::unique_ptr<FunctionCache> FnCache;
+  if (!FunctionCacheDir.empty())
+    FnCache = llvm::make_unique<FunctionCache>(
+        FunctionCacheDir, getPipelineKey(argc, argv, CPUStr, FeaturesStr),
+        uint64_t(FunctionCacheSizeLimit) << 20);
+
+  // With a standard pipeline, the function cache covers the function passes
+  // that run ahead of it, and the module passes that follow run uncached.
+  FunctionCache *FPassesCache = usesStandardPipeline() ? FnCache.get()
+                                                       : nullptr;
+  FunctionCache *PassesCache = FPassesCache ? nullptr : FnCache.get();
+
+  if (RunFPasses) {
+    if (FPassesCache)
+      FPassesCache->prepare(*M);
     FPasses->doInitialization();
     for (Function &F : *M)
       FPasses->run(F);
     FPasses->doFinalization();
+    if (FPassesCache)
+      if (std::error_code EC = FPassesCache->finish(*M))
+        errs() << argv[0] << ": warning: cannot write to function cache '"
+               << FunctionCacheDir << "': " << EC.message() << '\n';
   }
 
+  // With a function cache, the module is only complete once the cached
+  // bodies have been put back, so verify and write it separately.
+  legacy::PassManager OutputPasses;
+  legacy::PassManagerBase &LastPasses = PassesCache ? OutputPasses : Passes;
+
   // Check that the module is well formed on completion of optimization
-  if (!NoVerify && !VerifyEach)
-    Passes.add(createVerifierPass());
+  bool VerifyOutput = !NoVerify && !VerifyEach;
+  if (VerifyOutput)
+    LastPasses.add(createVerifierPass());
+
+  // Give each additional thread a copy of the pipeline.  The output of the
+  // analyses would interleave, so -analyze runs on one thread.
+  if (Threads > 1 && !AnalyzeOnly)
+    Passes.setFunctionPassThreads(Threads, [&](legacy::PassManagerBase &Copy) {
+      // The function passes that run ahead of the pipeline are not copied.
+      legacy::FunctionPassManager CopyFPasses(M.get());
+      bool RunCopyFPasses;
+      AddCommandLinePasses(Copy, &CopyFPasses, TLII, TM.get(), OS, argv[0],
+                           RunCopyFPasses);
+      if (VerifyOutput && !PassesCache)
+        Copy.add(createVerifierPass());
+    });
 
   // Write bitcode or assembly to the output as the last step...
   if (!NoOutput && !AnalyzeOnly) {
     if (OutputAssembly)
-      Passes.add(
+      LastPasses.add(
           createPrintModulePass(Out->os(), "", PreserveAssemblyUseListOrder));
     else
-      Passes.add(
+      LastPasses.add(
           createBitcodeWriterPass(Out->os(), PreserveBitcodeUseListOrder));
   }
 
@@ -597,7 +744,15 @@ int main(int argc, char **argv) {
   cl::PrintOptionValues();
 
   // Now that we have all of the passes ready, run them.
+  if (PassesCache)
+    PassesCache->prepare(*M);
   Passes.run(*M);
+  if (PassesCache) {
+    if (std::error_code EC = PassesCache->finish(*M))
+      errs() << argv[0] << ": warning: cannot write to function cache '"
+             << FunctionCacheDir << "': " << EC.message() << '\n';
+    OutputPasses.run(*M);
+  }
 
   // Declare success.
   if (!NoOutput || PrintBreakpoints)
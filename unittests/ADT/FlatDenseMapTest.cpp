@@ -0,0 +1,146 @@
+//===- llvm/unittest/ADT/FlatDenseMapTest.cpp - FlatDenseMap unit tests ---===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/FlatDenseMap.h"
+#include "gtest/gtest.h"
+#include <map>
+#include <memory>
+#include <random>
+
+using namespace llvm;
+
+namespace {
+
+TEST(FlatDenseMapTest, EmptyMap) {
+  FlatDenseMap<unsigned, unsigned> Map;
+  EXPECT_TRUE(Map.empty());
+  EXPECT_EQ(0u, Map.size());
+  EXPECT_EQ(0u, Map.getNumBuckets());
+  EXPECT_TRUE(Map.begin() == Map.end());
+  EXPECT_EQ(0u, Map.count(1));
+  EXPECT_TRUE(Map.find(1) == Map.end());
+  EXPECT_EQ(0u, Map.lookup(1));
+  EXPECT_FALSE(Map.erase(1));
+}
+
+TEST(FlatDenseMapTest, InsertFindErase) {
+  FlatDenseMap<unsigned, unsigned> Map;
+  auto R = Map.insert(std::make_pair(1u, 2u));
+  EXPECT_TRUE(R.second);
+  EXPECT_EQ(1u, R.first->first);
+  EXPECT_EQ(2u, R.first->second);
+
+  R = Map.insert(std::make_pair(1u, 3u));
+  EXPECT_FALSE(R.second);
+  EXPECT_EQ(2u, R.first->second);
+
+  Map[4] = 5;
+  EXPECT_EQ(2u, Map.size());
+  EXPECT_EQ(1u, Map.count(4));
+  EXPECT_EQ(5u, Map.lookup(4));
+  EXPECT_EQ(5u, Map.find(4)->second);
+
+  EXPECT_TRUE(Map.erase(1));
+  EXPECT_FALSE(Map.erase(1));
+  EXPECT_EQ(1u, Map.size());
+  Map.erase(Map.find(4));
+  EXPECT_TRUE(Map.empty());
+}
+
+// Use a hash that puts every key in the same bucket, so that erasing has to
+// move the colliding elements back.
+struct CollidingInfo {
+  static unsigned getHashValue(unsigned) { return 0; }
+  static bool isEqual(unsigned LHS, unsigned RHS) { return LHS == RHS; }
+};
+
+TEST(FlatDenseMapTest, EraseCollisions) {
+  FlatDenseMap<unsigned, unsigned, CollidingInfo> Map;
+  for (unsigned I = 0; I != 40; ++I)
+    Map[I] = I;
+  for (unsigned I = 0; I < 40; I += 3)
+    EXPECT_TRUE(Map.erase(I));
+  for (unsigned I = 0; I != 40; ++I) {
+    if (I % 3 == 0)
+      EXPECT_EQ(0u, Map.count(I));
+    else
+      EXPECT_EQ(I, Map.find(I)->second);
+  }
+}
+
+TEST(FlatDenseMapTest, MatchesStdMap) {
+  // Mix inserts and erases on a small key range, so that the table fills
+  // up, wraps around, and is emptied again.
+  std::mt19937 Rand(0);
+  FlatDenseMap<unsigned, unsigned> Map;
+  std::map<unsigned, unsigned> Ref;
+  for (unsigned I = 0; I != 100000; ++I) {
+    unsigned Key = Rand() % 2000;
+    if (Rand() % 2) {
+      Map[Key] = I;
+      Ref[Key] = I;
+    } else {
+      EXPECT_EQ(Ref.erase(Key), Map.erase(Key));
+    }
+  }
+  EXPECT_EQ(Ref.size(), Map.size());
+  for (auto &KV : Ref)
+    EXPECT_EQ(KV.second, Map.lookup(KV.first));
+  unsigned Count = 0;
+  for (auto &KV : Map) {
+    EXPECT_EQ(Ref[KV.first], KV.second);
+    ++Count;
+  }
+  EXPECT_EQ(Ref.size(), Count);
+}
+
+TEST(FlatDenseMapTest, Reserve) {
+  FlatDenseMap<unsigned, unsigned> Map(100);
+  unsigned NumBuckets = Map.getNumBuckets();
+  for (unsigned I = 0; I != 100; ++I)
+    Map[I] = I;
+  EXPECT_EQ(NumBuckets, Map.getNumBuckets());
+  EXPECT_EQ(NumBuckets * sizeof(detail::DenseMapPair<unsigned, unsigned>) +
+                NumBuckets + 15,
+            Map.getMemorySize());
+}
+
+TEST(FlatDenseMapTest, CopyAndMove) {
+  FlatDenseMap<unsigned, unsigned> Map;
+  for (unsigned I = 0; I != 100; ++I)
+    Map[I] = I + 1;
+
+  FlatDenseMap<unsigned, unsigned> Copy(Map);
+  EXPECT_EQ(100u, Copy.size());
+  EXPECT_EQ(51u, Copy.lookup(50));
+
+  FlatDenseMap<unsigned, unsigned> Moved(std::move(Map));
+  EXPECT_EQ(100u, Moved.size());
+  EXPECT_TRUE(Map.empty());
+
+  Map = Moved;
+  EXPECT_EQ(100u, Map.size());
+  Moved.clear();
+  EXPECT_TRUE(Moved.empty());
+  EXPECT_EQ(0u, Moved.count(50));
+  EXPECT_EQ(100u, Map.lookup(99));
+}
+
+TEST(FlatDenseMapTest, NonTrivialValues) {
+  // Leaks or double frees of the values show up under the sanitizers.
+  FlatDenseMap<unsigned, std::unique_ptr<unsigned>> Map;
+  for (unsigned I = 0; I != 100; ++I)
+    Map[I].reset(new unsigned(I));
+  for (unsigned I = 0; I < 100; I += 2)
+    Map.erase(I);
+  for (unsigned I = 1; I < 100; I += 2)
+    EXPECT_EQ(I, *Map[I]);
+}
+
+} // end anonymous namespace
@@ -9,6 +9,7 @@
 
 #include "gtest/gtest.h"
 #include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/Twine.h"
 #include "llvm/Support/DataTypes.h"
 #include <tuple>
 using namespace llvm;
@@ -356,4 +357,60 @@ TEST_F(StringMapTest, MoveDtor) {
   ASSERT_TRUE(B.empty());
 }
 
+TEST_F(StringMapTest, ManyInsertsAndErases) {
+  // Grow the map past several groups of buckets, and erase keys in a pattern
+  // that leaves both empty buckets and tombstones behind.
+  StringMap<unsigned> Map;
+  for (unsigned I = 0; I != 1000; ++I)
+    Map[("key" + Twine(I)).str()] = I;
+  for (unsigned I = 0; I < 1000; I += 3)
+    EXPECT_TRUE(Map.erase(("key" + Twine(I)).str()));
+  for (unsigned I = 0; I < 1000; I += 6)
+    Map[("key" + Twine(I)).str()] = I + 1;
+
+  EXPECT_EQ(833u, Map.size());
+  for (unsigned I = 0; I != 1000; ++I) {
+    auto It = Map.find(("key" + Twine(I)).str());
+    if (I % 3 != 0) {
+      ASSERT_NE(It, Map.end());
+      EXPECT_EQ(I, It->second);
+    } else if (I % 6 == 0) {
+      ASSERT_NE(It, Map.end());
+      EXPECT_EQ(I + 1, It->second);
+    } else {
+      EXPECT_EQ(It, Map.end());
+    }
+  }
+
+  unsigned Count = 0;
+  for (const auto &Entry : Map) {
+    (void)Entry;
+    ++Count;
+  }
+  EXPECT_EQ(833u, Count);
+
+  Map.clear();
+  EXPECT_TRUE(Map.empty());
+  EXPECT_EQ(0u, Map.count("key1"));
+  Map["key1"] = 1;
+  EXPECT_EQ(1u, Map.lookup("key1"));
+}
+
+TEST_F(StringMapTest, LongKeys) {
+  // Keys longer than a word are hashed a block at a time; make sure keys that
+  // only differ in the last block, or only in length, are told apart.
+  StringMap<unsigned> Map;
+  std::string Prefix(100, 'x');
+  for (unsigned I = 0; I != 64; ++I)
+    Map[Prefix + char('A' + I % 26) + Twine(I).str()] = I;
+  for (unsigned Len = 0; Len != 64; ++Len)
+    Map[std::string(Len, 'y')] = Len + 100;
+
+  EXPECT_EQ(128u, Map.size());
+  for (unsigned I = 0; I != 64; ++I)
+    EXPECT_EQ(I, Map.lookup(Prefix + char('A' + I % 26) + Twine(I).str()));
+  for (unsigned Len = 0; Len != 64; ++Len)
+    EXPECT_EQ(Len + 100, Map.lookup(std::string(Len, 'y')));
+}
+
 } // end anonymous namespace
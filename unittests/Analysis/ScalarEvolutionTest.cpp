@@ -10,11 +10,13 @@
 #include "llvm/Analysis/ScalarEvolutionExpressions.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Analysis/LoopInfo.h"
+#include "llvm/AsmParser/Parser.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/GlobalVariable.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/LegacyPassManager.h"
+#include "llvm/Support/SourceMgr.h"
 #include "gtest/gtest.h"
 
 namespace llvm {
@@ -230,5 +232,86 @@ TEST_F(ScalarEvolutionsTest, SCEVMultiplyAddRecs) {
   EXPECT_EQ(Product->getOperand(8), SE.getAddExpr(Sum));
 }
 
+// Check that isKnownPredicate answers again from its cache, and that
+// forgetting the loop, or a value, drops the cached answers.
+TEST_F(ScalarEvolutionsTest, KnownPredicateCache) {
+  const char *IR = "define void @f(i32 %n) {\n"
+                   "entry:\n"
+                   "  %guard = icmp sgt i32 %n, 0\n"
+                   "  br label %preheader\n"
+                   "preheader:\n"
+                   "  br label %loop\n"
+                   "loop:\n"
+                   "  %iv = phi i32 [ 0, %preheader ], [ %iv.next, %loop ]\n"
+                   "  %iv.next = add i32 %iv, 1\n"
+                   "  %cond = icmp slt i32 %iv.next, %n\n"
+                   "  br i1 %cond, label %loop, label %exit\n"
+                   "exit:\n"
+                   "  ret void\n"
+                   "}\n";
+  SMDiagnostic Error;
+  ASSERT_FALSE(parseAssemblyInto(MemoryBufferRef(IR, "test"), M, Error));
+
+  static char ID;
+  class KnownPredicateCacheTestPass : public FunctionPass {
+  public:
+    KnownPredicateCacheTestPass() : FunctionPass(ID) {}
+
+    static int initialize() {
+      PassInfo *PI = new PassInfo("isKnownPredicate cache testing pass", "",
+                                  &ID, nullptr, true, true);
+      PassRegistry::getPassRegistry()->registerPass(*PI, false);
+      initializeLoopInfoWrapperPassPass(*PassRegistry::getPassRegistry());
+      initializeScalarEvolutionPass(*PassRegistry::getPassRegistry());
+      return 0;
+    }
+
+    void getAnalysisUsage(AnalysisUsage &AU) const override {
+      AU.setPreservesAll();
+      AU.addRequired<LoopInfoWrapperPass>();
+      AU.addRequired<ScalarEvolution>();
+    }
+
+    bool runOnFunction(Function &F) override {
+      ScalarEvolution &SE = getAnalysis<ScalarEvolution>();
+      Loop *L = *getAnalysis<LoopInfoWrapperPass>().getLoopInfo().begin();
+      Function::iterator BBI = F.begin();
+      BasicBlock *Entry = BBI++;
+      BasicBlock *Preheader = BBI++;
+      BasicBlock *Exit = ++BBI;
+      Value *Guard = Entry->begin();
+      const SCEV *IV = SE.getSCEV(L->getHeader()->begin());
+      const SCEV *N = SE.getSCEV(F.arg_begin());
+
+      // Without a guard, %iv may not be less than %n on the first iteration.
+      EXPECT_FALSE(SE.isKnownPredicate(ICmpInst::ICMP_SLT, IV, N));
+
+      // Guard the loop with %n > 0. The cached answer stays until the loop
+      // is forgotten.
+      Entry->getTerminator()->eraseFromParent();
+      BranchInst::Create(Preheader, Exit, Guard, Entry);
+      EXPECT_FALSE(SE.isKnownPredicate(ICmpInst::ICMP_SLT, IV, N));
+      SE.forgetLoop(L);
+      EXPECT_TRUE(SE.isKnownPredicate(ICmpInst::ICMP_SLT, IV, N));
+
+      // Drop the guard again. The cached answer stays until the guard is
+      // forgotten.
+      Entry->getTerminator()->eraseFromParent();
+      BranchInst::Create(Preheader, Entry);
+      EXPECT_TRUE(SE.isKnownPredicate(ICmpInst::ICMP_SLT, IV, N));
+      SE.forgetValue(Guard);
+      EXPECT_FALSE(SE.isKnownPredicate(ICmpInst::ICMP_SLT, IV, N));
+      return false;
+    }
+  };
+
+  static int initialize = KnownPredicateCacheTestPass::initialize();
+  (void)initialize;
+
+  PM.add(&SE);
+  PM.add(new KnownPredicateCacheTestPass());
+  PM.run(M);
+}
+
 }  // end anonymous namespace
 }  // end namespace llvm
@@ -0,0 +1,142 @@
+//===- FileObjectCacheTest.cpp - Unit tests for FileObjectCache -----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/FileObjectCache.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Process.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+class FileObjectCacheTest : public testing::Test {
+protected:
+  void SetUp() override {
+    ASSERT_FALSE(sys::fs::createUniqueDirectory("object-cache", CacheDir));
+  }
+
+  void TearDown() override {
+    for (const std::string &Path : listCacheDir())
+      sys::fs::remove(Path);
+    sys::fs::remove(CacheDir);
+  }
+
+  std::vector<std::string> listCacheDir() {
+    std::vector<std::string> Paths;
+    std::error_code EC;
+    for (sys::fs::directory_iterator I(CacheDir, EC), E; I != E && !EC;
+         I.increment(EC))
+      Paths.push_back(I->path());
+    return Paths;
+  }
+
+  // Make every file in the cache look as if it was last used an hour ago.
+  void ageCacheDir() {
+    sys::TimeValue Old = sys::TimeValue::now() - sys::TimeValue(3600, 0);
+    for (const std::string &Path : listCacheDir()) {
+      int FD;
+      ASSERT_FALSE(sys::fs::openFileForRead(Path, FD));
+      EXPECT_FALSE(sys::fs::setLastModificationAndAccessTime(FD, Old));
+      sys::Process::SafelyCloseFileDescriptor(FD);
+    }
+  }
+
+  std::unique_ptr<Module> createModule(StringRef ID, int Init) {
+    auto M = make_unique<Module>(ID, Context);
+    Type *Int32Ty = Type::getInt32Ty(Context);
+    new GlobalVariable(*M, Int32Ty, false, GlobalValue::ExternalLinkage,
+                       ConstantInt::get(Int32Ty, Init), "G");
+    return M;
+  }
+
+  // Compile M, as far as the cache can tell, into Obj.
+  static void compile(FileObjectCache &Cache, const Module &M, StringRef Obj) {
+    EXPECT_EQ(nullptr, Cache.getObject(&M));
+    Cache.notifyObjectCompiled(&M, MemoryBufferRef(Obj, "obj"));
+  }
+
+  static std::string lookUp(FileObjectCache &Cache, const Module &M) {
+    std::unique_ptr<MemoryBuffer> Obj = Cache.getObject(&M);
+    return Obj ? Obj->getBuffer().str() : "";
+  }
+
+  LLVMContext Context;
+  SmallString<128> CacheDir;
+};
+
+TEST_F(FileObjectCacheTest, KeyedByContents) {
+  auto M1 = createModule("a", 1);
+  auto M1Copy = createModule("b", 1);
+  auto M2 = createModule("a", 2);
+
+  {
+    FileObjectCache Cache(CacheDir);
+    compile(Cache, *M1, "object 1");
+    EXPECT_EQ(1u, listCacheDir().size());
+  }
+
+  // A new cache on the same directory, as a later run would create, finds
+  // the object of any module with the same contents.
+  FileObjectCache Cache(CacheDir);
+  EXPECT_EQ("object 1", lookUp(Cache, *M1));
+  EXPECT_EQ("object 1", lookUp(Cache, *M1Copy));
+  EXPECT_EQ(Cache.getKey(*M1), Cache.getKey(*M1Copy));
+  EXPECT_NE(Cache.getKey(*M1), Cache.getKey(*M2));
+  compile(Cache, *M2, "object 2");
+  EXPECT_EQ("object 2", lookUp(Cache, *M2));
+  EXPECT_EQ(2u, listCacheDir().size());
+}
+
+TEST_F(FileObjectCacheTest, KeyComputedBeforeCompiling) {
+  FileObjectCache Cache(CacheDir);
+  auto M = createModule("m", 1);
+  auto Before = createModule("m", 1);
+
+  // Code generation may change the module between the lookup and the
+  // notification; the object must still be stored under the original key.
+  EXPECT_EQ(nullptr, Cache.getObject(M.get()));
+  M->setTargetTriple("x86_64-unknown-linux-gnu");
+  Cache.notifyObjectCompiled(M.get(), MemoryBufferRef("object", "obj"));
+  EXPECT_EQ("object", lookUp(Cache, *Before));
+}
+
+TEST_F(FileObjectCacheTest, PruneLeastRecentlyUsed) {
+  auto M1 = createModule("m1", 1);
+  auto M2 = createModule("m2", 2);
+  auto M3 = createModule("m3", 3);
+  std::string Obj(1000, 'x');
+
+  {
+    FileObjectCache Cache(CacheDir);
+    compile(Cache, *M1, Obj);
+    compile(Cache, *M2, Obj);
+  }
+  ageCacheDir();
+
+  // Using the first object makes the second the least recently used one,
+  // which must go when a third object is added to a cache holding two.
+  FileObjectCache Cache(CacheDir, 2 * Obj.size());
+  EXPECT_EQ(Obj, lookUp(Cache, *M1));
+  compile(Cache, *M3, Obj);
+  EXPECT_EQ(2u, listCacheDir().size());
+  EXPECT_EQ(Obj, lookUp(Cache, *M1));
+  EXPECT_EQ(Obj, lookUp(Cache, *M3));
+  EXPECT_EQ("", lookUp(Cache, *M2));
+}
+
+}
@@ -19,8 +19,10 @@
 #include "llvm-c/Target.h"
 #include "llvm-c/Transforms/PassManagerBuilder.h"
 #include "llvm-c/Transforms/Scalar.h"
+#include "llvm/ADT/SmallString.h"
 #include "llvm/ExecutionEngine/SectionMemoryManager.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Host.h"
 #include "gtest/gtest.h"
 
@@ -507,3 +509,38 @@ TEST_F(MCJITCAPITest, addGlobalMapping) {
 
   EXPECT_EQ(42, usable());
 }
+
+TEST_F(MCJITCAPITest, file_object_cache) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  SmallString<128> CacheDir;
+  ASSERT_FALSE(sys::fs::createUniqueDirectory("mcjit-object-cache", CacheDir));
+  LLVMObjectCacheRef Cache = LLVMCreateFileObjectCache(CacheDir.c_str(), 0);
+
+  // The second engine loads the object the first one compiled.
+  for (unsigned I = 0; I != 2; ++I) {
+    buildSimpleFunction();
+    buildMCJITOptions();
+    buildMCJITEngine();
+    LLVMSetExecutionEngineObjectCache(Engine, Cache);
+
+    auto *functionPointer = reinterpret_cast<int (*)()>(
+        reinterpret_cast<uintptr_t>(LLVMGetPointerToGlobal(Engine, Function)));
+    EXPECT_EQ(42, functionPointer());
+
+    LLVMDisposeExecutionEngine(Engine);
+    Engine = nullptr;
+    Module = nullptr;
+  }
+  LLVMDisposeObjectCache(Cache);
+
+  std::vector<std::string> Objects;
+  std::error_code EC;
+  for (sys::fs::directory_iterator I(CacheDir, EC), E; I != E && !EC;
+       I.increment(EC))
+    Objects.push_back(I->path());
+  EXPECT_EQ(1u, Objects.size());
+  for (const std::string &Path : Objects)
+    sys::fs::remove(Path);
+  sys::fs::remove(CacheDir);
+}
@@ -0,0 +1,127 @@
+//===- ObjectLinkingLayerTest.cpp - Unit tests for object linking layer ---===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/ExecutionEngine.h"
+#include "llvm/ExecutionEngine/Orc/CompileUtils.h"
+#include "llvm/ExecutionEngine/Orc/LambdaResolver.h"
+#include "llvm/ExecutionEngine/Orc/ObjectLinkingLayer.h"
+#include "llvm/ExecutionEngine/SectionMemoryManager.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Mangler.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/TargetSelect.h"
+#include "gtest/gtest.h"
+#include <thread>
+
+using namespace llvm;
+using namespace llvm::orc;
+
+namespace {
+
+// Build a module that defines "f<I>(N)", which returns I if N is zero and
+// f<(I + 1) % NumFns>(N - 1) otherwise, so that the objects refer to each
+// other in a cycle.
+static std::unique_ptr<Module> createModule(LLVMContext &Context,
+                                            const DataLayout &DL, unsigned I,
+                                            unsigned NumFns) {
+  auto M = llvm::make_unique<Module>(("f" + Twine(I)).str(), Context);
+  M->setDataLayout(DL);
+  Type *Int32Ty = Type::getInt32Ty(Context);
+  FunctionType *FTy = FunctionType::get(Int32Ty, Int32Ty, false);
+  Function *F = Function::Create(FTy, GlobalValue::ExternalLinkage,
+                                 "f" + Twine(I), M.get());
+  Function *Next = Function::Create(FTy, GlobalValue::ExternalLinkage,
+                                    "f" + Twine((I + 1) % NumFns), M.get());
+
+  BasicBlock *Entry = BasicBlock::Create(Context, "entry", F);
+  BasicBlock *Done = BasicBlock::Create(Context, "done", F);
+  BasicBlock *Recurse = BasicBlock::Create(Context, "recurse", F);
+  IRBuilder<> B(Entry);
+  Value *N = F->arg_begin();
+  B.CreateCondBr(B.CreateICmpEQ(N, B.getInt32(0)), Done, Recurse);
+  B.SetInsertPoint(Done);
+  B.CreateRet(B.getInt32(I));
+  B.SetInsertPoint(Recurse);
+  B.CreateRet(B.CreateCall(Next, B.CreateSub(N, B.getInt32(1))));
+  return M;
+}
+
+#if LLVM_ENABLE_THREADS
+
+TEST(ObjectLinkingLayerTest, ConcurrentAddAndLookup) {
+  InitializeNativeTarget();
+  InitializeNativeTargetAsmPrinter();
+  std::unique_ptr<TargetMachine> TM(EngineBuilder().selectTarget());
+  // Only run where the JIT can run the code it links.
+  if (!TM || TM->getTargetTriple().getArch() != Triple::x86_64)
+    return;
+
+  const unsigned NumFns = 8;
+  LLVMContext Context;
+  const DataLayout &DL = *TM->getDataLayout();
+  std::vector<object::OwningBinary<object::ObjectFile>> Objects;
+  for (unsigned I = 0; I < NumFns; ++I) {
+    auto M = createModule(Context, DL, I, NumFns);
+    Objects.push_back(SimpleCompiler(*TM)(*M));
+    ASSERT_TRUE(Objects.back().getBinary() != nullptr);
+  }
+
+  auto Mangle = [&](const Twine &Name) {
+    std::string MangledName;
+    raw_string_ostream MangledNameStream(MangledName);
+    Mangler::getNameWithPrefix(MangledNameStream, Name, DL);
+    return MangledNameStream.str();
+  };
+
+  ObjectLinkingLayer<> ObjLayer;
+  auto Resolve = [&](const std::string &Name) {
+    if (auto Sym = ObjLayer.findSymbol(Name, false))
+      return RuntimeDyld::SymbolInfo(Sym.getAddress(), Sym.getFlags());
+    return RuntimeDyld::SymbolInfo(nullptr);
+  };
+
+  // Link each object on its own thread.
+  std::vector<std::thread> Threads;
+  for (unsigned I = 0; I < NumFns; ++I)
+    Threads.push_back(std::thread([&, I]() {
+      std::vector<object::ObjectFile *> Set;
+      Set.push_back(Objects[I].getBinary());
+      ObjLayer.addObjectSet(std::move(Set),
+                            llvm::make_unique<SectionMemoryManager>(),
+                            createLambdaResolver(Resolve, Resolve));
+    }));
+  for (auto &T : Threads)
+    T.join();
+  Threads.clear();
+
+  // Then look up and call each function on its own thread, so that the
+  // objects, which all depend on each other, are finalized concurrently.
+  const int32_t Depth = 3 * NumFns + 1;
+  std::vector<int32_t> Results(NumFns, -1);
+  for (unsigned I = 0; I < NumFns; ++I)
+    Threads.push_back(std::thread([&, I]() {
+      auto Sym = ObjLayer.findSymbol(Mangle("f" + Twine(I)), true);
+      if (!Sym)
+        return;
+      auto *Fn = reinterpret_cast<int32_t (*)(int32_t)>(
+          static_cast<uintptr_t>(Sym.getAddress()));
+      Results[I] = Fn(Depth);
+    }));
+  for (auto &T : Threads)
+    T.join();
+
+  for (unsigned I = 0; I < NumFns; ++I)
+    EXPECT_EQ(int32_t((I + Depth) % NumFns), Results[I])
+        << "Wrong result from f" << I;
+}
+
+#endif
+
+}
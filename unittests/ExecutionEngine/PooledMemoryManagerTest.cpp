@@ -0,0 +1,152 @@
+//===- PooledMemoryManagerTest.cpp - Unit tests for the pooled manager ----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/PooledMemoryManager.h"
+#include "llvm/Support/Process.h"
+#include "gtest/gtest.h"
+#include <cstdio>
+#include <fstream>
+
+using namespace llvm;
+
+namespace {
+
+#ifdef __linux__
+// Return the number of mappings of the process overlapping [Begin, End).
+static unsigned countMappings(uintptr_t Begin, uintptr_t End) {
+  std::ifstream Maps("/proc/self/maps");
+  unsigned Count = 0;
+  std::string Line;
+  while (std::getline(Maps, Line)) {
+    unsigned long long Start, Stop;
+    if (sscanf(Line.c_str(), "%llx-%llx", &Start, &Stop) == 2 &&
+        Start < End && Stop > Begin)
+      ++Count;
+  }
+  return Count;
+}
+#endif
+
+TEST(PooledMemoryManagerTest, BasicAllocations) {
+  JITMemoryPool Pool;
+  {
+    PooledMemoryManager MemMgr(Pool);
+    uint8_t *code1 = MemMgr.allocateCodeSection(256, 0, 1, "");
+    uint8_t *data1 = MemMgr.allocateDataSection(256, 0, 2, "", true);
+    uint8_t *code2 = MemMgr.allocateCodeSection(256, 64, 3, "");
+    uint8_t *data2 = MemMgr.allocateDataSection(256, 0, 4, "", false);
+
+    ASSERT_NE((uint8_t*)nullptr, code1);
+    ASSERT_NE((uint8_t*)nullptr, code2);
+    ASSERT_NE((uint8_t*)nullptr, data1);
+    ASSERT_NE((uint8_t*)nullptr, data2);
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(code2) % 64);
+
+    for (unsigned i = 0; i < 256; ++i) {
+      code1[i] = 1;
+      code2[i] = 2;
+      data1[i] = 3;
+      data2[i] = 4;
+    }
+    for (unsigned i = 0; i < 256; ++i) {
+      EXPECT_EQ(1, code1[i]);
+      EXPECT_EQ(2, code2[i]);
+      EXPECT_EQ(3, data1[i]);
+      EXPECT_EQ(4, data2[i]);
+    }
+
+    // Code and data come from slabs of their own.
+    EXPECT_EQ(1u, Pool.getNumSlabs(JITMemoryPool::Code));
+    EXPECT_EQ(1u, Pool.getNumSlabs(JITMemoryPool::Data));
+
+    std::string Error;
+    EXPECT_FALSE(MemMgr.finalizeMemory(&Error));
+    EXPECT_NE(0u, Pool.getAllocatedSize(JITMemoryPool::Code));
+  }
+
+  // Destroying the memory manager gives all its memory back.
+  EXPECT_EQ(0u, Pool.getAllocatedSize(JITMemoryPool::Code));
+  EXPECT_EQ(0u, Pool.getAllocatedSize(JITMemoryPool::Data));
+}
+
+TEST(PooledMemoryManagerTest, CodeIsPacked) {
+  const size_t PageSize = sys::Process::getPageSize();
+  JITMemoryPool Pool;
+
+  // The pages a manager does not use are given back when it finalizes, so
+  // the code of the next module follows right after.
+  PooledMemoryManager MemMgr1(Pool);
+  uint8_t *code1 = MemMgr1.allocateCodeSection(100, 0, 1, "");
+  EXPECT_FALSE(MemMgr1.finalizeMemory());
+  EXPECT_EQ(PageSize, Pool.getAllocatedSize(JITMemoryPool::Code));
+
+  std::unique_ptr<PooledMemoryManager> MemMgr2(new PooledMemoryManager(Pool));
+  uint8_t *code2 = MemMgr2->allocateCodeSection(100, 0, 1, "");
+  EXPECT_EQ(code1 + PageSize, code2);
+  EXPECT_FALSE(MemMgr2->finalizeMemory());
+
+  // The memory of a module that is freed is reused by the next one.
+  MemMgr2.reset();
+  PooledMemoryManager MemMgr3(Pool);
+  EXPECT_EQ(code2, MemMgr3.allocateCodeSection(100, 0, 1, ""));
+  EXPECT_FALSE(MemMgr3.finalizeMemory());
+}
+
+TEST(PooledMemoryManagerTest, LargeAllocations) {
+  JITMemoryPool Pool(64 * 1024);
+  std::unique_ptr<PooledMemoryManager> MemMgr(new PooledMemoryManager(Pool));
+
+  uint8_t *code1 = MemMgr->allocateCodeSection(0x100000, 0, 1, "");
+  uint8_t *code2 = MemMgr->allocateCodeSection(0x100000, 0, 2, "");
+  uint8_t *code3 = MemMgr->allocateCodeSection(0x100000, 0, 3, "");
+  ASSERT_NE((uint8_t*)nullptr, code1);
+  ASSERT_NE((uint8_t*)nullptr, code2);
+  ASSERT_NE((uint8_t*)nullptr, code3);
+  code1[0x100000 - 1] = 1;
+  code2[0x100000 - 1] = 2;
+  code3[0x100000 - 1] = 3;
+  EXPECT_EQ(1, code1[0x100000 - 1]);
+  EXPECT_EQ(2, code2[0x100000 - 1]);
+  EXPECT_EQ(3, code3[0x100000 - 1]);
+  EXPECT_EQ(3u, Pool.getNumSlabs(JITMemoryPool::Code));
+  EXPECT_FALSE(MemMgr->finalizeMemory());
+
+  // Slabs that become unused are unmapped, but for one.
+  MemMgr.reset();
+  EXPECT_EQ(1u, Pool.getNumSlabs(JITMemoryPool::Code));
+  EXPECT_EQ(0u, Pool.getAllocatedSize(JITMemoryPool::Code));
+}
+
+TEST(PooledMemoryManagerTest, HugePageSlabs) {
+  JITMemoryPool Pool(1, true);
+  PooledMemoryManager MemMgr(Pool);
+  uint8_t *code = MemMgr.allocateCodeSection(256, 0, 1, "");
+  uint8_t *data = MemMgr.allocateDataSection(256, 0, 2, "", false);
+  ASSERT_NE((uint8_t*)nullptr, code);
+  ASSERT_NE((uint8_t*)nullptr, data);
+
+  // The first section of each kind starts its slab, which is aligned to a
+  // huge page.
+  EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(code) % JITMemoryPool::HugePageSize);
+  EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(data) % JITMemoryPool::HugePageSize);
+  EXPECT_FALSE(MemMgr.finalizeMemory());
+
+  // Finalizing does not change the permissions of part of the slabs, which
+  // would split their mappings and break up their huge pages.
+  EXPECT_TRUE(Pool.hasFixedPermissions());
+  code[0] = 1;
+  EXPECT_EQ(1, code[0]);
+#ifdef __linux__
+  uintptr_t CodeSlab = reinterpret_cast<uintptr_t>(code);
+  EXPECT_EQ(1u,
+            countMappings(CodeSlab, CodeSlab + JITMemoryPool::HugePageSize));
+#endif
+}
+
+}
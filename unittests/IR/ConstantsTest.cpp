@@ -12,10 +12,13 @@
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/InstrTypes.h"
 #include "llvm/IR/Instruction.h"
+#include "llvm/IR/Instructions.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Metadata.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Support/SourceMgr.h"
 #include "gtest/gtest.h"
+#include <thread>
 
 namespace llvm {
 namespace {
@@ -382,5 +385,93 @@ TEST(ConstantsTest, AliasCAPI) {
   ASSERT_EQ(unwrap<GlobalAlias>(AliasRef)->getAliasee(), Aliasee);
 }
 
+#if LLVM_ENABLE_THREADS
+TEST(ConstantsTest, MultithreadedUniquing) {
+  LLVMContext Context;
+  SMDiagnostic Error;
+  std::unique_ptr<Module> M =
+      parseAssemblyString("@g = global [4 x i32] zeroinitializer", Error,
+                          Context);
+  GlobalVariable *G = M->getGlobalVariable("g");
+  Context.setMultithreaded(true);
+
+  // Have several threads create the same constants, types and metadata at
+  // once, and check that they all got the same ones.
+  const unsigned NumThreads = 4;
+  const unsigned NumConstants = 500;
+  std::vector<std::vector<void *>> Created(NumThreads);
+  std::vector<std::thread> Threads;
+  for (unsigned T = 0; T < NumThreads; ++T)
+    Threads.emplace_back([&, T] {
+      for (unsigned I = 0; I < NumConstants; ++I) {
+        Type *IntTy = IntegerType::get(Context, 8 + I % 64);
+        Constant *Int = ConstantInt::get(IntTy, I);
+        Constant *Idx[] = {ConstantInt::get(Type::getInt32Ty(Context), 0),
+                           ConstantInt::get(Type::getInt32Ty(Context), I % 4)};
+        Constant *GEP =
+            ConstantExpr::getInBoundsGetElementPtr(G->getValueType(), G, Idx);
+        Constant *FP = ConstantFP::get(Context, APFloat(double(I)));
+        Constant *Fields[] = {Int, GEP, FP};
+        Constant *Struct = ConstantStruct::getAnon(Fields);
+        Metadata *Ops[] = {MDString::get(Context, Twine(I).str()),
+                           ConstantAsMetadata::get(Struct)};
+        MDNode *Node = MDTuple::get(Context, Ops);
+        Created[T].push_back(Int);
+        Created[T].push_back(GEP);
+        Created[T].push_back(Struct);
+        Created[T].push_back(Node);
+      }
+    });
+  for (std::thread &Thread : Threads)
+    Thread.join();
+
+  Context.setMultithreaded(false);
+  for (unsigned T = 1; T < NumThreads; ++T)
+    EXPECT_EQ(Created[0], Created[T]);
+  // One getelementptr for each of the elements of @g.
+  EXPECT_EQ(4u, G->getNumUses());
+}
+
+TEST(ConstantsTest, MultithreadedRemoveDeadConstantUsers) {
+  LLVMContext Context;
+  SMDiagnostic Error;
+  std::unique_ptr<Module> M = parseAssemblyString(
+      "@g = global i32 0\n"
+      "define void @f0() {\n  ret void\n}\n"
+      "define void @f1() {\n  ret void\n}\n"
+      "define void @f2() {\n  ret void\n}\n",
+      Error, Context);
+  GlobalVariable *G = M->getGlobalVariable("g");
+  Context.setMultithreaded(true);
+
+  // Have several threads add loads of @g to their own functions, while
+  // another one creates dead constant users of @g and removes them.
+  const unsigned NumThreads = 3;
+  const unsigned NumLoads = 1000;
+  std::vector<std::thread> Threads;
+  for (unsigned T = 0; T < NumThreads; ++T)
+    Threads.emplace_back([&, T] {
+      Function *F = M->getFunction("f" + Twine(T).str());
+      Instruction *Ret = F->getEntryBlock().getTerminator();
+      for (unsigned I = 0; I < NumLoads; ++I)
+        new LoadInst(G, "", Ret);
+    });
+  Threads.emplace_back([&] {
+    for (unsigned I = 0; I < NumLoads; ++I) {
+      ConstantExpr::getPtrToInt(G, IntegerType::get(Context, 8 + I % 56));
+      if (I % 8 == 7)
+        G->removeDeadConstantUsers();
+    }
+  });
+  for (std::thread &Thread : Threads)
+    Thread.join();
+
+  // The dead users stay until no other thread can refer to them.
+  EXPECT_LT(NumThreads * NumLoads, G->getNumUses());
+  Context.setMultithreaded(false);
+  EXPECT_EQ(NumThreads * NumLoads, G->getNumUses());
+}
+#endif
+
 }  // end anonymous namespace
 }  // end namespace llvm
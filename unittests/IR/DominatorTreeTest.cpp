@@ -17,6 +17,7 @@
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/Support/SourceMgr.h"
 #include "gtest/gtest.h"
+#include <random>
 
 using namespace llvm;
 
@@ -250,6 +251,211 @@ namespace llvm {
       Passes.add(P);
       Passes.run(*M);
     }
+
+    std::unique_ptr<Module> parseModule(const char *Source) {
+      SMDiagnostic Err;
+      return parseAssemblyString(Source, Err, getGlobalContext());
+    }
+
+    BasicBlock *getBlock(Function &F, StringRef Name) {
+      for (BasicBlock &BB : F)
+        if (BB.getName() == Name)
+          return &BB;
+      return nullptr;
+    }
+
+    // Replace the terminator of BB with a branch to Succs, on the first
+    // argument of the function if there are two of them.
+    void setSuccessors(BasicBlock *BB, ArrayRef<BasicBlock *> Succs) {
+      BB->getTerminator()->eraseFromParent();
+      if (Succs.size() == 1)
+        BranchInst::Create(Succs[0], BB);
+      else
+        BranchInst::Create(Succs[0], Succs[1],
+                           BB->getParent()->arg_begin(), BB);
+    }
+
+    // Return true if DT, levels included, matches a tree computed from
+    // scratch.
+    bool isUpToDate(const DominatorTree &DT, Function &F) {
+      DominatorTree Fresh;
+      Fresh.recalculate(F);
+      if (DT.compare(Fresh))
+        return false;
+      for (BasicBlock &BB : F) {
+        DomTreeNode *N = DT.getNode(&BB), *FreshN = Fresh.getNode(&BB);
+        if (!N != !FreshN || (N && N->getLevel() != FreshN->getLevel()))
+          return false;
+      }
+      return true;
+    }
+
+    const char *DiamondSource =
+        "define void @f(i1 %cond) {\n"
+        "entry:\n"
+        "  br i1 %cond, label %a, label %b\n"
+        "a:\n"
+        "  br label %c\n"
+        "b:\n"
+        "  br label %exit\n"
+        "c:\n"
+        "  br label %exit\n"
+        "exit:\n"
+        "  ret void\n"
+        "}\n";
+
+    TEST(DominatorTree, InsertDeleteReachable) {
+      std::unique_ptr<Module> M = parseModule(DiamondSource);
+      Function &F = *M->getFunction("f");
+      BasicBlock *Entry = getBlock(F, "entry"), *A = getBlock(F, "a"),
+                 *B = getBlock(F, "b"), *C = getBlock(F, "c"),
+                 *Exit = getBlock(F, "exit");
+      DominatorTree DT;
+      DT.recalculate(F);
+      EXPECT_EQ(A, DT.getNode(C)->getIDom()->getBlock());
+      EXPECT_EQ(2U, DT.getNode(C)->getLevel());
+
+      setSuccessors(B, {C, Exit});
+      DT.insertEdge(B, C);
+      EXPECT_TRUE(isUpToDate(DT, F));
+      EXPECT_EQ(Entry, DT.getNode(C)->getIDom()->getBlock());
+      EXPECT_EQ(1U, DT.getNode(C)->getLevel());
+
+      setSuccessors(B, {Exit});
+      DT.deleteEdge(B, C);
+      EXPECT_TRUE(isUpToDate(DT, F));
+      EXPECT_EQ(A, DT.getNode(C)->getIDom()->getBlock());
+
+      // Deleting an edge to a dominator changes nothing.
+      setSuccessors(A, {C, Entry});
+      DT.insertEdge(A, Entry);
+      EXPECT_TRUE(isUpToDate(DT, F));
+      setSuccessors(A, {C});
+      DT.deleteEdge(A, Entry);
+      EXPECT_TRUE(isUpToDate(DT, F));
+    }
+
+    TEST(DominatorTree, InsertDeleteUnreachable) {
+      std::unique_ptr<Module> M = parseModule(
+          "define void @f(i1 %cond) {\n"
+          "entry:\n"
+          "  br label %a\n"
+          "a:\n"
+          "  br label %b\n"
+          "b:\n"
+          "  ret void\n"
+          "dead:\n"
+          "  br label %dead2\n"
+          "dead2:\n"
+          "  br i1 %cond, label %dead, label %b\n"
+          "}\n");
+      Function &F = *M->getFunction("f");
+      BasicBlock *Entry = getBlock(F, "entry"), *A = getBlock(F, "a"),
+                 *B = getBlock(F, "b"), *Dead = getBlock(F, "dead"),
+                 *Dead2 = getBlock(F, "dead2");
+      DominatorTree DT;
+      DT.recalculate(F);
+      EXPECT_FALSE(DT.getNode(Dead));
+
+      // The edge makes dead and dead2 reachable, and b reachable around a.
+      setSuccessors(Entry, {A, Dead});
+      DT.insertEdge(Entry, Dead);
+      EXPECT_TRUE(isUpToDate(DT, F));
+      EXPECT_EQ(Dead, DT.getNode(Dead2)->getIDom()->getBlock());
+      EXPECT_EQ(Entry, DT.getNode(B)->getIDom()->getBlock());
+
+      // Deleting it removes them from the tree again.
+      setSuccessors(Entry, {A});
+      DT.deleteEdge(Entry, Dead);
+      EXPECT_TRUE(isUpToDate(DT, F));
+      EXPECT_FALSE(DT.getNode(Dead));
+      EXPECT_FALSE(DT.getNode(Dead2));
+      EXPECT_EQ(A, DT.getNode(B)->getIDom()->getBlock());
+    }
+
+    TEST(DominatorTree, BatchUpdates) {
+      std::unique_ptr<Module> M = parseModule(DiamondSource);
+      Function &F = *M->getFunction("f");
+      BasicBlock *Entry = getBlock(F, "entry"), *A = getBlock(F, "a"),
+                 *B = getBlock(F, "b"), *C = getBlock(F, "c"),
+                 *Exit = getBlock(F, "exit");
+      DominatorTree DT;
+      DT.recalculate(F);
+
+      // Make a the only way to b and c, and b a way to c. The edge a -> exit
+      // is inserted then deleted, which cancels out.
+      setSuccessors(Entry, {A});
+      setSuccessors(A, {B, C});
+      setSuccessors(B, {C});
+      DominatorTree::UpdateType Updates[] = {
+          {DominatorTree::Insert, A, Exit},
+          {DominatorTree::Delete, Entry, B},
+          {DominatorTree::Insert, A, B},
+          {DominatorTree::Delete, B, Exit},
+          {DominatorTree::Insert, B, C},
+          {DominatorTree::Delete, A, Exit}};
+      DT.applyUpdates(Updates);
+      EXPECT_TRUE(isUpToDate(DT, F));
+      EXPECT_EQ(A, DT.getNode(B)->getIDom()->getBlock());
+      EXPECT_EQ(A, DT.getNode(C)->getIDom()->getBlock());
+      EXPECT_EQ(C, DT.getNode(Exit)->getIDom()->getBlock());
+    }
+
+    // Insert and delete random edges of a random CFG, one at a time and in
+    // batches, checking the tree against one computed from scratch.
+    TEST(DominatorTree, RandomUpdates) {
+      LLVMContext &C = getGlobalContext();
+      Module M("m", C);
+      Type *I32 = Type::getInt32Ty(C);
+      Function *F = Function::Create(
+          FunctionType::get(Type::getVoidTy(C), I32, false),
+          GlobalValue::ExternalLinkage, "f", &M);
+      // Large enough for batches of four updates not to be recalculated.
+      const unsigned NumBlocks = 200;
+      std::vector<BasicBlock *> Blocks;
+      for (unsigned I = 0; I != NumBlocks; ++I)
+        Blocks.push_back(BasicBlock::Create(C, "", F));
+      BasicBlock *Exit = BasicBlock::Create(C, "exit", F);
+      ReturnInst::Create(C, Exit);
+
+      // Block I branches to block J when its switch has the case J.
+      std::mt19937 Rand(0);
+      std::vector<SwitchInst *> Switches;
+      for (BasicBlock *BB : Blocks)
+        Switches.push_back(SwitchInst::Create(F->arg_begin(), Exit, 0, BB));
+      auto HasEdge = [&](unsigned From, unsigned To) {
+        SwitchInst *SI = Switches[From];
+        return SI->findCaseValue(ConstantInt::get(C, APInt(32, To))) !=
+               SI->case_default();
+      };
+      auto Toggle = [&](unsigned From, unsigned To) {
+        SwitchInst *SI = Switches[From];
+        ConstantInt *V = ConstantInt::get(C, APInt(32, To));
+        if (HasEdge(From, To)) {
+          SI->removeCase(SI->findCaseValue(V));
+          return DominatorTree::Delete;
+        }
+        SI->addCase(V, Blocks[To]);
+        return DominatorTree::Insert;
+      };
+      for (unsigned I = 0; I != 2 * NumBlocks; ++I)
+        Toggle(Rand() % NumBlocks, 1 + Rand() % (NumBlocks - 1));
+
+      DominatorTree DT;
+      DT.recalculate(*F);
+      for (unsigned Step = 0; Step != 400; ++Step) {
+        SmallVector<DominatorTree::UpdateType, 4> Updates;
+        for (unsigned I = 0, E = 1 + Step % 4; I != E; ++I) {
+          unsigned From = Rand() % NumBlocks;
+          unsigned To = 1 + Rand() % (NumBlocks - 1);
+          DominatorTree::UpdateType U = {Toggle(From, To), Blocks[From],
+                                         Blocks[To]};
+          Updates.push_back(U);
+        }
+        DT.applyUpdates(Updates);
+        ASSERT_TRUE(isUpToDate(DT, *F)) << "step " << Step;
+      }
+    }
   }
 }
 
@@ -8,11 +8,13 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/Constants.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/User.h"
+#include "llvm/IR/Verifier.h"
 #include "llvm/Support/SourceMgr.h"
 #include "gtest/gtest.h"
 using namespace llvm;
@@ -93,4 +95,79 @@ TEST(UserTest, ValueOpIteration) {
   EXPECT_EQ(P.value_op_end(), (I - 2) + 8);
 }
 
+TEST(UserTest, ArenaAllocation) {
+  LLVMContext C;
+  EXPECT_EQ(0u, C.getIRArenaSize());
+
+  const char *ModuleString = "define i32 @f(i1 %c, i32 %x, i32 %y) {\n"
+                             "entry:\n"
+                             "  br i1 %c, label %a, label %b\n"
+                             "a:\n"
+                             "  %add = add i32 %x, %y\n"
+                             "  br label %exit\n"
+                             "b:\n"
+                             "  %mul = mul i32 %x, %y\n"
+                             "  br label %exit\n"
+                             "exit:\n"
+                             "  %p = phi i32 [ %add, %a ], [ %mul, %b ]\n"
+                             "  ret i32 %p\n"
+                             "}";
+  SMDiagnostic Err;
+  std::unique_ptr<Module> M;
+  {
+    IRArenaScope Scope(C);
+    M = parseAssemblyString(ModuleString, Err, C);
+  }
+  ASSERT_TRUE(M != nullptr);
+  size_t ArenaSize = C.getIRArenaSize();
+  EXPECT_NE(0u, ArenaSize);
+
+  // Instructions created outside of a scope come from the heap.
+  Function *F = M->getFunction("f");
+  BasicBlock &Exit = F->back();
+  Argument *X = &*std::next(F->arg_begin());
+  BinaryOperator *Sub = BinaryOperator::CreateSub(X, X, "sub");
+  EXPECT_EQ(ArenaSize, C.getIRArenaSize());
+  delete Sub;
+
+  // Growing the hung off operands of an arena PHI keeps it in the arena.
+  PHINode *P = cast<PHINode>(&Exit.front());
+  Instruction *Add = cast<Instruction>(P->getIncomingValue(0));
+  BasicBlock *A = P->getIncomingBlock(0);
+  for (unsigned I = 0; I != 16; ++I)
+    P->addIncoming(Add, A);
+  EXPECT_EQ(18u, P->getNumIncomingValues());
+  EXPECT_EQ(Add, P->getIncomingValue(17));
+  EXPECT_EQ(A, P->getIncomingBlock(17));
+  EXPECT_EQ(17u, Add->getNumUses());
+
+  // Use lists and deletion work as usual on arena-allocated values.
+  Add->replaceAllUsesWith(X);
+  EXPECT_TRUE(Add->use_empty());
+  EXPECT_EQ(X, P->getIncomingValue(0));
+  EXPECT_EQ(X, P->getIncomingValue(17));
+  Add->eraseFromParent();
+  while (P->getNumIncomingValues() > 2)
+    P->removeIncomingValue(2u);
+
+  {
+    IRArenaScope Scope(C);
+    Instruction *Ret = Exit.getTerminator();
+    Ret->setOperand(0, BinaryOperator::CreateNeg(P, "neg", Ret));
+  }
+  EXPECT_FALSE(verifyModule(*M));
+  M.reset();
+}
+
+#ifdef GTEST_HAS_DEATH_TEST
+#ifndef NDEBUG
+TEST(UserTest, IRArenaOfOtherContext) {
+  LLVMContext C1, C2;
+  IRArenaScope Scope(C1);
+  EXPECT_DEATH(ConstantInt::get(Type::getInt32Ty(C2), 1),
+               "User of one context created in the IR arena of another");
+}
+#endif
+#endif
+
 } // end anonymous namespace
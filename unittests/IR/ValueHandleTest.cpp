@@ -11,6 +11,7 @@
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
 #include "gtest/gtest.h"
 #include <memory>
 
@@ -410,4 +411,64 @@ TEST_F(ValueHandle, AssertingVHCheckedLast) {
   BitcastV.reset();
 }
 
+
+#if LLVM_ENABLE_THREADS
+TEST(ValueHandleMultithreaded, SharedValueCallbacksRunUnlocked) {
+  // The handles of a global are walked under a lock while the context is
+  // multithreaded, but the callbacks run once it is released, so they may
+  // create constants, whose lock comes first, and drop other handles.
+  LLVMContext Context;
+  Module M("m", Context);
+  Type *I32 = Type::getInt32Ty(Context);
+  auto *G = new GlobalVariable(M, I32, false, GlobalValue::ExternalLinkage,
+                               nullptr, "g");
+  auto *H = new GlobalVariable(M, I32, false, GlobalValue::ExternalLinkage,
+                               nullptr, "h");
+  Context.setMultithreaded(true);
+
+  class CreatingVH : public CallbackVH {
+  public:
+    Constant *Created;
+    CreatingVH(Value *V) : CallbackVH(V), Created(nullptr) {}
+    void allUsesReplacedWith(Value *New) override {
+      Created = ConstantExpr::getPtrToInt(cast<Constant>(New),
+                                          Type::getInt64Ty(New->getContext()));
+      setValPtr(New);
+    }
+  };
+
+  {
+    CreatingVH VH(G);
+    G->replaceAllUsesWith(H);
+    EXPECT_EQ(H, static_cast<Value *>(VH));
+    ASSERT_TRUE(VH.Created);
+    EXPECT_EQ(H, VH.Created->getOperand(0));
+  }
+
+  // Whichever of the two handles is called first drops the other one, which
+  // must then not be called.
+  class DroppingVH : public CallbackVH {
+    std::unique_ptr<DroppingVH> &Other;
+    unsigned &Calls;
+
+  public:
+    DroppingVH(Value *V, std::unique_ptr<DroppingVH> &Other, unsigned &Calls)
+        : CallbackVH(V), Other(Other), Calls(Calls) {}
+    void deleted() override {
+      ++Calls;
+      Other.reset();
+      CallbackVH::deleted();
+    }
+  };
+
+  std::unique_ptr<DroppingVH> VHs[2];
+  unsigned Calls = 0;
+  VHs[0].reset(new DroppingVH(G, VHs[1], Calls));
+  VHs[1].reset(new DroppingVH(G, VHs[0], Calls));
+  G->eraseFromParent();
+  EXPECT_EQ(1u, Calls);
+
+  Context.setMultithreaded(false);
+}
+#endif
 }
@@ -0,0 +1,101 @@
+//===- LTOCAPITest.cpp - Unit tests for the libLTO C API ------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm-c/lto.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Object/ObjectFile.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+static const char ModuleText[] = "define void @foo() {\n"
+                                 "  call void @bar()\n"
+                                 "  call void @bar()\n"
+                                 "  call void @bar()\n"
+                                 "  ret void\n"
+                                 "}\n"
+                                 "define void @bar() {\n"
+                                 "  ret void\n"
+                                 "}\n";
+
+// Return the bitcode of ModuleText.
+static SmallString<1024> getBitcode() {
+  LLVMContext Context;
+  SMDiagnostic Err;
+  std::unique_ptr<Module> M = parseAssemblyString(ModuleText, Err, Context);
+  SmallString<1024> Bitcode;
+  raw_svector_ostream OS(Bitcode);
+  WriteBitcodeToFile(M.get(), OS);
+  OS.flush();
+  return Bitcode;
+}
+
+// Return whether the object file in Object defines a symbol named Name, with
+// or without the global prefix of the target.
+static bool definesSymbol(const void *Object, size_t Length, StringRef Name) {
+  StringRef Buffer(static_cast<const char *>(Object), Length);
+  auto ObjOrErr = object::ObjectFile::createObjectFile(
+      MemoryBufferRef(Buffer, "lto-object"));
+  if (!ObjOrErr)
+    return false;
+  for (const object::SymbolRef &Sym : (*ObjOrErr)->symbols()) {
+    ErrorOr<StringRef> SymName = Sym.getName();
+    if (SymName && (*SymName == Name || *SymName == ("_" + Name).str()) &&
+        !(Sym.getFlags() & object::SymbolRef::SF_Undefined))
+      return true;
+  }
+  return false;
+}
+
+TEST(LTOCAPITest, Parallelism) {
+  SmallString<1024> Bitcode = getBitcode();
+  lto_module_t Mod = lto_module_create_from_memory(Bitcode.data(),
+                                                   Bitcode.size());
+  ASSERT_TRUE(Mod) << lto_get_error_message();
+
+  lto_code_gen_t CG = lto_codegen_create();
+  ASSERT_FALSE(lto_codegen_add_module(CG, Mod)) << lto_get_error_message();
+  lto_codegen_add_must_preserve_symbol(CG, "foo");
+  lto_codegen_add_must_preserve_symbol(CG, "bar");
+  lto_codegen_set_parallelism(CG, 2);
+
+  // Compiling to a single file cannot work with two partitions.
+  const char *Name;
+  EXPECT_TRUE(lto_codegen_compile_to_file(CG, &Name));
+
+  size_t Length;
+  const void *Object = lto_codegen_compile(CG, &Length);
+  ASSERT_TRUE(Object) << lto_get_error_message();
+  ASSERT_EQ(2u, lto_codegen_get_num_objects(CG));
+
+  // The first object is the one lto_codegen_compile returned.
+  size_t Length0, Length1;
+  EXPECT_EQ(Object, lto_codegen_get_object(CG, 0, &Length0));
+  EXPECT_EQ(Length, Length0);
+  const void *Object1 = lto_codegen_get_object(CG, 1, &Length1);
+
+  // Each function went to a partition of its own.
+  EXPECT_TRUE(definesSymbol(Object, Length, "foo"));
+  EXPECT_FALSE(definesSymbol(Object, Length, "bar"));
+  EXPECT_TRUE(definesSymbol(Object1, Length1, "bar"));
+  EXPECT_FALSE(definesSymbol(Object1, Length1, "foo"));
+
+  lto_codegen_dispose(CG);
+  lto_module_dispose(Mod);
+}
+
+} // end anonymous namespace
@@ -12,6 +12,7 @@
 #include "llvm/ProfileData/CoverageMappingWriter.h"
 #include "llvm/ProfileData/InstrProfReader.h"
 #include "llvm/ProfileData/InstrProfWriter.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
 #include "gtest/gtest.h"
 
@@ -64,7 +65,7 @@ struct OneFunctionCoverageReader : CoverageMappingReader {
 
   std::error_code readNextRecord(CoverageMappingRecord &Record) override {
     if (Done)
-      return instrprof_error::eof;
+      return coveragemap_error::eof;
     Done = true;
 
     Record.FunctionName = Name;
@@ -174,6 +175,51 @@ TEST_F(CoverageMappingTest, basic_write_read) {
   }
 }
 
+TEST_F(CoverageMappingTest, cached_reader_round_trip) {
+  addCMR(Counter::getCounter(0), "foo", 1, 1, 9, 9);
+  addCMR(Counter::getCounter(1), "foo", 2, 1, 2, 2);
+  addExpansionCMR("foo", "bar", 3, 3, 3, 3);
+  addCMR(Counter::getCounter(2), "bar", 1, 2, 3, 4);
+  readCoverageRegions(writeCoverageRegions());
+
+  SmallVector<StringRef, 8> Filenames;
+  for (const auto &E : Files)
+    Filenames.push_back(E.getKey());
+  OneFunctionCoverageReader CovReader("func", 0x1234, Filenames, OutputCMRs);
+  std::string Cache;
+  raw_string_ostream OS(Cache);
+  ASSERT_TRUE(NoError(CachedCoverageReader::write(CovReader, OS)));
+  OS.flush();
+
+  auto ReaderOrErr =
+      CachedCoverageReader::create(MemoryBuffer::getMemBufferCopy(Cache));
+  ASSERT_TRUE(NoError(ReaderOrErr.getError()));
+  CoverageMappingRecord Record;
+  ASSERT_TRUE(NoError(ReaderOrErr.get()->readNextRecord(Record)));
+  ASSERT_EQ("func", Record.FunctionName);
+  ASSERT_EQ(0x1234U, Record.FunctionHash);
+  ASSERT_EQ(Filenames.size(), Record.Filenames.size());
+  for (size_t I = 0, E = Filenames.size(); I != E; ++I)
+    ASSERT_EQ(Filenames[I], Record.Filenames[I]);
+  ASSERT_EQ(OutputCMRs.size(), Record.MappingRegions.size());
+  for (size_t I = 0, E = OutputCMRs.size(); I != E; ++I) {
+    ASSERT_EQ(OutputCMRs[I].Count,          Record.MappingRegions[I].Count);
+    ASSERT_EQ(OutputCMRs[I].FileID,         Record.MappingRegions[I].FileID);
+    ASSERT_EQ(OutputCMRs[I].ExpandedFileID,
+              Record.MappingRegions[I].ExpandedFileID);
+    ASSERT_EQ(OutputCMRs[I].startLoc(), Record.MappingRegions[I].startLoc());
+    ASSERT_EQ(OutputCMRs[I].endLoc(),   Record.MappingRegions[I].endLoc());
+    ASSERT_EQ(OutputCMRs[I].Kind,       Record.MappingRegions[I].Kind);
+  }
+  ASSERT_EQ(coveragemap_error::eof,
+            ReaderOrErr.get()->readNextRecord(Record));
+
+  // A cache cut short is rejected rather than read out of bounds.
+  auto TruncatedOrErr = CachedCoverageReader::create(
+      MemoryBuffer::getMemBufferCopy(StringRef(Cache).drop_back(1)));
+  ASSERT_EQ(coveragemap_error::truncated, TruncatedOrErr.getError());
+}
+
 TEST_F(CoverageMappingTest, expansion_gets_first_counter) {
   addCMR(Counter::getCounter(1), "foo", 10, 1, 10, 2);
   // This starts earlier in "foo", so the expansion should get its counter.
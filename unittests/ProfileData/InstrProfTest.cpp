@@ -91,6 +91,41 @@ TEST_F(InstrProfTest, get_function_counts) {
   ASSERT_TRUE(ErrorEquals(instrprof_error::unknown_function, EC));
 }
 
+TEST_F(InstrProfTest, get_function_counts_in_place) {
+  Writer.addFunctionCounts("foo", 0x1234, {1, 2});
+  Writer.addFunctionCounts("foo", 0x1235, {3, 4, 5});
+  Writer.addFunctionCounts("bar", 0x1234, {1ULL << 40});
+  auto Profile = Writer.writeBuffer();
+  const char *Start = Profile->getBufferStart();
+  const char *End = Profile->getBufferEnd();
+  readProfile(std::move(Profile));
+
+  ArrayRef<support::ulittle64_t> Counts;
+  ASSERT_TRUE(NoError(Reader->getFunctionCounts("foo", 0x1235, Counts)));
+  ASSERT_EQ(3U, Counts.size());
+  ASSERT_EQ(3U, Counts[0]);
+  ASSERT_EQ(4U, Counts[1]);
+  ASSERT_EQ(5U, Counts[2]);
+
+  // The counts are read from the profile data, not copied out of it, and
+  // stay valid after other lookups.
+  const char *CountsStart = reinterpret_cast<const char *>(Counts.data());
+  ASSERT_TRUE(CountsStart >= Start && CountsStart < End);
+
+  ArrayRef<support::ulittle64_t> BarCounts;
+  ASSERT_TRUE(NoError(Reader->getFunctionCounts("bar", 0x1234, BarCounts)));
+  ASSERT_EQ(1U, BarCounts.size());
+  ASSERT_EQ(1ULL << 40, BarCounts[0]);
+  ASSERT_EQ(3U, Counts[0]);
+
+  std::error_code EC;
+  EC = Reader->getFunctionCounts("foo", 0x5678, Counts);
+  ASSERT_TRUE(ErrorEquals(instrprof_error::hash_mismatch, EC));
+
+  EC = Reader->getFunctionCounts("baz", 0x1234, Counts);
+  ASSERT_TRUE(ErrorEquals(instrprof_error::unknown_function, EC));
+}
+
 TEST_F(InstrProfTest, get_max_function_count) {
   Writer.addFunctionCounts("foo", 0x1234, {1ULL << 31, 2});
   Writer.addFunctionCounts("bar", 0, {1ULL << 63});
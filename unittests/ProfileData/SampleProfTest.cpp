@@ -0,0 +1,126 @@
+//===- unittest/ProfileData/SampleProfTest.cpp ------------------------------=//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ProfileData/SampleProfReader.h"
+#include "llvm/ProfileData/SampleProfWriter.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/Support/FileSystem.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+using namespace sampleprof;
+
+static ::testing::AssertionResult NoError(std::error_code EC) {
+  if (!EC)
+    return ::testing::AssertionSuccess();
+  return ::testing::AssertionFailure() << "error " << EC.value()
+                                       << ": " << EC.message();
+}
+
+namespace {
+
+struct SampleProfTest : ::testing::Test {
+  LLVMContext Context;
+  SmallString<128> ProfilePath;
+  std::unique_ptr<SampleProfileReader> Reader;
+
+  void SetUp() override {
+    ASSERT_FALSE(sys::fs::createTemporaryFile("sampleprof", "prof",
+                                              ProfilePath));
+  }
+
+  void TearDown() override { sys::fs::remove(ProfilePath); }
+
+  void writeProfile(SampleProfileFormat Format,
+                    StringMap<FunctionSamples> &Profiles) {
+    auto WriterOrErr = SampleProfileWriter::create(ProfilePath, Format);
+    ASSERT_TRUE(NoError(WriterOrErr.getError()));
+    ASSERT_TRUE(WriterOrErr.get()->write(Profiles));
+  }
+
+  void readProfile() {
+    auto ReaderOrErr = SampleProfileReader::create(ProfilePath, Context);
+    ASSERT_TRUE(NoError(ReaderOrErr.getError()));
+    Reader = std::move(ReaderOrErr.get());
+  }
+
+  static StringMap<FunctionSamples> createProfiles() {
+    StringMap<FunctionSamples> Profiles;
+    FunctionSamples &Foo = Profiles["foo"];
+    Foo.addTotalSamples(7711);
+    Foo.addHeadSamples(610);
+    Foo.addBodySamples(1, 0, 610);
+    FunctionSamples &Bar = Profiles["bar"];
+    Bar.addTotalSamples(20301);
+    Bar.addHeadSamples(1437);
+    Bar.addBodySamples(1, 0, 1437);
+    Bar.addBodySamples(3, 2, 534);
+    Bar.addCalledTargetSamples(3, 2, "foo", 500);
+    FunctionSamples &Main = Profiles["main"];
+    Main.addTotalSamples(184019);
+    Main.addBodySamples(9, 0, 2064);
+    return Profiles;
+  }
+};
+
+TEST_F(SampleProfTest, indexed_read_all) {
+  StringMap<FunctionSamples> Profiles = createProfiles();
+  writeProfile(SPF_IndexedBinary, Profiles);
+  readProfile();
+  ASSERT_TRUE(NoError(Reader->read()));
+
+  StringMap<FunctionSamples> &ReadProfiles = Reader->getProfiles();
+  ASSERT_EQ(3U, ReadProfiles.size());
+  FunctionSamples &Bar = ReadProfiles["bar"];
+  ASSERT_EQ(20301U, Bar.getTotalSamples());
+  ASSERT_EQ(1437U, Bar.getHeadSamples());
+  ASSERT_EQ(1437U, Bar.samplesAt(1, 0));
+  ASSERT_EQ(534U, Bar.samplesAt(3, 2));
+  ASSERT_EQ(500U, Bar.sampleRecordAt(LineLocation(3, 2))
+                      .getCallTargets()
+                      .lookup("foo"));
+  ASSERT_EQ(184019U, ReadProfiles["main"].getTotalSamples());
+}
+
+TEST_F(SampleProfTest, indexed_read_module) {
+  StringMap<FunctionSamples> Profiles = createProfiles();
+  writeProfile(SPF_IndexedBinary, Profiles);
+  readProfile();
+
+  // Only the profiles of the functions defined in the module are read.
+  Module M("m", Context);
+  FunctionType *FTy = FunctionType::get(Type::getVoidTy(Context), false);
+  Function *Bar =
+      Function::Create(FTy, GlobalValue::ExternalLinkage, "bar", &M);
+  IRBuilder<>(BasicBlock::Create(Context, "entry", Bar)).CreateRetVoid();
+  Function::Create(FTy, GlobalValue::ExternalLinkage, "foo", &M);
+  Function *Baz =
+      Function::Create(FTy, GlobalValue::ExternalLinkage, "baz", &M);
+  IRBuilder<>(BasicBlock::Create(Context, "entry", Baz)).CreateRetVoid();
+
+  ASSERT_TRUE(NoError(Reader->readModuleProfiles(M)));
+  StringMap<FunctionSamples> &ReadProfiles = Reader->getProfiles();
+  ASSERT_EQ(1U, ReadProfiles.size());
+  ASSERT_EQ(20301U, Reader->getSamplesFor(*Bar)->getTotalSamples());
+  ASSERT_TRUE(Reader->getSamplesFor(*Baz)->empty());
+}
+
+TEST_F(SampleProfTest, binary_read_module) {
+  StringMap<FunctionSamples> Profiles = createProfiles();
+  writeProfile(SPF_Binary, Profiles);
+  readProfile();
+
+  // Formats without an index read every profile.
+  Module M("m", Context);
+  ASSERT_TRUE(NoError(Reader->readModuleProfiles(M)));
+  ASSERT_EQ(3U, Reader->getProfiles().size());
+}
+
+} // end anonymous namespace
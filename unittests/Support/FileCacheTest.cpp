@@ -0,0 +1,118 @@
+//===- unittests/Support/FileCacheTest.cpp - FileCache tests --------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/FileCache.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+TEST(FileCacheTest, StoreAndLookup) {
+  SmallString<64> TmpDir;
+  std::error_code EC =
+      sys::fs::createUniqueDirectory("FileCacheTestDir", TmpDir);
+  ASSERT_FALSE(EC);
+
+  // The cache directory does not exist until the first entry is stored.
+  SmallString<64> CacheDir(TmpDir);
+  sys::path::append(CacheDir, "cache");
+  FileCache Cache(CacheDir);
+
+  MD5 Hash;
+  Hash.update("input");
+  std::string Key = FileCache::getKey(Hash);
+  EXPECT_EQ(32u, Key.size());
+
+  auto Missing = Cache.lookup(Key);
+  EXPECT_EQ(std::errc::no_such_file_or_directory, Missing.getError());
+
+  ASSERT_FALSE(Cache.store(Key, "first"));
+  auto Entry = Cache.lookup(Key);
+  ASSERT_TRUE(bool(Entry));
+  EXPECT_EQ("first", (*Entry)->getBuffer());
+
+  // Storing again replaces the entry and leaves no temporary files behind.
+  ASSERT_FALSE(Cache.store(Key, "second"));
+  Entry = Cache.lookup(Key);
+  ASSERT_TRUE(bool(Entry));
+  EXPECT_EQ("second", (*Entry)->getBuffer());
+
+  unsigned NumFiles = 0;
+  for (sys::fs::directory_iterator I(CacheDir, EC), E; !EC && I != E;
+       I.increment(EC))
+    ++NumFiles;
+  ASSERT_FALSE(EC);
+  EXPECT_EQ(1u, NumFiles);
+
+  ASSERT_FALSE(sys::fs::remove(Cache.getEntryPath(Key)));
+  ASSERT_FALSE(sys::fs::remove(CacheDir));
+  ASSERT_FALSE(sys::fs::remove(TmpDir));
+}
+
+static void setUseTime(const std::string &Path, sys::TimeValue Time) {
+  int FD;
+  ASSERT_FALSE(sys::fs::openFileForWrite(Path, FD, sys::fs::F_Append));
+  EXPECT_FALSE(sys::fs::setLastModificationAndAccessTime(FD, Time));
+  sys::Process::SafelyCloseFileDescriptor(FD);
+}
+
+TEST(FileCacheTest, Prune) {
+  SmallString<64> CacheDir;
+  std::error_code EC =
+      sys::fs::createUniqueDirectory("FileCacheTestDir", CacheDir);
+  ASSERT_FALSE(EC);
+  FileCache Cache(CacheDir);
+
+  // Three entries of 4 bytes, used 300, 200 and 100 seconds ago.
+  const char *Keys[] = {"a", "b", "c"};
+  sys::TimeValue Now = sys::TimeValue::now();
+  for (unsigned I = 0; I != 3; ++I) {
+    ASSERT_FALSE(Cache.store(Keys[I], "data"));
+    setUseTime(Cache.getEntryPath(Keys[I]),
+               Now - sys::TimeValue(300 - 100 * I, 0));
+  }
+
+  // Nothing is removed while the cache is within the bound.
+  ASSERT_FALSE(Cache.prune(12));
+  EXPECT_TRUE(sys::fs::exists(Cache.getEntryPath("a")));
+
+  // A lookup makes "a" the most recently used entry, so "b" goes first.
+  EXPECT_TRUE(bool(Cache.lookup("a")));
+  ASSERT_FALSE(Cache.prune(8));
+  EXPECT_TRUE(sys::fs::exists(Cache.getEntryPath("a")));
+  EXPECT_FALSE(sys::fs::exists(Cache.getEntryPath("b")));
+  EXPECT_TRUE(sys::fs::exists(Cache.getEntryPath("c")));
+
+  // The temporary file of a store in progress is left alone, but one that
+  // was abandoned long ago is removed.
+  std::string Fresh = Cache.getEntryPath("d.tmp-fresh");
+  std::string Stale = Cache.getEntryPath("e.tmp-stale");
+  for (const std::string &Path : {Fresh, Stale}) {
+    int FD;
+    ASSERT_FALSE(sys::fs::openFileForWrite(Path, FD, sys::fs::F_None));
+    sys::Process::SafelyCloseFileDescriptor(FD);
+  }
+  setUseTime(Stale,
+             Now - sys::TimeValue(FileCache::TempFileGracePeriod + 60, 0));
+
+  ASSERT_FALSE(Cache.prune(0));
+  EXPECT_FALSE(sys::fs::exists(Cache.getEntryPath("a")));
+  EXPECT_FALSE(sys::fs::exists(Cache.getEntryPath("c")));
+  EXPECT_TRUE(sys::fs::exists(Fresh));
+  EXPECT_FALSE(sys::fs::exists(Stale));
+  ASSERT_FALSE(sys::fs::remove(Fresh));
+  ASSERT_FALSE(sys::fs::remove(CacheDir));
+}
+
+} // end anonymous namespace
@@ -0,0 +1,57 @@
+//===- llvm/unittest/Support/ParallelTest.cpp - Parallel algorithm tests --===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/Parallel.h"
+#include "gtest/gtest.h"
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+using namespace llvm;
+
+namespace {
+
+TEST(ParallelTest, ParallelFor) {
+  std::vector<int> Squares(10000);
+  parallel_for(0, 10000, [&Squares](int I) { Squares[I] = I * I; });
+  for (int I = 0; I < 10000; ++I)
+    ASSERT_EQ(I * I, Squares[I]);
+}
+
+TEST(ParallelTest, ParallelForEach) {
+  std::vector<unsigned> Values(5000, 1);
+  std::atomic<unsigned> Sum(0);
+  parallel_for_each(Values.begin(), Values.end(),
+                    [&Sum](unsigned V) { Sum += V; });
+  EXPECT_EQ(5000u, Sum);
+
+  parallel_for_each(Values.begin(), Values.begin(),
+                    [&Sum](unsigned V) { Sum += V; });
+  EXPECT_EQ(5000u, Sum);
+}
+
+TEST(ParallelTest, ParallelSort) {
+  std::vector<uint32_t> Values(100000);
+  uint32_t Seed = 42;
+  for (uint32_t &V : Values) {
+    Seed = Seed * 1103515245 + 12345;
+    V = Seed >> 8;
+  }
+  std::vector<uint32_t> Expected = Values;
+  std::sort(Expected.begin(), Expected.end());
+
+  parallel_sort(Values.begin(), Values.end());
+  EXPECT_EQ(Expected, Values);
+
+  parallel_sort(Values.begin(), Values.end(), std::greater<uint32_t>());
+  EXPECT_TRUE(std::is_sorted(Values.rbegin(), Values.rend()));
+}
+
+} // end anonymous namespace
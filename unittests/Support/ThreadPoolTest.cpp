@@ -0,0 +1,86 @@
+//===- llvm/unittest/Support/ThreadPoolTest.cpp - ThreadPool tests --------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/ThreadPool.h"
+#include "gtest/gtest.h"
+#include <atomic>
+
+using namespace llvm;
+
+namespace {
+
+TEST(ThreadPoolTest, AsyncAndWait) {
+  ThreadPool Pool(4);
+  std::atomic<int> Count(0);
+  for (int I = 0; I < 100; ++I)
+    Pool.async([&Count] { ++Count; });
+  Pool.wait();
+  EXPECT_EQ(100, Count);
+}
+
+TEST(ThreadPoolTest, AsyncWithArgs) {
+  ThreadPool Pool(2);
+  std::atomic<int> Sum(0);
+  for (int I = 1; I <= 10; ++I)
+    Pool.async([&Sum](int V) { Sum += V; }, I);
+  Pool.wait();
+  EXPECT_EQ(55, Sum);
+}
+
+TEST(ThreadPoolTest, Future) {
+  ThreadPool Pool(2);
+  std::atomic<bool> Ran(false);
+  std::shared_future<void> Future = Pool.async([&Ran] { Ran = true; });
+  Future.wait();
+  EXPECT_TRUE(Ran);
+}
+
+TEST(ThreadPoolTest, ThreadCountLimit) {
+  unsigned OldLimit = getMaxThreadCount();
+  setMaxThreadCount(2);
+  {
+    ThreadPool Pool(8);
+    EXPECT_EQ(2u, Pool.getThreadCount());
+  }
+  EXPECT_LE(getDefaultThreadCount(), 2u);
+  setMaxThreadCount(OldLimit);
+  EXPECT_GE(getDefaultThreadCount(), 1u);
+}
+
+TEST(ThreadPoolTest, TaskGroupWait) {
+  ThreadPool Pool(3);
+  std::atomic<int> Count(0);
+  TaskGroup TG(Pool);
+  for (int I = 0; I < 50; ++I)
+    TG.spawn([&Count] { ++Count; });
+  TG.wait();
+  EXPECT_EQ(50, Count);
+  EXPECT_FALSE(Pool.isWorkerThread());
+}
+
+// Waiting on a nested group from inside a task must not deadlock even when
+// every worker is busy doing the same.
+TEST(ThreadPoolTest, NestedTaskGroups) {
+  ThreadPool Pool(2);
+  std::atomic<int> Count(0);
+  {
+    TaskGroup Outer(Pool);
+    for (int I = 0; I < 8; ++I)
+      Outer.spawn([&Pool, &Count] {
+        EXPECT_TRUE(Pool.isWorkerThread());
+        TaskGroup Inner(Pool);
+        for (int J = 0; J < 8; ++J)
+          Inner.spawn([&Count] { ++Count; });
+        Inner.wait();
+      });
+  }
+  EXPECT_EQ(64, Count);
+}
+
+} // end anonymous namespace
@@ -0,0 +1,56 @@
+//===- llvm/unittest/Support/TimeTraceProfilerTest.cpp --------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/TimeTraceProfiler.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+TEST(TimeTraceProfilerTest, Write) {
+  TimeTraceProfiler Profiler;
+  // Events are recorded when they end, but written in the order they start.
+  Profiler.addEvent("inner", "f", 10, 20, 4096);
+  Profiler.addEvent("outer", "a \"quoted\"\\name\n", 10, 30, -4096);
+
+  std::string Trace;
+  raw_string_ostream OS(Trace);
+  Profiler.write(OS);
+  EXPECT_EQ("{\"traceEvents\":[\n"
+            "{\"ph\":\"X\",\"cat\":\"pass\",\"pid\":1,\"tid\":1,\"ts\":10,"
+            "\"dur\":20,\"name\":\"outer\",\"args\":{\"detail\":"
+            "\"a \\\"quoted\\\"\\\\name\\n\",\"rss_delta\":-4096}},\n"
+            "{\"ph\":\"X\",\"cat\":\"pass\",\"pid\":1,\"tid\":1,\"ts\":10,"
+            "\"dur\":10,\"name\":\"inner\",\"args\":{\"detail\":\"f\","
+            "\"rss_delta\":4096}}\n"
+            "],\"displayTimeUnit\":\"ms\"}\n",
+            OS.str());
+}
+
+TEST(TimeTraceProfilerTest, Region) {
+  TimeTraceProfiler Profiler;
+  {
+    TimeTraceRegion Outer(&Profiler, "outer", "");
+    TimeTraceRegion Inner(&Profiler, "inner", "");
+    // A null profiler records nothing.
+    TimeTraceRegion Disabled(nullptr, "disabled", "");
+  }
+
+  std::string Trace;
+  raw_string_ostream OS(Trace);
+  Profiler.write(OS);
+  StringRef Written = OS.str();
+  EXPECT_NE(StringRef::npos, Written.find("\"name\":\"outer\""));
+  EXPECT_NE(StringRef::npos, Written.find("\"name\":\"inner\""));
+  EXPECT_EQ(StringRef::npos, Written.find("disabled"));
+}
+
+} // end anonymous namespace
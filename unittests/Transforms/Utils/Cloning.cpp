@@ -450,4 +450,16 @@ TEST_F(CloneModule, Verify) {
   EXPECT_FALSE(verifyModule(*NewM));
 }
 
+TEST_F(CloneModule, ExternalReference) {
+  ValueToValueMapTy VMap;
+  std::unique_ptr<Module> DeclM(llvm::CloneModule(
+      OldM, VMap, [](const GlobalValue *GV) { return false; }));
+  Function *F = DeclM->getFunction("f");
+  ASSERT_TRUE(F);
+  EXPECT_TRUE(F->isDeclaration());
+  EXPECT_TRUE(F->hasExternalLinkage());
+  EXPECT_FALSE(F->hasPersonalityFn());
+  EXPECT_FALSE(verifyModule(*DeclM));
+}
+
 }
@@ -0,0 +1,148 @@
+//===- DenseMapBench - Benchmark DenseMap against FlatDenseMap ------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This benchmark times DenseMap and FlatDenseMap on the kind of workload passes
+// put on them: maps from pointers to IR-like objects, allocated from a bump
+// pointer allocator, with 10 to 10000 entries. It outputs the time per
+// operation of each map.
+//
+//===----------------------------------------------------------------------===//
+
+#include "LLVMBench.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/FlatDenseMap.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace llvm;
+using namespace llvm::bench;
+
+cl::OptionCategory bench::DenseMapCategory("densemap options");
+
+static cl::list<unsigned> Sizes("densemap-size", cl::CommaSeparated,
+                                cl::desc("Number of entries of the maps "
+                                         "(default: 10,100,1000,10000)"),
+                                cl::cat(DenseMapCategory));
+
+static cl::opt<unsigned>
+    OpsPerRun("densemap-ops", cl::desc("Number of operations to time per run"),
+              cl::init(10000000), cl::cat(DenseMapCategory));
+
+namespace {
+/// Something the size of a small instruction, to give the keys the spacing
+/// pointers to IR objects have.
+struct Object {
+  void *Fields[8];
+};
+
+/// Prevent the compiler from optimizing away the lookups.
+volatile unsigned Sink;
+
+template <typename MapT> struct Workloads {
+  /// Insert the keys into a new map, as a pass filling a map does.
+  static void insert(ArrayRef<Object *> Keys, unsigned Reps) {
+    for (unsigned R = 0; R != Reps; ++R) {
+      MapT Map;
+      for (unsigned I = 0, E = Keys.size(); I != E; ++I)
+        Map[Keys[I]] = I;
+      Sink = Map.size();
+    }
+  }
+
+  /// Look up keys that are in the map.
+  static void lookupHit(ArrayRef<Object *> Keys, ArrayRef<Object *> Order,
+                        unsigned Reps) {
+    MapT Map;
+    for (unsigned I = 0, E = Keys.size(); I != E; ++I)
+      Map[Keys[I]] = I;
+    unsigned Sum = 0;
+    for (unsigned R = 0; R != Reps; ++R)
+      for (Object *K : Order)
+        Sum += Map.find(K)->second;
+    Sink = Sum;
+  }
+
+  /// Look up keys that are not in the map.
+  static void lookupMiss(ArrayRef<Object *> Keys, ArrayRef<Object *> Others,
+                         unsigned Reps) {
+    MapT Map;
+    for (unsigned I = 0, E = Keys.size(); I != E; ++I)
+      Map[Keys[I]] = I;
+    unsigned Count = 0;
+    for (unsigned R = 0; R != Reps; ++R)
+      for (Object *K : Others)
+        Count += Map.count(K);
+    Sink = Count;
+  }
+
+  /// Erase keys and insert them again, as a worklist does.
+  static void churn(ArrayRef<Object *> Keys, ArrayRef<Object *> Order,
+                    unsigned Reps) {
+    MapT Map;
+    for (unsigned I = 0, E = Keys.size(); I != E; ++I)
+      Map[Keys[I]] = I;
+    for (unsigned R = 0; R != Reps; ++R)
+      for (Object *K : Order) {
+        Map.erase(K);
+        Map[K] = R;
+      }
+    Sink = Map.size();
+  }
+};
+
+} // end anonymous namespace
+
+template <typename MapT>
+static void runWorkloads(ArrayRef<Object *> Keys, ArrayRef<Object *> Order,
+                         ArrayRef<Object *> Others, double Times[4]) {
+  typedef Workloads<MapT> W;
+  unsigned Reps = std::max(1u, OpsPerRun / unsigned(Keys.size()));
+  Times[0] = timeRun([&] { W::insert(Keys, Reps); });
+  Times[1] = timeRun([&] { W::lookupHit(Keys, Order, Reps); });
+  Times[2] = timeRun([&] { W::lookupMiss(Keys, Others, Reps); });
+  Times[3] = timeRun([&] { W::churn(Keys, Order, Reps / 2); }) * 2;
+  for (unsigned I = 0; I != 4; ++I)
+    Times[I] = Times[I] * 1e9 / (double(Reps) * Keys.size());
+}
+
+int bench::runDenseMap() {
+  std::vector<unsigned> SizeList(Sizes.begin(), Sizes.end());
+  if (SizeList.empty())
+    SizeList = {10, 100, 1000, 10000};
+
+  std::mt19937 Rand(0);
+  outs() << "   size  workload      DenseMap  FlatDenseMap  (ns/op)\n";
+  static const char *const Names[] = {"insert", "lookup-hit", "lookup-miss",
+                                      "erase+insert"};
+  for (unsigned Size : SizeList) {
+    if (Size == 0)
+      continue;
+    BumpPtrAllocator Alloc;
+    std::vector<Object *> Keys, Others;
+    for (unsigned I = 0; I != Size; ++I) {
+      Keys.push_back(new (Alloc) Object());
+      Others.push_back(new (Alloc) Object());
+    }
+    std::vector<Object *> Order(Keys);
+    std::shuffle(Order.begin(), Order.end(), Rand);
+
+    double Dense[4], Flat[4];
+    runWorkloads<DenseMap<Object *, unsigned>>(Keys, Order, Others, Dense);
+    runWorkloads<FlatDenseMap<Object *, unsigned>>(Keys, Order, Others, Flat);
+    for (unsigned I = 0; I != 4; ++I)
+      outs() << format("%7u  %-12s  %8.2f  %12.2f\n", Size, Names[I], Dense[I],
+                       Flat[I]);
+  }
+  return 0;
+}
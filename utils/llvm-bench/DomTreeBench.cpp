@@ -0,0 +1,198 @@
+//===- DomTreeBench - Benchmark incremental dominator tree updates --------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This benchmark times keeping a dominator tree up to date while a transform
+// inserts and deletes edges of the CFG, either by recalculating the tree or
+// by updating it incrementally, after each change and after batches of
+// changes. The function is synthetic: a chain of blocks with short forward
+// and backward branches, and the changes are local, as those of the CFG
+// transforms are.
+//
+//===----------------------------------------------------------------------===//
+
+#include "LLVMBench.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include <random>
+#include <vector>
+
+using namespace llvm;
+using namespace llvm::bench;
+
+cl::OptionCategory bench::DomTreeCategory("domtree options");
+
+static cl::opt<unsigned>
+    NumBlocks("domtree-blocks", cl::desc("Number of blocks of the function"),
+              cl::init(2000), cl::cat(DomTreeCategory));
+
+static cl::opt<unsigned>
+    NumUpdates("domtree-updates",
+               cl::desc("Number of edge insertions and deletions"),
+               cl::init(2000), cl::cat(DomTreeCategory));
+
+static cl::opt<unsigned> BatchSize("domtree-batch",
+                                   cl::desc("Number of changes per batch"),
+                                   cl::init(8), cl::cat(DomTreeCategory));
+
+namespace {
+struct Edge {
+  bool Insert;
+  unsigned From, To;
+};
+
+/// A function whose block I branches to block J when the switch ending block
+/// I has the case J.
+class CFGFunction {
+  LLVMContext &C;
+  Module M;
+  Function *F;
+  std::vector<BasicBlock *> Blocks;
+  std::vector<SwitchInst *> Switches;
+
+public:
+  CFGFunction(LLVMContext &C, ArrayRef<Edge> Edges) : C(C), M("bench", C) {
+    F = Function::Create(FunctionType::get(Type::getVoidTy(C),
+                                           Type::getInt32Ty(C), false),
+                         GlobalValue::ExternalLinkage, "f", &M);
+    for (unsigned I = 0; I != NumBlocks; ++I)
+      Blocks.push_back(BasicBlock::Create(C, "", F));
+    BasicBlock *Exit = BasicBlock::Create(C, "exit", F);
+    ReturnInst::Create(C, Exit);
+    for (BasicBlock *BB : Blocks)
+      Switches.push_back(SwitchInst::Create(F->arg_begin(), Exit, 0, BB));
+    for (const Edge &E : Edges)
+      change(E);
+  }
+
+  Function &getFunction() { return *F; }
+
+  void change(const Edge &E) {
+    SwitchInst *SI = Switches[E.From];
+    ConstantInt *V = ConstantInt::get(C, APInt(32, E.To));
+    if (E.Insert)
+      SI->addCase(V, Blocks[E.To]);
+    else
+      SI->removeCase(SI->findCaseValue(V));
+  }
+
+  DominatorTree::UpdateType getUpdate(const Edge &E) const {
+    DominatorTree::UpdateType U = {E.Insert ? DominatorTree::Insert
+                                            : DominatorTree::Delete,
+                                   Blocks[E.From], Blocks[E.To]};
+    return U;
+  }
+};
+
+} // end anonymous namespace
+
+// Build the function with the initial edges, then make the changes in
+// batches of Batch, calling Update on the tree after each batch. Return the
+// time this took, and whether the tree is right in the end.
+template <typename UpdateFn>
+static double run(ArrayRef<Edge> Initial, ArrayRef<Edge> Changes,
+                  unsigned Batch, UpdateFn Update, bool &Valid) {
+  LLVMContext C;
+  CFGFunction CFG(C, Initial);
+  DominatorTree DT;
+  DT.recalculate(CFG.getFunction());
+
+  double Time = timeRun([&] {
+    SmallVector<DominatorTree::UpdateType, 16> Updates;
+    for (unsigned I = 0, E = Changes.size(); I < E; I += Batch) {
+      Updates.clear();
+      for (unsigned J = I, JE = std::min(E, I + Batch); J != JE; ++J) {
+        CFG.change(Changes[J]);
+        Updates.push_back(CFG.getUpdate(Changes[J]));
+      }
+      Update(DT, CFG.getFunction(), Updates);
+    }
+  });
+
+  DominatorTree Fresh;
+  Fresh.recalculate(CFG.getFunction());
+  Valid = !DT.compare(Fresh);
+  return Time;
+}
+
+int bench::runDomTree() {
+  if (NumBlocks < 16 || BatchSize == 0) {
+    errs() << "llvm-bench: the function needs at least 16 blocks, and "
+              "batches at least one change\n";
+    return 1;
+  }
+
+  // A chain of blocks, with a few short branches forward and back.
+  std::mt19937 Rand(0);
+  DenseSet<std::pair<unsigned, unsigned>> Present;
+  std::vector<Edge> Initial;
+  auto addEdge = [&](unsigned From, unsigned To) {
+    if (Present.insert(std::make_pair(From, To)).second)
+      Initial.push_back({true, From, To});
+  };
+  for (unsigned I = 0; I + 1 != NumBlocks; ++I) {
+    addEdge(I, I + 1);
+    if (Rand() % 3 == 0 && I + 4 < NumBlocks)
+      addEdge(I, I + 2 + Rand() % 3);
+    if (Rand() % 8 == 0 && I > 4)
+      addEdge(I, I - 1 - Rand() % 4);
+  }
+
+  // Toggle random short edges, keeping the chain so that most of the
+  // function stays reachable.
+  std::vector<Edge> Changes;
+  while (Changes.size() != NumUpdates) {
+    unsigned From = Rand() % (NumBlocks - 8);
+    unsigned To = From + 2 + Rand() % 6;
+    if (Rand() % 4 == 0 && From > 8)
+      To = From - 8 + Rand() % 8;
+    if (To == 0)
+      continue;
+    bool Insert = Present.insert(std::make_pair(From, To)).second;
+    if (!Insert)
+      Present.erase(std::make_pair(From, To));
+    Changes.push_back({Insert, From, To});
+  }
+
+  auto Recalculate = [](DominatorTree &DT, Function &F,
+                        ArrayRef<DominatorTree::UpdateType>) {
+    DT.recalculate(F);
+  };
+  auto Incremental = [](DominatorTree &DT, Function &,
+                        ArrayRef<DominatorTree::UpdateType> Updates) {
+    DT.applyUpdates(Updates);
+  };
+
+  bool Valid[4];
+  double Times[4] = {run(Initial, Changes, 1, Recalculate, Valid[0]),
+                     run(Initial, Changes, 1, Incremental, Valid[1]),
+                     run(Initial, Changes, BatchSize, Recalculate, Valid[2]),
+                     run(Initial, Changes, BatchSize, Incremental, Valid[3])};
+  if (!Valid[1] || !Valid[3]) {
+    errs() << "llvm-bench: the updated tree is wrong\n";
+    return 1;
+  }
+
+  outs() << format("function: %u blocks, %zu edges; %u changes\n",
+                   unsigned(NumBlocks), Initial.size() + NumBlocks,
+                   unsigned(NumUpdates));
+  outs() << format("  each change:     recalculate %10.2f ms, "
+                   "update %10.2f ms\n",
+                   Times[0] * 1e3, Times[1] * 1e3);
+  outs() << format("  batches of %3u:  recalculate %10.2f ms, "
+                   "update %10.2f ms\n",
+                   unsigned(BatchSize), Times[2] * 1e3, Times[3] * 1e3);
+  return 0;
+}
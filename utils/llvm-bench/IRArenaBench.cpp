@@ -0,0 +1,102 @@
+//===- IRArenaBench - Benchmark User allocation from the context arena ----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This benchmark times building, walking and destroying a module whose Users
+// are allocated on the heap, and one whose Users are allocated from the
+// LLVMContext arena under an IRArenaScope. The module is synthetic: functions
+// of straight-line integer arithmetic, loads and stores, with constant
+// operands, as a frontend would emit them.
+//
+//===----------------------------------------------------------------------===//
+
+#include "LLVMBench.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include <memory>
+
+using namespace llvm;
+using namespace llvm::bench;
+
+cl::OptionCategory bench::IRArenaCategory("irarena options");
+
+static cl::opt<unsigned>
+    NumFunctions("irarena-functions",
+                 cl::desc("Number of functions of the module"),
+                 cl::init(1000), cl::cat(IRArenaCategory));
+
+static cl::opt<unsigned>
+    NumInstructions("irarena-instructions",
+                    cl::desc("Number of instructions per function"),
+                    cl::init(1000), cl::cat(IRArenaCategory));
+
+namespace {
+
+struct Result {
+  double Build, Walk, Destroy;
+  size_t ArenaSize;
+  uint64_t Checksum;
+};
+} // end anonymous namespace
+
+// Visit every operand of every instruction, as an analysis would.
+static uint64_t walkModule(Module &M) {
+  uint64_t Sum = 0;
+  for (Function &F : M)
+    for (BasicBlock &BB : F)
+      for (Instruction &I : BB)
+        for (Value *Op : I.operands())
+          Sum += isa<Instruction>(Op) ? 1 : Op->getValueID();
+  return Sum;
+}
+
+static Result run(bool UseArena) {
+  Result R;
+  std::unique_ptr<LLVMContext> C(new LLVMContext);
+  std::unique_ptr<Module> M(new Module("bench", *C));
+  R.Build = timeRun([&] {
+    if (UseArena) {
+      IRArenaScope Scope(*C);
+      buildModule(*M, NumFunctions, NumInstructions);
+    } else {
+      buildModule(*M, NumFunctions, NumInstructions);
+    }
+  });
+  R.Walk = timeRun([&] { R.Checksum = walkModule(*M); });
+  R.ArenaSize = C->getIRArenaSize();
+  R.Destroy = timeRun([&] {
+    M.reset();
+    C.reset();
+  });
+  return R;
+}
+
+int bench::runIRArena() {
+
+  Result Heap = run(false);
+  Result Arena = run(true);
+  if (Heap.Checksum != Arena.Checksum) {
+    errs() << "llvm-bench: the two modules differ\n";
+    return 1;
+  }
+
+  outs() << format("module: %u functions of %u instructions\n",
+                   unsigned(NumFunctions), unsigned(NumInstructions));
+  outs() << "              build (ms)  walk (ms)  destroy (ms)  arena (MB)\n";
+  outs() << format("  heap     %12.2f %10.2f %13.2f %11.1f\n",
+                   Heap.Build * 1e3, Heap.Walk * 1e3, Heap.Destroy * 1e3,
+                   Heap.ArenaSize / 1048576.0);
+  outs() << format("  arena    %12.2f %10.2f %13.2f %11.1f\n",
+                   Arena.Build * 1e3, Arena.Walk * 1e3, Arena.Destroy * 1e3,
+                   Arena.ArenaSize / 1048576.0);
+  return 0;
+}
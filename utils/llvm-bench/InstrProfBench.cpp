@@ -0,0 +1,160 @@
+//===- InstrProfBench - Benchmark the indexed instrprof reader ------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This benchmark times the indexed profile reader on the work a PGO compile
+// puts on it: opening the profile, then looking up the counts of the
+// functions of a translation unit. Lookups are timed both copying the counts
+// out of the profile and reading them in place. The profile is either the
+// one given on the command line or a synthetic one of the requested size.
+//
+//===----------------------------------------------------------------------===//
+
+#include "LLVMBench.h"
+#include "llvm/ProfileData/InstrProfReader.h"
+#include "llvm/ProfileData/InstrProfWriter.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace llvm;
+using namespace llvm::bench;
+
+cl::OptionCategory bench::InstrProfCategory("instrprof options");
+
+static cl::opt<std::string>
+    InputFilename("instrprof-input",
+                  cl::desc("Indexed profile to read instead of a synthetic "
+                           "one"),
+                  cl::value_desc("filename"), cl::cat(InstrProfCategory));
+
+static cl::opt<unsigned>
+    NumFunctions("instrprof-functions",
+                 cl::desc("Number of functions of the synthetic profile"),
+                 cl::init(100000), cl::cat(InstrProfCategory));
+
+static cl::opt<unsigned>
+    NumCounters("instrprof-counters",
+                cl::desc("Number of counters per function of the synthetic "
+                         "profile"),
+                cl::init(32), cl::cat(InstrProfCategory));
+
+static cl::opt<unsigned>
+    NumLookups("instrprof-lookups", cl::desc("Number of lookups to time"),
+               cl::init(1000000), cl::cat(InstrProfCategory));
+
+namespace {
+/// A function to look up, as the compiler knows it.
+struct Function {
+  std::string Name;
+  uint64_t Hash;
+};
+
+/// Prevent the compiler from optimizing away the lookups.
+volatile uint64_t Sink;
+
+} // end anonymous namespace
+
+static std::unique_ptr<MemoryBuffer> createSyntheticProfile() {
+  InstrProfWriter Writer;
+  std::vector<uint64_t> Counts(std::max(1u, unsigned(NumCounters)));
+  for (unsigned I = 0; I != NumFunctions; ++I) {
+    for (unsigned J = 0, E = Counts.size(); J != E; ++J)
+      Counts[J] = I + J;
+    Writer.addFunctionCounts("function_" + std::to_string(I), I, Counts);
+  }
+  return Writer.writeBuffer();
+}
+
+static std::unique_ptr<IndexedInstrProfReader>
+openProfile(const MemoryBuffer &Profile) {
+  auto ReaderOrErr = IndexedInstrProfReader::create(
+      MemoryBuffer::getMemBuffer(Profile.getMemBufferRef(),
+                                 /*RequiresNullTerminator=*/false));
+  if (std::error_code EC = ReaderOrErr.getError()) {
+    errs() << "llvm-bench: " << EC.message() << "\n";
+    exit(1);
+  }
+  return std::move(ReaderOrErr.get());
+}
+
+int bench::runInstrProf() {
+
+  std::unique_ptr<MemoryBuffer> Profile;
+  if (InputFilename.empty()) {
+    Profile = createSyntheticProfile();
+  } else {
+    auto BufferOrErr = MemoryBuffer::getFile(InputFilename, /*FileSize=*/-1,
+                                             /*RequiresNullTerminator=*/false);
+    if (std::error_code EC = BufferOrErr.getError()) {
+      errs() << "llvm-bench: " << InputFilename << ": " << EC.message()
+             << "\n";
+      return 1;
+    }
+    Profile = std::move(BufferOrErr.get());
+  }
+
+  // Collect the functions of the profile, and look them up in random order,
+  // as the compiles of a large program do.
+  std::vector<Function> Functions;
+  uint64_t NumCounts = 0;
+  double IterateTime = timeRun([&] {
+    auto Reader = openProfile(*Profile);
+    for (const InstrProfRecord &Record : *Reader) {
+      Functions.push_back({Record.Name, Record.Hash});
+      NumCounts += Record.Counts.size();
+    }
+  });
+  if (Functions.empty()) {
+    errs() << "llvm-bench: the profile has no functions\n";
+    return 1;
+  }
+  std::mt19937 Rand(0);
+  std::vector<const Function *> Order;
+  for (unsigned I = 0; I != NumLookups; ++I)
+    Order.push_back(&Functions[Rand() % Functions.size()]);
+
+  const unsigned Opens = 100;
+  double OpenTime = timeRun([&] {
+    for (unsigned I = 0; I != Opens; ++I)
+      Sink = openProfile(*Profile)->getMaximumFunctionCount();
+  });
+
+  auto Reader = openProfile(*Profile);
+  double CopyTime = timeRun([&] {
+    std::vector<uint64_t> Counts;
+    uint64_t Sum = 0;
+    for (const Function *F : Order)
+      if (!Reader->getFunctionCounts(F->Name, F->Hash, Counts))
+        Sum += Counts[0];
+    Sink = Sum;
+  });
+  double InPlaceTime = timeRun([&] {
+    ArrayRef<support::ulittle64_t> Counts;
+    uint64_t Sum = 0;
+    for (const Function *F : Order)
+      if (!Reader->getFunctionCounts(F->Name, F->Hash, Counts))
+        Sum += Counts[0];
+    Sink = Sum;
+  });
+
+  outs() << format("profile: %zu bytes, %zu functions, %llu counters\n",
+                   Profile->getBufferSize(), Functions.size(),
+                   (unsigned long long)NumCounts);
+  outs() << format("  open               %12.2f us\n", OpenTime * 1e6 / Opens);
+  outs() << format("  read all records   %12.2f us\n", IterateTime * 1e6);
+  outs() << format("  lookup (copy)      %12.2f ns/op\n",
+                   CopyTime * 1e9 / Order.size());
+  outs() << format("  lookup (in place)  %12.2f ns/op\n",
+                   InPlaceTime * 1e9 / Order.size());
+  return 0;
+}
@@ -0,0 +1,58 @@
+//===- LLVMBench.h - Benchmarks of LLVM data structures ---------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the benchmarks that llvm-bench runs, and the helpers
+// they share.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_UTILS_LLVMBENCH_LLVMBENCH_H
+#define LLVM_UTILS_LLVMBENCH_LLVMBENCH_H
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Timer.h"
+
+namespace llvm {
+class Module;
+
+namespace bench {
+
+/// Return the process time, in seconds, that running F takes.
+template <typename Fn> double timeRun(Fn F) {
+  TimeRecord Start = TimeRecord::getCurrentTime(true);
+  F();
+  TimeRecord End = TimeRecord::getCurrentTime(false);
+  return End.getProcessTime() - Start.getProcessTime();
+}
+
+/// Add NumFunctions functions of NumInstructions instructions of straight-line
+/// integer arithmetic, loads and stores, with constant operands, to M, as a
+/// frontend would emit them.
+void buildModule(Module &M, unsigned NumFunctions, unsigned NumInstructions);
+
+/// Each benchmark puts its options in its own category, prints its results
+/// to outs() and returns the exit code of the program.
+extern cl::OptionCategory DenseMapCategory;
+extern cl::OptionCategory DomTreeCategory;
+extern cl::OptionCategory InstrProfCategory;
+extern cl::OptionCategory IRArenaCategory;
+extern cl::OptionCategory LazyLoadCategory;
+extern cl::OptionCategory SampleProfCategory;
+
+int runDenseMap();
+int runDomTree();
+int runInstrProf();
+int runIRArena();
+int runLazyLoad();
+int runSampleProf();
+
+} // end namespace bench
+} // end namespace llvm
+
+#endif
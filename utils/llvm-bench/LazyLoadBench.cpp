@@ -0,0 +1,152 @@
+//===- LazyLoadBench - Benchmark lazy loading of bitcode ------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This benchmark times the sessions of a JIT that loads the same library
+// module over and over, and calls only a few of its functions each time. It
+// loads the module from bitcode in memory either eagerly, reading every
+// function body, or lazily, reading only the bodies of the functions the
+// session calls, as lli -jit-kind=orc-lazy does.
+//
+//===----------------------------------------------------------------------===//
+
+#include "LLVMBench.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include <memory>
+
+using namespace llvm;
+using namespace llvm::bench;
+
+cl::OptionCategory bench::LazyLoadCategory("lazyload options");
+
+static cl::opt<unsigned>
+    NumFunctions("lazyload-functions",
+                 cl::desc("Number of functions of the module"),
+                 cl::init(1000), cl::cat(LazyLoadCategory));
+
+static cl::opt<unsigned>
+    NumInstructions("lazyload-instructions",
+                    cl::desc("Number of instructions per function"),
+                    cl::init(200), cl::cat(LazyLoadCategory));
+
+static cl::opt<unsigned>
+    NumCalled("lazyload-called",
+              cl::desc("Number of functions each session calls"),
+              cl::init(10), cl::cat(LazyLoadCategory));
+
+static cl::opt<unsigned>
+    NumSessions("lazyload-sessions",
+                cl::desc("Number of sessions that load the module"),
+                cl::init(20), cl::cat(LazyLoadCategory));
+
+namespace {
+struct Result {
+  double Load, Destroy;
+  uint64_t Checksum;
+};
+} // end anonymous namespace
+
+// Count the instructions of the functions the session calls, which makes
+// sure that their bodies have been read.
+static uint64_t walkCalled(Module &M) {
+  uint64_t Sum = 0;
+  unsigned N = 0;
+  for (Function &F : M) {
+    if (N++ == NumCalled)
+      break;
+    for (BasicBlock &BB : F)
+      Sum += BB.size();
+  }
+  return Sum;
+}
+
+static bool runSession(StringRef Bitcode, bool Lazy, Result &R) {
+  std::unique_ptr<LLVMContext> C(new LLVMContext);
+  std::unique_ptr<Module> M;
+  R.Load += timeRun([&] {
+    // The module refers to the bitcode in place, as it would to a mapped
+    // file, instead of copying it.
+    std::unique_ptr<MemoryBuffer> Buffer =
+        MemoryBuffer::getMemBuffer(Bitcode, "bench", false);
+    ErrorOr<std::unique_ptr<Module>> MOrErr =
+        Lazy ? getLazyBitcodeModule(std::move(Buffer), *C, nullptr,
+                                    /*ShouldLazyLoadMetadata=*/true)
+             : parseBitcodeFile(Buffer->getMemBufferRef(), *C);
+    if (!MOrErr)
+      return;
+    M = std::move(MOrErr.get());
+    unsigned N = 0;
+    for (Function &F : *M) {
+      if (N++ == NumCalled)
+        break;
+      if (M->materialize(&F)) {
+        M.reset();
+        return;
+      }
+    }
+    R.Checksum += walkCalled(*M);
+  });
+  if (!M)
+    return false;
+  R.Destroy += timeRun([&] {
+    M.reset();
+    C.reset();
+  });
+  return true;
+}
+
+static bool run(StringRef Bitcode, bool Lazy, Result &R) {
+  R = Result();
+  for (unsigned I = 0; I != NumSessions; ++I)
+    if (!runSession(Bitcode, Lazy, R))
+      return false;
+  return true;
+}
+
+int bench::runLazyLoad() {
+  SmallString<0> Bitcode;
+  {
+    LLVMContext C;
+    Module M("bench", C);
+    buildModule(M, NumFunctions, NumInstructions);
+    raw_svector_ostream OS(Bitcode);
+    WriteBitcodeToFile(&M, OS);
+  }
+
+  Result Eager, Lazy;
+  if (!run(Bitcode, false, Eager) || !run(Bitcode, true, Lazy)) {
+    errs() << "llvm-bench: cannot read the module\n";
+    return 1;
+  }
+  if (Eager.Checksum != Lazy.Checksum) {
+    errs() << "llvm-bench: the two loads differ\n";
+    return 1;
+  }
+
+  outs() << format("module: %u functions of %u instructions, %.1f MB of "
+                   "bitcode\n",
+                   unsigned(NumFunctions), unsigned(NumInstructions),
+                   Bitcode.size() / 1048576.0);
+  outs() << format("%u sessions calling %u functions each\n",
+                   unsigned(NumSessions), unsigned(NumCalled));
+  outs() << "           load (ms/session)  destroy (ms/session)\n";
+  outs() << format("  eager  %19.2f %21.2f\n",
+                   Eager.Load * 1e3 / NumSessions,
+                   Eager.Destroy * 1e3 / NumSessions);
+  outs() << format("  lazy   %19.2f %21.2f\n",
+                   Lazy.Load * 1e3 / NumSessions,
+                   Lazy.Destroy * 1e3 / NumSessions);
+  return 0;
+}
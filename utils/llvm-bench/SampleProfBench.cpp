@@ -0,0 +1,138 @@
+//===- SampleProfBench - Benchmark the sample profile readers -------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This benchmark times what the sample profile loader costs each compile of a
+// program: reading the profile of the functions of one translation unit out
+// of the profile of the whole program. It writes a synthetic profile of the
+// requested size in the binary and indexed binary formats, and times reading
+// all of it and reading the profiles of a module's worth of functions.
+//
+//===----------------------------------------------------------------------===//
+
+#include "LLVMBench.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/ProfileData/SampleProfReader.h"
+#include "llvm/ProfileData/SampleProfWriter.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include <random>
+#include <vector>
+
+using namespace llvm;
+using namespace llvm::bench;
+using namespace sampleprof;
+
+cl::OptionCategory bench::SampleProfCategory("sampleprof options");
+
+static cl::opt<unsigned>
+    NumFunctions("sampleprof-functions",
+                 cl::desc("Number of functions of the profile"),
+                 cl::init(100000), cl::cat(SampleProfCategory));
+
+static cl::opt<unsigned>
+    NumLines("sampleprof-lines",
+             cl::desc("Number of sampled lines per function"), cl::init(20),
+             cl::cat(SampleProfCategory));
+
+static cl::opt<unsigned>
+    NumModuleFunctions("sampleprof-module-functions",
+                       cl::desc("Number of functions of the module compiled"),
+                       cl::init(500), cl::cat(SampleProfCategory));
+
+static std::string functionName(unsigned I) {
+  return "_Z8functioni" + std::to_string(I);
+}
+
+static void writeProfile(StringRef Path, SampleProfileFormat Format) {
+  auto WriterOrErr = SampleProfileWriter::create(Path, Format);
+  if (std::error_code EC = WriterOrErr.getError()) {
+    errs() << "llvm-bench: " << Path << ": " << EC.message() << "\n";
+    exit(1);
+  }
+  SampleProfileWriter &Writer = *WriterOrErr.get();
+  for (unsigned I = 0; I != NumFunctions; ++I) {
+    FunctionSamples Samples;
+    Samples.addTotalSamples(I * NumLines + 1);
+    Samples.addHeadSamples(I + 1);
+    for (unsigned L = 0; L != NumLines; ++L) {
+      Samples.addBodySamples(L, L % 3, I + L);
+      if (L % 4 == 0)
+        Samples.addCalledTargetSamples(L, L % 3,
+                                       functionName((I + L) % NumFunctions),
+                                       I + 1);
+    }
+    Writer.write(functionName(I), Samples);
+  }
+}
+
+static std::unique_ptr<SampleProfileReader> openProfile(StringRef Path,
+                                                        LLVMContext &C) {
+  auto ReaderOrErr = SampleProfileReader::create(Path, C);
+  if (std::error_code EC = ReaderOrErr.getError()) {
+    errs() << "llvm-bench: " << Path << ": " << EC.message() << "\n";
+    exit(1);
+  }
+  return std::move(ReaderOrErr.get());
+}
+
+int bench::runSampleProf() {
+
+  SmallString<128> BinaryPath, IndexedPath;
+  if (sys::fs::createTemporaryFile("sampleprof-bench", "binprof",
+                                   BinaryPath) ||
+      sys::fs::createTemporaryFile("sampleprof-bench", "idxprof",
+                                   IndexedPath)) {
+    errs() << "llvm-bench: cannot create temporary files\n";
+    return 1;
+  }
+  writeProfile(BinaryPath, SPF_Binary);
+  writeProfile(IndexedPath, SPF_IndexedBinary);
+
+  // The functions of the module, picked at random in the program.
+  std::mt19937 Rand(0);
+  std::vector<std::string> ModuleFunctions;
+  for (unsigned I = 0; I != NumModuleFunctions; ++I)
+    ModuleFunctions.push_back(functionName(Rand() % NumFunctions));
+
+  LLVMContext Context;
+  double BinaryTime = timeRun([&] {
+    auto Reader = openProfile(BinaryPath, Context);
+    Reader->read();
+  });
+  double IndexedTime = timeRun([&] {
+    auto Reader = openProfile(IndexedPath, Context);
+    Reader->read();
+  });
+  double ModuleTime = timeRun([&] {
+    auto Reader = openProfile(IndexedPath, Context);
+    auto &Indexed = static_cast<SampleProfileReaderIndexed &>(*Reader);
+    for (const std::string &Name : ModuleFunctions)
+      Indexed.readFunctionProfile(Name);
+  });
+
+  uint64_t BinarySize = 0, IndexedSize = 0;
+  sys::fs::file_size(BinaryPath, BinarySize);
+  sys::fs::file_size(IndexedPath, IndexedSize);
+  sys::fs::remove(BinaryPath);
+  sys::fs::remove(IndexedPath);
+
+  outs() << format("profile: %u functions, %llu bytes binary, "
+                   "%llu bytes indexed\n",
+                   unsigned(NumFunctions), (unsigned long long)BinarySize,
+                   (unsigned long long)IndexedSize);
+  outs() << format("  read all (binary)           %10.2f ms\n",
+                   BinaryTime * 1e3);
+  outs() << format("  read all (indexed)          %10.2f ms\n",
+                   IndexedTime * 1e3);
+  outs() << format("  read %5u functions (indexed) %8.2f ms\n",
+                   unsigned(NumModuleFunctions), ModuleTime * 1e3);
+  return 0;
+}
@@ -0,0 +1,114 @@
+//===- llvm-bench - Benchmarks of LLVM data structures --------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This program runs one of the benchmarks of LLVM data structures, chosen by
+// its first argument. The remaining arguments are the options of the
+// benchmark, which all start with its name.
+//
+//===----------------------------------------------------------------------===//
+
+#include "LLVMBench.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/PrettyStackTrace.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <iterator>
+#include <string>
+
+using namespace llvm;
+using namespace llvm::bench;
+
+namespace {
+struct Benchmark {
+  const char *Name;
+  const char *Description;
+  cl::OptionCategory *Category;
+  int (*Run)();
+};
+} // end anonymous namespace
+
+void bench::buildModule(Module &M, unsigned NumFunctions,
+                        unsigned NumInstructions) {
+  LLVMContext &C = M.getContext();
+  Type *I32 = Type::getInt32Ty(C);
+  Type *Params[] = {I32, I32, I32->getPointerTo()};
+  FunctionType *FTy = FunctionType::get(I32, Params, false);
+  for (unsigned F = 0; F != NumFunctions; ++F) {
+    Function *Fn = Function::Create(FTy, GlobalValue::ExternalLinkage,
+                                    "f" + Twine(F), &M);
+    IRBuilder<> B(BasicBlock::Create(C, "entry", Fn));
+    Function::arg_iterator AI = Fn->arg_begin();
+    Value *X = AI++;
+    Value *Y = AI++;
+    Value *P = AI;
+    for (unsigned I = 0; I != NumInstructions; ++I) {
+      switch (I % 5) {
+      case 0:
+        X = B.CreateAdd(X, Y);
+        break;
+      case 1:
+        Y = B.CreateMul(Y, ConstantInt::get(I32, I));
+        break;
+      case 2:
+        X = B.CreateXor(X, ConstantInt::get(I32, I % 64));
+        break;
+      case 3:
+        B.CreateStore(X, B.CreateConstGEP1_32(P, I % 16));
+        break;
+      case 4:
+        Y = B.CreateLoad(B.CreateConstGEP1_32(P, I % 16));
+        break;
+      }
+    }
+    B.CreateRet(B.CreateAdd(X, Y));
+  }
+}
+
+static const Benchmark Benchmarks[] = {
+    {"densemap", "DenseMap against FlatDenseMap", &DenseMapCategory,
+     runDenseMap},
+    {"domtree", "Incremental dominator tree updates", &DomTreeCategory,
+     runDomTree},
+    {"instrprof", "Indexed profile reader", &InstrProfCategory, runInstrProf},
+    {"irarena", "IR arena allocation", &IRArenaCategory, runIRArena},
+    {"lazyload", "Lazy bitcode loading", &LazyLoadCategory, runLazyLoad},
+    {"sampleprof", "Sample profile reader", &SampleProfCategory,
+     runSampleProf},
+};
+
+int main(int argc, char **argv) {
+  sys::PrintStackTraceOnErrorSignal();
+  PrettyStackTraceProgram X(argc, argv);
+  llvm_shutdown_obj Y;
+
+  StringRef Name = argc > 1 ? argv[1] : "";
+  const Benchmark *B = std::find_if(
+      std::begin(Benchmarks), std::end(Benchmarks),
+      [&](const Benchmark &B) { return Name == B.Name; });
+  if (B == std::end(Benchmarks)) {
+    errs() << "usage: llvm-bench <benchmark> [options]\n\nbenchmarks:\n";
+    for (const Benchmark &B : Benchmarks)
+      errs() << format("  %-12s %s\n", B.Name, B.Description);
+    return 1;
+  }
+
+  // Parse the remaining arguments as if the benchmark were the program, so
+  // that -help shows only its options.
+  cl::HideUnrelatedOptions(*B->Category);
+  std::string Overview = std::string(B->Description) + " benchmark\n";
+  cl::ParseCommandLineOptions(argc - 1, argv + 1, Overview.c_str());
+  return B->Run();
+}